@@ -1,6 +1,6 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import i2c, sensor
+from esphome.components import i2c, i2c_arbiter, sensor
 from esphome.const import (
     CONF_ID,
     CONF_ADDRESS,
@@ -13,8 +13,8 @@ from esphome.const import (
 )
 from esphome import pins
 
-DEPENDENCIES = ["i2c"]
-AUTO_LOAD = ["sensor"]
+DEPENDENCIES = ["i2c", "i2c_arbiter"]
+AUTO_LOAD = ["sensor", "perf_stats"]
 MULTI_CONF = False
 
 CONF_AXP2101_ID = "axp2101_id"
@@ -62,6 +62,7 @@ CONFIG_SCHEMA = (
     )
     .extend(cv.COMPONENT_SCHEMA)
     .extend(i2c.i2c_device_schema(0x34))
+    .extend(i2c_arbiter.arbiter_client_schema("background"))
 )
 
 # Sensor platform schema
@@ -94,6 +95,7 @@ async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     await i2c.register_i2c_device(var, config)
+    await i2c_arbiter.register_arbiter_client(var, config)
 
     if CONF_IRQ_PIN in config:
         irq_pin = await cg.gpio_pin_expression(config[CONF_IRQ_PIN])
@@ -38,6 +38,7 @@ void AXP2101Component::setup() {
 
 void AXP2101Component::loop() {
   if (!this->initialized_) return;
+  perf_stats::ScopedTimer timer(this->loop_time_);
 
   // Update sensors every 5 seconds
   uint32_t now = millis();
@@ -63,10 +64,14 @@ void AXP2101Component::dump_config() {
 }
 
 bool AXP2101Component::write_register_(uint8_t reg, uint8_t value) {
+  i2c_arbiter::BusTransaction transaction(this->bus_client_, 2);
+  perf_stats::ScopedTimer timer(this->i2c_time_);
   return this->write_byte(reg, value);
 }
 
 uint8_t AXP2101Component::read_register_(uint8_t reg) {
+  i2c_arbiter::BusTransaction transaction(this->bus_client_, 2);
+  perf_stats::ScopedTimer timer(this->i2c_time_);
   uint8_t value = 0;
   this->read_byte(reg, &value);
   return value;
@@ -163,6 +168,7 @@ void AXP2101Component::clear_irq() {
 }
 
 void AXP2101Component::update_sensors_() {
+  perf_stats::TraceScope trace("axp2101.update");
   if (this->battery_voltage_sensor_ != nullptr) {
     float voltage = this->get_battery_voltage();
     this->battery_voltage_sensor_->publish_state(voltage);
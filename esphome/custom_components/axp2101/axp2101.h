@@ -4,6 +4,9 @@
 #include "esphome/core/hal.h"
 #include "esphome/components/i2c/i2c.h"
 #include "esphome/components/sensor/sensor.h"
+#include "esphome/components/perf_stats/event_trace.h"
+#include "esphome/components/perf_stats/timing_histogram.h"
+#include "esphome/components/i2c_arbiter/i2c_arbiter.h"
 
 namespace esphome {
 namespace axp2101 {
@@ -78,6 +81,11 @@ class AXP2101Component : public Component, public i2c::I2CDevice {
   void set_battery_voltage_sensor(sensor::Sensor *sensor) { this->battery_voltage_sensor_ = sensor; }
   void set_battery_level_sensor(sensor::Sensor *sensor) { this->battery_level_sensor_ = sensor; }
   void set_vbus_voltage_sensor(sensor::Sensor *sensor) { this->vbus_voltage_sensor_ = sensor; }
+  void set_bus_arbiter(i2c_arbiter::I2CArbiter *arbiter, i2c_arbiter::BusPriority priority, bool fast_mode_plus) {
+    this->bus_client_.set_priority(priority);
+    this->bus_client_.set_fast_mode_plus(fast_mode_plus);
+    arbiter->add_client(&this->bus_client_, "axp2101");
+  }
 
   // Get battery voltage in V
   float get_battery_voltage();
@@ -115,6 +123,11 @@ class AXP2101Component : public Component, public i2c::I2CDevice {
 
   uint32_t last_sensor_update_{0};
   bool initialized_{false};
+
+  // Execution time statistics
+  perf_stats::TimingHistogram loop_time_{"axp2101.loop"};
+  perf_stats::TimingHistogram i2c_time_{"axp2101.i2c"};
+  i2c_arbiter::BusClient bus_client_{"axp2101.i2c_wait", i2c_arbiter::PRIORITY_BACKGROUND};
 };
 
 }  // namespace axp2101
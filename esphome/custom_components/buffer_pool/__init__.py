@@ -0,0 +1,23 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.const import CONF_ID
+
+CODEOWNERS = ["@medallion"]
+AUTO_LOAD = ["sensor"]
+MULTI_CONF = False
+
+CONF_BUFFER_POOL_ID = "buffer_pool_id"
+
+buffer_pool_ns = cg.esphome_ns.namespace("buffer_pool")
+BufferPoolComponent = buffer_pool_ns.class_("BufferPoolComponent", cg.PollingComponent)
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(BufferPoolComponent),
+    }
+).extend(cv.polling_component_schema("60s"))
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
@@ -0,0 +1,76 @@
+#include "block_pool.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <cstring>
+
+namespace esphome {
+namespace buffer_pool {
+
+static const char *const TAG = "buffer_pool";
+
+std::vector<BlockPool *> &global_pools() {
+  static std::vector<BlockPool *> pools;
+  return pools;
+}
+
+BlockPool *find_pool(const char *name) {
+  for (auto *pool : global_pools()) {
+    if (strcmp(pool->get_name(), name) == 0)
+      return pool;
+  }
+  return nullptr;
+}
+
+BlockPool::BlockPool(const char *name, MemoryRegion region) : name_(name), region_(region) {
+  global_pools().push_back(this);
+}
+
+bool BlockPool::reserve(size_t block_size, uint16_t block_count) {
+  if (this->data_ != nullptr) return false;
+
+  size_t size = block_size * block_count;
+  uint8_t *data;
+  if (this->region_ == REGION_PSRAM) {
+    ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+    data = allocator.allocate(size);
+  } else {
+    // All of the S3's internal data RAM is DMA capable
+    RAMAllocator<uint8_t> allocator(RAMAllocator<uint8_t>::ALLOC_INTERNAL | RAMAllocator<uint8_t>::ALLOW_FAILURE);
+    data = allocator.allocate(size);
+  }
+  this->free_ = xQueueCreate(block_count, sizeof(uint8_t *));
+  if (data == nullptr || this->free_ == nullptr) {
+    ESP_LOGE(TAG, "%s: failed to allocate %u blocks of %u bytes", this->name_, (unsigned) block_count,
+             (unsigned) block_size);
+    return false;
+  }
+
+  this->data_ = data;
+  this->block_size_ = block_size;
+  this->block_count_ = block_count;
+  for (uint16_t i = 0; i < block_count; i++) {
+    uint8_t *block = data + i * block_size;
+    xQueueSend(this->free_, &block, 0);
+  }
+  ESP_LOGD(TAG, "%s: %u blocks of %u bytes", this->name_, (unsigned) block_count, (unsigned) block_size);
+  return true;
+}
+
+uint8_t *BlockPool::acquire() {
+  uint8_t *block;
+  if (this->free_ == nullptr || xQueueReceive(this->free_, &block, 0) != pdTRUE) {
+    this->failures_++;
+    return nullptr;
+  }
+  uint16_t used = ++this->in_use_;
+  if (used > this->high_water_.load()) this->high_water_.store(used);
+  return block;
+}
+
+void BlockPool::release(uint8_t *block) {
+  this->in_use_--;
+  xQueueSend(this->free_, &block, 0);
+}
+
+}  // namespace buffer_pool
+}  // namespace esphome
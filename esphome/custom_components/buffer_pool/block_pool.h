@@ -0,0 +1,83 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace buffer_pool {
+
+enum MemoryRegion : uint8_t {
+  // Internal SRAM, reachable by every DMA engine (I2S, SPI, QSPI)
+  REGION_INTERNAL_DMA,
+  // PSRAM, for bulk buffers only the CPU touches
+  REGION_PSRAM,
+};
+
+// Fixed-size blocks carved from one allocation made at setup. acquire() and
+// release() never touch the heap and may be called from any task, so hot
+// paths can take buffers without fragmenting internal SRAM.
+class BlockPool {
+ public:
+  // Registers the pool under `name` (must be a string literal)
+  BlockPool(const char *name, MemoryRegion region);
+
+  // Allocate the blocks; call once, from setup()
+  bool reserve(size_t block_size, uint16_t block_count);
+
+  // A free block, or nullptr (counted as a failure) if all are in use
+  uint8_t *acquire();
+  void release(uint8_t *block);
+  // Position of `block` in the pool, 0..block_count-1
+  uint16_t index_of(const uint8_t *block) const { return (block - this->data_) / this->block_size_; }
+
+  const char *get_name() const { return this->name_; }
+  MemoryRegion get_region() const { return this->region_; }
+  bool is_reserved() const { return this->data_ != nullptr; }
+  size_t get_block_size() const { return this->block_size_; }
+  uint16_t get_block_count() const { return this->block_count_; }
+  uint16_t get_in_use() const { return this->in_use_.load(); }
+  // Most blocks in use at once since boot
+  uint16_t get_high_water() const { return this->high_water_.load(); }
+  uint32_t get_failures() const { return this->failures_.load(); }
+
+ protected:
+  const char *name_;
+  MemoryRegion region_;
+  uint8_t *data_{nullptr};
+  size_t block_size_{0};
+  uint16_t block_count_{0};
+  QueueHandle_t free_{nullptr};
+  std::atomic<uint16_t> in_use_{0};
+  std::atomic<uint16_t> high_water_{0};
+  std::atomic<uint32_t> failures_{0};
+};
+
+// A block held for the lifetime of the scope
+class ScopedBlock {
+ public:
+  explicit ScopedBlock(BlockPool &pool) : pool_(pool), data_(pool.acquire()) {}
+  ~ScopedBlock() {
+    if (this->data_ != nullptr) this->pool_.release(this->data_);
+  }
+  ScopedBlock(const ScopedBlock &) = delete;
+  ScopedBlock &operator=(const ScopedBlock &) = delete;
+
+  explicit operator bool() const { return this->data_ != nullptr; }
+  uint8_t *data() const { return this->data_; }
+  size_t size() const { return this->pool_.get_block_size(); }
+
+ protected:
+  BlockPool &pool_;
+  uint8_t *data_;
+};
+
+// All pools created so far, in construction order
+std::vector<BlockPool *> &global_pools();
+BlockPool *find_pool(const char *name);
+
+}  // namespace buffer_pool
+}  // namespace esphome
@@ -0,0 +1,60 @@
+#include "buffer_pool.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace buffer_pool {
+
+static const char *const TAG = "buffer_pool";
+
+void BufferPoolComponent::setup() {
+  // Pools are registered by their owners' constructors, so all of them
+  // exist by the time we get here
+  for (auto &binding : this->sensors_) {
+    binding.pool = find_pool(binding.name);
+    if (binding.pool == nullptr) {
+      ESP_LOGW(TAG, "Unknown pool '%s'", binding.name);
+    }
+  }
+}
+
+void BufferPoolComponent::update() {
+  for (auto &binding : this->sensors_) {
+    if (binding.pool == nullptr || !binding.pool->is_reserved()) continue;
+
+    uint32_t value = 0;
+    switch (binding.statistic) {
+      case STATISTIC_IN_USE:
+        value = binding.pool->get_in_use();
+        break;
+      case STATISTIC_HIGH_WATER:
+        value = binding.pool->get_high_water();
+        break;
+      case STATISTIC_FAILURES:
+        value = binding.pool->get_failures();
+        break;
+    }
+    binding.sensor->publish_state(value);
+  }
+}
+
+void BufferPoolComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "Buffer Pools:");
+  LOG_UPDATE_INTERVAL(this);
+  for (auto *pool : global_pools()) {
+    if (!pool->is_reserved()) {
+      ESP_LOGCONFIG(TAG, "  %s: not allocated", pool->get_name());
+      continue;
+    }
+    ESP_LOGCONFIG(TAG, "  %s: %u x %u bytes in %s, high water %u, failures %u", pool->get_name(),
+                  (unsigned) pool->get_block_count(), (unsigned) pool->get_block_size(),
+                  pool->get_region() == REGION_PSRAM ? "PSRAM" : "internal RAM", (unsigned) pool->get_high_water(),
+                  (unsigned) pool->get_failures());
+  }
+}
+
+void BufferPoolComponent::add_sensor(const char *pool, PoolStatistic statistic, sensor::Sensor *sensor) {
+  this->sensors_.push_back({pool, statistic, sensor, nullptr});
+}
+
+}  // namespace buffer_pool
+}  // namespace esphome
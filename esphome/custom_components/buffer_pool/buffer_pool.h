@@ -0,0 +1,39 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+#include "block_pool.h"
+#include <vector>
+
+namespace esphome {
+namespace buffer_pool {
+
+enum PoolStatistic : uint8_t {
+  STATISTIC_IN_USE,
+  STATISTIC_HIGH_WATER,
+  STATISTIC_FAILURES,
+};
+
+class BufferPoolComponent : public PollingComponent {
+ public:
+  void setup() override;
+  void update() override;
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::LATE; }
+
+  // Publish a statistic of the named pool to a sensor every update
+  void add_sensor(const char *pool, PoolStatistic statistic, sensor::Sensor *sensor);
+
+ protected:
+  struct SensorBinding {
+    const char *name;
+    PoolStatistic statistic;
+    sensor::Sensor *sensor;
+    BlockPool *pool;
+  };
+
+  std::vector<SensorBinding> sensors_;
+};
+
+}  // namespace buffer_pool
+}  // namespace esphome
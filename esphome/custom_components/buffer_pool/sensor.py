@@ -0,0 +1,74 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+)
+from . import buffer_pool_ns, BufferPoolComponent, CONF_BUFFER_POOL_ID
+
+DEPENDENCIES = ["buffer_pool"]
+
+CONF_POOL = "pool"
+CONF_IN_USE = "in_use"
+CONF_HIGH_WATER = "high_water"
+CONF_FAILURES = "failures"
+
+UNIT_BLOCKS = "blocks"
+
+PoolStatistic = buffer_pool_ns.enum("PoolStatistic")
+STATISTICS = {
+    CONF_IN_USE: PoolStatistic.STATISTIC_IN_USE,
+    CONF_HIGH_WATER: PoolStatistic.STATISTIC_HIGH_WATER,
+    CONF_FAILURES: PoolStatistic.STATISTIC_FAILURES,
+}
+
+# Pool names registered by the custom components
+POOLS = [
+    "audio_bus",
+    "wide_capture",
+    "resample",
+    "rtp_resample",
+    "upload_chunk",
+    "upload_io",
+    "download",
+    "trace",
+    "deferred_log",
+    "frame_buffer",
+]
+
+_BLOCKS_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_BLOCKS,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    icon="mdi:memory",
+)
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(CONF_BUFFER_POOL_ID): cv.use_id(BufferPoolComponent),
+            cv.Required(CONF_POOL): cv.one_of(*POOLS, lower=True),
+            cv.Optional(CONF_IN_USE): _BLOCKS_SENSOR_SCHEMA,
+            cv.Optional(CONF_HIGH_WATER): _BLOCKS_SENSOR_SCHEMA,
+            cv.Optional(CONF_FAILURES): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                icon="mdi:memory",
+            ),
+        }
+    ),
+    cv.has_at_least_one_key(*STATISTICS),
+)
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_BUFFER_POOL_ID])
+
+    for key, statistic in STATISTICS.items():
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(parent.add_sensor(config[CONF_POOL], statistic, sens))
@@ -11,12 +11,16 @@ from esphome.const import (
 )
 
 CODEOWNERS = ["@medallion"]
+AUTO_LOAD = ["sensor", "perf_stats", "buffer_pool"]
 
 CONF_SCLK_PIN = "sclk_pin"
 CONF_DATA0_PIN = "data0_pin"
 CONF_DATA1_PIN = "data1_pin"
 CONF_DATA2_PIN = "data2_pin"
 CONF_DATA3_PIN = "data3_pin"
+CONF_TE_PIN = "te_pin"
+CONF_MAX_FRAME_RATE = "max_frame_rate"
+CONF_CO5300_QSPI_ID = "co5300_qspi_id"
 
 co5300_qspi_ns = cg.esphome_ns.namespace("co5300_qspi")
 CO5300QSPIComponent = co5300_qspi_ns.class_("CO5300QSPIComponent", cg.Component)
@@ -34,6 +38,9 @@ CONFIG_SCHEMA = cv.Schema(
         cv.Optional(CONF_WIDTH, default=466): cv.int_range(min=1, max=1024),
         cv.Optional(CONF_HEIGHT, default=466): cv.int_range(min=1, max=1024),
         cv.Optional(CONF_BRIGHTNESS, default=255): cv.int_range(min=0, max=255),
+        # Tearing-effect output: frames start on its rising edge
+        cv.Optional(CONF_TE_PIN): pins.internal_gpio_input_pin_schema,
+        cv.Optional(CONF_MAX_FRAME_RATE, default=30): cv.int_range(min=1, max=60),
     }
 ).extend(cv.COMPONENT_SCHEMA)
 
@@ -66,6 +73,11 @@ async def to_code(config):
     cg.add(var.set_width(config[CONF_WIDTH]))
     cg.add(var.set_height(config[CONF_HEIGHT]))
     cg.add(var.set_brightness(config[CONF_BRIGHTNESS]))
+    cg.add(var.set_max_frame_rate(config[CONF_MAX_FRAME_RATE]))
+
+    if CONF_TE_PIN in config:
+        te_pin = await cg.gpio_pin_expression(config[CONF_TE_PIN])
+        cg.add(var.set_te_pin(te_pin))
 
     # Add required Arduino GFX library includes
     cg.add_library("moononournation/GFX Library for Arduino", "1.4.9")
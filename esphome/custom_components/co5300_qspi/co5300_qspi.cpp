@@ -1,15 +1,37 @@
 #include "co5300_qspi.h"
 #include "esphome/core/log.h"
 #include <Arduino_GFX_Library.h>
+#include <algorithm>
+#include <new>
 
 namespace esphome {
 namespace co5300_qspi {
 
 static const char *const TAG = "co5300_qspi";
 
-// Store display instances (Arduino GFX doesn't use new easily with GPIOPin)
+// CO5300 commands
+static const uint8_t CMD_TEARING_EFFECT_ON = 0x35;
+// TE pulses during vertical blanking only
+static const uint8_t TEARING_VBLANK = 0x00;
+
+// Arduino_Canvas allocates its own frame buffer in begin() unless it already
+// has one; this one draws into a buffer_pool block
+class PooledCanvas : public Arduino_Canvas {
+ public:
+  PooledCanvas(int16_t w, int16_t h, Arduino_G *output, uint16_t *frame_buffer) : Arduino_Canvas(w, h, output) {
+    this->_framebuffer = frame_buffer;
+  }
+};
+
+// Store display instances (Arduino GFX doesn't use new easily with GPIOPin).
+// Built in static storage once the pins are known, so the display takes no
+// heap next to WiFi and TLS.
+alignas(Arduino_ESP32QSPI) static uint8_t g_bus_storage[sizeof(Arduino_ESP32QSPI)];
+alignas(Arduino_CO5300) static uint8_t g_gfx_storage[sizeof(Arduino_CO5300)];
 static Arduino_DataBus *g_bus = nullptr;
 static Arduino_GFX *g_gfx = nullptr;
+alignas(PooledCanvas) static uint8_t g_canvas_storage[sizeof(PooledCanvas)];
+static PooledCanvas *g_canvas = nullptr;
 
 void CO5300QSPIComponent::setup() {
   ESP_LOGI(TAG, "Setting up CO5300 QSPI AMOLED display...");
@@ -30,11 +52,11 @@ void CO5300QSPIComponent::setup() {
   this->reset_display_();
 
   // Create QSPI bus
-  g_bus = new Arduino_ESP32QSPI(cs, sclk, d0, d1, d2, d3);
+  g_bus = new (g_bus_storage) Arduino_ESP32QSPI(cs, sclk, d0, d1, d2, d3);
   this->bus_ = g_bus;
 
   // Create CO5300 display driver
-  g_gfx = new Arduino_CO5300(
+  g_gfx = new (g_gfx_storage) Arduino_CO5300(
       g_bus, rst, 0 /* rotation */, false /* IPS */,
       this->width_, this->height_,
       6 /* col_offset1 */, 0 /* row_offset1 */,
@@ -54,34 +76,182 @@ void CO5300QSPIComponent::setup() {
   // Set brightness
   ((Arduino_CO5300 *)g_gfx)->setBrightness(this->brightness_);
 
-  // Draw startup test pattern
+  if (!this->setup_frame_buffer_()) {
+    ESP_LOGW(TAG, "No frame buffer, drawing straight to the panel");
+  } else if (this->te_pin_ != nullptr) {
+    g_bus->beginWrite();
+    g_bus->writeC8D8(CMD_TEARING_EFFECT_ON, TEARING_VBLANK);
+    g_bus->endWrite();
+    this->te_pin_->setup();
+    this->te_pin_->attach_interrupt(CO5300QSPIComponent::te_isr, this, gpio::INTERRUPT_RISING_EDGE);
+  }
+
+  this->initialized_ = true;
+  this->draw_test_pattern_();
+  ESP_LOGI(TAG, "CO5300 QSPI display initialized (%dx%d)", this->width_, this->height_);
+}
+
+bool CO5300QSPIComponent::setup_frame_buffer_() {
+  size_t size = (size_t) this->width_ * this->height_ * sizeof(uint16_t);
+  if (!this->frame_buffer_pool_.reserve(size, 1)) return false;
+  auto *frame_buffer = reinterpret_cast<uint16_t *>(this->frame_buffer_pool_.acquire());
+  g_canvas = new (g_canvas_storage) PooledCanvas(this->width_, this->height_, g_gfx, frame_buffer);
+  g_canvas->begin(GFX_SKIP_OUTPUT_BEGIN);
+  g_canvas->fillScreen(BLACK);
+  if (xTaskCreatePinnedToCore(CO5300QSPIComponent::frame_task, "co5300_frame", FRAME_TASK_STACK_SIZE, this,
+                              FRAME_TASK_PRIORITY, &this->frame_task_handle_, 0) != pdPASS) {
+    this->frame_buffer_pool_.release(reinterpret_cast<uint8_t *>(frame_buffer));
+    g_canvas = nullptr;
+    return false;
+  }
+  this->canvas_ = g_canvas;
+  return true;
+}
+
+void CO5300QSPIComponent::draw_test_pattern_() {
+  // With a frame buffer the pattern goes out as the first frame
+  Arduino_GFX *gfx = g_canvas != nullptr ? static_cast<Arduino_GFX *>(g_canvas) : g_gfx;
   int16_t third = this->height_ / 3;
-  g_gfx->fillRect(0, 0, this->width_, third, RED);
-  g_gfx->fillRect(0, third, this->width_, third, GREEN);
-  g_gfx->fillRect(0, 2 * third, this->width_, third, BLUE);
+  gfx->fillRect(0, 0, this->width_, third, RED);
+  gfx->fillRect(0, third, this->width_, third, GREEN);
+  gfx->fillRect(0, 2 * third, this->width_, third, BLUE);
 
   // Draw centered text
-  g_gfx->setTextColor(WHITE);
-  g_gfx->setTextSize(2);
-  g_gfx->setTextWrap(false);
+  gfx->setTextColor(WHITE);
+  gfx->setTextSize(2);
+  gfx->setTextWrap(false);
   int16_t cx = this->width_ / 2;
   int16_t cy = this->height_ / 2;
-  g_gfx->fillRect(cx - 120, cy - 25, 240, 50, BLACK);
-  g_gfx->setCursor(cx - 100, cy - 10);
-  g_gfx->println("ESPHome Medallion");
-
-  this->initialized_ = true;
-  ESP_LOGI(TAG, "CO5300 QSPI display initialized (%dx%d)", this->width_, this->height_);
+  gfx->fillRect(cx - 120, cy - 25, 240, 50, BLACK);
+  gfx->setCursor(cx - 100, cy - 10);
+  gfx->println("ESPHome Medallion");
+  this->mark_dirty(0, this->height_);
 }
 
 void CO5300QSPIComponent::loop() {
-  // Display doesn't need continuous updates
+  // Drawing needs no loop; only the frame statistics are published here
+  if (this->canvas_ == nullptr) {
+    this->disable_loop();
+    return;
+  }
+  uint32_t now = millis();
+  if (now - this->last_stats_publish_ >= STATS_INTERVAL_MS) {
+    this->publish_stats_();
+    this->last_stats_publish_ = now;
+  }
+}
+
+void IRAM_ATTR CO5300QSPIComponent::te_isr(CO5300QSPIComponent *self) {
+  uint32_t now = micros();
+  if (self->frame_task_handle_ == nullptr) return;
+  if (self->te_time_ != 0) self->te_period_ = now - self->te_time_;
+  self->te_time_ = now;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(self->frame_task_handle_, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void CO5300QSPIComponent::frame_task(void *param) {
+  auto *self = static_cast<CO5300QSPIComponent *>(param);
+  const TickType_t frame_ticks = std::max<TickType_t>(pdMS_TO_TICKS(1000 / self->max_frame_rate_), 1);
+  while (true) {
+    bool te_edge = false;
+    if (self->te_pin_ != nullptr) {
+      // TE edges wake the task; while they are missing the timeout paces
+      // the frames instead
+      TickType_t timeout = self->te_active_ ? pdMS_TO_TICKS(TE_TIMEOUT_MS) : frame_ticks;
+      te_edge = ulTaskNotifyTake(pdTRUE, timeout) > 0;
+      if (te_edge != self->te_active_) {
+        self->te_active_ = te_edge;
+        if (!te_edge) ESP_LOGW(TAG, "No TE pulses for %u ms, pacing frames by timer", (unsigned) TE_TIMEOUT_MS);
+      }
+    } else {
+      vTaskDelay(frame_ticks);
+    }
+    int16_t brightness = self->pending_brightness_.exchange(-1);
+    if (brightness >= 0) ((Arduino_CO5300 *) g_gfx)->setBrightness(brightness);
+    self->send_frame_(te_edge);
+  }
+}
+
+void CO5300QSPIComponent::send_frame_(bool te_edge) {
+  uint32_t start = micros();
+  uint32_t edge = this->te_time_;
+  uint32_t period = te_edge ? this->te_period_ : 0;
+  // The frame rate cap, with slack for jitter: half a TE period, so 30 fps on
+  // a 60 Hz panel takes every other edge, or one tick on the timer
+  uint32_t slack = te_edge ? period / 2 : portTICK_PERIOD_MS * 1000;
+  uint32_t min_interval = 1000000 / this->max_frame_rate_;
+  if (start - this->last_frame_start_ + slack < min_interval) return;
+
+  int16_t top, bottom;
+  portENTER_CRITICAL(&this->dirty_lock_);
+  top = this->dirty_top_;
+  bottom = this->dirty_bottom_;
+  this->dirty_top_ = 0;
+  this->dirty_bottom_ = -1;
+  portEXIT_CRITICAL(&this->dirty_lock_);
+  // Nothing changed: skip the frame
+  if (top > bottom) return;
+
+  // The CO5300 takes windows that start on an even row and span an even
+  // number of rows
+  top &= ~1;
+  bottom |= 1;
+  if (bottom >= this->height_) bottom = this->height_ - 1;
+  this->last_frame_start_ = start;
+  {
+    perf_stats::TraceScope trace("co5300_qspi.frame");
+    uint16_t *frame_buffer = g_canvas->getFramebuffer();
+    g_gfx->draw16bitRGBBitmap(0, top, frame_buffer + (size_t) top * this->width_, this->width_, bottom - top + 1);
+  }
+  uint32_t end = micros();
+  uint32_t elapsed = end - start;
+  this->flush_time_.record(elapsed);
+  this->frames_++;
+  this->window_frames_++;
+  this->window_frame_us_ += elapsed;
+
+  // Sent in time if done before the scan-out reaches the next frame
+  bool missed = te_edge && period > 0 ? end - edge > period : elapsed > min_interval;
+  if (missed) this->missed_frames_++;
+}
+
+void CO5300QSPIComponent::publish_stats_() {
+  uint32_t frames = this->window_frames_.exchange(0);
+  uint32_t frame_us = this->window_frame_us_.exchange(0);
+  if (this->frame_time_sensor_ != nullptr && frames > 0) {
+    this->frame_time_sensor_->publish_state(frame_us / 1000.0f / frames);
+  }
+  if (this->frame_rate_sensor_ != nullptr) {
+    this->frame_rate_sensor_->publish_state(frames * 1000.0f / STATS_INTERVAL_MS);
+  }
+  if (this->missed_frames_sensor_ != nullptr) this->missed_frames_sensor_->publish_state(this->missed_frames_.load());
+}
+
+void CO5300QSPIComponent::mark_dirty(int16_t y, int16_t h) {
+  if (h <= 0) return;
+  int16_t top = std::max<int16_t>(y, 0);
+  int16_t bottom = (int16_t) std::min<int32_t>((int32_t) y + h - 1, this->height_ - 1);
+  if (top > bottom) return;
+  portENTER_CRITICAL(&this->dirty_lock_);
+  if (this->dirty_top_ > this->dirty_bottom_) {
+    this->dirty_top_ = top;
+    this->dirty_bottom_ = bottom;
+  } else {
+    this->dirty_top_ = std::min(this->dirty_top_, top);
+    this->dirty_bottom_ = std::max(this->dirty_bottom_, bottom);
+  }
+  portEXIT_CRITICAL(&this->dirty_lock_);
 }
 
 void CO5300QSPIComponent::dump_config() {
   ESP_LOGCONFIG(TAG, "CO5300 QSPI AMOLED Display:");
   ESP_LOGCONFIG(TAG, "  Resolution: %dx%d", this->width_, this->height_);
   ESP_LOGCONFIG(TAG, "  Brightness: %d", this->brightness_);
+  ESP_LOGCONFIG(TAG, "  Frame Buffer: %s", this->canvas_ != nullptr ? "PSRAM" : "none");
+  ESP_LOGCONFIG(TAG, "  Max Frame Rate: %u fps", this->max_frame_rate_);
+  LOG_PIN("  TE Pin: ", this->te_pin_);
   LOG_PIN("  CS Pin: ", this->cs_pin_);
   LOG_PIN("  SCLK Pin: ", this->sclk_pin_);
   LOG_PIN("  Reset Pin: ", this->reset_pin_);
@@ -101,24 +271,48 @@ void CO5300QSPIComponent::reset_display_() {
 
 void CO5300QSPIComponent::fill_screen(uint16_t color) {
   if (!this->initialized_ || g_gfx == nullptr) return;
+  if (g_canvas != nullptr) {
+    g_canvas->fillScreen(color);
+    this->mark_dirty(0, this->height_);
+    return;
+  }
+  perf_stats::ScopedTimer timer(this->flush_time_);
+  perf_stats::TraceScope trace("co5300_qspi.fill_screen");
   g_gfx->fillScreen(color);
 }
 
 void CO5300QSPIComponent::fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
   if (!this->initialized_ || g_gfx == nullptr) return;
+  if (g_canvas != nullptr) {
+    g_canvas->fillRect(x, y, w, h, color);
+    this->mark_dirty(y, h);
+    return;
+  }
+  perf_stats::ScopedTimer timer(this->flush_time_);
+  perf_stats::TraceScope trace("co5300_qspi.fill_rect");
   g_gfx->fillRect(x, y, w, h, color);
 }
 
 void CO5300QSPIComponent::draw_pixel(int16_t x, int16_t y, uint16_t color) {
   if (!this->initialized_ || g_gfx == nullptr) return;
+  if (g_canvas != nullptr) {
+    g_canvas->drawPixel(x, y, color);
+    this->mark_dirty(y, 1);
+    return;
+  }
+  perf_stats::ScopedTimer timer(this->flush_time_);
   g_gfx->drawPixel(x, y, color);
 }
 
 void CO5300QSPIComponent::set_brightness(uint8_t value) {
   this->brightness_ = value;
-  if (this->initialized_ && g_gfx != nullptr) {
-    ((Arduino_CO5300 *)g_gfx)->setBrightness(value);
+  if (!this->initialized_ || g_gfx == nullptr) return;
+  // The frame task may be halfway through a frame on the same bus
+  if (this->canvas_ != nullptr) {
+    this->pending_brightness_.store(value);
+    return;
   }
+  ((Arduino_CO5300 *)g_gfx)->setBrightness(value);
 }
 
 }  // namespace co5300_qspi
@@ -3,10 +3,28 @@
 #include "esphome/core/component.h"
 #include "esphome/core/hal.h"
 #include "esphome/core/gpio.h"
+#include "esphome/components/buffer_pool/block_pool.h"
+#include "esphome/components/perf_stats/event_trace.h"
+#include "esphome/components/perf_stats/timing_histogram.h"
+#include "esphome/components/sensor/sensor.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
 
 namespace esphome {
 namespace co5300_qspi {
 
+// Drawing goes into a frame buffer in PSRAM and marks the rows it touched.
+// A frame task sends the dirty rows to the panel, one frame at a time:
+//
+//   with a TE pin  on the panel's tearing-effect edge, the start of vertical
+//                  blanking, so the write stays ahead of the scan-out
+//   without        on a timer
+//
+// Frames come at most max_frame_rate times a second, and only when
+// something changed. A frame that is not sent before the next TE edge
+// (without TE: within one frame period) counts as missed. Without PSRAM
+// for the frame buffer, drawing goes straight to the panel as before.
 class CO5300QSPIComponent : public Component {
  public:
   void setup() override;
@@ -23,23 +41,54 @@ class CO5300QSPIComponent : public Component {
   void set_reset_pin(InternalGPIOPin *pin) { this->reset_pin_ = pin; }
   void set_width(uint16_t width) { this->width_ = width; }
   void set_height(uint16_t height) { this->height_ = height; }
+  // With a frame buffer the change goes out with the next frame
   void set_brightness(uint8_t brightness);
+  void set_te_pin(InternalGPIOPin *pin) { this->te_pin_ = pin; }
+  void set_max_frame_rate(uint8_t fps) { this->max_frame_rate_ = fps; }
+
+  // Frame statistics, published every few seconds
+  void set_frame_time_sensor(sensor::Sensor *sensor) { this->frame_time_sensor_ = sensor; }
+  void set_frame_rate_sensor(sensor::Sensor *sensor) { this->frame_rate_sensor_ = sensor; }
+  void set_missed_frames_sensor(sensor::Sensor *sensor) { this->missed_frames_sensor_ = sensor; }
 
   // Display control
   void fill_screen(uint16_t color);
   void fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
   void draw_pixel(int16_t x, int16_t y, uint16_t color);
-  
+  // Rows `y` to `y + h - 1` changed and go out with the next frame. Needed
+  // after drawing through get_gfx() directly.
+  void mark_dirty(int16_t y, int16_t h);
+
   // Get display dimensions
   uint16_t get_width() const { return this->width_; }
   uint16_t get_height() const { return this->height_; }
 
-  // Get GFX pointer for external use
-  void *get_gfx() { return this->gfx_; }
+  // Get GFX pointer for external use: the frame buffer's canvas if there is
+  // one, else the panel
+  void *get_gfx() { return this->canvas_ != nullptr ? this->canvas_ : this->gfx_; }
+  bool has_frame_buffer() const { return this->canvas_ != nullptr; }
+
+  uint32_t get_frames() const { return this->frames_.load(); }
+  uint32_t get_missed_frames() const { return this->missed_frames_.load(); }
 
  protected:
+  static constexpr uint32_t FRAME_TASK_STACK_SIZE = 3072;
+  // Above the upload task: a frame that waits misses its TE window
+  static constexpr UBaseType_t FRAME_TASK_PRIORITY = 2;
+  // TE edges absent this long: pace by timer instead
+  static constexpr uint32_t TE_TIMEOUT_MS = 100;
+  static constexpr uint32_t STATS_INTERVAL_MS = 10000;
+
   void reset_display_();
   void init_qspi_();
+  bool setup_frame_buffer_();
+  void draw_test_pattern_();
+
+  static void frame_task(void *param);
+  static void te_isr(CO5300QSPIComponent *self);
+  // Send the dirty rows, if there are any and the frame rate allows
+  void send_frame_(bool te_edge);
+  void publish_stats_();
 
   InternalGPIOPin *cs_pin_{nullptr};
   InternalGPIOPin *sclk_pin_{nullptr};
@@ -48,14 +97,49 @@ class CO5300QSPIComponent : public Component {
   InternalGPIOPin *data2_pin_{nullptr};
   InternalGPIOPin *data3_pin_{nullptr};
   InternalGPIOPin *reset_pin_{nullptr};
+  InternalGPIOPin *te_pin_{nullptr};
 
   uint16_t width_{466};
   uint16_t height_{466};
   uint8_t brightness_{255};
+  // Brightness for the frame task to send between frames, -1 when none: the
+  // panel's bus is not shared with other tasks mid-frame
+  std::atomic<int16_t> pending_brightness_{-1};
 
   void *bus_{nullptr};
   void *gfx_{nullptr};
+  void *canvas_{nullptr};
   bool initialized_{false};
+
+  buffer_pool::BlockPool frame_buffer_pool_{"frame_buffer", buffer_pool::REGION_PSRAM};
+  uint8_t max_frame_rate_{30};
+  TaskHandle_t frame_task_handle_{nullptr};
+  // Dirty rows, inclusive; dirty_top_ > dirty_bottom_ when clean. Guarded
+  // by dirty_lock_, as drawing and the frame task update them.
+  portMUX_TYPE dirty_lock_ = portMUX_INITIALIZER_UNLOCKED;
+  int16_t dirty_top_{0};
+  int16_t dirty_bottom_{-1};
+
+  // Written by the TE interrupt
+  volatile uint32_t te_time_{0};
+  volatile uint32_t te_period_{0};
+  bool te_active_{false};
+  uint32_t last_frame_start_{0};
+
+  std::atomic<uint32_t> frames_{0};
+  std::atomic<uint32_t> missed_frames_{0};
+  // Since the last publish
+  std::atomic<uint32_t> window_frames_{0};
+  std::atomic<uint32_t> window_frame_us_{0};
+  uint32_t last_stats_publish_{0};
+
+  sensor::Sensor *frame_time_sensor_{nullptr};
+  sensor::Sensor *frame_rate_sensor_{nullptr};
+  sensor::Sensor *missed_frames_sensor_{nullptr};
+
+  // Execution time statistics: one frame's QSPI transfer (without a frame
+  // buffer: one drawing operation)
+  perf_stats::TimingHistogram flush_time_{"co5300_qspi.flush"};
 };
 
 }  // namespace co5300_qspi
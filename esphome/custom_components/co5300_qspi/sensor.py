@@ -0,0 +1,62 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
+)
+from . import CO5300QSPIComponent, CONF_CO5300_QSPI_ID
+
+DEPENDENCIES = ["co5300_qspi"]
+
+CONF_FRAME_TIME = "frame_time"
+CONF_FRAME_RATE = "frame_rate"
+CONF_MISSED_FRAMES = "missed_frames"
+
+UNIT_FRAMES_PER_SECOND = "fps"
+
+# Only published with a frame buffer
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_CO5300_QSPI_ID): cv.use_id(CO5300QSPIComponent),
+        # Average QSPI transfer time per frame
+        cv.Optional(CONF_FRAME_TIME): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:timer-outline",
+        ),
+        cv.Optional(CONF_FRAME_RATE): sensor.sensor_schema(
+            unit_of_measurement=UNIT_FRAMES_PER_SECOND,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:monitor",
+        ),
+        cv.Optional(CONF_MISSED_FRAMES): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:alert-circle-outline",
+        ),
+    }
+)
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_CO5300_QSPI_ID])
+
+    if CONF_FRAME_TIME in config:
+        sens = await sensor.new_sensor(config[CONF_FRAME_TIME])
+        cg.add(parent.set_frame_time_sensor(sens))
+
+    if CONF_FRAME_RATE in config:
+        sens = await sensor.new_sensor(config[CONF_FRAME_RATE])
+        cg.add(parent.set_frame_rate_sensor(sens))
+
+    if CONF_MISSED_FRAMES in config:
+        sens = await sensor.new_sensor(config[CONF_MISSED_FRAMES])
+        cg.add(parent.set_missed_frames_sensor(sens))
@@ -1,7 +1,7 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome import pins
-from esphome.components import i2c
+from esphome.components import i2c, i2c_arbiter
 from esphome.const import (
     CONF_ID,
     CONF_ADDRESS,
@@ -11,7 +11,8 @@ from esphome.const import (
     CONF_HEIGHT,
 )
 
-DEPENDENCIES = ["i2c"]
+DEPENDENCIES = ["i2c", "i2c_arbiter"]
+AUTO_LOAD = ["perf_stats"]
 CODEOWNERS = ["@medallion"]
 
 CONF_MIRROR_X = "mirror_x"
@@ -34,6 +35,7 @@ CONFIG_SCHEMA = (
     )
     .extend(cv.COMPONENT_SCHEMA)
     .extend(i2c.i2c_device_schema(0x5A))
+    .extend(i2c_arbiter.arbiter_client_schema("latency_critical"))
 )
 
 
@@ -41,6 +43,7 @@ async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     await i2c.register_i2c_device(var, config)
+    await i2c_arbiter.register_arbiter_client(var, config)
 
     if CONF_INTERRUPT_PIN in config:
         int_pin = await cg.gpio_pin_expression(config[CONF_INTERRUPT_PIN])
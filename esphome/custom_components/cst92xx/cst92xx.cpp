@@ -33,7 +33,12 @@ void CST92xxComponent::setup() {
 
   // Try to read chip ID to verify communication
   uint8_t chip_id[3] = {0};
-  if (this->read_register(reg::CHIP_ID, chip_id, 3)) {
+  bool ok;
+  {
+    i2c_arbiter::BusTransaction transaction(this->bus_client_, 1 + sizeof(chip_id));
+    ok = this->read_register(reg::CHIP_ID, chip_id, sizeof(chip_id)) == i2c::ERROR_OK;
+  }
+  if (ok) {
     ESP_LOGI(TAG, "CST92xx Chip ID: 0x%02X%02X%02X", chip_id[0], chip_id[1], chip_id[2]);
   } else {
     ESP_LOGW(TAG, "Could not read chip ID, but continuing...");
@@ -41,7 +46,11 @@ void CST92xxComponent::setup() {
 
   // Read firmware version
   uint8_t fw_version = 0;
-  if (this->read_register(reg::FW_VERSION, &fw_version, 1)) {
+  {
+    i2c_arbiter::BusTransaction transaction(this->bus_client_, 2);
+    ok = this->read_register(reg::FW_VERSION, &fw_version, 1) == i2c::ERROR_OK;
+  }
+  if (ok) {
     ESP_LOGD(TAG, "Firmware version: 0x%02X", fw_version);
   }
 
@@ -51,6 +60,7 @@ void CST92xxComponent::setup() {
 
 void CST92xxComponent::loop() {
   if (!this->initialized_) return;
+  perf_stats::ScopedTimer timer(this->loop_time_);
 
   // Check for touch data
   this->read_touch_data_();
@@ -86,70 +96,34 @@ void CST92xxComponent::reset_controller_() {
 }
 
 bool CST92xxComponent::read_touch_data_() {
-  // CST92xx touch data format:
-  // Byte 0: Gesture ID
-  // Byte 1: Number of touch points
-  // For each point (starting at byte 2):
-  //   Byte 0: Event flag (4 bits) + X high (4 bits)
-  //   Byte 1: X low (8 bits)
-  //   Byte 2: Touch ID (4 bits) + Y high (4 bits)
-  //   Byte 3: Y low (8 bits)
-  //   Byte 4: Weight
-  //   Byte 5: Area
-
-  uint8_t data[32] = {0};
+  uint8_t data[TOUCH_REPORT_SIZE] = {0};
   
   // Read touch data starting from register 0
-  if (!this->read_register(reg::TOUCH_DATA, data, 8 + MAX_TOUCH_POINTS * 6)) {
-    return false;
+  bool ok;
+  {
+    i2c_arbiter::BusTransaction transaction(this->bus_client_, 1 + TOUCH_REPORT_SIZE);
+    uint32_t start = micros();
+    ok = this->read_register(reg::TOUCH_DATA, data, TOUCH_REPORT_SIZE) == i2c::ERROR_OK;
+    this->i2c_time_.record(micros() - start);
   }
-
-  // Parse number of touch points
-  uint8_t num_points = data[reg::TOUCH_NUM] & 0x0F;
-  if (num_points > MAX_TOUCH_POINTS) {
-    num_points = MAX_TOUCH_POINTS;
+  if (!ok) {
+    return false;
   }
 
   uint8_t prev_count = this->touch_count_;
-  this->touch_count_ = num_points;
-
-  // Parse each touch point
-  for (uint8_t i = 0; i < num_points; i++) {
-    uint8_t *point_data = &data[3 + i * 6];
-    
-    uint8_t event = (point_data[0] >> 4) & 0x0F;
-    int16_t x = ((point_data[0] & 0x0F) << 8) | point_data[1];
-    uint8_t id = (point_data[2] >> 4) & 0x0F;
-    int16_t y = ((point_data[2] & 0x0F) << 8) | point_data[3];
-
-    // Apply mirroring
-    if (this->mirror_x_) {
-      x = this->max_x_ - x;
-    }
-    if (this->mirror_y_) {
-      y = this->max_y_ - y;
-    }
-
-    // Clamp to valid range
-    if (x < 0) x = 0;
-    if (y < 0) y = 0;
-    if (x >= this->max_x_) x = this->max_x_ - 1;
-    if (y >= this->max_y_) y = this->max_y_ - 1;
-
-    this->touch_points_[i].x = x;
-    this->touch_points_[i].y = y;
-    this->touch_points_[i].id = id;
-    this->touch_points_[i].pressed = (event == 0 || event == 2);  // Down or Contact
-
-    // Fire callback for new touches
-    if (i == 0 && num_points > 0 && prev_count == 0) {
-      this->touch_callbacks_.call(num_points, x, y);
-    }
+  TouchTransform transform{this->max_x_, this->max_y_, this->mirror_x_, this->mirror_y_};
+  this->touch_count_ = parse_touch_report(data, transform, this->touch_points_);
+
+  // Touch and release as trace instants, the position packed as x << 16 | y
+  if (this->touch_count_ > 0 && prev_count == 0) {
+    perf_stats::trace_instant("cst92xx.touch", (uint32_t) this->touch_points_[0].x << 16 | this->touch_points_[0].y);
+  } else if (this->touch_count_ == 0 && prev_count > 0) {
+    perf_stats::trace_instant("cst92xx.release");
   }
 
-  // Clear remaining points
-  for (uint8_t i = num_points; i < MAX_TOUCH_POINTS; i++) {
-    this->touch_points_[i].pressed = false;
+  // Fire callback for new touches
+  if (this->touch_count_ > 0 && prev_count == 0) {
+    this->touch_callbacks_.call(this->touch_count_, this->touch_points_[0].x, this->touch_points_[0].y);
   }
 
   return true;
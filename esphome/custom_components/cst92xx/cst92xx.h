@@ -3,20 +3,14 @@
 #include "esphome/core/component.h"
 #include "esphome/core/hal.h"
 #include "esphome/components/i2c/i2c.h"
+#include "esphome/components/perf_stats/event_trace.h"
+#include "esphome/components/perf_stats/timing_histogram.h"
+#include "esphome/components/i2c_arbiter/i2c_arbiter.h"
+#include "touch_report.h"
 
 namespace esphome {
 namespace cst92xx {
 
-// Maximum number of touch points supported
-constexpr uint8_t MAX_TOUCH_POINTS = 5;
-
-struct TouchPoint {
-  int16_t x;
-  int16_t y;
-  uint8_t id;
-  bool pressed;
-};
-
 class CST92xxComponent : public Component, public i2c::I2CDevice {
  public:
   void setup() override;
@@ -30,6 +24,11 @@ class CST92xxComponent : public Component, public i2c::I2CDevice {
   void set_height(uint16_t height) { this->max_y_ = height; }
   void set_mirror_x(bool mirror) { this->mirror_x_ = mirror; }
   void set_mirror_y(bool mirror) { this->mirror_y_ = mirror; }
+  void set_bus_arbiter(i2c_arbiter::I2CArbiter *arbiter, i2c_arbiter::BusPriority priority, bool fast_mode_plus) {
+    this->bus_client_.set_priority(priority);
+    this->bus_client_.set_fast_mode_plus(fast_mode_plus);
+    arbiter->add_client(&this->bus_client_, "cst92xx");
+  }
 
   // Get current touch state
   uint8_t get_touch_count() const { return this->touch_count_; }
@@ -60,6 +59,11 @@ class CST92xxComponent : public Component, public i2c::I2CDevice {
   TouchPoint touch_points_[MAX_TOUCH_POINTS];
   uint8_t touch_count_{0};
   bool initialized_{false};
+
+  // Execution time statistics
+  perf_stats::TimingHistogram loop_time_{"cst92xx.loop"};
+  perf_stats::TimingHistogram i2c_time_{"cst92xx.i2c"};
+  i2c_arbiter::BusClient bus_client_{"cst92xx.i2c_wait", i2c_arbiter::PRIORITY_LATENCY_CRITICAL};
   
   CallbackManager<void(uint8_t, int16_t, int16_t)> touch_callbacks_;
 };
@@ -0,0 +1,62 @@
+#include "touch_report.h"
+
+namespace esphome {
+namespace cst92xx {
+
+uint8_t parse_touch_report(const uint8_t *data, const TouchTransform &transform, TouchPoint *points) {
+  // CST92xx touch data format:
+  // Byte 0: Gesture ID
+  // Byte 1: Number of touch points
+  // For each point (starting at byte 2):
+  //   Byte 0: Event flag (4 bits) + X high (4 bits)
+  //   Byte 1: X low (8 bits)
+  //   Byte 2: Touch ID (4 bits) + Y high (4 bits)
+  //   Byte 3: Y low (8 bits)
+  //   Byte 4: Weight
+  //   Byte 5: Area
+
+  // Parse number of touch points
+  uint8_t num_points = data[2] & 0x0F;
+  if (num_points > MAX_TOUCH_POINTS) {
+    num_points = MAX_TOUCH_POINTS;
+  }
+
+  // Parse each touch point
+  for (uint8_t i = 0; i < num_points; i++) {
+    const uint8_t *point_data = &data[3 + i * 6];
+
+    uint8_t event = (point_data[0] >> 4) & 0x0F;
+    int16_t x = ((point_data[0] & 0x0F) << 8) | point_data[1];
+    uint8_t id = (point_data[2] >> 4) & 0x0F;
+    int16_t y = ((point_data[2] & 0x0F) << 8) | point_data[3];
+
+    // Apply mirroring
+    if (transform.mirror_x) {
+      x = transform.max_x - x;
+    }
+    if (transform.mirror_y) {
+      y = transform.max_y - y;
+    }
+
+    // Clamp to valid range
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x >= transform.max_x) x = transform.max_x - 1;
+    if (y >= transform.max_y) y = transform.max_y - 1;
+
+    points[i].x = x;
+    points[i].y = y;
+    points[i].id = id;
+    points[i].pressed = (event == 0 || event == 2);  // Down or Contact
+  }
+
+  // Clear remaining points
+  for (uint8_t i = num_points; i < MAX_TOUCH_POINTS; i++) {
+    points[i].pressed = false;
+  }
+
+  return num_points;
+}
+
+}  // namespace cst92xx
+}  // namespace esphome
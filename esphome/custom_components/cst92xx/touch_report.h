@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace cst92xx {
+
+// Maximum number of touch points supported
+constexpr uint8_t MAX_TOUCH_POINTS = 5;
+
+// Bytes read per touch report: header plus 6 bytes per point
+constexpr size_t TOUCH_REPORT_SIZE = 8 + MAX_TOUCH_POINTS * 6;
+
+struct TouchPoint {
+  int16_t x;
+  int16_t y;
+  uint8_t id;
+  bool pressed;
+};
+
+// Panel geometry applied to raw controller coordinates
+struct TouchTransform {
+  uint16_t max_x;
+  uint16_t max_y;
+  bool mirror_x;
+  bool mirror_y;
+};
+
+// Decode a raw TOUCH_REPORT_SIZE-byte report into `points` (MAX_TOUCH_POINTS
+// entries). Points beyond the returned count are marked released. Free of
+// bus dependencies so it can be built and checked on the host.
+uint8_t parse_touch_report(const uint8_t *data, const TouchTransform &transform, TouchPoint *points);
+
+}  // namespace cst92xx
+}  // namespace esphome
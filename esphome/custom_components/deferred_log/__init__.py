@@ -0,0 +1,34 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.const import CONF_ID
+
+CODEOWNERS = ["@medallion"]
+AUTO_LOAD = ["buffer_pool"]
+MULTI_CONF = False
+
+CONF_DEFERRED_LOG_ID = "deferred_log_id"
+CONF_RECORDS = "records"
+CONF_FLUSH_INTERVAL = "flush_interval"
+
+deferred_log_ns = cg.esphome_ns.namespace("deferred_log")
+DeferredLogComponent = deferred_log_ns.class_("DeferredLogComponent", cg.Component)
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(DeferredLogComponent),
+        # Ring of pending log records in internal RAM, 36 bytes each
+        cv.Optional(CONF_RECORDS, default=256): cv.int_range(min=16, max=4096),
+        # How often the drain task formats and prints what has been logged
+        cv.Optional(CONF_FLUSH_INTERVAL, default="50ms"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=10), max=cv.TimePeriod(seconds=1)),
+        ),
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    cg.add(var.set_records(config[CONF_RECORDS]))
+    cg.add(var.set_flush_interval(config[CONF_FLUSH_INTERVAL]))
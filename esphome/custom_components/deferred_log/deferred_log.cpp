@@ -0,0 +1,114 @@
+#include "deferred_log.h"
+#include <cinttypes>
+#include <cstdio>
+#include <new>
+
+namespace esphome {
+namespace deferred_log {
+
+static const char *const TAG = "deferred_log";
+
+std::atomic<DeferredLogComponent *> global_deferred_log{nullptr};
+
+bool LogRing::setup(uint8_t *buffer, size_t size) {
+  size_t count = size / sizeof(Slot);
+  if (buffer == nullptr || count == 0) return false;
+  // Largest power of two that fits, so a slot is the index masked
+  while ((count & (count - 1)) != 0) count &= count - 1;
+  this->slots_ = reinterpret_cast<Slot *>(buffer);
+  for (size_t i = 0; i < count; i++) {
+    new (&this->slots_[i]) Slot();
+  }
+  this->mask_ = count - 1;
+  return true;
+}
+
+size_t LogRing::buffer_size(uint32_t records) { return records * sizeof(Slot); }
+
+bool LogRing::pop(LogRecord &out) {
+  uint32_t tail = this->tail_.load(std::memory_order_relaxed);
+  Slot &slot = this->slots_[tail & this->mask_];
+  // A claimed slot whose writer has not finished yet holds up the rest
+  if (slot.sequence.load(std::memory_order_acquire) != tail + 1) return false;
+  out = slot.record;
+  // Hands the slot back to the writers
+  this->tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+void DeferredLogComponent::setup() {
+  size_t size = LogRing::buffer_size(this->records_);
+  uint8_t *buffer = this->ring_pool_.reserve(size, 1) ? this->ring_pool_.acquire() : nullptr;
+  if (!this->ring_.setup(buffer, size)) {
+    // Deferred calls keep logging directly
+    ESP_LOGE(TAG, "No memory for %u log records", (unsigned) this->records_);
+    this->mark_failed();
+    return;
+  }
+  if (xTaskCreatePinnedToCore(DeferredLogComponent::drain_task, "deferred_log", TASK_STACK_SIZE, this, TASK_PRIORITY,
+                              &this->task_handle_, 0) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start drain task");
+    this->mark_failed();
+    return;
+  }
+  global_deferred_log.store(this, std::memory_order_release);
+}
+
+void DeferredLogComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "Deferred Log:");
+  ESP_LOGCONFIG(TAG, "  Records: %u", (unsigned) this->ring_.get_capacity());
+  ESP_LOGCONFIG(TAG, "  Flush Interval: %u ms", (unsigned) this->flush_interval_ms_);
+  ESP_LOGCONFIG(TAG, "  Sinks: %u", (unsigned) this->sink_count_.load());
+  ESP_LOGCONFIG(TAG, "  Dropped: %u, max pending %u", (unsigned) this->ring_.get_dropped(),
+                (unsigned) this->max_pending_);
+}
+
+bool DeferredLogComponent::add_sink(LogSink *sink) {
+  uint8_t count = this->sink_count_.load(std::memory_order_relaxed);
+  if (count >= MAX_SINKS) return false;
+  this->sinks_[count] = sink;
+  // The drain task only reads the sinks below the count
+  this->sink_count_.store(count + 1, std::memory_order_release);
+  return true;
+}
+
+void DeferredLogComponent::drain_task(void *param) {
+  auto *self = static_cast<DeferredLogComponent *>(param);
+  while (true) {
+    self->drain_();
+    vTaskDelay(pdMS_TO_TICKS(self->flush_interval_ms_));
+  }
+}
+
+void DeferredLogComponent::drain_() {
+  uint32_t pending = this->ring_.get_pending();
+  if (pending > this->max_pending_) this->max_pending_ = pending;
+
+  uint8_t sinks = this->sink_count_.load(std::memory_order_acquire);
+  LogRecord record;
+  char message[MESSAGE_SIZE];
+  while (this->ring_.pop(record)) {
+    const uint32_t *args = record.args;
+    // Every argument is one 32-bit word, as the call passed it
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+    snprintf(message, sizeof(message), record.format, args[0], args[1], args[2], args[3]);
+#pragma GCC diagnostic pop
+    // The logger prints when the record is formatted; the call's own time
+    // goes in front
+    esp_log_printf_(record.level, record.tag, record.line, "[%" PRIu32 ".%03" PRIu32 "] %s", record.timestamp / 1000,
+                    record.timestamp % 1000, message);
+    for (uint8_t i = 0; i < sinks; i++) this->sinks_[i]->write(record, message);
+  }
+  for (uint8_t i = 0; i < sinks; i++) this->sinks_[i]->flush();
+
+  uint32_t dropped = this->ring_.get_dropped();
+  if (dropped != this->reported_drops_) {
+    ESP_LOGW(TAG, "%u log records dropped, the ring was full", (unsigned) (dropped - this->reported_drops_));
+    this->reported_drops_ = dropped;
+  }
+}
+
+}  // namespace deferred_log
+}  // namespace esphome
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/components/buffer_pool/block_pool.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace esphome {
+namespace deferred_log {
+
+static constexpr uint8_t MAX_ARGS = 4;
+
+// One log call, formatted later. The format string's address stands in for
+// its ID: it is a literal in flash, so it outlives the record.
+struct LogRecord {
+  const char *format;
+  const char *tag;
+  uint32_t timestamp;  // millis()
+  uint16_t line;
+  uint8_t level;
+  uint8_t arg_count;
+  uint32_t args[MAX_ARGS];
+};
+
+// Log arguments are stored as 32-bit words and handed back to printf as
+// such, which the ESP32's calling convention passes exactly like the
+// original int, unsigned or pointer. Wider types (double, 64-bit integers)
+// are not supported.
+template<typename T> inline uint32_t to_log_word(T value) {
+  static_assert(std::is_pointer<T>::value || ((std::is_integral<T>::value || std::is_enum<T>::value) && sizeof(T) <= 4),
+                "Deferred log arguments must be 32-bit integers or pointers to static strings");
+  if constexpr (std::is_pointer<T>::value) {
+    return (uint32_t) reinterpret_cast<uintptr_t>(value);
+  } else {
+    return static_cast<uint32_t>(value);
+  }
+}
+
+// Bounded ring of log records. Any task may write: a writer claims a slot
+// with a compare-and-swap on the head and publishes it with a per-slot
+// sequence number. One reader, the drain task, consumes them in order.
+// When the ring is full new records are dropped and counted, so a burst
+// never blocks the caller.
+class LogRing {
+ public:
+  // Use `buffer` of `size` bytes; the slot count is rounded down to a power
+  // of two
+  bool setup(uint8_t *buffer, size_t size);
+  static size_t buffer_size(uint32_t records);
+
+  template<typename... Args>
+  void write(uint8_t level, const char *tag, int line, const char *format, Args... args) {
+    static_assert(sizeof...(Args) <= MAX_ARGS, "At most 4 arguments per deferred log call");
+    uint32_t head = this->head_.load(std::memory_order_relaxed);
+    do {
+      if (head - this->tail_.load(std::memory_order_acquire) > this->mask_) {
+        this->dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    } while (!this->head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed));
+
+    Slot &slot = this->slots_[head & this->mask_];
+    LogRecord &record = slot.record;
+    record.format = format;
+    record.tag = tag;
+    record.timestamp = millis();
+    record.line = line;
+    record.level = level;
+    record.arg_count = sizeof...(Args);
+    [[maybe_unused]] uint8_t i = 0;
+    ((record.args[i++] = to_log_word(args)), ...);
+    slot.sequence.store(head + 1, std::memory_order_release);
+  }
+
+  // The oldest record, if one is complete. Only the drain task may call this.
+  bool pop(LogRecord &out);
+
+  uint32_t get_capacity() const { return this->mask_ + 1; }
+  uint32_t get_pending() const {
+    return this->head_.load(std::memory_order_relaxed) - this->tail_.load(std::memory_order_relaxed);
+  }
+  uint32_t get_dropped() const { return this->dropped_.load(std::memory_order_relaxed); }
+
+ protected:
+  struct Slot {
+    std::atomic<uint32_t> sequence;  // index + 1 once written
+    LogRecord record;
+  };
+
+  Slot *slots_{nullptr};
+  uint32_t mask_{0};
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
+
+// Further destination of formatted records, besides the logger. Called from
+// the drain task.
+class LogSink {
+ public:
+  virtual void write(const LogRecord &record, const char *message) = 0;
+  // After every drain pass, at the flush interval, with or without records
+  virtual void flush() {}
+};
+
+// Moves log formatting and output off hot paths. DEFERRED_LOG* calls store a
+// record in the ring (a few hundred cycles); a low-priority task formats the
+// records and hands them to the logger, and so to serial and the API, and to
+// any sinks, such as a log file on SD.
+class DeferredLogComponent : public Component {
+ public:
+  void setup() override;
+  void dump_config() override;
+  // Ready before the components whose hot paths log through it
+  float get_setup_priority() const override { return setup_priority::BUS; }
+
+  void set_records(uint32_t records) { this->records_ = records; }
+  void set_flush_interval(uint32_t flush_interval_ms) { this->flush_interval_ms_ = flush_interval_ms; }
+  // Sinks may be added at any time, up to MAX_SINKS
+  bool add_sink(LogSink *sink);
+
+  LogRing &get_ring() { return this->ring_; }
+
+ protected:
+  static constexpr uint8_t MAX_SINKS = 2;
+  static constexpr size_t MESSAGE_SIZE = 256;
+  static constexpr uint32_t TASK_STACK_SIZE = 4096;
+  static constexpr UBaseType_t TASK_PRIORITY = 1;
+
+  static void drain_task(void *param);
+  // Format and output every complete record
+  void drain_();
+
+  LogRing ring_;
+  buffer_pool::BlockPool ring_pool_{"deferred_log", buffer_pool::REGION_INTERNAL_DMA};
+  uint32_t records_{256};
+  uint32_t flush_interval_ms_{50};
+  TaskHandle_t task_handle_{nullptr};
+  LogSink *sinks_[MAX_SINKS]{};
+  std::atomic<uint8_t> sink_count_{0};
+  uint32_t reported_drops_{0};
+  uint32_t max_pending_{0};
+};
+
+// Set once the ring is ready; until then deferred calls log directly
+extern std::atomic<DeferredLogComponent *> global_deferred_log;
+
+template<typename... Args>
+inline void log(uint8_t level, const char *tag, int line, const char *format, Args... args) {
+  DeferredLogComponent *deferred = global_deferred_log.load(std::memory_order_acquire);
+  if (deferred != nullptr) {
+    deferred->get_ring().write(level, tag, line, format, args...);
+  } else if constexpr (sizeof...(Args) == 0) {
+    esp_log_printf_(level, tag, line, "%s", format);
+  } else {
+    esp_log_printf_(level, tag, line, format, args...);
+  }
+}
+
+// Never called: lets the compiler check each call's format against its
+// arguments
+__attribute__((format(printf, 1, 2))) inline void check_format(const char *format, ...) {}
+
+}  // namespace deferred_log
+}  // namespace esphome
+
+// Drop-in replacements for ESP_LOGx on hot paths. Arguments must be 32-bit
+// integers or pointers; a string argument must stay valid until the record
+// is printed, so pass literals or static strings, never c_str() of a buffer
+// that may change.
+#define DEFERRED_LOG_(level, tag, format, ...) \
+  do { \
+    if (false) \
+      ::esphome::deferred_log::check_format(format, ##__VA_ARGS__); \
+    ::esphome::deferred_log::log(level, tag, __LINE__, format, ##__VA_ARGS__); \
+  } while (0)
+
+#define DEFERRED_LOGE(tag, format, ...) DEFERRED_LOG_(ESPHOME_LOG_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_WARN
+#define DEFERRED_LOGW(tag, format, ...) DEFERRED_LOG_(ESPHOME_LOG_LEVEL_WARN, tag, format, ##__VA_ARGS__)
+#else
+#define DEFERRED_LOGW(tag, format, ...)
+#endif
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_INFO
+#define DEFERRED_LOGI(tag, format, ...) DEFERRED_LOG_(ESPHOME_LOG_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#else
+#define DEFERRED_LOGI(tag, format, ...)
+#endif
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+#define DEFERRED_LOGD(tag, format, ...) DEFERRED_LOG_(ESPHOME_LOG_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#define DEFERRED_LOGD(tag, format, ...)
+#endif
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+#define DEFERRED_LOGV(tag, format, ...) DEFERRED_LOG_(ESPHOME_LOG_LEVEL_VERBOSE, tag, format, ##__VA_ARGS__)
+#else
+#define DEFERRED_LOGV(tag, format, ...)
+#endif
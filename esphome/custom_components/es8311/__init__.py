@@ -1,13 +1,14 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome import pins
-from esphome.components import i2c
+from esphome import automation, pins
+from esphome.components import i2c, i2c_arbiter
 from esphome.const import (
     CONF_ID,
     CONF_ADDRESS,
 )
 
-DEPENDENCIES = ["i2c"]
+DEPENDENCIES = ["i2c", "i2c_arbiter"]
+AUTO_LOAD = ["perf_stats", "deferred_log"]
 CODEOWNERS = ["@medallion"]
 
 CONF_PA_ENABLE_PIN = "pa_enable_pin"
@@ -19,9 +20,16 @@ CONF_I2S_DIN_PIN = "i2s_din_pin"
 CONF_SAMPLE_RATE = "sample_rate"
 CONF_BITS_PER_SAMPLE = "bits_per_sample"
 CONF_MIC_GAIN = "mic_gain"
+CONF_MCLK_MULTIPLE = "mclk_multiple"
 
 es8311_ns = cg.esphome_ns.namespace("es8311")
 ES8311Component = es8311_ns.class_("ES8311Component", cg.Component, i2c.I2CDevice)
+SetSampleRateAction = es8311_ns.class_("SetSampleRateAction", automation.Action)
+
+# Rates with an entry for every MCLK multiple in CLOCK_COEFFICIENTS
+# (clock_coefficients.h); keep the two in step
+SAMPLE_RATES = [8000, 11025, 16000, 22050, 32000, 44100, 48000]
+MCLK_MULTIPLES = [256, 384]
 
 MIC_GAIN_OPTIONS = {
     "0dB": 0,
@@ -44,13 +52,15 @@ CONFIG_SCHEMA = (
             cv.Required(CONF_I2S_WS_PIN): cv.int_range(min=0, max=48),
             cv.Required(CONF_I2S_DOUT_PIN): cv.int_range(min=0, max=48),
             cv.Required(CONF_I2S_DIN_PIN): cv.int_range(min=0, max=48),
-            cv.Optional(CONF_SAMPLE_RATE, default=16000): cv.int_range(min=8000, max=48000),
+            cv.Optional(CONF_SAMPLE_RATE, default=16000): cv.one_of(*SAMPLE_RATES, int=True),
+            cv.Optional(CONF_MCLK_MULTIPLE, default=256): cv.one_of(*MCLK_MULTIPLES, int=True),
             cv.Optional(CONF_BITS_PER_SAMPLE, default=16): cv.one_of(16, 24, 32, int=True),
             cv.Optional(CONF_MIC_GAIN, default="30dB"): cv.enum(MIC_GAIN_OPTIONS, upper=False),
         }
     )
     .extend(cv.COMPONENT_SCHEMA)
     .extend(i2c.i2c_device_schema(0x18))
+    .extend(i2c_arbiter.arbiter_client_schema("latency_critical"))
 )
 
 
@@ -58,6 +68,7 @@ async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     await i2c.register_i2c_device(var, config)
+    await i2c_arbiter.register_arbiter_client(var, config)
 
     if CONF_PA_ENABLE_PIN in config:
         pa_pin = await cg.gpio_pin_expression(config[CONF_PA_ENABLE_PIN])
@@ -68,6 +79,28 @@ async def to_code(config):
     cg.add(var.set_i2s_ws_pin(config[CONF_I2S_WS_PIN]))
     cg.add(var.set_i2s_dout_pin(config[CONF_I2S_DOUT_PIN]))
     cg.add(var.set_i2s_din_pin(config[CONF_I2S_DIN_PIN]))
+    cg.add(var.set_mclk_multiple(config[CONF_MCLK_MULTIPLE]))
     cg.add(var.set_sample_rate(config[CONF_SAMPLE_RATE]))
     cg.add(var.set_bits_per_sample(config[CONF_BITS_PER_SAMPLE]))
     cg.add(var.set_mic_gain(config[CONF_MIC_GAIN]))
+
+
+SET_SAMPLE_RATE_ACTION_SCHEMA = cv.maybe_simple_value(
+    {
+        cv.GenerateID(): cv.use_id(ES8311Component),
+        # A lambda's rate is checked on the device, which refuses unsupported ones
+        cv.Required(CONF_SAMPLE_RATE): cv.templatable(cv.one_of(*SAMPLE_RATES, int=True)),
+    },
+    key=CONF_SAMPLE_RATE,
+)
+
+
+@automation.register_action(
+    "es8311.set_sample_rate", SetSampleRateAction, SET_SAMPLE_RATE_ACTION_SCHEMA
+)
+async def set_sample_rate_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    rate = await cg.templatable(config[CONF_SAMPLE_RATE], args, cg.uint32)
+    cg.add(var.set_sample_rate(rate))
+    return var
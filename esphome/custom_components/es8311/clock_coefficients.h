@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace es8311 {
+
+// Clock tree settings for one MCLK frequency and sample rate, following the
+// coefficient table in Everest's ES8311 user guide. MCLK is divided by
+// pre_div and multiplied by pre_multi into the internal clock, which must
+// run at 256 fs (128 fs in double speed mode) for the converters.
+struct ClockCoefficients {
+  uint32_t mclk;
+  uint32_t sample_rate;
+  uint8_t pre_div;    // 1-8
+  uint8_t pre_multi;  // 1, 2, 4 or 8
+  uint8_t adc_div;    // 1-16
+  uint8_t dac_div;    // 1-16
+  uint8_t fs_mode;    // 0: single speed, 1: double speed
+  uint16_t lrck_div;  // MCLK cycles per LRCK, used in master mode
+  uint8_t bclk_div;   // MCLK cycles per BCLK, used in master mode
+  uint8_t adc_osr;
+  uint8_t dac_osr;
+};
+
+// MCLK is generated by the I2S peripheral as a multiple of the sample rate.
+// es8311/__init__.py validates sample_rate and mclk_multiple against this
+// table; keep the two in step.
+static constexpr ClockCoefficients CLOCK_COEFFICIENTS[] = {
+    // 256 fs: the internal clock is MCLK itself
+    {2048000, 8000, 1, 1, 1, 1, 0, 256, 4, 0x10, 0x20},
+    {2822400, 11025, 1, 1, 1, 1, 0, 256, 4, 0x10, 0x20},
+    {4096000, 16000, 1, 1, 1, 1, 0, 256, 4, 0x10, 0x20},
+    {5644800, 22050, 1, 1, 1, 1, 0, 256, 4, 0x10, 0x10},
+    {8192000, 32000, 1, 1, 1, 1, 0, 256, 4, 0x10, 0x10},
+    {11289600, 44100, 1, 1, 1, 1, 0, 256, 4, 0x10, 0x10},
+    {12288000, 48000, 1, 1, 1, 1, 0, 256, 4, 0x10, 0x10},
+    // 384 fs: divided by 3 and doubled
+    {3072000, 8000, 3, 2, 1, 1, 0, 384, 6, 0x10, 0x20},
+    {4233600, 11025, 3, 2, 1, 1, 0, 384, 6, 0x10, 0x20},
+    {6144000, 16000, 3, 2, 1, 1, 0, 384, 6, 0x10, 0x20},
+    {8467200, 22050, 3, 2, 1, 1, 0, 384, 6, 0x10, 0x10},
+    {12288000, 32000, 3, 2, 1, 1, 0, 384, 6, 0x10, 0x10},
+    {16934400, 44100, 3, 2, 1, 1, 0, 384, 6, 0x10, 0x10},
+    {18432000, 48000, 3, 2, 1, 1, 0, 384, 6, 0x10, 0x10},
+};
+
+constexpr const ClockCoefficients *find_clock_coefficients(uint32_t mclk, uint32_t sample_rate) {
+  for (const ClockCoefficients &coefs : CLOCK_COEFFICIENTS) {
+    if (coefs.mclk == mclk && coefs.sample_rate == sample_rate) return &coefs;
+  }
+  return nullptr;
+}
+
+constexpr bool is_valid(const ClockCoefficients &coefs) {
+  return coefs.pre_div >= 1 && coefs.pre_div <= 8 &&
+         (coefs.pre_multi == 1 || coefs.pre_multi == 2 || coefs.pre_multi == 4 || coefs.pre_multi == 8) &&
+         coefs.adc_div >= 1 && coefs.adc_div <= 16 && coefs.dac_div >= 1 && coefs.dac_div <= 16 &&
+         (uint64_t) coefs.mclk * coefs.pre_multi ==
+             (uint64_t) coefs.sample_rate * coefs.pre_div * (coefs.fs_mode ? 128 : 256) &&
+         (uint64_t) coefs.lrck_div * coefs.sample_rate == coefs.mclk && coefs.lrck_div % coefs.bclk_div == 0;
+}
+
+constexpr bool all_valid() {
+  for (const ClockCoefficients &coefs : CLOCK_COEFFICIENTS) {
+    if (!is_valid(coefs)) return false;
+  }
+  return true;
+}
+
+static_assert(all_valid(), "ES8311 clock coefficients do not produce their sample rate");
+static_assert(find_clock_coefficients(16000 * 256, 16000)->sample_rate == 16000, "Default rate missing");
+
+}  // namespace es8311
+}  // namespace esphome
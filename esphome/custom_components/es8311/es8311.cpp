@@ -1,11 +1,14 @@
 #include "es8311.h"
 #include "esphome/core/log.h"
+#include "esphome/components/deferred_log/deferred_log.h"
 
 namespace esphome {
 namespace es8311 {
 
 static const char *const TAG = "es8311";
 
+static const int I2S_EVENT_QUEUE_SIZE = 8;
+
 void ES8311Component::setup() {
   ESP_LOGI(TAG, "Setting up ES8311 Audio Codec...");
 
@@ -49,16 +52,20 @@ void ES8311Component::dump_config() {
   ESP_LOGCONFIG(TAG, "  I2S WS Pin: %d", this->i2s_ws_pin_);
   ESP_LOGCONFIG(TAG, "  I2S DOUT Pin: %d", this->i2s_dout_pin_);
   ESP_LOGCONFIG(TAG, "  I2S DIN Pin: %d", this->i2s_din_pin_);
-  ESP_LOGCONFIG(TAG, "  Sample Rate: %d Hz", this->sample_rate_);
+  ESP_LOGCONFIG(TAG, "  Sample Rate: %d Hz, MCLK %u x fs", this->sample_rate_, this->mclk_multiple_);
   ESP_LOGCONFIG(TAG, "  Bits Per Sample: %d", this->bits_per_sample_);
   ESP_LOGCONFIG(TAG, "  Mic Gain: %d (x6 dB)", this->mic_gain_);
 }
 
 bool ES8311Component::write_reg_(uint8_t reg, uint8_t value) {
+  i2c_arbiter::BusTransaction transaction(this->bus_client_, 2);
+  perf_stats::ScopedTimer timer(this->i2c_time_);
   return this->write_byte(reg, value);
 }
 
 uint8_t ES8311Component::read_reg_(uint8_t reg) {
+  i2c_arbiter::BusTransaction transaction(this->bus_client_, 2);
+  perf_stats::ScopedTimer timer(this->i2c_time_);
   uint8_t value = 0;
   this->read_byte(reg, &value);
   return value;
@@ -82,7 +89,7 @@ bool ES8311Component::init_codec_() {
   }
 
   // Configure clocks
-  this->configure_clock_();
+  if (!this->configure_clock_()) return false;
 
   // Configure SDP (Serial Data Port)
   // I2S format, 16-bit
@@ -122,32 +129,35 @@ bool ES8311Component::init_codec_() {
   return true;
 }
 
-void ES8311Component::configure_clock_() {
+bool ES8311Component::configure_clock_() {
+  const ClockCoefficients *coefs = find_clock_coefficients(this->sample_rate_ * this->mclk_multiple_, this->sample_rate_);
+  if (coefs == nullptr) {
+    ESP_LOGE(TAG, "No clock coefficients for %u Hz with MCLK %u x fs", (unsigned) this->sample_rate_,
+             this->mclk_multiple_);
+    return false;
+  }
+
   // MCLK from MCLK pin, not from SCLK
   this->write_reg_(reg::CLK_MANAGER1, 0x3F);  // MCLK enable
-  
-  // For 16kHz sample rate with 256*fs MCLK (4.096MHz):
-  // MCLK_DIV = 1, BCLK divider based on bits
-  
-  // Calculate dividers for the sample rate
-  uint32_t mclk_freq = this->sample_rate_ * 256;
-  
-  // CLK_MANAGER2: MCLK divider
-  this->write_reg_(reg::CLK_MANAGER2, 0x00);
-  
-  // CLK_MANAGER3-5: PLL config (bypassed when using direct MCLK)
-  this->write_reg_(reg::CLK_MANAGER3, 0x10);
-  this->write_reg_(reg::CLK_MANAGER4, 0x00);
-  this->write_reg_(reg::CLK_MANAGER5, 0x00);
-  
-  // CLK_MANAGER6: ADC/DAC clock dividers
-  this->write_reg_(reg::CLK_MANAGER6, 0x00);
-  
-  // CLK_MANAGER7-8: Additional dividers
-  this->write_reg_(reg::CLK_MANAGER7, 0x00);
-  this->write_reg_(reg::CLK_MANAGER8, 0xFF);  // Enable ADC/DAC clocks
-  
+
+  // CLK_MANAGER2: MCLK pre-divider and multiplier (log2)
+  uint8_t multi = coefs->pre_multi == 8 ? 3 : coefs->pre_multi == 4 ? 2 : coefs->pre_multi == 2 ? 1 : 0;
+  this->write_reg_(reg::CLK_MANAGER2, ((coefs->pre_div - 1) << 5) | (multi << 3));
+
+  // CLK_MANAGER3-4: speed mode and oversampling rates
+  this->write_reg_(reg::CLK_MANAGER3, (coefs->fs_mode << 6) | coefs->adc_osr);
+  this->write_reg_(reg::CLK_MANAGER4, coefs->dac_osr);
+
+  // CLK_MANAGER5: ADC/DAC clock dividers
+  this->write_reg_(reg::CLK_MANAGER5, ((coefs->adc_div - 1) << 4) | (coefs->dac_div - 1));
+
+  // CLK_MANAGER6-8: BCLK and LRCK dividers, only used in master mode
+  this->write_reg_(reg::CLK_MANAGER6, coefs->bclk_div < 19 ? coefs->bclk_div - 1 : coefs->bclk_div);
+  this->write_reg_(reg::CLK_MANAGER7, (coefs->lrck_div - 1) >> 8);
+  this->write_reg_(reg::CLK_MANAGER8, (coefs->lrck_div - 1) & 0xFF);
+
   ESP_LOGD(TAG, "Clock configured for %d Hz sample rate", this->sample_rate_);
+  return true;
 }
 
 bool ES8311Component::init_i2s_() {
@@ -162,9 +172,12 @@ bool ES8311Component::init_i2s_() {
   i2s_config.dma_buf_len = 1024;
   i2s_config.use_apll = true;
   i2s_config.tx_desc_auto_clear = false;
-  i2s_config.fixed_mclk = this->sample_rate_ * 256;
+  // i2s_set_clk() keeps the multiple when the sample rate changes
+  i2s_config.mclk_multiple = this->mclk_multiple_ == 384 ? I2S_MCLK_MULTIPLE_384 : I2S_MCLK_MULTIPLE_256;
 
-  esp_err_t err = i2s_driver_install(this->i2s_port_, &i2s_config, 0, nullptr);
+  // The event queue reports RX DMA overflows (samples lost because the
+  // reader fell behind)
+  esp_err_t err = i2s_driver_install(this->i2s_port_, &i2s_config, I2S_EVENT_QUEUE_SIZE, &this->i2s_event_queue_);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "I2S driver install failed: %s", esp_err_to_name(err));
     return false;
@@ -196,7 +209,14 @@ bool ES8311Component::start_recording() {
     ESP_LOGW(TAG, "Already recording");
     return false;
   }
-  
+  perf_stats::TraceScope trace("es8311.start_recording");
+
+  // The DMA keeps running between recordings, so discard overflows that
+  // happened while nobody was reading
+  this->drain_i2s_events_();
+  this->overflow_count_ = 0;
+  this->read_error_count_ = 0;
+
   this->recording_ = true;
   ESP_LOGI(TAG, "Recording started");
   return true;
@@ -204,7 +224,8 @@ bool ES8311Component::start_recording() {
 
 void ES8311Component::stop_recording() {
   if (!this->recording_) return;
-  
+  perf_stats::trace_instant("es8311.stop_recording");
+
   this->recording_ = false;
   ESP_LOGI(TAG, "Recording stopped");
 }
@@ -213,16 +234,33 @@ size_t ES8311Component::read_samples(uint8_t *buffer, size_t max_size) {
   if (!this->initialized_ || !this->recording_) return 0;
   
   size_t bytes_read = 0;
+  perf_stats::TraceScope trace("es8311.i2s_read");
+  uint32_t start = micros();
   esp_err_t err = i2s_read(this->i2s_port_, buffer, max_size, &bytes_read, pdMS_TO_TICKS(20));
+  this->i2s_read_time_.record(micros() - start);
+
+  this->drain_i2s_events_();
   
   if (err != ESP_OK) {
-    ESP_LOGW(TAG, "I2S read error: %s", esp_err_to_name(err));
+    this->read_error_count_++;
+    DEFERRED_LOGW(TAG, "I2S read error: %s", esp_err_to_name(err));
     return 0;
   }
   
   return bytes_read;
 }
 
+void ES8311Component::drain_i2s_events_() {
+  if (this->i2s_event_queue_ == nullptr) return;
+
+  i2s_event_t event;
+  while (xQueueReceive(this->i2s_event_queue_, &event, 0) == pdTRUE) {
+    if (event.type == I2S_EVENT_RX_Q_OVF) {
+      this->overflow_count_++;
+    }
+  }
+}
+
 void ES8311Component::set_volume(uint8_t volume) {
   if (volume > 100) volume = 100;
   this->volume_ = volume;
@@ -233,5 +271,47 @@ void ES8311Component::set_volume(uint8_t volume) {
   }
 }
 
+bool ES8311Component::set_sample_rate(uint32_t rate) {
+  if (!this->initialized_) {
+    // Before setup: validated by codegen, applied by init_codec_()
+    this->sample_rate_ = rate;
+    return true;
+  }
+  if (rate == this->sample_rate_) return true;
+  if (this->recording_) {
+    ESP_LOGW(TAG, "Cannot change the sample rate while recording");
+    return false;
+  }
+  if (find_clock_coefficients(rate * this->mclk_multiple_, rate) == nullptr) {
+    ESP_LOGE(TAG, "Unsupported sample rate: %u Hz", (unsigned) rate);
+    return false;
+  }
+
+  perf_stats::TraceScope trace("es8311.set_sample_rate");
+  uint32_t previous = this->sample_rate_;
+  this->sample_rate_ = rate;
+  esp_err_t err = ESP_FAIL;
+  if (this->configure_clock_()) {
+    err = i2s_set_clk(this->i2s_port_, rate, (i2s_bits_per_sample_t) this->bits_per_sample_, I2S_CHANNEL_STEREO);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Cannot switch to %u Hz: %s", (unsigned) rate, esp_err_to_name(err));
+    this->sample_rate_ = previous;
+    this->configure_clock_();
+    return false;
+  }
+  // Drop overflows from the switch itself
+  this->drain_i2s_events_();
+  ESP_LOGI(TAG, "Sample rate changed to %u Hz", (unsigned) rate);
+  return true;
+}
+
+bool ES8311Component::set_adc_gain(uint8_t gain) {
+  if (gain > MIC_GAIN_42DB) return false;
+  if (this->initialized_ && !this->write_reg_(reg::ADC_GAIN, gain)) return false;
+  this->mic_gain_ = gain;
+  return true;
+}
+
 }  // namespace es8311
 }  // namespace esphome
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/core/automation.h"
 #include "esphome/core/hal.h"
 #include "esphome/components/i2c/i2c.h"
+#include "esphome/components/perf_stats/event_trace.h"
+#include "esphome/components/perf_stats/timing_histogram.h"
+#include "esphome/components/i2c_arbiter/i2c_arbiter.h"
+#include "clock_coefficients.h"
 #include <driver/i2s.h>
 
 namespace esphome {
@@ -57,9 +62,19 @@ class ES8311Component : public Component, public i2c::I2CDevice {
   void set_i2s_ws_pin(uint8_t pin) { this->i2s_ws_pin_ = pin; }
   void set_i2s_dout_pin(uint8_t pin) { this->i2s_dout_pin_ = pin; }
   void set_i2s_din_pin(uint8_t pin) { this->i2s_din_pin_ = pin; }
-  void set_sample_rate(uint32_t rate) { this->sample_rate_ = rate; }
+  // Takes effect at once when set after setup, outside a recording: a few
+  // clock register writes and an I2S clock change. False if the rate has no
+  // clock coefficients or a recording is running.
+  bool set_sample_rate(uint32_t rate);
+  // MCLK as a multiple of the sample rate, 256 or 384
+  void set_mclk_multiple(uint16_t multiple) { this->mclk_multiple_ = multiple; }
   void set_bits_per_sample(uint8_t bits) { this->bits_per_sample_ = bits; }
   void set_mic_gain(uint8_t gain) { this->mic_gain_ = gain; }
+  void set_bus_arbiter(i2c_arbiter::I2CArbiter *arbiter, i2c_arbiter::BusPriority priority, bool fast_mode_plus) {
+    this->bus_client_.set_priority(priority);
+    this->bus_client_.set_fast_mode_plus(fast_mode_plus);
+    arbiter->add_client(&this->bus_client_, "es8311");
+  }
 
   // Audio control
   bool start_recording();
@@ -70,15 +85,30 @@ class ES8311Component : public Component, public i2c::I2CDevice {
   // Returns number of bytes read
   size_t read_samples(uint8_t *buffer, size_t max_size);
 
+  // Capture format
+  uint32_t get_sample_rate() const { return this->sample_rate_; }
+  uint8_t get_bits_per_sample() const { return this->bits_per_sample_; }
+  // Bytes produced per second of stereo capture (I2S slots are 16 or 32 bits)
+  uint32_t get_byte_rate() const { return this->sample_rate_ * 2 * (this->bits_per_sample_ == 16 ? 2 : 4); }
+
+  // Capture health counters, reset by start_recording()
+  uint32_t get_overflow_count() const { return this->overflow_count_; }
+  uint32_t get_read_error_count() const { return this->read_error_count_; }
+
   // Set volume (0-100)
   void set_volume(uint8_t volume);
+  // Change the microphone PGA (ES8311MicGain) while running; false if out
+  // of range or the register write fails
+  bool set_adc_gain(uint8_t gain);
+  uint8_t get_mic_gain() const { return this->mic_gain_; }
 
  protected:
   bool write_reg_(uint8_t reg, uint8_t value);
   uint8_t read_reg_(uint8_t reg);
   bool init_codec_();
   bool init_i2s_();
-  void configure_clock_();
+  bool configure_clock_();
+  void drain_i2s_events_();
 
   GPIOPin *pa_enable_pin_{nullptr};
   uint8_t i2s_mclk_pin_{0};
@@ -87,6 +117,7 @@ class ES8311Component : public Component, public i2c::I2CDevice {
   uint8_t i2s_dout_pin_{0};
   uint8_t i2s_din_pin_{0};
   uint32_t sample_rate_{16000};
+  uint16_t mclk_multiple_{256};
   uint8_t bits_per_sample_{16};
   uint8_t mic_gain_{MIC_GAIN_30DB};
   uint8_t volume_{70};
@@ -94,6 +125,21 @@ class ES8311Component : public Component, public i2c::I2CDevice {
   bool initialized_{false};
   bool recording_{false};
   i2s_port_t i2s_port_{I2S_NUM_0};
+  QueueHandle_t i2s_event_queue_{nullptr};
+  uint32_t overflow_count_{0};
+  uint32_t read_error_count_{0};
+
+  // Execution time statistics
+  perf_stats::TimingHistogram i2c_time_{"es8311.i2c"};
+  perf_stats::TimingHistogram i2s_read_time_{"es8311.i2s_read"};
+  i2c_arbiter::BusClient bus_client_{"es8311.i2c_wait", i2c_arbiter::PRIORITY_LATENCY_CRITICAL};
+};
+
+template<typename... Ts> class SetSampleRateAction : public Action<Ts...>, public Parented<ES8311Component> {
+ public:
+  TEMPLATABLE_VALUE(uint32_t, sample_rate)
+
+  void play(Ts... x) override { this->parent_->set_sample_rate(this->sample_rate_.value(x...)); }
 };
 
 }  // namespace es8311
@@ -0,0 +1,75 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome import automation
+from esphome.components import i2c
+from esphome.const import CONF_ID, CONF_I2C_ID
+
+DEPENDENCIES = ["i2c"]
+AUTO_LOAD = ["perf_stats"]
+CODEOWNERS = ["@medallion"]
+MULTI_CONF = True
+
+CONF_I2C_ARBITER_ID = "i2c_arbiter_id"
+CONF_BUS_PRIORITY = "bus_priority"
+CONF_FAST_MODE_PLUS = "fast_mode_plus"
+
+i2c_arbiter_ns = cg.esphome_ns.namespace("i2c_arbiter")
+I2CArbiter = i2c_arbiter_ns.class_("I2CArbiter", cg.Component)
+BusPriority = i2c_arbiter_ns.enum("BusPriority")
+
+# Actions
+DumpAction = i2c_arbiter_ns.class_("DumpAction", automation.Action)
+
+BUS_PRIORITIES = {
+    "background": BusPriority.PRIORITY_BACKGROUND,
+    "latency_critical": BusPriority.PRIORITY_LATENCY_CRITICAL,
+}
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(I2CArbiter),
+        cv.GenerateID(CONF_I2C_ID): cv.use_id(i2c.InternalI2CBus),
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+DUMP_ACTION_SCHEMA = automation.maybe_simple_id(
+    {
+        cv.GenerateID(): cv.use_id(I2CArbiter),
+    }
+)
+
+
+def arbiter_client_schema(default_priority):
+    """Options of a device on an arbitrated bus, to extend its CONFIG_SCHEMA with."""
+    return cv.Schema(
+        {
+            cv.GenerateID(CONF_I2C_ARBITER_ID): cv.use_id(I2CArbiter),
+            cv.Optional(CONF_BUS_PRIORITY, default=default_priority): cv.enum(
+                BUS_PRIORITIES, lower=True
+            ),
+            cv.Optional(CONF_FAST_MODE_PLUS, default=False): cv.boolean,
+        }
+    )
+
+
+async def register_arbiter_client(var, config):
+    arbiter = await cg.get_variable(config[CONF_I2C_ARBITER_ID])
+    cg.add(
+        var.set_bus_arbiter(
+            arbiter, config[CONF_BUS_PRIORITY], config[CONF_FAST_MODE_PLUS]
+        )
+    )
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    bus = await cg.get_variable(config[CONF_I2C_ID])
+    cg.add(var.set_bus(bus))
+
+
+@automation.register_action("i2c_arbiter.dump", DumpAction, DUMP_ACTION_SCHEMA)
+async def dump_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
@@ -0,0 +1,111 @@
+#include "i2c_arbiter.h"
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <freertos/task.h>
+#ifdef USE_ARDUINO
+#include <esp32-hal-i2c.h>
+#endif
+
+namespace esphome {
+namespace i2c_arbiter {
+
+static const char *const TAG = "i2c_arbiter";
+
+I2CArbiter::I2CArbiter() { this->mutex_ = xSemaphoreCreateMutex(); }
+
+void I2CArbiter::dump_config() {
+  ESP_LOGCONFIG(TAG, "I2C Arbiter:");
+  for (const BusClient *client : this->clients_) {
+    ESP_LOGCONFIG(TAG, "  %s: %s%s", client->get_name(),
+                  client->get_priority() == PRIORITY_LATENCY_CRITICAL ? "latency-critical" : "background",
+                  client->is_fast_mode_plus() ? ", 1 MHz" : "");
+  }
+#ifndef USE_ARDUINO
+  for (const BusClient *client : this->clients_) {
+    if (client->is_fast_mode_plus()) {
+      ESP_LOGW(TAG, "  Fast-mode Plus needs the Arduino framework; %s runs at the bus frequency", client->get_name());
+    }
+  }
+#endif
+}
+
+void I2CArbiter::add_client(BusClient *client, const char *name) {
+  client->name_ = name;
+  client->arbiter_ = this;
+  this->clients_.push_back(client);
+}
+
+void I2CArbiter::dump_stats() {
+  ESP_LOGI(TAG, "I2C bus clients:");
+  for (const BusClient *client : this->clients_) {
+    const perf_stats::TimingHistogram &wait = client->get_wait_time();
+    ESP_LOGI(TAG, "  %s: %u transactions, %u bytes, %u contended; wait avg %u us, p99 %u us, max %u us",
+             client->get_name(), (unsigned) client->get_transactions(), (unsigned) client->get_bytes(),
+             (unsigned) client->get_contended(), (unsigned) wait.get_avg(), (unsigned) wait.get_percentile(99),
+             (unsigned) wait.get_max());
+  }
+}
+
+bool I2CArbiter::acquire_(BusClient *client) {
+  const bool critical = client->priority_ == PRIORITY_LATENCY_CRITICAL;
+  if (xSemaphoreTake(this->mutex_, 0) == pdTRUE) {
+    if (critical || this->critical_waiting_.load() == 0) return false;
+    xSemaphoreGive(this->mutex_);
+  }
+  if (critical) {
+    this->critical_waiting_++;
+    xSemaphoreTake(this->mutex_, portMAX_DELAY);
+    this->critical_waiting_--;
+    return true;
+  }
+  while (true) {
+    xSemaphoreTake(this->mutex_, portMAX_DELAY);
+    if (this->critical_waiting_.load() == 0) return true;
+    // A latency-critical client is queued behind us: hand the bus over,
+    // and sleep a tick so it runs even from a lower task priority
+    xSemaphoreGive(this->mutex_);
+    vTaskDelay(1);
+  }
+}
+
+void I2CArbiter::release_() { xSemaphoreGive(this->mutex_); }
+
+void I2CArbiter::set_frequency_(uint32_t frequency) {
+#ifdef USE_ARDUINO
+  // 0: the bus's own frequency, which is only off after a 1 MHz client
+  if (frequency == 0 && this->base_frequency_ == 0) return;
+  uint8_t port = this->bus_->get_port();
+  if (this->base_frequency_ == 0) {
+    if (i2cGetClock(port, &this->base_frequency_) != ESP_OK || this->base_frequency_ == 0) return;
+    this->frequency_ = this->base_frequency_;
+  }
+  if (frequency == 0) frequency = this->base_frequency_;
+  if (frequency == this->frequency_) return;
+  if (i2cSetClock(port, frequency) == ESP_OK) {
+    this->frequency_ = frequency;
+  } else {
+    ESP_LOGW(TAG, "Cannot set the bus to %u Hz", (unsigned) frequency);
+  }
+#endif
+}
+
+BusTransaction::BusTransaction(BusClient &client, size_t bytes) : arbiter_(client.arbiter_) {
+  client.transactions_++;
+  client.bytes_ += bytes;
+  if (this->arbiter_ == nullptr) return;
+
+  uint32_t start = micros();
+  if (this->arbiter_->acquire_(&client)) client.contended_++;
+  uint32_t waited = micros() - start;
+  client.wait_time_.record(waited);
+  client.lifetime_wait_.record(waited);
+  this->arbiter_->set_frequency_(client.fast_mode_plus_ ? FAST_MODE_PLUS_FREQUENCY : 0);
+}
+
+BusTransaction::~BusTransaction() {
+  if (this->arbiter_ != nullptr) this->arbiter_->release_();
+}
+
+}  // namespace i2c_arbiter
+}  // namespace esphome
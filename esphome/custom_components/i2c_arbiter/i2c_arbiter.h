@@ -0,0 +1,122 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/automation.h"
+#include "esphome/components/i2c/i2c_bus.h"
+#include "esphome/components/perf_stats/timing_histogram.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace i2c_arbiter {
+
+enum BusPriority : uint8_t {
+  // Telemetry and housekeeping: yields to latency-critical transactions
+  PRIORITY_BACKGROUND,
+  // Touch reports and codec control
+  PRIORITY_LATENCY_CRITICAL,
+};
+
+static constexpr uint32_t FAST_MODE_PLUS_FREQUENCY = 1000000;
+
+class I2CArbiter;
+
+// One device's share of an arbitrated bus: its priority and clock, and
+// counters of its transactions. Without an arbiter it only counts.
+class BusClient {
+ public:
+  // Registers the wait time histogram under `wait_name` (string literal),
+  // so it can be published through perf_stats
+  BusClient(const char *wait_name, BusPriority priority) : priority_(priority), wait_time_(wait_name) {}
+
+  void set_priority(BusPriority priority) { this->priority_ = priority; }
+  // Run this device's transactions at 1 MHz (Fast-mode Plus); the bus
+  // returns to its own frequency for everyone else
+  void set_fast_mode_plus(bool fast_mode_plus) { this->fast_mode_plus_ = fast_mode_plus; }
+
+  const char *get_name() const { return this->name_; }
+  I2CArbiter *get_arbiter() const { return this->arbiter_; }
+  BusPriority get_priority() const { return this->priority_; }
+  bool is_fast_mode_plus() const { return this->fast_mode_plus_; }
+  uint32_t get_transactions() const { return this->transactions_.load(); }
+  uint32_t get_bytes() const { return this->bytes_.load(); }
+  // Transactions that found the bus taken
+  uint32_t get_contended() const { return this->contended_.load(); }
+  // Time from asking for the bus to holding it, since boot
+  const perf_stats::TimingHistogram &get_wait_time() const { return this->lifetime_wait_; }
+
+ protected:
+  friend class I2CArbiter;
+  friend class BusTransaction;
+
+  const char *name_{""};
+  I2CArbiter *arbiter_{nullptr};
+  BusPriority priority_;
+  bool fast_mode_plus_{false};
+  std::atomic<uint32_t> transactions_{0};
+  std::atomic<uint32_t> bytes_{0};
+  std::atomic<uint32_t> contended_{0};
+  // perf_stats window, and since boot
+  perf_stats::TimingHistogram wait_time_;
+  perf_stats::TimingHistogram lifetime_wait_;
+};
+
+// Serializes the transactions of every device on one I2C bus. A background
+// client that gets the bus while a latency-critical one is waiting hands it
+// over first, so touch and codec traffic never queue behind telemetry for
+// longer than the transaction already on the wire.
+class I2CArbiter : public Component {
+ public:
+  I2CArbiter();
+
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::BUS; }
+
+  void set_bus(i2c::InternalI2CBus *bus) { this->bus_ = bus; }
+  // Register `client` as device `name` (string literal) on this bus
+  void add_client(BusClient *client, const char *name);
+
+  // Log the counters of every client
+  void dump_stats();
+
+ protected:
+  friend class BusTransaction;
+
+  // Take the bus for `client`; true if it had to wait
+  bool acquire_(BusClient *client);
+  void release_();
+  void set_frequency_(uint32_t frequency);
+
+  i2c::InternalI2CBus *bus_{nullptr};
+  SemaphoreHandle_t mutex_{nullptr};
+  std::atomic<uint8_t> critical_waiting_{0};
+  // The bus's configured frequency, read on the first switch to 1 MHz
+  uint32_t base_frequency_{0};
+  uint32_t frequency_{0};
+  std::vector<BusClient *> clients_;
+};
+
+// Holds the bus for the lifetime of the scope: one register access or
+// burst read of `bytes` bytes, register address included
+class BusTransaction {
+ public:
+  BusTransaction(BusClient &client, size_t bytes);
+  ~BusTransaction();
+  BusTransaction(const BusTransaction &) = delete;
+  BusTransaction &operator=(const BusTransaction &) = delete;
+
+ protected:
+  I2CArbiter *arbiter_;
+};
+
+template<typename... Ts> class DumpAction : public Action<Ts...>, public Parented<I2CArbiter> {
+ public:
+  void play(Ts... x) override { this->parent_->dump_stats(); }
+};
+
+}  // namespace i2c_arbiter
+}  // namespace esphome
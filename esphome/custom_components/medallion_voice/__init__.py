@@ -1,16 +1,52 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome import pins, automation
-from esphome.components import spi
-from esphome.const import CONF_ID
+from esphome.components import spi, web_server_base
+from esphome.components.deferred_log import CONF_DEFERRED_LOG_ID, DeferredLogComponent
+from esphome.components.perf_stats import CONF_PERF_STATS_ID, PerfStatsComponent
+from esphome.components.web_server_base import CONF_WEB_SERVER_BASE_ID
+from esphome.const import (
+    CONF_HOST,
+    CONF_ID,
+    CONF_ON_STATE,
+    CONF_PATH,
+    CONF_PORT,
+    CONF_SAMPLE_RATE,
+    CONF_TRIGGER_ID,
+)
 
 DEPENDENCIES = ["es8311"]
+AUTO_LOAD = ["sensor", "text_sensor", "binary_sensor", "perf_stats", "buffer_pool", "deferred_log"]
 CODEOWNERS = ["@medallion"]
 
+CONF_MEDALLION_VOICE_ID = "medallion_voice_id"
 CONF_AUDIO_CODEC_ID = "audio_codec_id"
 CONF_SD_CS_PIN = "sd_cs_pin"
 CONF_SD_SPI_ID = "sd_spi_id"
 CONF_UPLOAD_URL = "upload_url"
+CONF_RESUMABLE_UPLOAD = "resumable_upload"
+CONF_UPLOAD_CHUNK_SIZE = "upload_chunk_size"
+CONF_CA_CERTIFICATE = "ca_certificate"
+CONF_SEGMENT_DURATION = "segment_duration"
+CONF_CHECKPOINT_INTERVAL = "checkpoint_interval"
+CONF_PENDING_ONLY = "pending_only"
+CONF_STORAGE_SLOTS = "storage_slots"
+CONF_COUNT = "count"
+CONF_SIZE_MB = "size_mb"
+CONF_HTTP_DOWNLOAD = "http_download"
+CONF_LIVE_STREAM = "live_stream"
+CONF_FRAME_DURATION = "frame_duration"
+CONF_FILE_FORMAT = "file_format"
+CONF_AUDIO_PROCESSING = "audio_processing"
+CONF_HIGH_PASS = "high_pass"
+CONF_AGC = "agc"
+CONF_TARGET_LEVEL = "target_level"
+CONF_MAX_GAIN = "max_gain"
+CONF_PGA_CONTROL = "pga_control"
+CONF_LOG_FILE = "log_file"
+CONF_SIZE_KB = "size_kb"
+CONF_FILES = "files"
 
 medallion_voice_ns = cg.esphome_ns.namespace("medallion_voice")
 MedallionVoiceComponent = medallion_voice_ns.class_("MedallionVoiceComponent", cg.Component)
@@ -23,16 +59,169 @@ ES8311Component = es8311_ns.class_("ES8311Component")
 StartRecordingAction = medallion_voice_ns.class_("StartRecordingAction", automation.Action)
 StopRecordingAction = medallion_voice_ns.class_("StopRecordingAction", automation.Action)
 UploadAction = medallion_voice_ns.class_("UploadAction", automation.Action)
+SaveTraceAction = medallion_voice_ns.class_("SaveTraceAction", automation.Action)
+ListRecordingsAction = medallion_voice_ns.class_("ListRecordingsAction", automation.Action)
+
+# Triggers
+RecorderState = medallion_voice_ns.enum("RecorderState", is_class=True)
+StateTrigger = medallion_voice_ns.class_(
+    "StateTrigger", automation.Trigger.template(RecorderState, RecorderState)
+)
+
+
+def _validate_segments(config):
+    # Finished segments are handed to the background uploader, which is
+    # the resumable one
+    if CONF_SEGMENT_DURATION in config and not config[CONF_RESUMABLE_UPLOAD]:
+        raise cv.Invalid(
+            f"{CONF_SEGMENT_DURATION} requires {CONF_RESUMABLE_UPLOAD}: true"
+        )
+    # A slot is longer than its recording; only the WAV header tells how
+    # much of it is audio
+    if config[CONF_FILE_FORMAT] == "flac" and CONF_STORAGE_SLOTS in config:
+        raise cv.Invalid(f"{CONF_STORAGE_SLOTS} requires {CONF_FILE_FORMAT}: wav")
+    return config
+
+
+def _final_validate_stream(config):
+    # One packet per Ethernet frame: MAX_FRAME_BYTES in RtpStreamer. Without
+    # a rate of its own the stream runs at the codec's, which is only known
+    # once the whole configuration is.
+    if CONF_LIVE_STREAM not in config:
+        return config
+    stream = config[CONF_LIVE_STREAM]
+    rate = stream.get(CONF_SAMPLE_RATE)
+    if rate is None:
+        full_config = fv.full_config.get()
+        path = full_config.get_path_for_id(config[CONF_AUDIO_CODEC_ID])[:-1]
+        rate = full_config.get_config_for_path(path)[CONF_SAMPLE_RATE]
+    frame_bytes = rate * 4 * stream[CONF_FRAME_DURATION] // 1000
+    if frame_bytes > 1280:
+        raise cv.Invalid(
+            f"{stream[CONF_FRAME_DURATION]} ms packets at {rate} Hz exceed 1280 bytes; "
+            f"shorten {CONF_FRAME_DURATION} or set a lower {CONF_SAMPLE_RATE}",
+            path=[CONF_LIVE_STREAM],
+        )
+    return config
+
+
+def _validate_download_path(value):
+    value = cv.string_strict(value).rstrip("/")
+    if not value.startswith("/") or len(value) < 2:
+        raise cv.Invalid("Download path must start with / and not be the root")
+    return value
 
-CONFIG_SCHEMA = cv.Schema(
+
+CONFIG_SCHEMA = cv.All(cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(MedallionVoiceComponent),
         cv.Required(CONF_AUDIO_CODEC_ID): cv.use_id(ES8311Component),
         cv.Required(CONF_SD_CS_PIN): pins.gpio_output_pin_schema,
         cv.Optional(CONF_SD_SPI_ID): cv.use_id(spi.SPIComponent),
         cv.Required(CONF_UPLOAD_URL): cv.string,
+        # PEM certificate that signed the server's certificate (https:// only)
+        cv.Optional(CONF_CA_CERTIFICATE): cv.string,
+        cv.Optional(CONF_RESUMABLE_UPLOAD, default=False): cv.boolean,
+        cv.Optional(CONF_UPLOAD_CHUNK_SIZE, default=16384): cv.int_range(
+            min=1024, max=262144
+        ),
+        cv.Optional(CONF_SEGMENT_DURATION): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(seconds=10)),
+        ),
+        # flac: lossless, typically half the size of WAV for speech, at the
+        # cost of encoding on the capture path
+        cv.Optional(CONF_FILE_FORMAT, default="wav"): cv.one_of("wav", "flac", lower=True),
+        # Rate of the recordings when it differs from the codec's; captured
+        # audio is resampled on the way to SD
+        cv.Optional(CONF_SAMPLE_RATE): cv.int_range(min=8000, max=48000),
+        # Conditioning of the captured audio, ahead of every consumer
+        cv.Optional(CONF_AUDIO_PROCESSING): cv.Schema(
+            {
+                # Removes DC offset and rumble; 0Hz turns it off
+                cv.Optional(CONF_HIGH_PASS, default="80Hz"): cv.All(
+                    cv.frequency, cv.Range(min=0, max=1000)
+                ),
+                # Automatic gain towards target_level RMS (dBFS), with a
+                # limiter at -1 dBFS
+                cv.Optional(CONF_AGC): cv.Schema(
+                    {
+                        cv.Optional(CONF_TARGET_LEVEL, default=-18): cv.int_range(
+                            min=-40, max=-6
+                        ),
+                        cv.Optional(CONF_MAX_GAIN, default=24): cv.int_range(
+                            min=0, max=40
+                        ),
+                        # Also step the ES8311 microphone gain in 6 dB steps
+                        cv.Optional(CONF_PGA_CONTROL, default=False): cv.boolean,
+                    }
+                ),
+            }
+        ),
+        # How much audio a reset can cost; each checkpoint is one header
+        # rewrite and a sync
+        cv.Optional(CONF_CHECKPOINT_INTERVAL, default="2s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=500), max=cv.TimePeriod(minutes=5)),
+        ),
+        # Preallocated recording files, reused oldest-uploaded first. One
+        # slot holds size_mb of audio (about 16 s per MiB).
+        cv.Optional(CONF_STORAGE_SLOTS): cv.Schema(
+            {
+                cv.Required(CONF_COUNT): cv.int_range(min=2, max=255),
+                cv.Required(CONF_SIZE_MB): cv.int_range(min=1, max=4095),
+            }
+        ),
+        # RTP copy of the audio being recorded, for live monitoring
+        cv.Optional(CONF_LIVE_STREAM): cv.Schema(
+            {
+                cv.Required(CONF_HOST): cv.string_strict,
+                cv.Optional(CONF_PORT, default=5004): cv.port,
+                # Stream rate, independent of the recordings'; defaults to
+                # the codec's
+                cv.Optional(CONF_SAMPLE_RATE): cv.int_range(min=8000, max=48000),
+                cv.Optional(CONF_FRAME_DURATION, default="20ms"): cv.All(
+                    cv.positive_time_period_milliseconds,
+                    cv.Range(
+                        min=cv.TimePeriod(milliseconds=10),
+                        max=cv.TimePeriod(milliseconds=20),
+                    ),
+                ),
+            }
+        ),
+        # Runs on every state change, with the new `state` and the
+        # `previous` one
+        cv.Optional(CONF_ON_STATE): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(StateTrigger),
+            }
+        ),
+        # Copy of the deferred log in a rotating file on the card
+        cv.Optional(CONF_LOG_FILE): cv.Schema(
+            {
+                cv.GenerateID(CONF_DEFERRED_LOG_ID): cv.use_id(DeferredLogComponent),
+                # Room for ".<n>" in LogFile::rotate_()'s 48-byte names
+                cv.Optional(CONF_PATH, default="/medallion.log"): cv.All(
+                    cv.string_strict, cv.Length(min=1, max=44)
+                ),
+                cv.Optional(CONF_SIZE_KB, default=256): cv.int_range(min=16, max=65536),
+                # Older files kept, <path>.1 being the newest
+                cv.Optional(CONF_FILES, default=3): cv.int_range(min=0, max=9),
+            }
+        ),
+        # List and download recordings on the web server
+        cv.Optional(CONF_HTTP_DOWNLOAD): cv.Schema(
+            {
+                cv.GenerateID(CONF_WEB_SERVER_BASE_ID): cv.use_id(
+                    web_server_base.WebServerBase
+                ),
+                cv.Optional(CONF_PATH, default="/recordings"): _validate_download_path,
+            }
+        ),
     }
-).extend(cv.COMPONENT_SCHEMA)
+).extend(cv.COMPONENT_SCHEMA), _validate_segments)
+
+FINAL_VALIDATE_SCHEMA = _final_validate_stream
 
 # Action schemas
 START_RECORDING_ACTION_SCHEMA = automation.maybe_simple_id(
@@ -53,6 +242,21 @@ UPLOAD_ACTION_SCHEMA = automation.maybe_simple_id(
     }
 )
 
+SAVE_TRACE_ACTION_SCHEMA = automation.maybe_simple_id(
+    {
+        cv.GenerateID(): cv.use_id(MedallionVoiceComponent),
+        cv.GenerateID(CONF_PERF_STATS_ID): cv.use_id(PerfStatsComponent),
+        cv.Optional(CONF_PATH, default="/trace.json"): cv.string_strict,
+    }
+)
+
+LIST_RECORDINGS_ACTION_SCHEMA = automation.maybe_simple_id(
+    {
+        cv.GenerateID(): cv.use_id(MedallionVoiceComponent),
+        cv.Optional(CONF_PENDING_ONLY, default=False): cv.templatable(cv.boolean),
+    }
+)
+
 
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
@@ -68,6 +272,58 @@ async def to_code(config):
 
     # Upload URL
     cg.add(var.set_upload_url(config[CONF_UPLOAD_URL]))
+    cg.add(var.set_resumable_upload(config[CONF_RESUMABLE_UPLOAD]))
+    cg.add(var.set_upload_chunk_size(config[CONF_UPLOAD_CHUNK_SIZE]))
+    if CONF_CA_CERTIFICATE in config:
+        cg.add(var.set_ca_certificate(config[CONF_CA_CERTIFICATE]))
+    cg.add(var.set_checkpoint_interval(config[CONF_CHECKPOINT_INTERVAL]))
+    if config[CONF_FILE_FORMAT] == "flac":
+        cg.add(var.set_flac(True))
+    if CONF_SAMPLE_RATE in config:
+        cg.add(var.set_sample_rate(config[CONF_SAMPLE_RATE]))
+    if CONF_AUDIO_PROCESSING in config:
+        processing = config[CONF_AUDIO_PROCESSING]
+        cg.add(var.set_highpass_cutoff(int(processing[CONF_HIGH_PASS])))
+        if CONF_AGC in processing:
+            agc = processing[CONF_AGC]
+            cg.add(
+                var.set_agc(
+                    agc[CONF_TARGET_LEVEL], agc[CONF_MAX_GAIN], agc[CONF_PGA_CONTROL]
+                )
+            )
+    if CONF_SEGMENT_DURATION in config:
+        cg.add(var.set_segment_duration(config[CONF_SEGMENT_DURATION]))
+    if CONF_STORAGE_SLOTS in config:
+        slots = config[CONF_STORAGE_SLOTS]
+        cg.add(var.set_storage_slots(slots[CONF_COUNT], slots[CONF_SIZE_MB] * 1024 * 1024))
+    if CONF_LIVE_STREAM in config:
+        stream = config[CONF_LIVE_STREAM]
+        cg.add(
+            var.set_stream_target(
+                stream[CONF_HOST], stream[CONF_PORT], stream[CONF_FRAME_DURATION]
+            )
+        )
+        if CONF_SAMPLE_RATE in stream:
+            cg.add(var.set_stream_sample_rate(stream[CONF_SAMPLE_RATE]))
+    if CONF_LOG_FILE in config:
+        log_file = config[CONF_LOG_FILE]
+        deferred_log = await cg.get_variable(log_file[CONF_DEFERRED_LOG_ID])
+        cg.add(
+            var.set_log_file(
+                deferred_log, log_file[CONF_PATH], log_file[CONF_SIZE_KB] * 1024, log_file[CONF_FILES]
+            )
+        )
+    if CONF_HTTP_DOWNLOAD in config:
+        download = config[CONF_HTTP_DOWNLOAD]
+        base = await cg.get_variable(download[CONF_WEB_SERVER_BASE_ID])
+        cg.add(var.set_download_server(base, download[CONF_PATH]))
+        cg.add_define("USE_MEDALLION_VOICE_DOWNLOAD")
+
+    for conf in config.get(CONF_ON_STATE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(
+            trigger, [(RecorderState, "state"), (RecorderState, "previous")], conf
+        )
 
     # Add SdFat library
     cg.add_library("greiman/SdFat", "2.2.2")
@@ -98,3 +354,26 @@ async def upload_action_to_code(config, action_id, template_arg, args):
     var = cg.new_Pvariable(action_id, template_arg)
     await cg.register_parented(var, config[CONF_ID])
     return var
+
+
+@automation.register_action(
+    "medallion_voice.list_recordings", ListRecordingsAction, LIST_RECORDINGS_ACTION_SCHEMA
+)
+async def list_recordings_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    pending_only = await cg.templatable(config[CONF_PENDING_ONLY], args, bool)
+    cg.add(var.set_pending_only(pending_only))
+    return var
+
+
+@automation.register_action(
+    "medallion_voice.save_trace", SaveTraceAction, SAVE_TRACE_ACTION_SCHEMA
+)
+async def save_trace_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    stats = await cg.get_variable(config[CONF_PERF_STATS_ID])
+    cg.add(var.set_perf_stats(stats))
+    cg.add(var.set_path(config[CONF_PATH]))
+    return var
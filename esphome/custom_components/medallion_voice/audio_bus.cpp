@@ -0,0 +1,95 @@
+#include "audio_bus.h"
+#include "esphome/core/log.h"
+#include <esp_timer.h>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.bus";
+
+AudioBlock *AudioConsumer::receive(TickType_t wait) {
+  AudioBlock *block;
+  if (xQueueReceive(this->queue_, &block, wait) != pdTRUE) return nullptr;
+  return block;
+}
+
+void AudioConsumer::release(AudioBlock *block) { this->bus_->release(block); }
+
+void AudioConsumer::flush() {
+  AudioBlock *block;
+  while ((block = this->receive(0)) != nullptr) this->release(block);
+}
+
+void AudioConsumer::reset_stats() {
+  this->delivered_.store(0);
+  this->dropped_.store(0);
+  this->max_lag_.store(0);
+}
+
+AudioConsumer *AudioBus::add_consumer(const char *name, uint8_t depth) {
+  auto *consumer = new AudioConsumer();
+  consumer->bus_ = this;
+  consumer->name_ = name;
+  consumer->depth_ = depth;
+  consumer->queue_ = xQueueCreate(depth, sizeof(AudioBlock *));
+  if (consumer->queue_ == nullptr) {
+    ESP_LOGE(TAG, "Failed to create queue for %s", name);
+    delete consumer;
+    return nullptr;
+  }
+  this->consumers_.push_back(consumer);
+  return consumer;
+}
+
+bool AudioBus::setup(size_t block_size) {
+  // Every consumer's queue full, each consumer holding one more block, and
+  // the one being filled. Consumers fall behind independently, so their
+  // queues can hold different blocks and each counts in full.
+  size_t count = 1;
+  for (AudioConsumer *consumer : this->consumers_) count += consumer->depth_ + 1;
+
+  // Internal RAM: every block is filled by I2S, hashed, written to SD and
+  // byte-swapped for RTP, each pass slower from PSRAM
+  if (!this->pool_.reserve(block_size, count)) return false;
+  this->blocks_ = new AudioBlock[count];
+  ESP_LOGD(TAG, "%u blocks of %u bytes for %u consumers", (unsigned) count, (unsigned) block_size,
+           (unsigned) this->consumers_.size());
+  return true;
+}
+
+AudioBlock *AudioBus::acquire() {
+  uint8_t *data = this->pool_.acquire();
+  if (data == nullptr) return nullptr;
+  AudioBlock *block = &this->blocks_[this->pool_.index_of(data)];
+  block->data = data;
+  block->length = 0;
+  block->refs.store(1);  // the producer's, until publish()
+  return block;
+}
+
+void AudioBus::publish(AudioBlock *block) {
+  block->sequence = this->sequence_++;
+  block->capture_us = esp_timer_get_time();
+  for (AudioConsumer *consumer : this->consumers_) {
+    if (!consumer->active_.load()) continue;
+    block->refs++;
+    if (xQueueSend(consumer->queue_, &block, 0) != pdTRUE) {
+      block->refs--;
+      consumer->dropped_++;
+      continue;
+    }
+    consumer->delivered_++;
+    uint32_t lag = uxQueueMessagesWaiting(consumer->queue_);
+    if (lag > consumer->max_lag_.load()) consumer->max_lag_.store(lag);
+  }
+  this->release(block);
+}
+
+void AudioBus::release(AudioBlock *block) {
+  if (block->refs.fetch_sub(1) == 1) {
+    this->pool_.release(block->data);
+  }
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "esphome/components/buffer_pool/block_pool.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace medallion_voice {
+
+// One block of captured PCM, shared read-only by every consumer it was
+// delivered to and returned to the pool when the last one releases it
+struct AudioBlock {
+  uint8_t *data;
+  size_t length;
+  uint32_t sequence;    // consecutive per published block
+  int64_t capture_us;   // esp_timer time of publish(), right after the I2S read
+  std::atomic<uint8_t> refs{0};
+};
+
+class AudioBus;
+
+// A registered reader of the bus. Blocks are queued to it by pointer, at
+// most `depth` at a time; a block that finds the queue full is not delivered
+// and counts as dropped, so a slow consumer loses audio instead of holding
+// up capture. receive() and release() may be called from any one task.
+class AudioConsumer {
+ public:
+  // Next block, waiting up to `wait`; nullptr if none. Must be released.
+  AudioBlock *receive(TickType_t wait);
+  void release(AudioBlock *block);
+
+  // Inactive consumers are skipped by publish()
+  void set_active(bool active) { this->active_.store(active); }
+  // Release everything queued, e.g. when recording stops
+  void flush();
+  void reset_stats();
+
+  const char *get_name() const { return this->name_; }
+  uint32_t get_delivered() const { return this->delivered_.load(); }
+  uint32_t get_dropped() const { return this->dropped_.load(); }
+  // Most blocks that were waiting in the queue at once
+  uint32_t get_max_lag() const { return this->max_lag_.load(); }
+
+ protected:
+  friend class AudioBus;
+
+  AudioBus *bus_{nullptr};
+  const char *name_{nullptr};
+  uint8_t depth_{0};
+  QueueHandle_t queue_{nullptr};
+  std::atomic<bool> active_{false};
+  std::atomic<uint32_t> delivered_{0};
+  std::atomic<uint32_t> dropped_{0};
+  std::atomic<uint32_t> max_lag_{0};
+};
+
+// Fan-out of captured audio without copies. The capture loop takes a free
+// block from the "audio_bus" buffer pool, reads I2S straight into it and
+// publishes it; every active consumer gets the same block by pointer. The
+// pool is sized from the consumers' queue depths, so it cannot run dry while
+// each consumer holds at most one block outside its queue.
+class AudioBus {
+ public:
+  // Register before setup()
+  AudioConsumer *add_consumer(const char *name, uint8_t depth);
+  bool setup(size_t block_size);
+
+  // Producer side, from one task
+  AudioBlock *acquire();
+  void publish(AudioBlock *block);
+  // Hand back a block that was acquired but not published
+  void discard(AudioBlock *block) { this->release(block); }
+
+  void release(AudioBlock *block);
+
+  size_t get_block_size() const { return this->pool_.get_block_size(); }
+  size_t get_pool_size() const { return this->pool_.get_block_count(); }
+  const std::vector<AudioConsumer *> &get_consumers() const { return this->consumers_; }
+  // acquire() found the pool empty
+  uint32_t get_overruns() const { return this->pool_.get_failures(); }
+
+ protected:
+  std::vector<AudioConsumer *> consumers_;
+  // Sample data; blocks_[i] describes the pool's block i
+  buffer_pool::BlockPool pool_{"audio_bus", buffer_pool::REGION_INTERNAL_DMA};
+  AudioBlock *blocks_{nullptr};
+  uint32_t sequence_{0};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,170 @@
+#include "audio_frontend.h"
+#include <cmath>
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const int COEF_BITS = 28;
+static const int GAIN_BITS = 12;
+// -1 dBFS, the most a block may reach after the gain
+static const int32_t LIMIT_LEVEL = 29205;
+// A peak this close to full scale means the ADC itself clipped
+static const int32_t CLIP_LEVEL = 32000;
+// Blocks quieter than this hold the gain
+static const float GATE_DBFS = -55.0f;
+static const float MIN_GAIN_DB = -12.0f;
+static const float ATTACK_DB_PER_S = 40.0f;
+static const float RELEASE_DB_PER_S = 6.0f;
+// How long the AGC must sit at the end of its range before asking for a
+// PGA step, and how long to wait after one before asking again
+static const uint32_t PGA_PINNED_SECONDS = 2;
+static const uint32_t PGA_HOLDOFF_SECONDS = 1;
+static const float PGA_STEP_DB = 6.0f;
+
+static inline int16_t saturate(int32_t sample) {
+  return sample > INT16_MAX ? INT16_MAX : sample < INT16_MIN ? INT16_MIN : sample;
+}
+
+void AudioFrontEnd::setup(uint32_t sample_rate, uint8_t channels) {
+  this->sample_rate_ = sample_rate;
+  this->channels_ = channels > MAX_CHANNELS ? MAX_CHANNELS : channels;
+  if (this->highpass_hz_ * 2 >= sample_rate) this->highpass_hz_ = 0;
+  if (this->highpass_hz_ > 0) {
+    // RBJ cookbook high-pass with Q = 1/sqrt(2), i.e. Butterworth
+    double w0 = 2.0 * M_PI * this->highpass_hz_ / sample_rate;
+    double cosw = cos(w0);
+    double alpha = sin(w0) / (2.0 * M_SQRT1_2);
+    double a0 = 1.0 + alpha;
+    double scale = (double) (1 << COEF_BITS) / a0;
+    this->b0_ = lround((1.0 + cosw) / 2.0 * scale);
+    this->b1_ = lround(-(1.0 + cosw) * scale);
+    this->b2_ = this->b0_;
+    this->a1_ = lround(-2.0 * cosw * scale);
+    this->a2_ = lround((1.0 - alpha) * scale);
+  }
+  this->gain_db_ = 0.0f;
+  this->gain_q12_ = 1 << GAIN_BITS;
+  this->reset();
+}
+
+void AudioFrontEnd::reset() {
+  memset(this->state_, 0, sizeof(this->state_));
+  this->pga_request_ = 0;
+  this->pinned_samples_ = 0;
+  this->pga_holdoff_samples_ = 0;
+}
+
+void AudioFrontEnd::pga_changed(int8_t steps) {
+  // The analog gain moved, take the same out of the digital gain
+  float change = steps * PGA_STEP_DB;
+  this->gain_db_ -= change;
+  this->gain_q12_ = lroundf(this->gain_q12_ * powf(10.0f, -change / 20.0f));
+  this->pga_request_ = 0;
+  this->pinned_samples_ = 0;
+  this->pga_holdoff_samples_ = this->sample_rate_ * PGA_HOLDOFF_SECONDS;
+}
+
+void AudioFrontEnd::highpass_(int16_t *samples, size_t frames) {
+  const uint8_t channels = this->channels_;
+  const int64_t b0 = this->b0_, b1 = this->b1_, b2 = this->b2_, a1 = this->a1_, a2 = this->a2_;
+  for (uint8_t c = 0; c < channels; c++) {
+    // State in locals so the loop runs from registers
+    BiquadState &state = this->state_[c];
+    int32_t x1 = state.x1, x2 = state.x2, y1 = state.y1, y2 = state.y2;
+    int64_t error = state.error;
+    int16_t *sample = samples + c;
+    for (size_t i = 0; i < frames; i++, sample += channels) {
+      int32_t x = *sample;
+      int64_t acc = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2 + error;
+      int32_t y = (int32_t) (acc >> COEF_BITS);
+      // What the shift dropped goes into the next output, so the
+      // truncation adds no DC and little low-frequency noise
+      error = acc - ((int64_t) y << COEF_BITS);
+      x2 = x1;
+      x1 = x;
+      y2 = y1;
+      y1 = y;
+      *sample = saturate(y);
+    }
+    state = {x1, x2, y1, y2, error};
+  }
+}
+
+float AudioFrontEnd::next_gain_db_(uint64_t sum_squares, size_t count, int32_t peak) {
+  const uint32_t frames = count / this->channels_;
+  const float seconds = (float) frames / this->sample_rate_;
+  float level_dbfs = sum_squares == 0 ? -120.0f : 10.0f * log10f((float) sum_squares / count / (32768.0f * 32768.0f));
+  bool active = level_dbfs > GATE_DBFS;
+  if (active) {
+    float desired = this->target_dbfs_ - level_dbfs;
+    desired = fminf(fmaxf(desired, MIN_GAIN_DB), (float) this->max_gain_db_);
+    if (desired < this->gain_db_) {
+      this->gain_db_ = fmaxf(desired, this->gain_db_ - ATTACK_DB_PER_S * seconds);
+    } else {
+      this->gain_db_ = fminf(desired, this->gain_db_ + RELEASE_DB_PER_S * seconds);
+    }
+  }
+
+  if (this->pga_control_) {
+    this->pga_holdoff_samples_ = this->pga_holdoff_samples_ > frames ? this->pga_holdoff_samples_ - frames : 0;
+    bool high = active && this->gain_db_ >= this->max_gain_db_ - 0.5f;
+    bool low = this->gain_db_ <= MIN_GAIN_DB + 0.5f;
+    this->pinned_samples_ = high || low ? this->pinned_samples_ + frames : 0;
+    if (this->pga_holdoff_samples_ == 0) {
+      if (peak >= CLIP_LEVEL) {
+        this->pga_request_ = -1;
+      } else if (this->pinned_samples_ >= this->sample_rate_ * PGA_PINNED_SECONDS) {
+        this->pga_request_ = high ? 1 : -1;
+      } else {
+        this->pga_request_ = 0;
+      }
+    }
+  }
+  return this->gain_db_;
+}
+
+void AudioFrontEnd::process(int16_t *samples, size_t frames) {
+  if (frames == 0) return;
+  if (this->highpass_hz_ > 0) this->highpass_(samples, frames);
+  if (!this->agc_enabled_) return;
+
+  const uint8_t channels = this->channels_;
+  const size_t count = frames * channels;
+  uint64_t sum_squares = 0;
+  int32_t peak = 0;
+  for (size_t i = 0; i < count; i++) {
+    int32_t sample = samples[i];
+    sum_squares += (uint32_t) (sample * sample);
+    int32_t magnitude = sample < 0 ? -sample : sample;
+    if (magnitude > peak) peak = magnitude;
+  }
+
+  float gain_db = this->next_gain_db_(sum_squares, count, peak);
+  int32_t start = this->gain_q12_;
+  int32_t end = lroundf(powf(10.0f, gain_db / 20.0f) * (1 << GAIN_BITS));
+  if (peak > 0) {
+    // Limiter: neither end of the ramp may push the peak over the limit,
+    // which also keeps every product below within 32 bits
+    int32_t cap = (int32_t) (((int64_t) LIMIT_LEVEL << GAIN_BITS) / peak);
+    if (start > cap) start = cap;
+    if (end > cap) end = cap;
+  }
+  this->gain_q12_ = end;
+
+  // Ramp linearly from the last block's gain to this one's, with 8 extra
+  // fraction bits so short blocks still reach the end value
+  int32_t ramp = start << 8;
+  const int32_t step = ((end - start) << 8) / (int32_t) frames;
+  for (size_t i = 0; i < frames; i++) {
+    int32_t gain = ramp >> 8;
+    for (uint8_t c = 0; c < channels; c++) {
+      int16_t &sample = samples[i * channels + c];
+      sample = saturate((sample * gain + (1 << (GAIN_BITS - 1))) >> GAIN_BITS);
+    }
+    ramp += step;
+  }
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
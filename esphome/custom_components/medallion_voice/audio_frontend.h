@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace medallion_voice {
+
+// Fixed-point conditioning of captured audio, in place, one DMA block at a
+// time before it goes on the audio bus:
+//
+//   high-pass  2nd-order Butterworth biquad (direct form I, Q28
+//              coefficients, first-order error feedback) removing DC offset
+//              and rumble below the cutoff
+//   AGC        one gain for all channels, steered per block towards a target
+//              RMS level: fast attack, slow release, held while the input is
+//              below the noise gate so silence is not pumped up
+//   limiter    caps the gain of a block so its peak stays below -1 dBFS.
+//              The whole block is in memory before it is scaled, so this
+//              needs no look-ahead delay.
+//
+// When the AGC sits at the end of its range it asks for a coarse 6 dB step
+// of the codec's PGA (get_pga_request()), and compensates digitally once the
+// caller reports the step done, so the level does not jump.
+class AudioFrontEnd {
+ public:
+  static constexpr uint8_t MAX_CHANNELS = 2;
+
+  // 0 disables the high-pass filter
+  void set_highpass_cutoff(uint16_t hz) { this->highpass_hz_ = hz; }
+  // Target RMS level in dBFS and the most gain the AGC may add
+  void set_agc(int8_t target_dbfs, uint8_t max_gain_db) {
+    this->agc_enabled_ = true;
+    this->target_dbfs_ = target_dbfs;
+    this->max_gain_db_ = max_gain_db;
+  }
+  void set_pga_control(bool enabled) { this->pga_control_ = enabled; }
+
+  void setup(uint32_t sample_rate, uint8_t channels);
+  // Clear the filter state, e.g. at the start of a recording. The AGC gain
+  // carries over: the room and the speaker rarely change between recordings.
+  void reset();
+  bool is_enabled() const { return this->is_highpass_enabled() || this->agc_enabled_; }
+  bool is_highpass_enabled() const { return this->highpass_hz_ > 0; }
+  bool is_agc_enabled() const { return this->agc_enabled_; }
+  uint16_t get_highpass_cutoff() const { return this->highpass_hz_; }
+  int8_t get_agc_target() const { return this->target_dbfs_; }
+  uint8_t get_agc_max_gain() const { return this->max_gain_db_; }
+  bool is_pga_control() const { return this->pga_control_; }
+
+  // Process `frames` interleaved 16-bit sample frames in place
+  void process(int16_t *samples, size_t frames);
+
+  // Digital gain applied to the last block, in dB
+  float get_gain_db() const { return this->gain_db_; }
+  // Coarse PGA step the AGC wants: +1 for 6 dB more, -1 for 6 dB less, or 0
+  int8_t get_pga_request() const { return this->pga_request_; }
+  // The PGA has moved by `steps` 6 dB steps
+  void pga_changed(int8_t steps);
+
+ protected:
+  void highpass_(int16_t *samples, size_t frames);
+  // Gain for the next block from its level and peak
+  float next_gain_db_(uint64_t sum_squares, size_t count, int32_t peak);
+
+  uint32_t sample_rate_{16000};
+  uint8_t channels_{2};
+  uint16_t highpass_hz_{0};
+  bool agc_enabled_{false};
+  bool pga_control_{false};
+  int8_t target_dbfs_{-18};
+  uint8_t max_gain_db_{24};
+
+  // Biquad, Q28: y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2
+  int32_t b0_{0}, b1_{0}, b2_{0}, a1_{0}, a2_{0};
+  struct BiquadState {
+    int32_t x1, x2, y1, y2;
+    int64_t error;  // fraction dropped from the last output, fed back
+  };
+  BiquadState state_[MAX_CHANNELS]{};
+
+  float gain_db_{0.0f};
+  // Gain of the last block, Q12 linear, where the next block's ramp starts
+  int32_t gain_q12_{4096};
+  int8_t pga_request_{0};
+  // Samples per channel since the AGC last left its range, or since the
+  // last PGA step
+  uint32_t pinned_samples_{0};
+  uint32_t pga_holdoff_samples_{0};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,34 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import binary_sensor
+from . import MedallionVoiceComponent, CONF_MEDALLION_VOICE_ID
+
+DEPENDENCIES = ["medallion_voice"]
+
+CONF_RECORDING = "recording"
+CONF_STREAMING = "streaming"
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_MEDALLION_VOICE_ID): cv.use_id(MedallionVoiceComponent),
+        cv.Optional(CONF_RECORDING): binary_sensor.binary_sensor_schema(
+            icon="mdi:record-rec",
+        ),
+        # On while the recording is streamed live; stays off when live_stream
+        # cannot carry the capture rate
+        cv.Optional(CONF_STREAMING): binary_sensor.binary_sensor_schema(
+            icon="mdi:broadcast",
+        ),
+    }
+)
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_MEDALLION_VOICE_ID])
+
+    if CONF_RECORDING in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_RECORDING])
+        cg.add(parent.set_recording_binary_sensor(sens))
+    if CONF_STREAMING in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_STREAMING])
+        cg.add(parent.set_streaming_binary_sensor(sens))
@@ -0,0 +1,293 @@
+#include "catalog.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <esp_rom_crc.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.catalog";
+
+static const char *const CATALOG_FILE = "catalog.bin";
+// Written in full and then renamed over the catalog
+static const char *const COMPACT_FILE = "catalog.tmp";
+
+static const char CATALOG_MAGIC[4] = {'M', 'V', 'C', 'T'};
+static const uint16_t CATALOG_VERSION = 1;
+
+struct CatalogHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t compacted_count;
+  uint32_t reserved;
+};
+static_assert(sizeof(CatalogHeader) == 16, "catalog header layout is part of the file format");
+
+// Don't bother compacting small catalogs
+static const uint32_t COMPACT_MIN_APPENDED = 64;
+static const uint32_t COMPACT_RETRY_MS = 10 * 60 * 1000;
+
+static uint32_t record_crc(const CatalogRecord &record) {
+  return esp_rom_crc32_le(0, (const uint8_t *) &record, offsetof(CatalogRecord, crc));
+}
+
+static uint32_t record_offset(uint32_t index) { return sizeof(CatalogHeader) + index * sizeof(CatalogRecord); }
+
+const char *recording_state_to_string(RecordingState state) {
+  switch (state) {
+    case RecordingState::RECORDING:
+      return "recording";
+    case RecordingState::SAVED:
+      return "saved";
+    case RecordingState::UPLOADED:
+      return "uploaded";
+    case RecordingState::UPLOAD_FAILED:
+      return "upload failed";
+    case RecordingState::EVICTED:
+      return "evicted";
+    default:
+      return "unknown";
+  }
+}
+
+bool RecordingCatalog::parse_name(const char *name, uint16_t *session, uint16_t *segment) {
+  const char *last_slash = strrchr(name, '/');
+  if (last_slash != nullptr) name = last_slash + 1;
+
+  unsigned s = 0, g = 0;
+  int fields = sscanf(name, "voice_%u_%u", &s, &g);
+  if (fields < 1 || s > UINT16_MAX || g > UINT16_MAX) return false;
+  *session = s;
+  *segment = fields == 2 ? g : 0;
+  return true;
+}
+
+void RecordingCatalog::format_name(uint16_t session, uint16_t segment, char *out, size_t size,
+                                   const char *extension) {
+  if (segment > 0) {
+    snprintf(out, size, "/voice_%04u_%03u%s", session, segment, extension);
+  } else {
+    snprintf(out, size, "/voice_%04u%s", session, extension);
+  }
+}
+
+bool RecordingCatalog::is_flac_name(const char *name) {
+  size_t len = strlen(name);
+  return len > 5 && strcmp(name + len - 5, ".flac") == 0;
+}
+
+bool RecordingCatalog::read_record_(FsFile &file, uint32_t index, CatalogRecord &record) {
+  if (!file.seekSet(record_offset(index))) return false;
+  if (file.read(&record, sizeof(record)) != (int) sizeof(record)) return false;
+  return record.crc == record_crc(record);
+}
+
+bool RecordingCatalog::load() {
+  SdLock lock(this->sd_mutex_);
+  // A compaction cut off between remove and rename
+  if (!this->sd_->exists(CATALOG_FILE) && this->sd_->exists(COMPACT_FILE)) {
+    this->sd_->rename(COMPACT_FILE, CATALOG_FILE);
+  }
+
+  FsFile file = this->sd_->open(CATALOG_FILE, O_RDONLY);
+  if (!file) return false;
+
+  CatalogHeader header;
+  if (file.read(&header, sizeof(header)) != (int) sizeof(header) ||
+      memcmp(header.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0 || header.version != CATALOG_VERSION ||
+      header.record_size != sizeof(CatalogRecord)) {
+    ESP_LOGW(TAG, "Ignoring catalog in unknown format");
+    file.close();
+    return false;
+  }
+
+  // A torn append leaves a partial record at the end; the next append
+  // overwrites it
+  this->record_count_ = (file.size() - sizeof(header)) / sizeof(CatalogRecord);
+  this->compacted_count_ = std::min(header.compacted_count, this->record_count_);
+  this->loaded_ = true;
+
+  // Walk back to the newest recording start. Any record after it for the
+  // same recording means it was finalized.
+  uint32_t start = millis();
+  uint32_t read = 0;
+  uint16_t max_session = 0;
+  bool found = false;
+  std::vector<uint32_t> finalized;
+  CatalogRecord record;
+  for (uint32_t i = this->record_count_; i > this->compacted_count_ && !found; i--) {
+    read++;
+    if (!this->read_record_(file, i - 1, record)) continue;
+    max_session = std::max(max_session, record.session);
+    if (static_cast<RecordingState>(record.state) != RecordingState::RECORDING) {
+      finalized.push_back(record.key());
+      continue;
+    }
+    found = true;
+    if (std::find(finalized.begin(), finalized.end(), record.key()) == finalized.end()) {
+      this->unfinished_ = record;
+      this->has_unfinished_ = true;
+    }
+  }
+  // The compacted part is sorted, so its last record is its newest
+  if (!found && this->compacted_count_ > 0) {
+    read++;
+    if (this->read_record_(file, this->compacted_count_ - 1, record)) {
+      max_session = std::max(max_session, record.session);
+    }
+  }
+  file.close();
+
+  this->next_session_ = max_session < UINT16_MAX ? max_session + 1 : 1;
+  ESP_LOGD(TAG, "Loaded catalog tail: %" PRIu32 " of %" PRIu32 " records in %" PRIu32 " ms, next session %u", read,
+           this->record_count_, millis() - start, this->next_session_);
+  return true;
+}
+
+bool RecordingCatalog::append(CatalogRecord record) {
+  record.crc = record_crc(record);
+
+  SdLock lock(this->sd_mutex_);
+  // Without a usable catalog, start a new one
+  FsFile file = this->sd_->open(CATALOG_FILE, this->loaded_ ? O_RDWR | O_CREAT : O_RDWR | O_CREAT | O_TRUNC);
+  if (!file) {
+    ESP_LOGW(TAG, "Failed to open catalog");
+    return false;
+  }
+  if (!this->loaded_) {
+    CatalogHeader header{};
+    memcpy(header.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    header.version = CATALOG_VERSION;
+    header.record_size = sizeof(CatalogRecord);
+    file.write(&header, sizeof(header));
+    this->record_count_ = 0;
+    this->compacted_count_ = 0;
+    this->loaded_ = true;
+  }
+
+  bool ok = file.seekSet(record_offset(this->record_count_)) &&
+            file.write(&record, sizeof(record)) == sizeof(record);
+  file.close();
+  if (!ok) {
+    ESP_LOGW(TAG, "Failed to append to catalog");
+    return false;
+  }
+  this->record_count_++;
+  return true;
+}
+
+bool RecordingCatalog::set_state(const char *name, RecordingState state) {
+  CatalogRecord record{};
+  if (!parse_name(name, &record.session, &record.segment)) return false;
+  snprintf(record.name, sizeof(record.name), "%s", name);
+  record.state = static_cast<uint8_t>(state);
+  return this->append(record);
+}
+
+bool RecordingCatalog::read_all_(FsFile &file, CatalogList &out) {
+  out.clear();
+  CatalogRecord record;
+  for (uint32_t i = 0; i < this->record_count_; i++) {
+    if (!this->read_record_(file, i, record)) continue;
+
+    // New recordings mostly arrive in key order, so this is usually an append
+    auto it = std::lower_bound(out.begin(), out.end(), record.key(),
+                               [](const CatalogRecord &r, uint32_t key) { return r.key() < key; });
+    if (it == out.end() || it->key() != record.key()) {
+      out.insert(it, record);
+    } else if (record.sample_rate != 0) {
+      *it = record;
+    } else {
+      it->state = record.state;
+    }
+  }
+  return true;
+}
+
+bool RecordingCatalog::read_all(CatalogList &out) {
+  SdLock lock(this->sd_mutex_);
+  if (!this->loaded_) return false;
+  FsFile file = this->sd_->open(CATALOG_FILE, O_RDONLY);
+  if (!file) return false;
+  bool ok = this->read_all_(file, out);
+  file.close();
+  return ok;
+}
+
+bool RecordingCatalog::rewrite_(const CatalogList &records) {
+  FsFile file = this->sd_->open(COMPACT_FILE, O_WRONLY | O_CREAT | O_TRUNC);
+  if (!file) {
+    ESP_LOGW(TAG, "Failed to create %s", COMPACT_FILE);
+    return false;
+  }
+
+  CatalogHeader header{};
+  memcpy(header.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+  header.version = CATALOG_VERSION;
+  header.record_size = sizeof(CatalogRecord);
+  header.compacted_count = records.size();
+  bool ok = file.write(&header, sizeof(header)) == sizeof(header);
+  for (CatalogRecord record : records) {
+    if (!ok) break;
+    // Merged state updates invalidate the stored CRC
+    record.crc = record_crc(record);
+    ok = file.write(&record, sizeof(record)) == sizeof(record);
+  }
+  ok = ok && file.sync();
+  file.close();
+  if (!ok) {
+    ESP_LOGW(TAG, "Failed to write %s", COMPACT_FILE);
+    this->sd_->remove(COMPACT_FILE);
+    return false;
+  }
+
+  // load() finishes the rename if this is cut off in between
+  this->sd_->remove(CATALOG_FILE);
+  if (!this->sd_->rename(COMPACT_FILE, CATALOG_FILE)) {
+    ESP_LOGW(TAG, "Failed to replace catalog");
+    return false;
+  }
+  this->record_count_ = records.size();
+  this->compacted_count_ = records.size();
+  this->loaded_ = true;
+  return true;
+}
+
+bool RecordingCatalog::rebuild(CatalogList &records) {
+  std::sort(records.begin(), records.end(),
+            [](const CatalogRecord &a, const CatalogRecord &b) { return a.key() < b.key(); });
+
+  SdLock lock(this->sd_mutex_);
+  return this->rewrite_(records);
+}
+
+bool RecordingCatalog::compact_if_needed() {
+  uint32_t appended = this->record_count_ - this->compacted_count_;
+  if (!this->loaded_ || appended < std::max(this->compacted_count_, COMPACT_MIN_APPENDED)) return false;
+  uint32_t start = millis();
+  if ((int32_t) (start - this->compact_retry_at_) < 0) return false;
+
+  uint32_t before = this->record_count_;
+  CatalogList records;
+  SdLock lock(this->sd_mutex_);
+  FsFile file = this->sd_->open(CATALOG_FILE, O_RDONLY);
+  if (!file) return false;
+  this->read_all_(file, records);
+  file.close();
+  if (!this->rewrite_(records)) {
+    this->compact_retry_at_ = millis() + COMPACT_RETRY_MS;
+    return false;
+  }
+
+  ESP_LOGI(TAG, "Compacted catalog: %" PRIu32 " -> %u records in %" PRIu32 " ms", before,
+           (unsigned) records.size(), millis() - start);
+  return true;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+#include "sd_lock.h"
+#include <SdFat.h>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace medallion_voice {
+
+enum class RecordingState : uint8_t {
+  RECORDING = 1,      // file opened, not finalized yet
+  SAVED = 2,          // finalized on SD, not uploaded
+  UPLOADED = 3,
+  UPLOAD_FAILED = 4,  // rejected by the server
+  EVICTED = 5,        // storage slot reused for a newer recording
+};
+
+const char *recording_state_to_string(RecordingState state);
+
+// One catalog entry, stored as-is (little-endian) on the card
+struct CatalogRecord {
+  char name[24];  // SD path, e.g. "/voice_0003_002.wav"
+  uint16_t session;
+  uint16_t segment;  // 1-based, 0 for unsegmented recordings
+  uint32_t data_bytes;
+  uint32_t duration_ms;
+  uint32_t timestamp;    // UNIX time at start, 0 if the clock was not set
+  uint32_t sample_rate;  // 0 marks a state-only update
+  uint8_t channels;
+  uint8_t bits_per_sample;
+  uint8_t state;  // RecordingState
+  uint8_t reserved;
+  uint32_t crc;  // CRC-32 of the bytes above
+
+  uint32_t key() const { return ((uint32_t) this->session << 16) | this->segment; }
+};
+static_assert(sizeof(CatalogRecord) == 52, "catalog record layout is part of the file format");
+
+using CatalogList = std::vector<CatalogRecord, ExternalRAMAllocator<CatalogRecord>>;
+
+// Append-only index of the recordings on the SD card ("catalog.bin").
+//
+// Every change (started, saved, uploaded) appends a fixed-size record and the
+// latest record of a recording wins. Startup reads the file backwards only as
+// far as the newest RECORDING entry, which gives the next session number and
+// tells whether that recording was cut off by a reset. Listing reads the
+// catalog front to back instead of walking the FAT directory. Once the
+// records appended since the last compaction outnumber the compacted ones,
+// compact_if_needed() rewrites the file with one record per recording.
+class RecordingCatalog {
+ public:
+  // All SD access is done under `sd_mutex` (may be null)
+  void setup(SdFs *sd, SemaphoreHandle_t sd_mutex) {
+    this->sd_ = sd;
+    this->sd_mutex_ = sd_mutex;
+  }
+
+  // Read the tail of the catalog. False if there is no usable catalog.
+  bool load();
+  uint16_t get_next_session() const { return this->next_session_; }
+  // The newest recording if it was never finalized, else nullptr
+  const CatalogRecord *get_unfinished() const { return this->has_unfinished_ ? &this->unfinished_ : nullptr; }
+
+  bool append(CatalogRecord record);
+  // Record a new state for `name`, keeping its other fields
+  bool set_state(const char *name, RecordingState state);
+
+  // Latest record of every recording, ordered by session and segment
+  bool read_all(CatalogList &out);
+  // Replace the catalog with `records`, e.g. when indexing an existing card
+  bool rebuild(CatalogList &records);
+  bool compact_if_needed();
+
+  uint32_t get_record_count() const { return this->record_count_; }
+
+  // "/voice_0003_002.wav" -> 3, 2; "/voice_0003.flac" -> 3, 0
+  static bool parse_name(const char *name, uint16_t *session, uint16_t *segment);
+  // The reverse of parse_name(); `extension` is ".wav" or ".flac"
+  static void format_name(uint16_t session, uint16_t segment, char *out, size_t size, const char *extension = ".wav");
+  // Media type to serve a recording with, by its extension
+  static bool is_flac_name(const char *name);
+  static const char *content_type(const char *name) { return is_flac_name(name) ? "audio/flac" : "audio/wav"; }
+
+ protected:
+  bool read_record_(FsFile &file, uint32_t index, CatalogRecord &record);
+  bool read_all_(FsFile &file, CatalogList &out);
+  bool rewrite_(const CatalogList &records);
+
+  SdFs *sd_{nullptr};
+  SemaphoreHandle_t sd_mutex_{nullptr};
+  bool loaded_{false};
+  uint32_t record_count_{0};
+  // Records at the start of the file written by the last compaction, in key order
+  uint32_t compacted_count_{0};
+  uint32_t compact_retry_at_{0};
+  uint16_t next_session_{1};
+  CatalogRecord unfinished_{};
+  bool has_unfinished_{false};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,24 @@
+#include "content_hash.h"
+#include <cstdio>
+
+namespace esphome {
+namespace medallion_voice {
+
+void ContentHash::begin() {
+  mbedtls_sha256_free(&this->ctx_);
+  mbedtls_sha256_init(&this->ctx_);
+  mbedtls_sha256_starts(&this->ctx_, 0);
+}
+
+void ContentHash::update(const uint8_t *data, size_t length) { mbedtls_sha256_update(&this->ctx_, data, length); }
+
+void ContentHash::finish(char *hex) {
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&this->ctx_, digest);
+  for (size_t i = 0; i < sizeof(digest); i++) {
+    snprintf(hex + i * 2, 3, "%02x", digest[i]);
+  }
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
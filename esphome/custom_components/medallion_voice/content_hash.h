@@ -0,0 +1,37 @@
+#pragma once
+
+#include <mbedtls/sha256.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace medallion_voice {
+
+// Hex SHA-256 digest plus terminating NUL
+static const size_t CONTENT_HASH_HEX_SIZE = 65;
+
+// Upload request header carrying the digest of the audio data (the bytes
+// after the WAV header, or the FLAC frames after the FLAC header)
+static const char *const CONTENT_HASH_HEADER = "X-Audio-SHA256";
+
+// Incremental SHA-256 of a recording's audio data, fed block by block as it
+// is written to SD. On the ESP32-S3 mbedTLS runs SHA-256 on the SHA
+// peripheral, so hashing costs little compared with the SD write.
+class ContentHash {
+ public:
+  ContentHash() { mbedtls_sha256_init(&this->ctx_); }
+  ~ContentHash() { mbedtls_sha256_free(&this->ctx_); }
+  ContentHash(const ContentHash &) = delete;
+  ContentHash &operator=(const ContentHash &) = delete;
+
+  void begin();
+  void update(const uint8_t *data, size_t length);
+  // Write the lowercase hex digest into `hex` (CONTENT_HASH_HEX_SIZE bytes)
+  void finish(char *hex);
+
+ protected:
+  mbedtls_sha256_context ctx_;
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,232 @@
+#include "download_handler.h"
+
+#ifdef USE_MEDALLION_VOICE_DOWNLOAD
+
+#include "medallion_voice.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <esp_http_server.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.download";
+
+// Sent to the client in pieces this size
+static const uint32_t DOWNLOAD_BUFFER_SIZE = 32 * 1024;
+
+enum class ByteRange : uint8_t {
+  NONE,           // no usable Range header: send the whole file
+  VALID,          // send [first, last]
+  UNSATISFIABLE,  // starts past the end: 416
+};
+
+// Single ranges only ("bytes=100-", "bytes=100-199", "bytes=-500"). Multiple
+// ranges are ignored, which the spec allows.
+static ByteRange parse_byte_range(const char *value, uint32_t size, uint32_t *first, uint32_t *last) {
+  if (strncmp(value, "bytes=", 6) != 0 || strchr(value, ',') != nullptr) return ByteRange::NONE;
+  const char *p = value + 6;
+  char *end;
+
+  if (*p == '-') {
+    unsigned long suffix = strtoul(p + 1, &end, 10);
+    if (end == p + 1 || *end != '\0') return ByteRange::NONE;
+    if (suffix == 0 || size == 0) return ByteRange::UNSATISFIABLE;
+    *first = suffix < size ? size - suffix : 0;
+    *last = size - 1;
+    return ByteRange::VALID;
+  }
+
+  unsigned long start = strtoul(p, &end, 10);
+  if (end == p || *end != '-') return ByteRange::NONE;
+  p = end + 1;
+  unsigned long stop = UINT32_MAX;
+  if (*p != '\0') {
+    stop = strtoul(p, &end, 10);
+    if (end == p || *end != '\0' || stop < start) return ByteRange::NONE;
+  }
+  if (start >= size) return ByteRange::UNSATISFIABLE;
+  *first = start;
+  *last = std::min<unsigned long>(stop, size - 1);
+  return ByteRange::VALID;
+}
+
+static bool send_all(httpd_req_t *req, const uint8_t *data, size_t length) {
+  while (length > 0) {
+    int sent = httpd_send(req, (const char *) data, length);
+    if (sent <= 0) return false;
+    data += sent;
+    length -= sent;
+  }
+  return true;
+}
+
+static void send_error(httpd_req_t *req, const char *status, const char *message) {
+  httpd_resp_set_status(req, status);
+  httpd_resp_set_type(req, "text/plain");
+  httpd_resp_sendstr(req, message);
+}
+
+RecordingDownloadHandler::RecordingDownloadHandler(MedallionVoiceComponent *parent, const std::string &path)
+    : parent_(parent), path_(path) {
+  this->buffer_pool_.reserve(DOWNLOAD_BUFFER_SIZE, 1);
+}
+
+bool RecordingDownloadHandler::canHandle(AsyncWebServerRequest *request) const {
+  if (request->method() != HTTP_GET) return false;
+  std::string url = request->url();
+  if (url.compare(0, this->path_.size(), this->path_) != 0) return false;
+  return url.size() == this->path_.size() || url[this->path_.size()] == '/';
+}
+
+void RecordingDownloadHandler::handleRequest(AsyncWebServerRequest *request) {
+  httpd_req_t *req = *request;
+  std::string url = request->url();
+  std::string name = url.size() > this->path_.size() + 1 ? url.substr(this->path_.size() + 1) : "";
+
+  buffer_pool::ScopedBlock buffer(this->buffer_pool_);
+  if (!buffer) {
+    httpd_resp_set_hdr(req, "Retry-After", "5");
+    send_error(req, "503 Service Unavailable", "Another download is in progress");
+    return;
+  }
+  if (name.empty()) {
+    this->send_list_(request);
+  } else {
+    this->send_file_(request, name, buffer.data());
+  }
+}
+
+void RecordingDownloadHandler::send_list_(AsyncWebServerRequest *request) {
+  httpd_req_t *req = *request;
+  CatalogList records;
+  if (!this->parent_->read_catalog(records)) {
+    send_error(req, "503 Service Unavailable", "Recording catalog unavailable");
+    return;
+  }
+
+  // One record at a time, as a chunked response
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_sendstr_chunk(req, "[");
+  bool first = true;
+  for (const CatalogRecord &record : records) {
+    RecordingState state = static_cast<RecordingState>(record.state);
+    if (state == RecordingState::EVICTED) continue;
+    const char *name = record.name[0] == '/' ? record.name + 1 : record.name;
+    char item[224];
+    snprintf(item, sizeof(item),
+             "%s{\"name\":\"%s\",\"url\":\"%s/%s\",\"data_bytes\":%" PRIu32 ",\"duration_ms\":%" PRIu32
+             ",\"timestamp\":%" PRIu32 ",\"state\":\"%s\"}",
+             first ? "" : ",", name, this->path_.c_str(), name, record.data_bytes, record.duration_ms,
+             record.timestamp, recording_state_to_string(state));
+    first = false;
+    if (httpd_resp_sendstr_chunk(req, item) != ESP_OK) return;
+  }
+  httpd_resp_sendstr_chunk(req, "]");
+  httpd_resp_sendstr_chunk(req, nullptr);
+}
+
+void RecordingDownloadHandler::send_file_(AsyncWebServerRequest *request, const std::string &name, uint8_t *buffer) {
+  httpd_req_t *req = *request;
+  uint16_t session, segment;
+  if (name.size() >= sizeof(CatalogRecord::name) - 1 || name.find('/') != std::string::npos ||
+      name.compare(0, 6, "voice_") != 0 ||
+      ((name.size() < 4 || name.compare(name.size() - 4, 4, ".wav") != 0) &&
+       !RecordingCatalog::is_flac_name(name.c_str())) ||
+      !RecordingCatalog::parse_name(name.c_str(), &session, &segment)) {
+    send_error(req, "404 Not Found", "No such recording");
+    return;
+  }
+
+  FsFile file;
+  uint32_t size = 0;
+  if (!this->parent_->open_recording("/" + name, file, &size)) {
+    send_error(req, "404 Not Found", "No such recording");
+    return;
+  }
+
+  uint32_t first = 0, last = size > 0 ? size - 1 : 0;
+  ByteRange range = ByteRange::NONE;
+  char range_header[48];
+  if (httpd_req_get_hdr_value_str(req, "Range", range_header, sizeof(range_header)) == ESP_OK) {
+    range = parse_byte_range(range_header, size, &first, &last);
+  }
+
+  // The status line and headers are written directly, so the body can go out
+  // with a Content-Length instead of chunked
+  char head[320];
+  int head_len;
+  if (range == ByteRange::UNSATISFIABLE) {
+    head_len = snprintf(head, sizeof(head),
+                        "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                        "Content-Range: bytes */%" PRIu32 "\r\n"
+                        "Content-Length: 0\r\n\r\n",
+                        size);
+    send_all(req, (const uint8_t *) head, head_len);
+    SdLock lock(this->parent_->get_sd_mutex());
+    file.close();
+    return;
+  }
+  uint32_t length = size > 0 ? last - first + 1 : 0;
+  head_len = snprintf(head, sizeof(head),
+                      "HTTP/1.1 %s\r\n"
+                      "Content-Type: %s\r\n"
+                      "Content-Length: %" PRIu32 "\r\n"
+                      "Content-Disposition: inline; filename=\"%s\"\r\n"
+                      "Accept-Ranges: bytes\r\n",
+                      range == ByteRange::VALID ? "206 Partial Content" : "200 OK",
+                      RecordingCatalog::content_type(name.c_str()), length, name.c_str());
+  if (range == ByteRange::VALID) {
+    head_len += snprintf(head + head_len, sizeof(head) - head_len,
+                         "Content-Range: bytes %" PRIu32 "-%" PRIu32 "/%" PRIu32 "\r\n", first, last, size);
+  }
+  head_len += snprintf(head + head_len, sizeof(head) - head_len, "\r\n");
+
+  ESP_LOGD(TAG, "Sending %s bytes %" PRIu32 "-%" PRIu32 "/%" PRIu32, name.c_str(), first, last, size);
+  uint32_t start = millis();
+  uint32_t offset = first;
+  uint32_t end = first + length;
+  bool ok = send_all(req, (const uint8_t *) head, head_len);
+  while (ok && offset < end) {
+    uint32_t fill = std::min(end - offset, DOWNLOAD_BUFFER_SIZE);
+    for (uint32_t done = 0; ok && done < fill;) {
+      uint32_t piece = std::min(fill - done, SD_READ_PIECE_SIZE);
+      {
+        SdLock lock(this->parent_->get_sd_mutex());
+        ok = file.seekSet(offset + done) && file.read(buffer + done, piece) == (int) piece;
+      }
+      done += piece;
+      // Let the recorder take the card before the next piece
+      if (this->parent_->is_recording()) delay(1);
+    }
+    if (!ok) {
+      ESP_LOGW(TAG, "SD read failed at %" PRIu32 " in %s", offset, name.c_str());
+      break;
+    }
+    ok = send_all(req, buffer, fill);
+    offset += fill;
+  }
+
+  {
+    SdLock lock(this->parent_->get_sd_mutex());
+    file.close();
+  }
+  uint32_t elapsed = millis() - start;
+  if (ok) {
+    ESP_LOGI(TAG, "Sent %s: %" PRIu32 " bytes in %" PRIu32 " ms", name.c_str(), length, elapsed);
+  } else {
+    // A response cut short can only be ended by dropping the connection
+    ESP_LOGW(TAG, "Download of %s stopped after %" PRIu32 " of %" PRIu32 " bytes", name.c_str(), offset - first,
+             length);
+    httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+  }
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
+
+#endif  // USE_MEDALLION_VOICE_DOWNLOAD
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_MEDALLION_VOICE_DOWNLOAD
+
+#include "esphome/components/buffer_pool/block_pool.h"
+#include "esphome/components/web_server_base/web_server_base.h"
+#include <string>
+
+namespace esphome {
+namespace medallion_voice {
+
+class MedallionVoiceComponent;
+
+// Serves recordings from SD on the web server:
+//
+//   GET <path>                   -> JSON list from the recording catalog
+//   GET <path>/voice_0003.wav    -> the file, with "Range: bytes=..." support
+//
+// Files are streamed from SD through one fixed buffer, never loaded whole.
+// The SD lock is taken per 4 KiB read, as for uploads, and released between
+// reads while recording so the recorder's writes are not held up. Only one
+// download runs at a time, holding the one "download" pool buffer; others
+// get 503 with Retry-After.
+class RecordingDownloadHandler : public AsyncWebHandler {
+ public:
+  RecordingDownloadHandler(MedallionVoiceComponent *parent, const std::string &path);
+
+  bool canHandle(AsyncWebServerRequest *request) const override;
+  void handleRequest(AsyncWebServerRequest *request) override;
+  bool isRequestHandlerTrivial() const override { return false; }
+
+ protected:
+  void send_list_(AsyncWebServerRequest *request);
+  void send_file_(AsyncWebServerRequest *request, const std::string &name, uint8_t *buffer);
+
+  MedallionVoiceComponent *parent_;
+  std::string path_;
+  buffer_pool::BlockPool buffer_pool_{"download", buffer_pool::REGION_PSRAM};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
+
+#endif  // USE_MEDALLION_VOICE_DOWNLOAD
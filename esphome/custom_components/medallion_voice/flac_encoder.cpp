@@ -0,0 +1,542 @@
+#include "flac_encoder.h"
+#include <cmath>
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const uint8_t METADATA_STREAMINFO = 0;
+static const uint8_t METADATA_SEEKTABLE = 3;
+static const uint8_t METADATA_LAST = 0x80;
+static const uint64_t SEEKPOINT_PLACEHOLDER = 0xFFFFFFFFFFFFFFFFULL;
+
+// Quantized LPC coefficient precision in bits
+static const uint8_t LPC_PRECISION = 12;
+// Largest Rice parameter with the 4-bit parameter field; 15 is the escape
+static const uint8_t MAX_RICE_PARAM_4BIT = 14;
+static const uint8_t MAX_RICE_PARAM = 30;
+// Keeps residuals well inside the 32-bit range the format allows
+static const int64_t MAX_RESIDUAL = 1 << 30;
+
+// Frame header codes
+static const uint8_t BLOCK_SIZE_CODE_8BIT = 6;
+static const uint8_t BLOCK_SIZE_CODE_16BIT = 7;
+static const uint8_t SAMPLE_SIZE_CODE_16 = 4;
+static const uint8_t CHANNELS_LEFT_SIDE = 8;
+static const uint8_t CHANNELS_SIDE_RIGHT = 9;
+static const uint8_t CHANNELS_MID_SIDE = 10;
+
+struct CrcTables {
+  uint8_t crc8[256];
+  uint16_t crc16[256];
+
+  constexpr CrcTables() : crc8(), crc16() {
+    for (int i = 0; i < 256; i++) {
+      uint8_t c8 = i;
+      uint16_t c16 = i << 8;
+      for (int bit = 0; bit < 8; bit++) {
+        c8 = (c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1;
+        c16 = (c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1;
+      }
+      this->crc8[i] = c8;
+      this->crc16[i] = c16;
+    }
+  }
+};
+static constexpr CrcTables CRC_TABLES{};
+
+static uint8_t crc8(const uint8_t *data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; i++) crc = CRC_TABLES.crc8[crc ^ data[i]];
+  return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < length; i++) crc = (crc << 8) ^ CRC_TABLES.crc16[(crc >> 8) ^ data[i]];
+  return crc;
+}
+
+static void put_be(uint8_t *p, uint64_t v, uint8_t bytes) {
+  for (int i = bytes - 1; i >= 0; i--) {
+    p[i] = v & 0xFF;
+    v >>= 8;
+  }
+}
+
+static uint64_t get_be(const uint8_t *p, uint8_t bytes) {
+  uint64_t v = 0;
+  for (uint8_t i = 0; i < bytes; i++) v = (v << 8) | p[i];
+  return v;
+}
+
+// Signed residual to the unsigned value Rice coding works on
+static uint32_t fold(int32_t residual) {
+  return residual >= 0 ? (uint32_t) residual << 1 : ((uint32_t) -residual << 1) - 1;
+}
+
+static uint8_t sample_rate_code(uint32_t rate) {
+  switch (rate) {
+    case 8000:
+      return 4;
+    case 16000:
+      return 5;
+    case 22050:
+      return 6;
+    case 24000:
+      return 7;
+    case 32000:
+      return 8;
+    case 44100:
+      return 9;
+    case 48000:
+      return 10;
+    default:
+      return 0;  // from STREAMINFO
+  }
+}
+
+void build_flac_header(uint8_t *out, const AudioFormat &format, const FlacStreamInfo &info) {
+  memcpy(out, "fLaC", 4);
+
+  uint8_t *block = out + 4;
+  block[0] = METADATA_STREAMINFO;
+  put_be(block + 1, 34, 3);
+  uint8_t *p = block + 4;
+  put_be(p, FlacEncoder::BLOCK_SIZE, 2);  // min block size, except the last
+  put_be(p + 2, FlacEncoder::BLOCK_SIZE, 2);
+  put_be(p + 4, info.min_frame_size, 3);
+  put_be(p + 7, info.max_frame_size, 3);
+  put_be(p + 10,
+         ((uint64_t) format.sample_rate << 44) | ((uint64_t) (format.channels - 1) << 41) |
+             ((uint64_t) (format.bits_per_sample - 1) << 36) | (info.total_samples & 0xFFFFFFFFFULL),
+         8);
+  memset(p + 18, 0, 16);  // MD5
+
+  block = out + 4 + 4 + 34;
+  block[0] = METADATA_LAST | METADATA_SEEKTABLE;
+  put_be(block + 1, 18, 3);
+  p = block + 4;
+  if (info.has_checkpoint) {
+    put_be(p, info.checkpoint_samples, 8);
+    put_be(p + 8, info.checkpoint_offset, 8);
+    put_be(p + 16, FlacEncoder::BLOCK_SIZE, 2);
+  } else {
+    put_be(p, SEEKPOINT_PLACEHOLDER, 8);
+    put_be(p + 8, 0, 8);
+    put_be(p + 16, 0, 2);
+  }
+}
+
+bool parse_flac_header(const uint8_t *header, FlacStreamInfo *info) {
+  const uint8_t *streaminfo = header + 4;
+  const uint8_t *seektable = header + 4 + 4 + 34;
+  if (memcmp(header, "fLaC", 4) != 0 || streaminfo[0] != METADATA_STREAMINFO || get_be(streaminfo + 1, 3) != 34 ||
+      seektable[0] != (METADATA_LAST | METADATA_SEEKTABLE) || get_be(seektable + 1, 3) != 18) {
+    return false;
+  }
+  const uint8_t *p = streaminfo + 4;
+  info->min_frame_size = get_be(p + 4, 3);
+  info->max_frame_size = get_be(p + 7, 3);
+  info->total_samples = get_be(p + 10, 8) & 0xFFFFFFFFFULL;
+  p = seektable + 4;
+  info->checkpoint_samples = get_be(p, 8);
+  info->checkpoint_offset = get_be(p + 8, 8);
+  info->has_checkpoint = info->checkpoint_samples != SEEKPOINT_PLACEHOLDER;
+  if (!info->has_checkpoint) {
+    info->checkpoint_samples = 0;
+    info->checkpoint_offset = 0;
+  }
+  return true;
+}
+
+void FlacEncoder::BitWriter::put(uint32_t value, uint8_t bits) {
+  // At most 7 bits wait in the accumulator between calls
+  this->acc_ = (this->acc_ << bits) | (value & ((1ULL << bits) - 1));
+  this->acc_bits_ += bits;
+  while (this->acc_bits_ >= 8) {
+    this->acc_bits_ -= 8;
+    this->out_[this->length_++] = this->acc_ >> this->acc_bits_;
+  }
+}
+
+void FlacEncoder::BitWriter::put_rice(uint32_t folded, uint8_t param) {
+  // Quotient in unary (zeros, then a one), then the low bits
+  uint32_t quotient = folded >> param;
+  uint32_t low = folded & ((1u << param) - 1);
+  if (quotient + 1 + param <= 32) {
+    this->put((1u << param) | low, quotient + 1 + param);
+    return;
+  }
+  for (; quotient >= 32; quotient -= 32) this->put(0, 32);
+  this->put(1, quotient + 1);
+  this->put(low, param);
+}
+
+void FlacEncoder::BitWriter::align() {
+  if (this->acc_bits_ > 0) this->put(0, 8 - this->acc_bits_);
+}
+
+bool FlacEncoder::begin(const AudioFormat &format) {
+  if (format.bits_per_sample != 16 || format.channels < 1 || format.channels > MAX_CHANNELS) return false;
+  this->format_ = format;
+  this->fill_ = 0;
+  this->frame_samples_ = 0;
+  this->frame_number_ = 0;
+  this->total_samples_ = 0;
+  this->min_frame_size_ = 0;
+  this->max_frame_size_ = 0;
+  return true;
+}
+
+size_t FlacEncoder::add(const uint8_t *pcm, size_t length) {
+  uint16_t channels = this->format_.channels;
+  size_t block_align = channels * 2;
+  size_t taken = 0;
+  while (this->fill_ < BLOCK_SIZE && length - taken >= block_align) {
+    for (uint16_t c = 0; c < channels; c++) {
+      this->samples_[c][this->fill_] = (int16_t) (pcm[0] | (pcm[1] << 8));
+      pcm += 2;
+    }
+    this->fill_++;
+    taken += block_align;
+  }
+  return taken;
+}
+
+void FlacEncoder::load_channel_(Channel channel, uint16_t n) {
+  const int16_t *left = this->samples_[0];
+  const int16_t *right = this->samples_[this->format_.channels - 1];
+  int32_t *x = this->work_;
+  switch (channel) {
+    case CHANNEL_LEFT:
+      for (uint16_t i = 0; i < n; i++) x[i] = left[i];
+      break;
+    case CHANNEL_RIGHT:
+      for (uint16_t i = 0; i < n; i++) x[i] = right[i];
+      break;
+    case CHANNEL_MID:
+      for (uint16_t i = 0; i < n; i++) x[i] = ((int32_t) left[i] + right[i]) >> 1;
+      break;
+    case CHANNEL_SIDE:
+      for (uint16_t i = 0; i < n; i++) x[i] = (int32_t) left[i] - right[i];
+      break;
+    default:
+      break;
+  }
+}
+
+int32_t FlacEncoder::residual_(const Plan &plan, uint16_t i) const {
+  const int32_t *x = this->work_;
+  if (plan.type == SUBFRAME_LPC) {
+    int64_t sum = 0;
+    for (uint8_t j = 0; j < plan.order; j++) sum += (int64_t) plan.coefs[j] * x[i - 1 - j];
+    return x[i] - (int32_t) (sum >> plan.shift);
+  }
+  switch (plan.order) {
+    case 0:
+      return x[i];
+    case 1:
+      return x[i] - x[i - 1];
+    case 2:
+      return x[i] - 2 * x[i - 1] + x[i - 2];
+    case 3:
+      return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+    default:
+      return x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+  }
+}
+
+// Bits to Rice code `count` values summing to `sum` with the best
+// parameter. An upper bound: sum >> param is at least the sum of the
+// individual quotients.
+static uint64_t rice_bits(uint64_t sum, uint32_t count, uint8_t *param) {
+  *param = 0;
+  if (count == 0 || sum == 0) return count;
+  uint64_t mean = sum / count;
+  int guess = mean > 0 ? 63 - __builtin_clzll(mean) : 0;
+  uint64_t best = UINT64_MAX;
+  for (int k = guess - 1; k <= guess + 1; k++) {
+    if (k < 0 || k > MAX_RICE_PARAM) continue;
+    uint64_t bits = (uint64_t) count * (k + 1) + (sum >> k);
+    if (bits < best) {
+      best = bits;
+      *param = k;
+    }
+  }
+  return best;
+}
+
+uint32_t FlacEncoder::plan_rice_(const uint64_t *sums, uint16_t n, uint8_t order, uint8_t max_partition_order,
+                                 Plan &plan) {
+  uint64_t best = UINT64_MAX;
+  for (int po = max_partition_order; po >= 0; po--) {
+    uint16_t partitions = 1 << po;
+    uint16_t merge = 1 << (max_partition_order - po);
+    uint8_t params[1 << MAX_PARTITION_ORDER];
+    uint64_t bits = 2 + 4;  // coding method, partition order
+    bool wide = false;
+    for (uint16_t p = 0; p < partitions; p++) {
+      uint64_t sum = 0;
+      for (uint16_t m = 0; m < merge; m++) sum += sums[p * merge + m];
+      // The first partition starts after the warm-up samples
+      uint32_t count = (n >> po) - (p == 0 ? order : 0);
+      bits += rice_bits(sum, count, &params[p]);
+      if (params[p] > MAX_RICE_PARAM_4BIT) wide = true;
+    }
+    bits += partitions * (wide ? 5 : 4);
+    if (bits < best) {
+      best = bits;
+      plan.partition_order = po;
+      plan.param_bits = wide ? 5 : 4;
+      memcpy(plan.params, params, partitions);
+    }
+  }
+  return best < UINT32_MAX ? best : UINT32_MAX;
+}
+
+bool FlacEncoder::plan_lpc_(uint16_t n, uint8_t bps, Plan &plan) {
+  const int32_t *x = this->work_;
+  const uint8_t order = MAX_LPC_ORDER;
+
+  // Autocorrelation of the Welch-windowed block. Floats: the S3 has a
+  // single-precision FPU only.
+  float autoc[MAX_LPC_ORDER + 1] = {};
+  float history[MAX_LPC_ORDER + 1] = {};
+  float center = (n - 1) / 2.0f;
+  float half = (n + 1) / 2.0f;
+  for (uint16_t i = 0; i < n; i++) {
+    float d = (i - center) / half;
+    for (uint8_t l = order; l > 0; l--) history[l] = history[l - 1];
+    history[0] = x[i] * (1.0f - d * d);
+    uint8_t lags = i < order ? i : order;
+    for (uint8_t l = 0; l <= lags; l++) autoc[l] += history[0] * history[l];
+  }
+  if (autoc[0] <= 0.0f) return false;
+
+  // Levinson-Durbin; a few dozen operations, so double is affordable
+  double lpc[MAX_LPC_ORDER] = {};
+  double err = autoc[0] * (1.0 + 1e-9);
+  for (uint8_t i = 0; i < order; i++) {
+    double acc = autoc[i + 1];
+    for (uint8_t j = 0; j < i; j++) acc -= lpc[j] * autoc[i - j];
+    double k = acc / err;
+    double prev[MAX_LPC_ORDER];
+    memcpy(prev, lpc, sizeof(prev));
+    lpc[i] = k;
+    for (uint8_t j = 0; j < i; j++) lpc[j] = prev[j] - k * prev[i - 1 - j];
+    err *= 1.0 - k * k;
+    if (err <= 0.0) return false;
+  }
+
+  // Quantize, carrying the rounding error into the next coefficient
+  double cmax = 0.0;
+  for (uint8_t j = 0; j < order; j++) cmax = std::fmax(cmax, std::fabs(lpc[j]));
+  if (cmax <= 0.0) return false;
+  int exponent;
+  std::frexp(cmax, &exponent);  // cmax < 2^exponent
+  int shift = LPC_PRECISION - 1 - exponent;
+  if (shift > 15) shift = 15;
+  if (shift < 0) return false;
+  const int32_t qmax = (1 << (LPC_PRECISION - 1)) - 1;
+  const int32_t qmin = -(1 << (LPC_PRECISION - 1));
+  double error = 0.0;
+  for (uint8_t j = 0; j < order; j++) {
+    error += lpc[j] * (1 << shift);
+    int32_t q = std::lround(error);
+    q = q > qmax ? qmax : (q < qmin ? qmin : q);
+    plan.coefs[j] = q;
+    error -= q;
+  }
+
+  plan.type = SUBFRAME_LPC;
+  plan.bits_per_sample = bps;
+  plan.order = order;
+  plan.precision = LPC_PRECISION;
+  plan.shift = shift;
+
+  uint8_t max_partition_order = 0;
+  while (max_partition_order < MAX_PARTITION_ORDER && n % (2 << max_partition_order) == 0 &&
+         (n >> (max_partition_order + 1)) > MAX_LPC_ORDER)
+    max_partition_order++;
+  uint64_t sums[1 << MAX_PARTITION_ORDER] = {};
+  uint16_t partition_size = n >> max_partition_order;
+  for (uint16_t i = order; i < n; i++) {
+    int64_t sum = 0;
+    for (uint8_t j = 0; j < order; j++) sum += (int64_t) plan.coefs[j] * x[i - 1 - j];
+    int64_t residual = x[i] - (sum >> shift);
+    if (residual >= MAX_RESIDUAL || residual <= -MAX_RESIDUAL) return false;
+    sums[i / partition_size] += fold(residual);
+  }
+  uint64_t bits = 8 + (uint64_t) order * bps + 4 + 5 + order * LPC_PRECISION +
+                  plan_rice_(sums, n, order, max_partition_order, plan);
+  plan.bits = bits < UINT32_MAX ? bits : UINT32_MAX;
+  return true;
+}
+
+void FlacEncoder::plan_channel_(Channel channel, uint16_t n, Plan &plan) {
+  this->load_channel_(channel, n);
+  const int32_t *x = this->work_;
+  uint8_t bps = this->format_.bits_per_sample + (channel == CHANNEL_SIDE ? 1 : 0);
+
+  bool constant = true;
+  for (uint16_t i = 1; i < n && constant; i++) constant = x[i] == x[0];
+  plan.bits_per_sample = bps;
+  plan.order = 0;
+  if (constant) {
+    plan.type = SUBFRAME_CONSTANT;
+    plan.bits = 8 + bps;
+    return;
+  }
+  plan.type = SUBFRAME_VERBATIM;
+  plan.bits = 8 + (uint32_t) n * bps;
+
+  uint8_t max_partition_order = 0;
+  while (max_partition_order < MAX_PARTITION_ORDER && n % (2 << max_partition_order) == 0 &&
+         (n >> (max_partition_order + 1)) > MAX_LPC_ORDER)
+    max_partition_order++;
+  uint16_t partition_size = n >> max_partition_order;
+
+  Plan candidate{};
+  candidate.type = SUBFRAME_FIXED;
+  candidate.bits_per_sample = bps;
+  for (uint8_t order = 0; order <= 4 && order < n; order++) {
+    candidate.order = order;
+    uint64_t sums[1 << MAX_PARTITION_ORDER] = {};
+    for (uint16_t i = order; i < n; i++) sums[i / partition_size] += fold(this->residual_(candidate, i));
+    uint64_t bits = 8 + (uint64_t) order * bps + plan_rice_(sums, n, order, max_partition_order, candidate);
+    if (bits < plan.bits) {
+      candidate.bits = bits;
+      plan = candidate;
+    }
+  }
+
+  if (n > MAX_LPC_ORDER && this->plan_lpc_(n, bps, candidate) && candidate.bits < plan.bits) {
+    plan = candidate;
+  }
+}
+
+void FlacEncoder::write_residual_(uint16_t n, const Plan &plan) {
+  BitWriter &w = this->writer_;
+  w.put(plan.param_bits == 5 ? 1 : 0, 2);
+  w.put(plan.partition_order, 4);
+  uint16_t partitions = 1 << plan.partition_order;
+  uint16_t partition_size = n >> plan.partition_order;
+  uint16_t i = plan.order;
+  for (uint16_t p = 0; p < partitions; p++) {
+    uint8_t param = plan.params[p];
+    w.put(param, plan.param_bits);
+    for (uint16_t end = (p + 1) * partition_size; i < end; i++) {
+      w.put_rice(fold(this->residual_(plan, i)), param);
+    }
+  }
+}
+
+void FlacEncoder::write_subframe_(Channel channel, uint16_t n, const Plan &plan) {
+  this->load_channel_(channel, n);
+  const int32_t *x = this->work_;
+  BitWriter &w = this->writer_;
+  uint8_t bps = plan.bits_per_sample;
+
+  // Zero bit, 6-bit type, no wasted bits
+  switch (plan.type) {
+    case SUBFRAME_CONSTANT:
+      w.put(0x00, 8);
+      w.put_signed(x[0], bps);
+      break;
+    case SUBFRAME_VERBATIM:
+      w.put(0x01 << 1, 8);
+      for (uint16_t i = 0; i < n; i++) w.put_signed(x[i], bps);
+      break;
+    case SUBFRAME_FIXED:
+      w.put((0x08 | plan.order) << 1, 8);
+      for (uint8_t i = 0; i < plan.order; i++) w.put_signed(x[i], bps);
+      this->write_residual_(n, plan);
+      break;
+    case SUBFRAME_LPC:
+      w.put((0x20 | (plan.order - 1)) << 1, 8);
+      for (uint8_t i = 0; i < plan.order; i++) w.put_signed(x[i], bps);
+      w.put(plan.precision - 1, 4);
+      w.put_signed(plan.shift, 5);
+      for (uint8_t j = 0; j < plan.order; j++) w.put_signed(plan.coefs[j], plan.precision);
+      this->write_residual_(n, plan);
+      break;
+  }
+}
+
+size_t FlacEncoder::encode_frame() {
+  uint16_t n = this->fill_;
+  if (n == 0) return 0;
+
+  // Channel assignment and the two channels it codes
+  uint8_t assignment = this->format_.channels - 1;
+  Channel first = CHANNEL_LEFT, second = CHANNEL_RIGHT;
+  this->plan_channel_(CHANNEL_LEFT, n, this->plans_[CHANNEL_LEFT]);
+  if (this->format_.channels == 2) {
+    for (uint8_t c = CHANNEL_RIGHT; c < NUM_PLANS; c++) this->plan_channel_((Channel) c, n, this->plans_[c]);
+    uint32_t left = this->plans_[CHANNEL_LEFT].bits, right = this->plans_[CHANNEL_RIGHT].bits;
+    uint32_t mid = this->plans_[CHANNEL_MID].bits, side = this->plans_[CHANNEL_SIDE].bits;
+    uint32_t best = left + right;
+    if (left + side < best) {
+      best = left + side;
+      assignment = CHANNELS_LEFT_SIDE;
+      first = CHANNEL_LEFT, second = CHANNEL_SIDE;
+    }
+    if (side + right < best) {
+      best = side + right;
+      assignment = CHANNELS_SIDE_RIGHT;
+      first = CHANNEL_SIDE, second = CHANNEL_RIGHT;
+    }
+    if (mid + side < best) {
+      assignment = CHANNELS_MID_SIDE;
+      first = CHANNEL_MID, second = CHANNEL_SIDE;
+    }
+  }
+
+  BitWriter &w = this->writer_;
+  w.reset(this->frame_);
+  w.put(0xFFF8, 16);  // sync, fixed block size
+  uint8_t block_size_code;
+  if (n == BLOCK_SIZE) {
+    block_size_code = 8 + 2;  // 256 << 2
+    static_assert(BLOCK_SIZE == 256 << 2, "block size code");
+  } else {
+    block_size_code = n <= 256 ? BLOCK_SIZE_CODE_8BIT : BLOCK_SIZE_CODE_16BIT;
+  }
+  w.put(block_size_code, 4);
+  w.put(sample_rate_code(this->format_.sample_rate), 4);
+  w.put(assignment, 4);
+  w.put(SAMPLE_SIZE_CODE_16, 3);
+  w.put(0, 1);
+
+  // Frame number, UTF-8 coded
+  uint32_t number = this->frame_number_;
+  if (number < 0x80) {
+    w.put(number, 8);
+  } else {
+    uint8_t extra = number < 0x800 ? 1 : number < 0x10000 ? 2 : number < 0x200000 ? 3 : number < 0x4000000 ? 4 : 5;
+    // As many leading ones as bytes in total
+    w.put(((0xFF00 >> (extra + 1)) & 0xFF) | (number >> (6 * extra)), 8);
+    for (int i = extra - 1; i >= 0; i--) w.put(0x80 | ((number >> (6 * i)) & 0x3F), 8);
+  }
+  if (block_size_code == BLOCK_SIZE_CODE_8BIT) w.put(n - 1, 8);
+  if (block_size_code == BLOCK_SIZE_CODE_16BIT) w.put(n - 1, 16);
+  w.put(crc8(this->frame_, w.length()), 8);
+
+  this->write_subframe_(first, n, this->plans_[first]);
+  if (this->format_.channels == 2) this->write_subframe_(second, n, this->plans_[second]);
+  w.align();
+  w.put(crc16(this->frame_, w.length()), 16);
+
+  uint32_t size = w.length();
+  if (this->min_frame_size_ == 0 || size < this->min_frame_size_) this->min_frame_size_ = size;
+  if (size > this->max_frame_size_) this->max_frame_size_ = size;
+  this->total_samples_ += n;
+  this->frame_number_++;
+  this->frame_samples_ = n;
+  this->fill_ = 0;
+  return size;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
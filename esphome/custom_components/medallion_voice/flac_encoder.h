@@ -0,0 +1,137 @@
+#pragma once
+
+#include "wav_format.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace medallion_voice {
+
+// "fLaC", STREAMINFO and a SEEKTABLE with one point
+static constexpr size_t FLAC_HEADER_SIZE = 4 + 4 + 34 + 4 + 18;
+
+// The header fields a recording keeps up to date
+struct FlacStreamInfo {
+  uint64_t total_samples;   // per channel
+  uint32_t min_frame_size;  // 0: not known
+  uint32_t max_frame_size;
+  // While recording, the seek point marks the last checkpoint: the first
+  // `checkpoint_samples` samples end `checkpoint_offset` bytes after the
+  // header. A finished file has a placeholder point instead.
+  bool has_checkpoint;
+  uint64_t checkpoint_samples;
+  uint64_t checkpoint_offset;
+};
+
+// Fill the FLAC_HEADER_SIZE-byte header. The MD5 field is left zero, which
+// FLAC defines as "not computed". Like the WAV header helpers, this has no
+// hardware dependencies so it can be built and checked on the host.
+void build_flac_header(uint8_t *out, const AudioFormat &format, const FlacStreamInfo &info);
+
+// Fails unless `header` is a header written by build_flac_header()
+bool parse_flac_header(const uint8_t *header, FlacStreamInfo *info);
+
+// Streaming FLAC encoder for 16-bit PCM with one or two channels. Each frame
+// picks, per channel, the cheapest of a constant, verbatim, fixed (orders
+// 0-4) or LPC (order 8) subframe with partitioned Rice residuals, and for
+// stereo the cheapest of left/right, left/side, side/right and mid/side.
+// All buffers are members: encoding never allocates.
+class FlacEncoder {
+ public:
+  // Samples per channel in every frame but the last: 64 ms at 16 kHz
+  static constexpr uint16_t BLOCK_SIZE = 1024;
+  static constexpr uint8_t MAX_CHANNELS = 2;
+  static constexpr uint8_t MAX_LPC_ORDER = 8;
+  static constexpr uint8_t MAX_PARTITION_ORDER = 4;
+  // Frame header, two verbatim subframes of which one is a 17-bit side
+  // channel, CRC-16. No subframe is ever coded larger than verbatim.
+  static constexpr size_t MAX_FRAME_SIZE = 16 + 2 * (1 + (17 * BLOCK_SIZE + 7) / 8) + 2;
+
+  // Start a new stream
+  bool begin(const AudioFormat &format);
+
+  // Take interleaved little-endian PCM until the block is full; returns the
+  // bytes taken, always whole sample frames
+  size_t add(const uint8_t *pcm, size_t length);
+  bool is_frame_ready() const { return this->fill_ == BLOCK_SIZE; }
+  bool has_samples() const { return this->fill_ > 0; }
+
+  // Encode the buffered samples, a full block or at the end of the stream
+  // what is left, into get_frame(). Returns the frame size, 0 if nothing was
+  // buffered.
+  size_t encode_frame();
+  const uint8_t *get_frame() const { return this->frame_; }
+  // Samples per channel in the frame last encoded
+  uint16_t get_frame_samples() const { return this->frame_samples_; }
+
+  // Totals over the frames encoded so far
+  uint64_t get_total_samples() const { return this->total_samples_; }
+  uint32_t get_min_frame_size() const { return this->min_frame_size_; }
+  uint32_t get_max_frame_size() const { return this->max_frame_size_; }
+
+ protected:
+  enum Channel : uint8_t { CHANNEL_LEFT, CHANNEL_RIGHT, CHANNEL_MID, CHANNEL_SIDE, NUM_PLANS };
+  enum SubframeType : uint8_t { SUBFRAME_CONSTANT, SUBFRAME_VERBATIM, SUBFRAME_FIXED, SUBFRAME_LPC };
+
+  // The cheapest coding found for one channel of the block
+  struct Plan {
+    SubframeType type;
+    uint8_t bits_per_sample;
+    uint8_t order;
+    uint8_t precision;
+    uint8_t shift;
+    int32_t coefs[MAX_LPC_ORDER];
+    uint8_t partition_order;
+    uint8_t param_bits;  // 4, or 5 when a parameter is above 14
+    uint8_t params[1 << MAX_PARTITION_ORDER];
+    uint32_t bits;  // whole subframe
+  };
+
+  class BitWriter {
+   public:
+    void reset(uint8_t *out) {
+      this->out_ = out;
+      this->length_ = 0;
+      this->acc_ = 0;
+      this->acc_bits_ = 0;
+    }
+    void put(uint32_t value, uint8_t bits);
+    void put_signed(int32_t value, uint8_t bits) { this->put((uint32_t) value & (0xFFFFFFFFu >> (32 - bits)), bits); }
+    void put_rice(uint32_t folded, uint8_t param);
+    // Pad to a byte boundary
+    void align();
+    size_t length() const { return this->length_; }
+
+   protected:
+    uint8_t *out_;
+    size_t length_;
+    uint64_t acc_;
+    uint8_t acc_bits_;
+  };
+
+  void load_channel_(Channel channel, uint16_t n);
+  void plan_channel_(Channel channel, uint16_t n, Plan &plan);
+  bool plan_lpc_(uint16_t n, uint8_t bps, Plan &plan);
+  uint32_t plan_rice_(const uint64_t *sums, uint16_t n, uint8_t order, uint8_t max_partition_order, Plan &plan);
+  void write_subframe_(Channel channel, uint16_t n, const Plan &plan);
+  void write_residual_(uint16_t n, const Plan &plan);
+  int32_t residual_(const Plan &plan, uint16_t i) const;
+
+  AudioFormat format_{};
+  uint16_t fill_{0};
+  uint16_t frame_samples_{0};
+  uint32_t frame_number_{0};
+  uint64_t total_samples_{0};
+  uint32_t min_frame_size_{0};
+  uint32_t max_frame_size_{0};
+
+  int16_t samples_[MAX_CHANNELS][BLOCK_SIZE];
+  // The channel being planned or written, as 32-bit samples
+  int32_t work_[BLOCK_SIZE];
+  Plan plans_[NUM_PLANS];
+  BitWriter writer_;
+  uint8_t frame_[MAX_FRAME_SIZE];
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,319 @@
+#include "http_upload_client.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/components/deferred_log/deferred_log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.http";
+
+// Socket timeout for connect, writes and each response read
+static const uint32_t HTTP_TIMEOUT_MS = 10000;
+
+void HttpUploadClient::set_server(const std::string &host, uint16_t port, bool secure) {
+  if (host == this->host_ && port == this->port_ && secure == this->secure_) return;
+  this->close();
+  this->tls_.forget_session();
+  this->host_ = host;
+  this->port_ = port;
+  this->secure_ = secure;
+}
+
+bool HttpUploadClient::ensure_connected(bool &reused) {
+  if (this->is_connected()) {
+    reused = true;
+    return true;
+  }
+  reused = false;
+
+  this->close();
+  this->client_.setTimeout(HTTP_TIMEOUT_MS);
+  if (!this->client_.connect(this->host_.c_str(), this->port_, HTTP_TIMEOUT_MS)) {
+    ESP_LOGE(TAG, "Failed to connect to %s:%u", this->host_.c_str(), this->port_);
+    return false;
+  }
+  this->client_.setNoDelay(true);
+  if (this->secure_ && !this->tls_.handshake(&this->client_, this->host_, HTTP_TIMEOUT_MS)) {
+    this->client_.stop();
+    return false;
+  }
+  this->connect_count_++;
+  ESP_LOGD(TAG, "Connected to %s:%u", this->host_.c_str(), this->port_);
+  return true;
+}
+
+void HttpUploadClient::close() {
+  this->tls_.close();
+  this->client_.stop();
+}
+
+bool HttpUploadClient::send_request(const char *method, const char *path, const char *extra_headers,
+                                    size_t content_length) {
+  char head[256];
+  int len = snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s\r\n", method, path, this->host_.c_str());
+  if (len < 0 || (size_t) len >= sizeof(head)) return false;
+  if (!this->write((const uint8_t *) head, len)) return false;
+
+  if (extra_headers != nullptr && !this->print(extra_headers)) return false;
+
+  len = snprintf(head, sizeof(head), "Content-Length: %u\r\n\r\n", (unsigned) content_length);
+  return this->write((const uint8_t *) head, len);
+}
+
+bool HttpUploadClient::write(const uint8_t *data, size_t length) {
+  if (this->secure_) {
+    if (this->tls_.write(data, length)) return true;
+    this->close();
+    return false;
+  }
+  while (length > 0) {
+    size_t n = this->client_.write(data, length);
+    if (n == 0) {
+      DEFERRED_LOGW(TAG, "Write failed");
+      this->close();
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+size_t HttpUploadClient::read_some_(uint8_t *buf, size_t length) {
+  uint32_t start = millis();
+  while (true) {
+    int n;
+    if (this->secure_) {
+      n = this->tls_.read(buf, length);
+    } else {
+      int available = this->client_.available();
+      if (available > 0) {
+        n = this->client_.read(buf, length < (size_t) available ? length : (size_t) available);
+      } else {
+        n = this->client_.connected() ? 0 : -1;
+      }
+    }
+    if (n > 0) return n;
+    if (n < 0) return 0;
+    if (millis() - start > HTTP_TIMEOUT_MS) return 0;
+    delay(1);
+  }
+}
+
+int HttpUploadClient::read_byte_() {
+  uint8_t c;
+  return this->read_some_(&c, 1) == 1 ? c : -1;
+}
+
+bool HttpUploadClient::read_line_(char *buf, size_t size) {
+  size_t len = 0;
+  while (true) {
+    int c = this->read_byte_();
+    if (c < 0) return false;
+    if (c == '\n') break;
+    if (c == '\r') continue;
+    // Over-long lines are truncated; only the start is ever interpreted
+    if (len + 1 < size) buf[len++] = c;
+  }
+  buf[len] = '\0';
+  return true;
+}
+
+bool HttpUploadClient::read_body_bytes_(HttpResponse &response, size_t length) {
+  uint8_t scratch[64];
+  while (length > 0) {
+    size_t want = length < sizeof(scratch) ? length : sizeof(scratch);
+    size_t n = this->read_some_(scratch, want);
+    if (n == 0) return false;
+
+    size_t room = sizeof(response.body) - 1 - response.body_length;
+    size_t keep = n < room ? n : room;
+    memcpy(response.body + response.body_length, scratch, keep);
+    response.body_length += keep;
+    length -= n;
+  }
+  return true;
+}
+
+bool HttpUploadClient::read_chunked_body_(HttpResponse &response) {
+  char line[64];
+  while (true) {
+    if (!this->read_line_(line, sizeof(line))) return false;
+    size_t chunk = strtoul(line, nullptr, 16);
+    if (chunk == 0) break;
+    if (!this->read_body_bytes_(response, chunk)) return false;
+    // CRLF after chunk data
+    if (!this->read_line_(line, sizeof(line))) return false;
+  }
+  // Trailers end with an empty line
+  do {
+    if (!this->read_line_(line, sizeof(line))) return false;
+  } while (line[0] != '\0');
+  return true;
+}
+
+bool HttpUploadClient::read_body_until_close_(HttpResponse &response) {
+  while (true) {
+    int c = this->read_byte_();
+    if (c < 0) return true;
+    if (response.body_length + 1 < sizeof(response.body)) {
+      response.body[response.body_length++] = c;
+    }
+  }
+}
+
+bool HttpUploadClient::read_status_(HttpResponse &response, bool &http11) {
+  char line[192];
+  if (!this->read_line_(line, sizeof(line))) {
+    DEFERRED_LOGW(TAG, "No response from server");
+    this->close();
+    return false;
+  }
+  if (strncmp(line, "HTTP/1.", 7) != 0 || strlen(line) < 12) {
+    ESP_LOGW(TAG, "Malformed status line: %s", line);
+    this->close();
+    return false;
+  }
+  http11 = line[7] == '1';
+  response.status = atoi(line + 9);
+  return true;
+}
+
+bool HttpUploadClient::skip_headers_() {
+  char line[192];
+  do {
+    if (!this->read_line_(line, sizeof(line))) {
+      this->close();
+      return false;
+    }
+  } while (line[0] != '\0');
+  return true;
+}
+
+bool HttpUploadClient::read_response(HttpResponse &response) {
+  response.status = 0;
+  response.keep_alive = false;
+  response.body_length = 0;
+  response.body[0] = '\0';
+
+  bool http11 = false;
+  // Skip interim 1xx responses (e.g. 100 Continue); they have no body
+  do {
+    if (!this->read_status_(response, http11)) return false;
+    if (response.status >= 200) break;
+    if (!this->skip_headers_()) return false;
+  } while (true);
+
+  return this->read_headers_and_body_(response, http11);
+}
+
+bool HttpUploadClient::await_continue(HttpResponse &response, uint32_t timeout_ms, bool &send_body) {
+  response.status = 0;
+  response.keep_alive = false;
+  response.body_length = 0;
+  response.body[0] = '\0';
+  send_body = true;
+
+  uint32_t start = millis();
+  while (true) {
+    // Servers that ignore Expect never answer; send the body after a while
+    while (this->available_() == 0) {
+      if (!this->is_connected()) return false;
+      if (millis() - start > timeout_ms) return true;
+      delay(1);
+    }
+
+    bool http11 = false;
+    if (!this->read_status_(response, http11)) return false;
+    if (response.status == 100) return this->skip_headers_();
+    if (response.status > 100 && response.status < 200) {
+      if (!this->skip_headers_()) return false;
+      continue;
+    }
+
+    // Final response before the body: the request's Content-Length was never
+    // satisfied, so the connection cannot carry another request
+    send_body = false;
+    bool ok = this->read_headers_and_body_(response, http11);
+    this->close();
+    return ok;
+  }
+}
+
+int HttpUploadClient::available_() {
+  if (this->secure_) return this->tls_.available();
+  return this->client_.available();
+}
+
+bool HttpUploadClient::read_headers_and_body_(HttpResponse &response, bool http11) {
+  DEFERRED_LOGD(TAG, "Response: %d", response.status);
+
+  char line[192];
+  bool has_length = false;
+  size_t content_length = 0;
+  bool chunked = false;
+  response.keep_alive = http11;
+  while (true) {
+    if (!this->read_line_(line, sizeof(line))) {
+      this->close();
+      return false;
+    }
+    if (line[0] == '\0') break;
+
+    char *colon = strchr(line, ':');
+    if (colon == nullptr) continue;
+    *colon = '\0';
+    char *value = colon + 1;
+    while (*value == ' ' || *value == '\t') value++;
+
+    if (strcasecmp(line, "Content-Length") == 0) {
+      has_length = true;
+      content_length = strtoul(value, nullptr, 10);
+    } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+      // Chunked must be the final coding, e.g. "gzip, chunked"
+      const char *last = strrchr(value, ',');
+      last = last != nullptr ? last + 1 : value;
+      while (*last == ' ') last++;
+      chunked = strncasecmp(last, "chunked", 7) == 0;
+    } else if (strcasecmp(line, "Connection") == 0) {
+      if (strcasecmp(value, "close") == 0) {
+        response.keep_alive = false;
+      } else if (strcasecmp(value, "keep-alive") == 0) {
+        response.keep_alive = true;
+      }
+    }
+    if (response.on_header) response.on_header(line, value);
+  }
+
+  // Body
+  bool ok = true;
+  if (response.status == 204 || response.status == 304) {
+    // No body by definition
+  } else if (chunked) {
+    ok = this->read_chunked_body_(response);
+  } else if (has_length) {
+    ok = this->read_body_bytes_(response, content_length);
+  } else {
+    // Body delimited by connection close
+    ok = this->read_body_until_close_(response);
+    response.keep_alive = false;
+  }
+  response.body[response.body_length] = '\0';
+
+  if (!ok) {
+    DEFERRED_LOGW(TAG, "Truncated response body");
+    response.keep_alive = false;
+  }
+  if (!response.keep_alive) {
+    this->close();
+  }
+  return ok;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
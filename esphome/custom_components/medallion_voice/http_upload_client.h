@@ -0,0 +1,86 @@
+#pragma once
+
+#include "tls_session.h"
+#include <WiFi.h>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace esphome {
+namespace medallion_voice {
+
+struct HttpResponse {
+  int status{0};
+  bool keep_alive{false};
+  // Called for every response header while the response is parsed
+  std::function<void(const char *name, const char *value)> on_header;
+  // Start of the response body, NUL-terminated and truncated to fit; the rest
+  // of the body is drained so the connection stays in sync
+  char body[128]{};
+  size_t body_length{0};
+
+  bool is_success() const { return this->status >= 200 && this->status < 300; }
+};
+
+// Minimal HTTP/1.1 client that keeps a persistent connection to one server.
+// Responses are parsed completely (status, headers, Content-Length or chunked
+// body) so the connection can be reused for the next request. With `secure`
+// the connection runs over TLS, resuming the previous TLS session whenever a
+// new connection has to be opened.
+class HttpUploadClient {
+ public:
+  // Select the server; drops the current connection and cached TLS session
+  // if it points elsewhere
+  void set_server(const std::string &host, uint16_t port, bool secure);
+  void set_ca_certificate(const char *pem) { this->tls_.set_ca_certificate(pem); }
+
+  // Connect unless a live connection already exists. `reused` reports whether
+  // an existing connection was kept, so callers can retry once on a fresh
+  // socket if the server closed it while idle.
+  bool ensure_connected(bool &reused);
+  bool is_connected() { return this->client_.connected() && (!this->secure_ || this->tls_.is_open()); }
+  void close();
+
+  // Send request line, Host header, `extra_headers` (preformatted lines ending
+  // in CRLF, may be nullptr) and Content-Length
+  bool send_request(const char *method, const char *path, const char *extra_headers, size_t content_length);
+  bool write(const uint8_t *data, size_t length);
+  bool print(const char *text) { return this->write((const uint8_t *) text, strlen(text)); }
+
+  // Read the complete response. Closes the connection on protocol errors or
+  // when the server does not keep it alive.
+  bool read_response(HttpResponse &response);
+
+  // For requests sent with "Expect: 100-continue": wait up to `timeout_ms`
+  // for the server's go-ahead before sending the body. `send_body` is false
+  // when the server answered early with a final response (filled into
+  // `response`); the connection is then closed, as the body was declared but
+  // never sent. Returns false on connection errors.
+  bool await_continue(HttpResponse &response, uint32_t timeout_ms, bool &send_body);
+
+  uint32_t get_connect_count() const { return this->connect_count_; }
+  const TlsSession &get_tls() const { return this->tls_; }
+
+ protected:
+  bool read_status_(HttpResponse &response, bool &http11);
+  bool skip_headers_();
+  bool read_headers_and_body_(HttpResponse &response, bool http11);
+  bool read_line_(char *buf, size_t size);
+  bool read_body_bytes_(HttpResponse &response, size_t length);
+  bool read_chunked_body_(HttpResponse &response);
+  bool read_body_until_close_(HttpResponse &response);
+  int read_byte_();
+  int available_();
+  // Read up to `length` bytes, waiting for at least one; 0 on close or timeout
+  size_t read_some_(uint8_t *buf, size_t length);
+
+  WiFiClient client_;
+  TlsSession tls_;
+  std::string host_;
+  uint16_t port_{0};
+  bool secure_{false};
+  uint32_t connect_count_{0};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
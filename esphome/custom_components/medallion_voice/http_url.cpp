@@ -0,0 +1,53 @@
+#include "http_url.h"
+#include <cstdlib>
+
+namespace esphome {
+namespace medallion_voice {
+
+bool parse_http_url(const std::string &url, HttpUrl &out, const char **error) {
+  size_t scheme_length;
+  if (url.compare(0, 7, "http://") == 0) {
+    out.secure = false;
+    scheme_length = 7;
+  } else if (url.compare(0, 8, "https://") == 0) {
+    out.secure = true;
+    scheme_length = 8;
+  } else {
+    *error = "Only http:// and https:// URLs are supported";
+    return false;
+  }
+
+  std::string rest = url.substr(scheme_length);
+  size_t path_start = rest.find('/');
+  if (path_start == std::string::npos) {
+    *error = "Invalid URL: no path";
+    return false;
+  }
+
+  std::string host_port = rest.substr(0, path_start);
+  out.path = rest.substr(path_start);
+
+  size_t colon = host_port.find(':');
+  if (colon != std::string::npos) {
+    out.host = host_port.substr(0, colon);
+    char *end = nullptr;
+    long port = strtol(host_port.c_str() + colon + 1, &end, 10);
+    if (end == host_port.c_str() + colon + 1 || *end != '\0' || port <= 0 || port > 65535) {
+      *error = "Invalid URL: bad port";
+      return false;
+    }
+    out.port = port;
+  } else {
+    out.host = host_port;
+    out.port = out.secure ? 443 : 80;
+  }
+
+  if (out.host.empty()) {
+    *error = "Invalid URL: no host";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
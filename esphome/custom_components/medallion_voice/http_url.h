@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace medallion_voice {
+
+struct HttpUrl {
+  std::string host;
+  uint16_t port{80};
+  std::string path;
+  bool secure{false};
+};
+
+// Parse "http[s]://host[:port]/path". Returns false and sets `error` on
+// malformed input. Free of Arduino dependencies for host-side testing.
+bool parse_http_url(const std::string &url, HttpUrl &out, const char **error);
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,126 @@
+#include "log_file.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <cinttypes>
+#include <cstdio>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.log";
+
+static char level_letter(uint8_t level) {
+  switch (level) {
+    case ESPHOME_LOG_LEVEL_ERROR:
+      return 'E';
+    case ESPHOME_LOG_LEVEL_WARN:
+      return 'W';
+    case ESPHOME_LOG_LEVEL_INFO:
+      return 'I';
+    case ESPHOME_LOG_LEVEL_CONFIG:
+      return 'C';
+    case ESPHOME_LOG_LEVEL_DEBUG:
+      return 'D';
+    default:
+      return 'V';
+  }
+}
+
+bool LogFile::setup(SdFs *sd, SemaphoreHandle_t sd_mutex) {
+  this->sd_ = sd;
+  this->sd_mutex_ = sd_mutex;
+  SdLock lock(this->sd_mutex_);
+  if (!this->open_()) {
+    ESP_LOGE(TAG, "Cannot open %s", this->path_.c_str());
+    this->failed_ = true;
+    return false;
+  }
+  if (this->size_ >= this->max_size_) this->rotate_();
+  return !this->failed_;
+}
+
+void LogFile::write(const deferred_log::LogRecord &record, const char *message) {
+  if (this->failed_) return;
+  for (int attempt = 0; attempt < 2; attempt++) {
+    size_t room = BUFFER_SIZE - this->used_;
+    int length = snprintf(this->buffer_ + this->used_, room, "%" PRIu32 ".%03" PRIu32 " %c %s: %s\n",
+                          record.timestamp / 1000, record.timestamp % 1000, level_letter(record.level), record.tag,
+                          message);
+    if (length < 0) return;
+    if ((size_t) length < room) {
+      this->used_ += length;
+      return;
+    }
+    if (this->used_ == 0) {
+      // Longer than the whole buffer: keep what fits
+      this->buffer_[BUFFER_SIZE - 2] = '\n';
+      this->used_ = BUFFER_SIZE - 1;
+      return;
+    }
+    // Did not fit: write out what is there and try again in the empty buffer
+    SdLock lock(this->sd_mutex_);
+    this->write_buffer_();
+  }
+}
+
+void LogFile::flush() {
+  if (this->failed_ || this->used_ == 0) return;
+  if (this->used_ < BUFFER_SIZE / 2 && millis() - this->last_write_ms_ < WRITE_INTERVAL_MS) return;
+  SdLock lock(this->sd_mutex_);
+  this->write_buffer_();
+}
+
+bool LogFile::open_() {
+  this->file_ = this->sd_->open(this->path_.c_str(), O_WRONLY | O_CREAT | O_APPEND);
+  if (!this->file_) return false;
+  this->size_ = this->file_.fileSize();
+  return true;
+}
+
+void LogFile::rotate_() {
+  this->file_.close();
+  // The config limits the path to 44 characters, leaving room for ".<n>"
+  char from[48];
+  char to[48];
+  snprintf(to, sizeof(to), "%s.%u", this->path_.c_str(), (unsigned) this->files_);
+  this->sd_->remove(to);
+  for (uint8_t i = this->files_; i > 1; i--) {
+    snprintf(from, sizeof(from), "%s.%u", this->path_.c_str(), (unsigned) (i - 1));
+    snprintf(to, sizeof(to), "%s.%u", this->path_.c_str(), (unsigned) i);
+    if (this->sd_->exists(from)) this->sd_->rename(from, to);
+  }
+  if (this->files_ > 0) {
+    snprintf(to, sizeof(to), "%s.1", this->path_.c_str());
+    this->sd_->rename(this->path_.c_str(), to);
+  } else {
+    this->sd_->remove(this->path_.c_str());
+  }
+  if (!this->open_()) {
+    ESP_LOGE(TAG, "Cannot reopen %s after rotation", this->path_.c_str());
+    this->failed_ = true;
+  }
+}
+
+void LogFile::write_buffer_() {
+  uint32_t now = millis();
+  size_t written = this->file_.write(this->buffer_, this->used_);
+  if (written != this->used_) {
+    // A card that fails here would fail every write; stop instead of
+    // retrying on each batch
+    ESP_LOGW(TAG, "Write to %s failed, SD logging stopped", this->path_.c_str());
+    this->file_.close();
+    this->failed_ = true;
+    return;
+  }
+  this->size_ += written;
+  this->used_ = 0;
+  this->last_write_ms_ = now;
+  if (now - this->last_sync_ms_ >= SYNC_INTERVAL_MS) {
+    this->file_.sync();
+    this->last_sync_ms_ = now;
+  }
+  if (this->size_ >= this->max_size_) this->rotate_();
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "esphome/components/deferred_log/deferred_log.h"
+#include "sd_lock.h"
+#include <SdFat.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace medallion_voice {
+
+// Rotating text log on the SD card, fed by deferred_log's drain task.
+//
+// Lines collect in a buffer that goes to the card when half full or a second
+// after the last write, so the card sees a few larger writes instead of one
+// per line. Once the file passes its size limit it is renamed to
+// "<path>.1", older files move up by one and the oldest is removed.
+class LogFile : public deferred_log::LogSink {
+ public:
+  void set_path(const std::string &path) { this->path_ = path; }
+  void set_max_size(uint32_t max_size) { this->max_size_ = max_size; }
+  // Rotated files kept besides the current one
+  void set_files(uint8_t files) { this->files_ = files; }
+  bool is_enabled() const { return !this->path_.empty(); }
+
+  // Open the log for appending. All SD access is done under `sd_mutex`
+  // (may be null).
+  bool setup(SdFs *sd, SemaphoreHandle_t sd_mutex);
+
+  void write(const deferred_log::LogRecord &record, const char *message) override;
+  void flush() override;
+
+  const std::string &get_path() const { return this->path_; }
+  uint32_t get_max_size() const { return this->max_size_; }
+  uint8_t get_files() const { return this->files_; }
+
+ protected:
+  static constexpr size_t BUFFER_SIZE = 1024;
+  static constexpr uint32_t WRITE_INTERVAL_MS = 1000;
+  static constexpr uint32_t SYNC_INTERVAL_MS = 5000;
+
+  // Under the SD lock
+  bool open_();
+  void rotate_();
+  void write_buffer_();
+
+  SdFs *sd_{nullptr};
+  SemaphoreHandle_t sd_mutex_{nullptr};
+  FsFile file_;
+  std::string path_;
+  uint32_t max_size_{256 * 1024};
+  uint8_t files_{3};
+  uint32_t size_{0};
+  char buffer_[BUFFER_SIZE];
+  size_t used_{0};
+  uint32_t last_write_ms_{0};
+  uint32_t last_sync_ms_{0};
+  bool failed_{false};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -1,44 +1,144 @@
 #include "medallion_voice.h"
+#include "http_url.h"
 #include "esphome/core/log.h"
 #include "esphome/components/network/util.h"
+#include <esp_cpu.h>
+#include <algorithm>
+#include <cinttypes>
+#include <ctime>
 
 namespace esphome {
 namespace medallion_voice {
 
 static const char *const TAG = "medallion_voice";
 
-// WAV format constants
-static const uint16_t WAV_NUM_CHANNELS = 2;
-static const uint16_t WAV_BITS_PER_SAMPLE = 16;
-static const uint32_t WAV_SAMPLE_RATE = 16000;
+// Live capture stats are published at this interval while recording
+static const uint32_t STATS_PUBLISH_INTERVAL_MS = 5000;
+
+// Before this (2020-09-13) the clock has not been set by SNTP
+static const time_t CLOCK_VALID_AFTER = 1600000000;
 
 void MedallionVoiceComponent::setup() {
   ESP_LOGI(TAG, "Setting up Medallion Voice Recorder...");
 
+  this->setup_formats_();
+
   // Initialize SD card
   if (!this->init_sd_card_()) {
     ESP_LOGE(TAG, "Failed to initialize SD card");
-    this->status_ = "SD Failed";
+    this->fail_(RecorderError::SD_FAILED);
     // Don't mark failed - device can still function without SD
   } else {
-    this->status_ = "Ready";
+    // Shared by the recorder, the catalog and the upload task
+    this->sd_mutex_ = xSemaphoreCreateMutex();
+    this->catalog_.setup(&this->sd_, this->sd_mutex_);
+    if (this->slot_store_.get_slot_count() > 0 && !this->slot_store_.setup(&this->sd_, this->sd_mutex_)) {
+      ESP_LOGE(TAG, "Storage slots unavailable, recording to plain files");
+    }
+    this->load_catalog_();
+    if (this->log_file_.is_enabled() && this->deferred_log_ != nullptr &&
+        this->log_file_.setup(&this->sd_, this->sd_mutex_)) {
+      this->deferred_log_->add_sink(&this->log_file_);
+    }
+  }
+
+  if (this->resumable_upload_ && this->sd_mounted_) {
+    this->start_upload_task_();
+  }
+
+  this->upload_io_pool_.reserve(MULTIPART_IO_SIZE, 1);
+
+  // Every consumer registers before the pool is sized
+  this->sd_consumer_ = this->audio_bus_.add_consumer("sd", SD_BUS_DEPTH);
+  if (!this->streamer_.get_host().empty()) {
+    this->streamer_.setup(this->capture_format_, &this->audio_bus_, AUDIO_BLOCK_SIZE);
+  }
+  if (this->sd_consumer_ == nullptr || !this->audio_bus_.setup(AUDIO_BLOCK_SIZE)) {
+    ESP_LOGE(TAG, "Audio bus unavailable, recording disabled");
   }
 
+#ifdef USE_MEDALLION_VOICE_DOWNLOAD
+  if (this->web_server_base_ != nullptr && this->sd_mounted_) {
+    this->web_server_base_->add_handler(new RecordingDownloadHandler(this, this->download_path_));
+  }
+#endif
+
+  // Later changes are published by set_state_() as they happen
+  if (this->status_text_sensor_ != nullptr) this->status_text_sensor_->publish_state(this->get_status());
+  if (this->recording_binary_sensor_ != nullptr) this->recording_binary_sensor_->publish_state(false);
+  if (this->streaming_binary_sensor_ != nullptr) this->streaming_binary_sensor_->publish_state(false);
+
   ESP_LOGI(TAG, "Medallion Voice Recorder initialized");
 }
 
+void MedallionVoiceComponent::setup_formats_() {
+  // Recordings can be written at a rate of their own, which their headers
+  // carry; the SD writer then resamples every captured block
+  if (this->audio_codec_ != nullptr) {
+    this->capture_format_.sample_rate = this->audio_codec_->get_sample_rate();
+    // The front end, resampler, encoder and streamer all take int16: wider
+    // slots are read into a buffer of their own and narrowed from there
+    if (this->audio_codec_->get_bits_per_sample() != 16 && this->wide_buffer_ == nullptr) {
+      if (this->wide_pool_.reserve(AUDIO_BLOCK_SIZE * 2, 1)) this->wide_buffer_ = this->wide_pool_.acquire();
+      if (this->wide_buffer_ == nullptr) {
+        ESP_LOGE(TAG, "No buffer for %u-bit capture, recording disabled",
+                 (unsigned) this->audio_codec_->get_bits_per_sample());
+      }
+    }
+  }
+  this->record_format_ = this->capture_format_;
+  if (this->sample_rate_ > 0) this->record_format_.sample_rate = this->sample_rate_;
+  this->frontend_.setup(this->capture_format_.sample_rate, this->capture_format_.channels);
+
+  this->resampling_ = false;
+  if (this->record_format_.sample_rate == this->capture_format_.sample_rate) return;
+  size_t frames = AUDIO_BLOCK_SIZE / this->capture_format_.block_align();
+  if (this->resampler_.setup(this->capture_format_.sample_rate, this->record_format_.sample_rate,
+                             this->record_format_.channels)) {
+    // The buffer is sized by the first ratio; a later capture rate that
+    // needs more falls back
+    size_t size = this->resampler_.max_output_frames(frames) * this->record_format_.block_align();
+    if (!this->resample_pool_.is_reserved() && this->resample_pool_.reserve(size, 1)) {
+      this->resample_buffer_ = this->resample_pool_.acquire();
+    }
+    this->resampling_ = this->resample_buffer_ != nullptr && size <= this->resample_pool_.get_block_size();
+  }
+  if (!this->resampling_) {
+    ESP_LOGE(TAG, "Cannot resample to %u Hz, recording at %u Hz", (unsigned) this->record_format_.sample_rate,
+             (unsigned) this->capture_format_.sample_rate);
+    this->record_format_.sample_rate = this->capture_format_.sample_rate;
+  }
+}
+
 void MedallionVoiceComponent::loop() {
-  if (!this->recording_) return;
+  if (!this->is_recording()) {
+    this->update_upload_status_();
+    if (this->sd_mounted_) this->catalog_.compact_if_needed();
+    this->publish_storage_stats_();
+    // Nothing changes while idle until a state change or the upload task
+    // wakes the loop again
+    this->disable_loop();
+    return;
+  }
+  perf_stats::ScopedTimer timer(this->loop_time_);
 
-  // Read audio data and write to SD card
+  // Capture one block, then write what the SD consumer has queued
   if (this->audio_codec_ != nullptr && this->record_file_) {
-    size_t bytes_read = this->audio_codec_->read_samples(this->audio_buffer_, AUDIO_BUFFER_SIZE);
-    if (bytes_read > 0) {
-      size_t written = this->record_file_.write(this->audio_buffer_, bytes_read);
-      if (written > 0) {
-        this->recorded_bytes_ += written;
-      }
-    }
+    this->capture_block_();
+    this->write_queued_blocks_();
+    if (!this->is_recording()) return;
+  }
+
+  uint32_t now = millis();
+  if (now - this->last_checkpoint_ms_ >= this->checkpoint_interval_ms_) {
+    this->checkpoint_record_file_();
+    now = millis();
+  }
+  if (now - this->last_stats_publish_ >= STATS_PUBLISH_INTERVAL_MS) {
+    this->last_stats_publish_ = now;
+    this->update_capture_stats_();
+    this->publish_capture_stats_();
+    this->publish_stream_state_();
   }
 }
 
@@ -46,6 +146,44 @@ void MedallionVoiceComponent::dump_config() {
   ESP_LOGCONFIG(TAG, "Medallion Voice Recorder:");
   LOG_PIN("  SD CS Pin: ", this->sd_cs_pin_);
   ESP_LOGCONFIG(TAG, "  Upload URL: %s", this->upload_url_.c_str());
+  if (this->upload_url_.compare(0, 8, "https://") == 0) {
+    ESP_LOGCONFIG(TAG, "  TLS: %s, crypto %s", this->ca_certificate_ != nullptr ? "CA verified" : "unverified",
+                  TlsSession::crypto_backend());
+  }
+  if (this->resumable_upload_) {
+    ESP_LOGCONFIG(TAG, "  Resumable Upload: chunk size %u bytes", (unsigned) this->uploader_.get_chunk_size());
+  }
+  if (this->segment_duration_ms_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Segment Duration: %u s", (unsigned) (this->segment_duration_ms_ / 1000));
+  }
+  ESP_LOGCONFIG(TAG, "  Checkpoint Interval: %u ms", (unsigned) this->checkpoint_interval_ms_);
+  ESP_LOGCONFIG(TAG, "  File Format: %s, %u Hz%s", this->flac_ ? "FLAC" : "WAV",
+                (unsigned) this->record_format_.sample_rate,
+                this->resampling_ ? " (resampled)" : "");
+  if (this->frontend_.is_highpass_enabled()) {
+    ESP_LOGCONFIG(TAG, "  High-pass: %u Hz", (unsigned) this->frontend_.get_highpass_cutoff());
+  }
+  if (this->frontend_.is_agc_enabled()) {
+    ESP_LOGCONFIG(TAG, "  AGC: target %d dBFS, max gain %u dB%s", this->frontend_.get_agc_target(),
+                  (unsigned) this->frontend_.get_agc_max_gain(), this->frontend_.is_pga_control() ? ", PGA control" : "");
+  }
+  ESP_LOGCONFIG(TAG, "  Audio Bus: %u blocks of %u bytes, %u consumers", (unsigned) this->audio_bus_.get_pool_size(),
+                (unsigned) this->audio_bus_.get_block_size(), (unsigned) this->audio_bus_.get_consumers().size());
+  if (!this->streamer_.get_host().empty()) {
+    ESP_LOGCONFIG(TAG, "  Live Stream: rtp://%s:%u, %u Hz, %u ms packets%s", this->streamer_.get_host().c_str(),
+                  this->streamer_.get_port(), (unsigned) this->streamer_.get_format().sample_rate,
+                  (unsigned) this->streamer_.get_frame_duration(), this->streamer_.is_enabled() ? "" : " (failed)");
+  }
+  if (this->slot_store_.get_slot_count() > 0) {
+    ESP_LOGCONFIG(TAG, "  Storage Slots: %u x %u bytes%s", this->slot_store_.get_slot_count(),
+                  (unsigned) this->slot_store_.get_slot_size(), this->slot_store_.is_enabled() ? "" : " (unavailable)");
+  }
+  if (this->log_file_.is_enabled()) {
+    ESP_LOGCONFIG(TAG, "  Log File: %s, %u bytes, %u older files", this->log_file_.get_path().c_str(),
+                  (unsigned) this->log_file_.get_max_size(), this->log_file_.get_files());
+  }
+  ESP_LOGCONFIG(TAG, "  Catalog: %u records, next recording %u", (unsigned) this->catalog_.get_record_count(),
+                this->record_counter_);
   ESP_LOGCONFIG(TAG, "  SD Mounted: %s", this->sd_mounted_ ? "Yes" : "No");
 }
 
@@ -97,7 +235,7 @@ bool MedallionVoiceComponent::init_sd_card_() {
     else if (card_type == SD_CARD_TYPE_SDHC) type_str = "SDHC/SDXC";
     
     uint64_t card_size = (this->sd_.card()->sectorCount() * 512ULL) / (1024ULL * 1024ULL);
-    ESP_LOGI(TAG, "SD Card: %s, Size: %llu MB", type_str, card_size);
+    ESP_LOGI(TAG, "SD Card: %s, Size: %" PRIu64 " MB", type_str, card_size);
   }
 
   return true;
@@ -105,281 +243,1193 @@ bool MedallionVoiceComponent::init_sd_card_() {
 
 void MedallionVoiceComponent::update_record_path_() {
   char path[32];
-  snprintf(path, sizeof(path), "/voice_%04u.wav", this->record_counter_++);
+  uint16_t segment = this->segment_duration_ms_ > 0 ? ++this->segment_index_ : 0;
+  RecordingCatalog::format_name(this->session_, segment, path, sizeof(path), this->flac_ ? ".flac" : ".wav");
   this->current_file_ = path;
 }
 
+bool MedallionVoiceComponent::open_record_file_() {
+  this->update_record_path_();
+
+  bool in_slot = this->slot_store_.is_enabled();
+  this->record_path_ = this->current_file_;
+  if (in_slot) {
+    std::string evicted;
+    if (!this->slot_store_.acquire(this->current_file_.c_str(), this->record_path_, evicted)) {
+      ESP_LOGE(TAG, "No storage slot for %s: all hold recordings not uploaded yet", this->current_file_.c_str());
+      this->fail_(RecorderError::STORAGE_FULL);
+      return false;
+    }
+    if (!evicted.empty()) this->evict_recording_(evicted);
+  }
+
+  const char *filename = this->record_path_.c_str();
+  if (filename[0] == '/') filename++;  // Strip leading slash
+
+  {
+    SdLock lock(this->sd_mutex_);
+    if (in_slot) {
+      // Overwrite in place; the slot keeps its clusters and its size
+      this->record_file_ = this->sd_.open(filename, O_RDWR);
+    } else {
+      // Remove existing file if present
+      if (this->sd_.exists(filename)) {
+        this->sd_.remove(filename);
+      }
+      this->record_file_ = this->sd_.open(filename, O_WRONLY | O_CREAT | O_TRUNC);
+    }
+    if (!this->record_file_) {
+      ESP_LOGE(TAG, "Failed to open file for recording: %s", this->record_path_.c_str());
+      this->fail_(RecorderError::FILE_ERROR);
+      return false;
+    }
+
+    if (this->flac_) {
+      // Seek point at zero: a reset before the first checkpoint leaves an
+      // empty but valid file
+      uint8_t header[FLAC_HEADER_SIZE];
+      FlacStreamInfo info{};
+      info.has_checkpoint = true;
+      build_flac_header(header, this->record_format_, info);
+      this->record_file_.write(header, FLAC_HEADER_SIZE);
+    } else {
+      // Write placeholder WAV header (44 bytes)
+      uint8_t header[WAV_HEADER_SIZE] = {0};
+      this->record_file_.write(header, WAV_HEADER_SIZE);
+    }
+  }
+  this->file_bytes_ = 0;
+  this->encoded_bytes_ = 0;
+  if (this->flac_) this->encoder_.begin(this->record_format_);
+  this->last_checkpoint_ms_ = millis();
+  this->content_hash_.begin();
+
+  time_t now = ::time(nullptr);
+  this->record_started_at_ = now > CLOCK_VALID_AFTER ? now : 0;
+  this->catalog_.append(this->make_catalog_record_(this->current_file_, RecordingState::RECORDING, 0));
+  return true;
+}
+
+void MedallionVoiceComponent::close_record_file_() {
+  // The last frame is a partial block
+  if (this->flac_ && this->encoder_.has_samples()) this->write_flac_frame_();
+  this->update_capture_stats_();
+  this->content_hash_.finish(this->content_digest_);
+
+  // Update the header with the actual data length
+  {
+    SdLock lock(this->sd_mutex_);
+    if (this->record_file_) {
+      if (this->flac_) {
+        // Drop what a short write left past the last whole frame
+        this->record_file_.truncate(FLAC_HEADER_SIZE + this->encoded_bytes_);
+        this->write_flac_header_(false);
+      } else {
+        this->write_wav_header_(this->record_file_, this->file_bytes_);
+      }
+      this->record_file_.flush();
+      this->record_file_.close();
+    }
+  }
+  this->write_stats_sidecar_();
+  this->catalog_.append(this->make_catalog_record_(this->current_file_, RecordingState::SAVED, this->file_bytes_));
+  this->slot_store_.set_state(this->current_file_.c_str(), RecordingState::SAVED);
+}
+
+std::string MedallionVoiceComponent::storage_path_(const std::string &recording) {
+  std::string path;
+  if (this->slot_store_.find(recording.c_str(), path)) return path;
+  return recording;
+}
+
+// A slot file is longer than the recording in it; the header has the length
+static uint32_t wav_file_length(FsFile &file) {
+  uint32_t size = file.size();
+  uint8_t header[WAV_HEADER_SIZE];
+  uint32_t data_length;
+  file.seekSet(0);
+  if (file.read(header, WAV_HEADER_SIZE) == (int) WAV_HEADER_SIZE && parse_wav_data_length(header, &data_length) &&
+      WAV_HEADER_SIZE + data_length < size) {
+    return WAV_HEADER_SIZE + data_length;
+  }
+  return size;
+}
+
+bool MedallionVoiceComponent::read_catalog(CatalogList &out) {
+  return this->sd_mounted_ && this->catalog_.read_all(out);
+}
+
+bool MedallionVoiceComponent::open_recording(const std::string &recording, FsFile &file, uint32_t *length) {
+  if (!this->sd_mounted_) return false;
+  std::string path = this->storage_path_(recording);
+  SdLock lock(this->sd_mutex_);
+  file = this->sd_.open(path.c_str() + (path[0] == '/' ? 1 : 0), O_RDONLY);
+  if (!file) return false;
+  *length = wav_file_length(file);
+  return true;
+}
+
+CatalogRecord MedallionVoiceComponent::make_catalog_record_(const std::string &file, RecordingState state,
+                                                            uint32_t data_bytes) {
+  CatalogRecord record{};
+  snprintf(record.name, sizeof(record.name), "%s", file.c_str());
+  RecordingCatalog::parse_name(file.c_str(), &record.session, &record.segment);
+  record.data_bytes = data_bytes;
+  record.duration_ms = (uint64_t) data_bytes * 1000 / this->record_format_.byte_rate();
+  record.timestamp = this->record_started_at_;
+  record.sample_rate = this->record_format_.sample_rate;
+  record.channels = this->record_format_.channels;
+  record.bits_per_sample = this->record_format_.bits_per_sample;
+  record.state = static_cast<uint8_t>(state);
+  return record;
+}
+
+void MedallionVoiceComponent::checkpoint_record_file_() {
+  // Make what is written so far a playable file: real sizes in the header,
+  // data and directory entry on the card. A reset then loses at most one
+  // interval of audio.
+  perf_stats::TraceScope trace("medallion_voice.checkpoint");
+  uint32_t start = micros();
+  {
+    SdLock lock(this->sd_mutex_);
+    if (this->flac_) {
+      this->write_flac_header_(true);
+      this->record_file_.seekSet(FLAC_HEADER_SIZE + this->encoded_bytes_);
+    } else {
+      this->write_wav_header_(this->record_file_, this->file_bytes_);
+      this->record_file_.seekEnd();
+    }
+    this->record_file_.sync();
+  }
+  uint32_t elapsed = micros() - start;
+  this->checkpoint_time_.record(elapsed);
+
+  CaptureStats &stats = this->capture_stats_;
+  stats.checkpoint_latency.record(elapsed);
+  stats.checkpoints++;
+  uint32_t now = millis();
+  uint32_t unsynced = now - this->last_checkpoint_ms_;
+  if (unsynced > stats.max_unsynced_ms) stats.max_unsynced_ms = unsynced;
+  this->last_checkpoint_ms_ = now;
+}
+
+void MedallionVoiceComponent::load_catalog_() {
+  if (!this->catalog_.load()) {
+    // No catalog yet: index what is already on the card, once
+    this->rebuild_catalog_();
+    return;
+  }
+  if (this->catalog_.get_next_session() > this->record_counter_) {
+    this->record_counter_ = this->catalog_.get_next_session();
+  }
+
+  // Only the recording that was open at reset can need repair
+  const CatalogRecord *unfinished = this->catalog_.get_unfinished();
+  if (unfinished == nullptr) return;
+  CatalogRecord record = *unfinished;
+  std::string path;
+  bool in_slot = this->slot_store_.find(record.name, path);
+  if (!in_slot) path = record.name;
+  FsFile file = this->sd_.open(path.c_str() + (path[0] == '/' ? 1 : 0), O_RDWR);
+  if (!file) {
+    ESP_LOGW(TAG, "Unfinished recording %s is missing", record.name);
+    return;
+  }
+  uint32_t data_length = 0;
+  this->repair_recording_(file, record.name, &data_length, in_slot);
+  file.close();
+
+  this->record_started_at_ = record.timestamp;
+  this->catalog_.append(this->make_catalog_record_(record.name, RecordingState::SAVED, data_length));
+  this->slot_store_.set_state(record.name, RecordingState::SAVED);
+}
+
+void MedallionVoiceComponent::rebuild_catalog_() {
+  FsFile root = this->sd_.open("/", O_RDONLY);
+  if (!root) return;
+
+  uint32_t start = millis();
+  unsigned repaired = 0;
+  CatalogList records;
+  FsFile entry;
+  while (entry.openNext(&root, O_RDWR)) {
+    char name[32];
+    name[0] = '/';
+    entry.getName(name + 1, sizeof(name) - 1);
+    size_t len = strlen(name);
+    uint16_t session, segment;
+    if (!entry.isDir() && RecordingCatalog::parse_name(name, &session, &segment) &&
+        ((len > 4 && strcmp(name + len - 4, ".wav") == 0) || RecordingCatalog::is_flac_name(name))) {
+      uint32_t data_length = 0;
+      if (this->repair_recording_(entry, name, &data_length, false)) repaired++;
+      // Whether it was uploaded is not known
+      this->record_started_at_ = 0;
+      records.push_back(this->make_catalog_record_(name, RecordingState::SAVED, data_length));
+      // Continue numbering after the recordings already on the card
+      if (session >= this->record_counter_ && session < UINT16_MAX) this->record_counter_ = session + 1;
+    }
+    entry.close();
+  }
+  root.close();
+
+  this->catalog_.rebuild(records);
+  ESP_LOGI(TAG, "Indexed %u recordings in %u ms, repaired %u", (unsigned) records.size(),
+           (unsigned) (millis() - start), repaired);
+}
+
+bool MedallionVoiceComponent::repair_recording_(FsFile &file, const char *name, uint32_t *data_bytes,
+                                                 bool fixed_size) {
+  if (RecordingCatalog::is_flac_name(name)) return this->repair_flac_recording_(file, name, data_bytes);
+  uint64_t size = file.size();
+  if (size < WAV_HEADER_SIZE) {
+    ESP_LOGW(TAG, "%s is too short to repair (%u bytes)", name, (unsigned) size);
+    return false;
+  }
+  if (fixed_size) {
+    // A slot is always full size, so only the last checkpoint tells how much
+    // of it is this recording
+    uint8_t header[WAV_HEADER_SIZE];
+    uint32_t stored = 0;
+    bool valid = file.read(header, WAV_HEADER_SIZE) == (int) WAV_HEADER_SIZE && parse_wav_data_length(header, &stored);
+    *data_bytes = valid && WAV_HEADER_SIZE + stored <= size ? stored : 0;
+    if (valid && *data_bytes == stored) return false;
+    this->write_wav_header_(file, *data_bytes);
+    file.sync();
+    ESP_LOGW(TAG, "Recovered unfinished recording %s from its slot: %u bytes of audio up to the last checkpoint", name,
+             (unsigned) *data_bytes);
+    return true;
+  }
+
+  // A finalized or checkpointed file matches its size exactly; after a reset
+  // the card may hold data past the last checkpoint, or only the placeholder
+  uint32_t data_length = wav_data_length_for_size(this->record_format_, size);
+  *data_bytes = data_length;
+  uint8_t header[WAV_HEADER_SIZE];
+  uint32_t stored = 0;
+  bool valid = file.read(header, WAV_HEADER_SIZE) == (int) WAV_HEADER_SIZE && parse_wav_data_length(header, &stored);
+  if (valid && stored == data_length && size == WAV_HEADER_SIZE + data_length) return false;
+
+  // Drop a trailing partial frame, then write the real sizes
+  file.truncate(WAV_HEADER_SIZE + data_length);
+  this->write_wav_header_(file, data_length);
+  file.sync();
+  ESP_LOGW(TAG, "Recovered unfinished recording %s: %u bytes of audio (header had %s%u)", name,
+           (unsigned) data_length, valid ? "" : "none, placeholder ", (unsigned) stored);
+  return true;
+}
+
+bool MedallionVoiceComponent::repair_flac_recording_(FsFile &file, const char *name, uint32_t *data_bytes) {
+  uint64_t size = file.size();
+  uint8_t header[FLAC_HEADER_SIZE];
+  FlacStreamInfo info;
+  *data_bytes = 0;
+  if (size < FLAC_HEADER_SIZE || file.read(header, FLAC_HEADER_SIZE) != (int) FLAC_HEADER_SIZE ||
+      !parse_flac_header(header, &info)) {
+    ESP_LOGW(TAG, "%s has no FLAC header, cannot repair", name);
+    return false;
+  }
+  // Finalized files have no seek point
+  if (!info.has_checkpoint) {
+    *data_bytes = info.total_samples * this->record_format_.block_align();
+    return false;
+  }
+
+  // Frames written after the last checkpoint may be cut off anywhere, and
+  // FLAC has no way to find the end of the last whole one short of decoding:
+  // go back to the checkpoint
+  uint64_t length = FLAC_HEADER_SIZE + info.checkpoint_offset;
+  if (length > size) {
+    ESP_LOGW(TAG, "%s is shorter than its last checkpoint, cannot repair", name);
+    return false;
+  }
+  file.truncate(length);
+  info.total_samples = info.checkpoint_samples;
+  info.has_checkpoint = false;
+  build_flac_header(header, this->record_format_, info);
+  file.seek(0);
+  file.write(header, FLAC_HEADER_SIZE);
+  file.sync();
+  *data_bytes = info.total_samples * this->record_format_.block_align();
+  ESP_LOGW(TAG, "Recovered unfinished recording %s: %u bytes of audio up to the last checkpoint, dropped %u bytes",
+           name, (unsigned) *data_bytes, (unsigned) (size - length));
+  return true;
+}
+
+void MedallionVoiceComponent::capture_block_() {
+  // The pool is sized to never run dry; if it does, the overrun is counted
+  // and the audio stays in the I2S DMA buffers until the next loop
+  AudioBlock *block = this->audio_bus_.acquire();
+  if (block == nullptr) return;
+  if (this->audio_codec_->get_bits_per_sample() == 16) {
+    block->length = this->audio_codec_->read_samples(block->data, this->audio_bus_.get_block_size());
+  } else {
+    block->length = this->read_wide_block_(block->data, this->audio_bus_.get_block_size());
+  }
+  if (block->length == 0) {
+    this->audio_bus_.discard(block);
+    return;
+  }
+  // Time from the start (or the touch that started it) to audio
+  if (this->capture_stats_.captured_bytes == 0) perf_stats::trace_instant("medallion_voice.first_audio", block->length);
+  this->capture_stats_.captured_bytes += block->length;
+  if (this->frontend_.is_enabled()) this->condition_block_(block);
+  this->audio_bus_.publish(block);
+}
+
+size_t MedallionVoiceComponent::read_wide_block_(uint8_t *out, size_t size) {
+  if (this->wide_buffer_ == nullptr) return 0;
+  // 32-bit slots carry the sample left-justified: the top half is the
+  // 16-bit sample
+  size_t length = this->audio_codec_->read_samples(this->wide_buffer_, std::min(size * 2, AUDIO_BLOCK_SIZE * 2));
+  const int32_t *wide = reinterpret_cast<const int32_t *>(this->wide_buffer_);
+  int16_t *samples = reinterpret_cast<int16_t *>(out);
+  size_t count = length / sizeof(int32_t);
+  for (size_t i = 0; i < count; i++) samples[i] = (int16_t) (wide[i] >> 16);
+  return count * sizeof(int16_t);
+}
+
+void MedallionVoiceComponent::condition_block_(AudioBlock *block) {
+  perf_stats::ScopedTimer frontend_timer(this->frontend_time_);
+  uint32_t start = esp_cpu_get_cycle_count();
+  this->frontend_.process(reinterpret_cast<int16_t *>(block->data), block->length / this->capture_format_.block_align());
+  this->capture_stats_.frontend_cycles.record(esp_cpu_get_cycle_count() - start);
+
+  // Coarse steps of the analog gain; at either end of its range the request
+  // stands and is refused here without touching the bus
+  int8_t step = this->frontend_.get_pga_request();
+  if (step != 0 && this->audio_codec_->set_adc_gain(this->audio_codec_->get_mic_gain() + step)) {
+    this->frontend_.pga_changed(step);
+    DEFERRED_LOGD(TAG, "Mic gain %s to %u (x6 dB)", step > 0 ? "raised" : "lowered",
+                  (unsigned) this->audio_codec_->get_mic_gain());
+  }
+}
+
+void MedallionVoiceComponent::write_block_(const AudioBlock *block) {
+  const uint8_t *data = block->data;
+  size_t length = block->length;
+  if (this->resampling_) {
+    perf_stats::ScopedTimer resample_timer(this->resample_time_);
+    size_t frames = this->resampler_.process(reinterpret_cast<const int16_t *>(block->data),
+                                             length / this->capture_format_.block_align(),
+                                             reinterpret_cast<int16_t *>(this->resample_buffer_));
+    data = this->resample_buffer_;
+    length = frames * this->record_format_.block_align();
+  }
+  // A slot file never grows; audio past its end is dropped
+  if (this->file_limit_bytes_ > 0 && length > this->file_limit_bytes_ - this->file_bytes_) {
+    length = this->file_limit_bytes_ - this->file_bytes_;
+  }
+  if (length == 0) return;
+  if (this->flac_) {
+    this->encode_block_(data, length);
+    return;
+  }
+
+  // Includes waiting for the upload task to release the card
+  uint32_t start = micros();
+  size_t written;
+  {
+    SdLock lock(this->sd_mutex_);
+    written = this->record_file_.write(data, length);
+  }
+  uint32_t elapsed = micros() - start;
+  this->sd_write_time_.record(elapsed);
+  this->capture_stats_.sd_write_latency.record(elapsed);
+
+  if (written < length) {
+    this->capture_stats_.short_writes++;
+    DEFERRED_LOGW(TAG, "Short SD write: %u of %u bytes", (unsigned) written, (unsigned) length);
+  }
+  if (written > 0) {
+    this->recorded_bytes_ += written;
+    this->file_bytes_ += written;
+    // Hash exactly what reached the file
+    perf_stats::ScopedTimer hash_timer(this->hash_time_);
+    this->content_hash_.update(data, written);
+  }
+}
+
+void MedallionVoiceComponent::encode_block_(const uint8_t *data, size_t length) {
+  // Capture blocks and frames do not line up; a frame goes out whenever one
+  // fills, so file_bytes_ trails the audio taken by up to a frame
+  while (length > 0) {
+    size_t taken = this->encoder_.add(data, length);
+    data += taken;
+    length -= taken;
+    if (this->encoder_.is_frame_ready()) {
+      this->write_flac_frame_();
+    } else if (taken == 0) {
+      break;  // a partial sample frame, which capture never delivers
+    }
+  }
+}
+
+void MedallionVoiceComponent::write_flac_frame_() {
+  size_t size;
+  {
+    perf_stats::ScopedTimer encode_timer(this->encode_time_);
+    size = this->encoder_.encode_frame();
+  }
+  if (size == 0) return;
+  uint32_t pcm_bytes = this->encoder_.get_frame_samples() * this->record_format_.block_align();
+
+  // Includes waiting for the upload task to release the card
+  uint32_t start = micros();
+  size_t written;
+  {
+    SdLock lock(this->sd_mutex_);
+    written = this->record_file_.write(this->encoder_.get_frame(), size);
+    // Part of a frame would break the stream: the next frame overwrites it
+    if (written < size) this->record_file_.seekSet(FLAC_HEADER_SIZE + this->encoded_bytes_);
+  }
+  uint32_t elapsed = micros() - start;
+  this->sd_write_time_.record(elapsed);
+  this->capture_stats_.sd_write_latency.record(elapsed);
+
+  if (written < size) {
+    this->capture_stats_.short_writes++;
+    DEFERRED_LOGW(TAG, "Short SD write: %u of %u bytes, frame of %u samples dropped", (unsigned) written,
+                  (unsigned) size, (unsigned) this->encoder_.get_frame_samples());
+    return;
+  }
+  this->recorded_bytes_ += pcm_bytes;
+  this->file_bytes_ += pcm_bytes;
+  this->encoded_bytes_ += size;
+  perf_stats::ScopedTimer hash_timer(this->hash_time_);
+  this->content_hash_.update(this->encoder_.get_frame(), size);
+}
+
+void MedallionVoiceComponent::write_queued_blocks_() {
+  AudioBlock *block;
+  while (this->is_recording() && (block = this->sd_consumer_->receive(0)) != nullptr) {
+    this->write_block_(block);
+    this->sd_consumer_->release(block);
+
+    if (this->segment_bytes_ > 0 && this->file_bytes_ >= this->segment_bytes_) {
+      this->roll_segment_();
+    } else if (this->file_limit_bytes_ > 0 && this->file_bytes_ >= this->file_limit_bytes_) {
+      DEFERRED_LOGW(TAG, "Storage slot full, stopping recording");
+      this->stop_recording();
+      this->fail_(RecorderError::SLOT_FULL);
+    }
+  }
+}
+
+void MedallionVoiceComponent::roll_segment_() {
+  std::string finished = this->current_file_;
+  this->close_record_file_();
+  ESP_LOGI(TAG, "Segment complete: %s (%u bytes)", finished.c_str(), (unsigned) this->file_bytes_);
+  perf_stats::trace_instant("medallion_voice.segment", this->segment_index_);
+  this->queue_upload_(finished);
+
+  // A failed open has already ended the recording in the error state
+  if (!this->open_record_file_()) {
+    this->audio_codec_->stop_recording();
+    this->streamer_.end();
+    this->publish_stream_state_();
+    this->sd_consumer_->set_active(false);
+    this->sd_consumer_->flush();
+    return;
+  }
+  ESP_LOGD(TAG, "Recording segment %s", this->current_file_.c_str());
+}
+
 bool MedallionVoiceComponent::start_recording() {
-  if (this->recording_) {
+  perf_stats::TraceScope trace("medallion_voice.start_recording");
+  if (this->is_recording()) {
     ESP_LOGW(TAG, "Already recording");
     return false;
   }
 
   if (!this->sd_mounted_) {
     ESP_LOGE(TAG, "Cannot record: SD card not mounted");
-    this->status_ = "SD Not Ready";
+    this->fail_(RecorderError::SD_NOT_READY);
     return false;
   }
 
   if (this->audio_codec_ == nullptr) {
     ESP_LOGE(TAG, "Cannot record: Audio codec not configured");
-    this->status_ = "No Audio";
+    this->fail_(RecorderError::NO_AUDIO);
     return false;
   }
 
-  // Generate new filename
-  this->update_record_path_();
-  
-  // Remove existing file if present
-  const char *filename = this->current_file_.c_str();
-  if (filename[0] == '/') filename++;  // Strip leading slash
-  
-  if (this->sd_.exists(filename)) {
-    this->sd_.remove(filename);
+  if (this->audio_bus_.get_pool_size() == 0) {
+    ESP_LOGE(TAG, "Cannot record: no audio buffers");
+    this->fail_(RecorderError::NO_MEMORY);
+    return false;
   }
 
-  // Open file for writing
-  this->record_file_ = this->sd_.open(filename, O_WRONLY | O_CREAT | O_TRUNC);
-  if (!this->record_file_) {
-    ESP_LOGE(TAG, "Failed to open file for recording: %s", this->current_file_.c_str());
-    this->status_ = "File Error";
-    return false;
+  // The codec's rate may have been switched since the last recording
+  if (this->audio_codec_->get_sample_rate() != this->capture_format_.sample_rate) {
+    this->setup_formats_();
+    ESP_LOGI(TAG, "Capture rate now %u Hz, recording at %u Hz", (unsigned) this->capture_format_.sample_rate,
+             (unsigned) this->record_format_.sample_rate);
   }
 
-  // Write placeholder WAV header (44 bytes)
-  uint8_t header[44] = {0};
-  this->record_file_.write(header, 44);
+  // Generate new filename and open it
+  this->session_ = this->record_counter_++;
+  this->segment_index_ = 0;
+  if (!this->open_record_file_()) return false;
   this->recorded_bytes_ = 0;
+  this->resampler_.reset();
+
+  // Whole frames per segment, so every segment is a valid WAV on its own
+  this->segment_bytes_ = 0;
+  if (this->segment_duration_ms_ > 0) {
+    uint64_t bytes = (uint64_t) this->segment_duration_ms_ * this->record_format_.byte_rate() / 1000;
+    this->segment_bytes_ = bytes - bytes % this->record_format_.block_align();
+  }
+  this->file_limit_bytes_ = 0;
+  if (this->slot_store_.is_enabled()) {
+    uint32_t capacity = this->slot_store_.get_capacity();
+    this->file_limit_bytes_ = capacity - capacity % this->record_format_.block_align();
+    // Segments longer than a slot roll when the slot is full
+    if (this->segment_bytes_ > this->file_limit_bytes_) this->segment_bytes_ = this->file_limit_bytes_;
+  }
+
+  this->capture_stats_.start_ms = millis();
+  this->capture_stats_.duration_ms = 0;
+  this->capture_stats_.expected_bytes = 0;
+  this->capture_stats_.captured_bytes = 0;
+  this->capture_stats_.written_bytes = 0;
+  this->capture_stats_.short_writes = 0;
+  this->capture_stats_.i2s_overflows = 0;
+  this->capture_stats_.i2s_read_errors = 0;
+  this->capture_stats_.sd_write_latency.reset();
+  this->capture_stats_.checkpoints = 0;
+  this->capture_stats_.max_unsynced_ms = 0;
+  this->capture_stats_.checkpoint_latency.reset();
+  this->capture_stats_.frontend_cycles.reset();
+  this->frontend_.reset();
+  this->last_stats_publish_ = this->capture_stats_.start_ms;
 
   // Start audio capture
   if (!this->audio_codec_->start_recording()) {
     ESP_LOGE(TAG, "Failed to start audio codec");
-    this->record_file_.close();
-    this->status_ = "Codec Error";
+    {
+      SdLock lock(this->sd_mutex_);
+      this->record_file_.close();
+    }
+    this->fail_(RecorderError::CODEC_ERROR);
     return false;
   }
 
-  this->recording_ = true;
-  this->status_ = "Recording";
+  this->sd_consumer_->reset_stats();
+  this->sd_consumer_->set_active(true);
+  // The recording goes on without its live copy
+  if (!this->streamer_.get_host().empty() && !this->streamer_.begin(this->capture_format_.sample_rate)) {
+    ESP_LOGW(TAG, "Live stream unavailable for this recording");
+  }
+  this->publish_stream_state_();
+  this->set_state_(RecorderState::RECORDING);
+  perf_stats::trace_async_begin("medallion_voice.recording", this->session_);
   ESP_LOGI(TAG, "Recording started: %s", this->current_file_.c_str());
   return true;
 }
 
 void MedallionVoiceComponent::stop_recording() {
-  if (!this->recording_) return;
+  if (!this->is_recording()) return;
+  perf_stats::TraceScope trace("medallion_voice.stop_recording");
 
   // Stop audio capture
   if (this->audio_codec_ != nullptr) {
     this->audio_codec_->stop_recording();
   }
+  this->streamer_.end();
+  this->publish_stream_state_();
+  this->sd_consumer_->set_active(false);
+  // Audio captured but not yet written still belongs to this file
+  AudioBlock *block;
+  while ((block = this->sd_consumer_->receive(0)) != nullptr) {
+    this->write_block_(block);
+    this->sd_consumer_->release(block);
+  }
+  this->close_record_file_();
+
+  this->set_state_(RecorderState::SAVED);
+  perf_stats::trace_async_end("medallion_voice.recording", this->session_);
+  ESP_LOGI(TAG, "Recording stopped: %s (%lu bytes, sha256 %s)", 
+           this->current_file_.c_str(), (unsigned long)this->recorded_bytes_, this->content_digest_);
 
-  // Update WAV header with actual data length
-  if (this->record_file_) {
-    this->write_wav_header_(this->record_file_, this->recorded_bytes_);
-    this->record_file_.flush();
-    this->record_file_.close();
+  const CaptureStats &stats = this->capture_stats_;
+  ESP_LOGI(TAG, "Capture stats: expected %" PRIu64 ", captured %" PRIu64 ", written %" PRIu64 " bytes; "
+           "%u overflows, %u read errors, %u short writes; SD write p99 %u us, max %u us",
+           stats.expected_bytes, stats.captured_bytes, stats.written_bytes, (unsigned) stats.i2s_overflows,
+           (unsigned) stats.i2s_read_errors, (unsigned) stats.short_writes,
+           (unsigned) stats.sd_write_latency.get_percentile(99), (unsigned) stats.sd_write_latency.get_max());
+  ESP_LOGI(TAG, "Checkpoints: %u, max unsynced %u ms, checkpoint avg %u us, max %u us",
+           (unsigned) stats.checkpoints, (unsigned) stats.max_unsynced_ms,
+           (unsigned) stats.checkpoint_latency.get_avg(), (unsigned) stats.checkpoint_latency.get_max());
+  if (stats.frontend_cycles.get_count() > 0) {
+    // Cycles spent against the cycles that passed while the audio was captured
+    uint64_t cycles = (uint64_t) stats.frontend_cycles.get_avg() * stats.frontend_cycles.get_count();
+    uint64_t audio_us = stats.captured_bytes * 1000000 / this->capture_format_.byte_rate();
+    float load = audio_us > 0 ? 100.0f * cycles / ((float) audio_us * getCpuFrequencyMhz()) : 0.0f;
+    ESP_LOGI(TAG, "Front end: avg %u, p99 %u, max %u cycles per block, %.2f%% of a core; gain %.1f dB, mic gain %u",
+             (unsigned) stats.frontend_cycles.get_avg(), (unsigned) stats.frontend_cycles.get_percentile(99),
+             (unsigned) stats.frontend_cycles.get_max(), load, this->frontend_.get_gain_db(),
+             (unsigned) this->audio_codec_->get_mic_gain());
+  }
+  this->publish_capture_stats_();
+  for (const AudioConsumer *consumer : this->audio_bus_.get_consumers()) {
+    ESP_LOGI(TAG, "Audio bus %s: %u blocks delivered, %u dropped, max lag %u", consumer->get_name(),
+             (unsigned) consumer->get_delivered(), (unsigned) consumer->get_dropped(),
+             (unsigned) consumer->get_max_lag());
+  }
+  if (this->audio_bus_.get_overruns() > 0) {
+    ESP_LOGW(TAG, "Audio bus ran out of blocks %u times", (unsigned) this->audio_bus_.get_overruns());
+  }
+  if (this->streamer_.is_enabled()) {
+    ESP_LOGI(TAG, "Live stream: %u packets sent, %u send errors", (unsigned) this->streamer_.get_sent(),
+             (unsigned) this->streamer_.get_send_errors());
   }
 
-  this->recording_ = false;
-  this->status_ = "Saved";
-  ESP_LOGI(TAG, "Recording stopped: %s (%lu bytes)", 
-           this->current_file_.c_str(), (unsigned long)this->recorded_bytes_);
+  // Earlier segments are already queued; the last one follows
+  if (this->segment_duration_ms_ > 0) {
+    this->queue_upload_(this->current_file_);
+  }
 }
 
-void MedallionVoiceComponent::write_wav_header_(FsFile &file, uint32_t data_length) {
-  const uint32_t byte_rate = WAV_SAMPLE_RATE * WAV_NUM_CHANNELS * (WAV_BITS_PER_SAMPLE / 8);
-  const uint16_t block_align = WAV_NUM_CHANNELS * (WAV_BITS_PER_SAMPLE / 8);
-  const uint32_t chunk_size = 36 + data_length;
+bool MedallionVoiceComponent::set_state_(RecorderState state, RecorderError error) {
+  RecorderState previous = this->state_;
+  if (state != RecorderState::ERROR) error = RecorderError::NONE;
+  if (state == previous && error == this->error_) return true;
+  if (state != previous && !is_valid_transition(previous, state)) {
+    ESP_LOGW(TAG, "Ignoring state change %s -> %s", this->get_status(), recorder_status_text(state, error));
+    return false;
+  }
+  this->state_ = state;
+  this->error_ = error;
+  ESP_LOGD(TAG, "State: %s", this->get_status());
+  perf_stats::trace_instant("medallion_voice.state", static_cast<uint32_t>(state));
 
-  file.seek(0);
-  
-  // RIFF header
-  file.write((const uint8_t *)"RIFF", 4);
-  file.write((uint8_t *)&chunk_size, 4);
-  file.write((const uint8_t *)"WAVE", 4);
-  
-  // fmt subchunk
-  file.write((const uint8_t *)"fmt ", 4);
-  uint32_t subchunk1_size = 16;
-  uint16_t audio_format = 1;  // PCM
-  uint32_t sample_rate = WAV_SAMPLE_RATE;
-  file.write((uint8_t *)&subchunk1_size, 4);
-  file.write((uint8_t *)&audio_format, 2);
-  file.write((uint8_t *)&WAV_NUM_CHANNELS, 2);
-  file.write((uint8_t *)&sample_rate, 4);
-  file.write((uint8_t *)&byte_rate, 4);
-  file.write((uint8_t *)&block_align, 2);
-  file.write((uint8_t *)&WAV_BITS_PER_SAMPLE, 2);
-  
-  // data subchunk
-  file.write((const uint8_t *)"data", 4);
-  file.write((uint8_t *)&data_length, 4);
+  if (this->status_text_sensor_ != nullptr) this->status_text_sensor_->publish_state(this->get_status());
+  bool recording = state == RecorderState::RECORDING;
+  if (this->recording_binary_sensor_ != nullptr && recording != (previous == RecorderState::RECORDING))
+    this->recording_binary_sensor_->publish_state(recording);
+  this->state_callbacks_.call(state, previous);
+  // The catalog or the storage slots may have changed with the state
+  this->enable_loop();
+  return true;
 }
 
-bool MedallionVoiceComponent::parse_url_(const std::string &url, std::string &host, uint16_t &port, std::string &path) {
-  // Parse URL like "http://192.168.1.119:8000/upload"
-  if (url.substr(0, 7) != "http://") {
-    ESP_LOGE(TAG, "Only http:// URLs are supported");
-    return false;
+void MedallionVoiceComponent::update_capture_stats_() {
+  CaptureStats &stats = this->capture_stats_;
+  stats.duration_ms = millis() - stats.start_ms;
+  stats.written_bytes = this->recorded_bytes_;
+  if (this->audio_codec_ != nullptr) {
+    stats.expected_bytes = (uint64_t) stats.duration_ms * this->record_format_.byte_rate() / 1000;
+    stats.i2s_overflows = this->audio_codec_->get_overflow_count();
+    stats.i2s_read_errors = this->audio_codec_->get_read_error_count();
   }
+}
 
-  std::string rest = url.substr(7);
-  size_t path_start = rest.find('/');
-  if (path_start == std::string::npos) {
-    ESP_LOGE(TAG, "Invalid URL: no path");
-    return false;
+void MedallionVoiceComponent::publish_capture_stats_() {
+  const CaptureStats &stats = this->capture_stats_;
+  if (this->dropped_bytes_sensor_ != nullptr)
+    this->dropped_bytes_sensor_->publish_state(stats.get_dropped_bytes());
+  if (this->i2s_overflows_sensor_ != nullptr)
+    this->i2s_overflows_sensor_->publish_state(stats.i2s_overflows);
+  if (this->short_writes_sensor_ != nullptr)
+    this->short_writes_sensor_->publish_state(stats.short_writes);
+  if (this->sd_write_latency_p99_sensor_ != nullptr)
+    this->sd_write_latency_p99_sensor_->publish_state(stats.sd_write_latency.get_percentile(99));
+  if (this->sd_write_latency_max_sensor_ != nullptr)
+    this->sd_write_latency_max_sensor_->publish_state(stats.sd_write_latency.get_max());
+  if (this->agc_gain_sensor_ != nullptr && this->frontend_.is_agc_enabled())
+    this->agc_gain_sensor_->publish_state(this->frontend_.get_gain_db());
+  if (this->frontend_cycles_p99_sensor_ != nullptr && stats.frontend_cycles.get_count() > 0)
+    this->frontend_cycles_p99_sensor_->publish_state(stats.frontend_cycles.get_percentile(99));
+}
+
+void MedallionVoiceComponent::publish_stream_state_() {
+  // Falls when the stream cannot start or cannot follow a new capture rate
+  bool streaming = this->streamer_.is_streaming();
+  if (streaming == this->last_streaming_) return;
+  this->last_streaming_ = streaming;
+  if (this->streaming_binary_sensor_ != nullptr)
+    this->streaming_binary_sensor_->publish_state(streaming);
+}
+
+void MedallionVoiceComponent::publish_storage_stats_() {
+  if (!this->slot_store_.is_enabled()) return;
+  // Only changes when a recording starts, finishes or is uploaded
+  uint64_t free_bytes = this->slot_store_.get_free_bytes();
+  uint32_t evictions = this->slot_store_.get_evictions();
+  if (free_bytes == this->last_storage_free_ && evictions == this->last_evictions_) return;
+  this->last_storage_free_ = free_bytes;
+  this->last_evictions_ = evictions;
+  if (this->storage_free_sensor_ != nullptr)
+    this->storage_free_sensor_->publish_state(free_bytes);
+  if (this->evictions_sensor_ != nullptr)
+    this->evictions_sensor_->publish_state(evictions);
+}
+
+// voice_0001.wav -> voice_0001.json
+static std::string manifest_path(const std::string &recording) {
+  std::string path = recording;
+  size_t dot = path.rfind('.');
+  if (dot != std::string::npos) path.resize(dot);
+  path += ".json";
+  return path;
+}
+
+void MedallionVoiceComponent::write_stats_sidecar_() {
+  std::string path = manifest_path(this->current_file_);
+  const char *filename = path.c_str();
+  if (filename[0] == '/') filename++;
+
+  SdLock lock(this->sd_mutex_);
+  FsFile file = this->sd_.open(filename, O_WRONLY | O_CREAT | O_TRUNC);
+  if (!file) {
+    ESP_LOGW(TAG, "Failed to write capture stats: %s", path.c_str());
+    return;
   }
 
-  std::string host_port = rest.substr(0, path_start);
-  path = rest.substr(path_start);
+  const CaptureStats &stats = this->capture_stats_;
+  char buf[512];
+  int len = snprintf(buf, sizeof(buf),
+                     "{\"sha256\":\"%s\",\"duration_ms\":%u,\"expected_bytes\":%" PRIu64 ",\"captured_bytes\":%" PRIu64
+                     ",\"written_bytes\":%" PRIu64 ",\"dropped_bytes\":%" PRIu64 ",\"i2s_overflows\":%u,"
+                     "\"i2s_read_errors\":%u,\"short_writes\":%u,\"sd_write_us\":"
+                     "{\"min\":%u,\"avg\":%u,\"p99\":%u,\"max\":%u},\"checkpoints\":%u,"
+                     "\"max_unsynced_ms\":%u,\"checkpoint_us\":{\"avg\":%u,\"max\":%u}}\n",
+                     this->content_digest_, (unsigned) stats.duration_ms, stats.expected_bytes, stats.captured_bytes, stats.written_bytes,
+                     stats.get_dropped_bytes(), (unsigned) stats.i2s_overflows, (unsigned) stats.i2s_read_errors,
+                     (unsigned) stats.short_writes, (unsigned) stats.sd_write_latency.get_min(),
+                     (unsigned) stats.sd_write_latency.get_avg(), (unsigned) stats.sd_write_latency.get_percentile(99),
+                     (unsigned) stats.sd_write_latency.get_max(), (unsigned) stats.checkpoints,
+                     (unsigned) stats.max_unsynced_ms, (unsigned) stats.checkpoint_latency.get_avg(),
+                     (unsigned) stats.checkpoint_latency.get_max());
+  file.write((const uint8_t *) buf, len);
+  file.close();
+}
 
-  size_t colon = host_port.find(':');
-  if (colon != std::string::npos) {
-    host = host_port.substr(0, colon);
-    port = std::stoi(host_port.substr(colon + 1));
-  } else {
-    host = host_port;
-    port = 80;
+bool MedallionVoiceComponent::read_manifest_hash_(const std::string &recording, char *hex) {
+  std::string path = manifest_path(recording);
+  const char *filename = path.c_str();
+  if (filename[0] == '/') filename++;
+
+  char buf[160];
+  int len;
+  {
+    SdLock lock(this->sd_mutex_);
+    FsFile file = this->sd_.open(filename, O_RDONLY);
+    if (!file) return false;
+    len = file.read(buf, sizeof(buf) - 1);
+    file.close();
   }
+  if (len <= 0) return false;
+  buf[len] = '\0';
+
+  // The digest is the first manifest field
+  static const char KEY[] = "\"sha256\":\"";
+  const char *start = strstr(buf, KEY);
+  if (start == nullptr) return false;
+  start += sizeof(KEY) - 1;
+  if (strlen(start) < CONTENT_HASH_HEX_SIZE - 1 || start[CONTENT_HASH_HEX_SIZE - 1] != '"') return false;
+  memcpy(hex, start, CONTENT_HASH_HEX_SIZE - 1);
+  hex[CONTENT_HASH_HEX_SIZE - 1] = '\0';
+  return true;
+}
+
+void MedallionVoiceComponent::evict_recording_(const std::string &recording) {
+  ESP_LOGI(TAG, "Evicting uploaded recording %s", recording.c_str());
+  std::string manifest = manifest_path(recording);
+  {
+    SdLock lock(this->sd_mutex_);
+    this->sd_.remove(manifest.c_str() + 1);
+  }
+  this->catalog_.set_state(recording.c_str(), RecordingState::EVICTED);
+}
+
+void MedallionVoiceComponent::write_wav_header_(FsFile &file, uint32_t data_length) {
+  uint8_t header[WAV_HEADER_SIZE];
+  build_wav_header(header, this->record_format_, data_length);
+  file.seek(0);
+  file.write(header, WAV_HEADER_SIZE);
+}
 
+void MedallionVoiceComponent::write_flac_header_(bool checkpoint) {
+  FlacStreamInfo info{};
+  info.total_samples = this->file_bytes_ / this->record_format_.block_align();
+  info.min_frame_size = this->encoder_.get_min_frame_size();
+  info.max_frame_size = this->encoder_.get_max_frame_size();
+  info.has_checkpoint = checkpoint;
+  info.checkpoint_samples = info.total_samples;
+  info.checkpoint_offset = this->encoded_bytes_;
+  uint8_t header[FLAC_HEADER_SIZE];
+  build_flac_header(header, this->record_format_, info);
+  this->record_file_.seek(0);
+  this->record_file_.write(header, FLAC_HEADER_SIZE);
+}
+
+bool MedallionVoiceComponent::parse_url_(const std::string &url, HttpUrl &out) {
+  // Parse URL like "http://192.168.1.119:8000/upload"
+  const char *error = nullptr;
+  if (!parse_http_url(url, out, &error)) {
+    ESP_LOGE(TAG, "%s", error);
+    return false;
+  }
   return true;
 }
 
 bool MedallionVoiceComponent::upload_recording() {
-  if (this->recording_) {
+  perf_stats::TraceScope trace("medallion_voice.upload_recording");
+  if (this->is_recording()) {
     ESP_LOGW(TAG, "Cannot upload while recording");
-    this->status_ = "Stop First";
     return false;
   }
 
   if (!this->sd_mounted_) {
     ESP_LOGE(TAG, "Cannot upload: SD card not mounted");
-    this->status_ = "SD Not Ready";
+    this->fail_(RecorderError::SD_NOT_READY);
     return false;
   }
 
   if (this->current_file_.empty()) {
     ESP_LOGW(TAG, "No recording to upload");
-    this->status_ = "No File";
+    this->fail_(RecorderError::NO_FILE);
     return false;
   }
 
+  if (this->resumable_upload_) {
+    if (!this->queue_upload_(this->current_file_)) {
+      this->fail_(RecorderError::UPLOAD_FAIL);
+      return false;
+    }
+    this->set_state_(RecorderState::UPLOAD_QUEUED);
+    return true;
+  }
+
   // Check WiFi connection
   if (!network::is_connected()) {
     ESP_LOGE(TAG, "Cannot upload: WiFi not connected");
-    this->status_ = "No WiFi";
+    this->fail_(RecorderError::NO_WIFI);
     return false;
   }
 
   // Parse URL
-  std::string host, path;
-  uint16_t port;
-  if (!this->parse_url_(this->upload_url_, host, port, path)) {
-    this->status_ = "Bad URL";
+  HttpUrl url;
+  if (!this->parse_url_(this->upload_url_, url)) {
+    this->fail_(RecorderError::BAD_URL);
     return false;
   }
 
   // Open file for reading
-  const char *filename = this->current_file_.c_str();
+  std::string path = this->storage_path_(this->current_file_);
+  const char *filename = path.c_str();
   if (filename[0] == '/') filename++;
   
-  FsFile file = this->sd_.open(filename, O_RDONLY);
-  if (!file) {
+  // The card is only held for file access, never across a network write:
+  // the log file and background uploads share it
+  FsFile file;
+  bool opened;
+  size_t file_size = 0;
+  {
+    SdLock lock(this->sd_mutex_);
+    file = this->sd_.open(filename, O_RDONLY);
+    opened = (bool) file;
+    if (opened) file_size = wav_file_length(file);
+    if (opened && file_size <= WAV_HEADER_SIZE) file.close();
+  }
+  if (!opened) {
     ESP_LOGE(TAG, "Failed to open file for upload: %s", this->current_file_.c_str());
-    this->status_ = "File Error";
+    this->fail_(RecorderError::FILE_ERROR);
     return false;
   }
-
-  size_t file_size = file.size();
-  if (file_size <= 44) {
+  if (file_size <= WAV_HEADER_SIZE) {
     ESP_LOGW(TAG, "File too small to upload: %u bytes", (unsigned)file_size);
-    file.close();
-    this->status_ = "Empty File";
+    this->fail_(RecorderError::EMPTY_FILE);
     return false;
   }
 
-  this->status_ = "Uploading";
+  this->set_state_(RecorderState::UPLOADING);
   ESP_LOGI(TAG, "Uploading %s (%u bytes) to %s:%d%s", 
-           this->current_file_.c_str(), (unsigned)file_size, host.c_str(), port, path.c_str());
+           this->current_file_.c_str(), (unsigned)file_size, url.host.c_str(), url.port, url.path.c_str());
 
-  // Connect to server
-  WiFiClient client;
-  client.setTimeout(10000);
-  
-  if (!client.connect(host.c_str(), port)) {
-    ESP_LOGE(TAG, "Failed to connect to upload server");
-    file.close();
-    this->status_ = "Connect Fail";
+  const char *http_filename = this->current_file_.c_str();
+  const char *last_slash = strrchr(http_filename, '/');
+  if (last_slash != nullptr) http_filename = last_slash + 1;
+  // The audio digest from the manifest lets the server skip a known body
+  char digest[CONTENT_HASH_HEX_SIZE];
+  bool has_digest = this->read_manifest_hash_(this->current_file_, digest);
+
+  // Card access is locked per piece, never across a network write
+  buffer_pool::ScopedBlock buf(this->upload_io_pool_);
+  auto read = [this, &file](size_t offset, uint8_t *data, size_t length) {
+    SdLock lock(this->sd_mutex_);
+    if (offset == 0) file.seek(0);
+    return file.read(data, length);
+  };
+  HttpResponse response;
+  uint32_t upload_start = millis();
+  MultipartResult result =
+      buf ? post_multipart(this->http_, url, http_filename, file_size, has_digest ? digest : nullptr, read,
+                           buf.data(), buf.size(), response)
+          : MultipartResult::NO_RESPONSE;
+  this->close_upload_file_(file);
+
+  if (result == MultipartResult::CONNECT_FAIL) {
+    this->fail_(RecorderError::CONNECT_FAIL);
     return false;
   }
-
-  // Build multipart form data
-  String boundary = "----ESPHomeMedallion";
-  
-  // Extract filename from path
-  std::string http_filename = this->current_file_;
-  size_t last_slash = http_filename.rfind('/');
-  if (last_slash != std::string::npos) {
-    http_filename = http_filename.substr(last_slash + 1);
+  if (result == MultipartResult::NO_RESPONSE) {
+    ESP_LOGE(TAG, "Upload failed: no response");
+    this->fail_(RecorderError::UPLOAD_FAIL);
+    return false;
   }
+  bool body_skipped = result == MultipartResult::BODY_SKIPPED;
 
-  String head = "--" + boundary + "\r\n";
-  head += "Content-Disposition: form-data; name=\"file\"; filename=\"" + String(http_filename.c_str()) + "\"\r\n";
-  head += "Content-Type: audio/wav\r\n\r\n";
-  
-  String tail = "\r\n--" + boundary + "--\r\n";
-  
-  size_t total_length = head.length() + file_size + tail.length();
-
-  // Send HTTP headers
-  client.print("POST " + String(path.c_str()) + " HTTP/1.1\r\n");
-  client.print("Host: " + String(host.c_str()) + "\r\n");
-  client.print("Connection: close\r\n");
-  client.print("Content-Type: multipart/form-data; boundary=" + boundary + "\r\n");
-  client.print("Content-Length: " + String(total_length) + "\r\n\r\n");
-  
-  // Send multipart header
-  client.print(head);
-
-  // Send file data
-  uint8_t buf[1024];
-  size_t bytes_sent = 0;
-  while (file.available()) {
-    size_t n = file.read(buf, sizeof(buf));
-    if (n == 0) break;
-    client.write(buf, n);
-    bytes_sent += n;
-    
-    // Yield to prevent watchdog
-    yield();
+  if (response.is_success()) {
+    this->catalog_.set_state(this->current_file_.c_str(), RecordingState::UPLOADED);
+    this->slot_store_.set_state(this->current_file_.c_str(), RecordingState::UPLOADED);
+  }
+  if (response.is_success() && body_skipped) {
+    ESP_LOGI(TAG, "Server already has %s (%d), body not sent", this->current_file_.c_str(), response.status);
+    this->set_state_(RecorderState::UPLOADED);
+    return true;
   }
+  if (response.is_success()) {
+    // Includes the TLS handshake, if one was needed
+    uint32_t elapsed = millis() - upload_start;
+    ESP_LOGI(TAG, "Upload successful (%d): %u bytes in %u ms, %u KiB/s", response.status, (unsigned) file_size,
+             (unsigned) elapsed, (unsigned) (elapsed > 0 ? (uint64_t) file_size * 1000 / 1024 / elapsed : 0));
+    this->set_state_(RecorderState::UPLOADED);
+    return true;
+  } else {
+    ESP_LOGE(TAG, "Upload failed: HTTP %d", response.status);
+    this->fail_(RecorderError::UPLOAD_FAIL);
+    return false;
+  }
+}
+
+void MedallionVoiceComponent::close_upload_file_(FsFile &file) {
+  SdLock lock(this->sd_mutex_);
   file.close();
+}
+
+bool MedallionVoiceComponent::start_upload_task_() {
+  if (!this->parse_url_(this->upload_url_, this->upload_target_)) {
+    this->fail_(RecorderError::BAD_URL);
+    return false;
+  }
+
+  this->upload_queue_ = xQueueCreate(UPLOAD_QUEUE_LENGTH, sizeof(QueuedUpload));
+  if (this->sd_mutex_ == nullptr || this->upload_queue_ == nullptr ||
+      !this->uploader_.setup(&this->sd_, &this->http_, this->sd_mutex_)) {
+    ESP_LOGE(TAG, "Failed to set up background uploads");
+    return false;
+  }
+
+  // Pick up an upload interrupted by a reboot
+  if (this->uploader_.has_pending()) {
+    char digest[CONTENT_HASH_HEX_SIZE];
+    bool has_digest = this->read_manifest_hash_(this->uploader_.get_file(), digest);
+    this->uploader_.resume(this->upload_target_, has_digest ? digest : nullptr);
+  }
+  // Finished segments that were still queued at the reboot
+  this->requeue_saved_.store(this->segment_duration_ms_ > 0);
+
+  // Core 0 runs the WiFi stack; the main loop and with it capture stay on core 1
+  if (xTaskCreatePinnedToCore(MedallionVoiceComponent::upload_task, "voice_upload", UPLOAD_TASK_STACK_SIZE, this,
+                              UPLOAD_TASK_PRIORITY, &this->upload_task_handle_, 0) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start upload task");
+    vQueueDelete(this->upload_queue_);
+    this->upload_queue_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool MedallionVoiceComponent::queue_upload_(const std::string &file) {
+  if (this->upload_queue_ == nullptr) {
+    ESP_LOGE(TAG, "Cannot upload %s: background uploads not running", file.c_str());
+    return false;
+  }
+
+  QueuedUpload item{};
+  snprintf(item.file, sizeof(item.file), "%s", file.c_str());
+  if (xQueueSend(this->upload_queue_, &item, 0) != pdTRUE) {
+    // Still SAVED in the catalog; segments are picked up from there once
+    // the queue has drained
+    ESP_LOGW(TAG, "Upload queue full, %s waits on SD", file.c_str());
+    if (this->segment_duration_ms_ > 0) this->requeue_saved_.store(true);
+    return false;
+  }
+  ESP_LOGD(TAG, "Queued %s for upload", file.c_str());
+  return true;
+}
 
-  // Send multipart footer
-  client.print(tail);
+void MedallionVoiceComponent::upload_task(void *param) {
+  auto *self = static_cast<MedallionVoiceComponent *>(param);
+  // The uploader forgets the file once it completes; the catalog needs it
+  QueuedUpload active{};
+  snprintf(active.file, sizeof(active.file), "%s", self->uploader_.get_file().c_str());
+  // Identifies each upload's span in the trace
+  uint32_t upload_id = 0;
+  if (self->uploader_.is_active()) perf_stats::trace_async_begin("medallion_voice.upload", upload_id);
+  while (true) {
+    if (!self->uploader_.is_active()) {
+      if (uxQueueMessagesWaiting(self->upload_queue_) == 0 && self->requeue_saved_.exchange(false))
+        self->queue_saved_uploads_();
+      QueuedUpload next;
+      if (xQueueReceive(self->upload_queue_, &next, portMAX_DELAY) != pdTRUE) continue;
+      active = next;
 
-  // Read response
-  String status_line = client.readStringUntil('\n');
-  status_line.trim();
-  ESP_LOGD(TAG, "Upload response: %s", status_line.c_str());
+      char digest[CONTENT_HASH_HEX_SIZE];
+      bool has_digest = self->read_manifest_hash_(next.file, digest);
+      std::string path = self->storage_path_(next.file);
+      bool started =
+          self->uploader_.start(next.file, path, self->upload_target_, has_digest ? digest : nullptr);
+      if (started) {
+        perf_stats::trace_async_begin("medallion_voice.upload", ++upload_id);
+        ESP_LOGI(TAG, "Resumable upload of %s (%u bytes) to %s:%u%s", next.file,
+                 (unsigned) self->uploader_.get_size(), self->upload_target_.host.c_str(), self->upload_target_.port,
+                 self->upload_target_.path.c_str());
+      }
+      self->publish_upload_result_(started ? ResumableStatus::IN_PROGRESS : ResumableStatus::FAILED);
+      continue;
+    }
+
+    // Progress is kept on SD and on the server; just wait for the network
+    if (!network::is_connected()) {
+      vTaskDelay(pdMS_TO_TICKS(500));
+      continue;
+    }
+
+    ResumableStatus status = self->uploader_.step();
+    if (status == ResumableStatus::COMPLETE || status == ResumableStatus::FAILED)
+      perf_stats::trace_async_end("medallion_voice.upload", upload_id);
+    if (status == ResumableStatus::COMPLETE) {
+      DEFERRED_LOGI(TAG, "Upload successful");
+      self->catalog_.set_state(active.file, RecordingState::UPLOADED);
+      self->slot_store_.set_state(active.file, RecordingState::UPLOADED);
+    } else if (status == ResumableStatus::FAILED) {
+      self->catalog_.set_state(active.file, RecordingState::UPLOAD_FAILED);
+      self->slot_store_.set_state(active.file, RecordingState::UPLOAD_FAILED);
+    }
+    self->publish_upload_result_(status);
+    if (status == ResumableStatus::BACKOFF) {
+      vTaskDelay(pdMS_TO_TICKS(100));
+    }
+  }
+}
 
-  client.stop();
+void MedallionVoiceComponent::publish_upload_result_(ResumableStatus status) {
+  // Only the upload task writes the result, so the count cannot be raced
+  uint32_t count = (this->upload_result_.load() >> 8) + 1;
+  this->upload_result_.store(count << 8 | static_cast<uint8_t>(status));
+  this->enable_loop_soon_any_context();
+}
 
-  // Check response
-  bool success = status_line.startsWith("HTTP/1.1 200") || 
-                 status_line.startsWith("HTTP/1.1 201") ||
-                 status_line.startsWith("HTTP/1.0 200") ||
-                 status_line.startsWith("HTTP/1.0 201");
+void MedallionVoiceComponent::queue_saved_uploads_() {
+  // Nothing is queued or uploading, so every SAVED recording is one the
+  // queue lost or never took
+  CatalogList records;
+  if (!this->catalog_.read_all(records)) return;
+  for (const CatalogRecord &record : records) {
+    if (record.state != static_cast<uint8_t>(RecordingState::SAVED)) continue;
+    // A full queue asks for the next sweep
+    if (!this->queue_upload_(record.name)) break;
+  }
+}
+
+void MedallionVoiceComponent::update_upload_status_() {
+  // The upload task only publishes its last result; the state is owned here
+  uint32_t result = this->upload_result_.load();
+  if (result == this->last_upload_result_) return;
+  this->last_upload_result_ = result;
+
+  switch (static_cast<ResumableStatus>(result & 0xFF)) {
+    case ResumableStatus::COMPLETE:
+      this->set_state_(RecorderState::UPLOADED);
+      break;
+    case ResumableStatus::FAILED:
+      this->fail_(RecorderError::UPLOAD_FAIL);
+      break;
+    case ResumableStatus::BACKOFF:
+      this->set_state_(RecorderState::UPLOAD_RETRY);
+      break;
+    case ResumableStatus::IN_PROGRESS:
+      this->set_state_(RecorderState::UPLOADING);
+      break;
+    case ResumableStatus::IDLE:
+      break;
+  }
+}
+
+bool MedallionVoiceComponent::save_trace(perf_stats::PerfStatsComponent *stats, const std::string &path) {
+  if (!this->sd_mounted_) {
+    ESP_LOGE(TAG, "Cannot save trace: SD card not mounted");
+    return false;
+  }
+  const char *filename = path.c_str();
+  if (filename[0] == '/') filename++;
 
-  if (success) {
-    ESP_LOGI(TAG, "Upload successful");
-    this->status_ = "Uploaded";
+  FsFile file;
+  {
+    SdLock lock(this->sd_mutex_);
+    file = this->sd_.open(filename, O_WRONLY | O_CREAT | O_TRUNC);
+  }
+  if (!file) {
+    ESP_LOGE(TAG, "Cannot save trace: failed to create %s", path.c_str());
+    return false;
+  }
+  // The card is taken per piece, so a recording in progress only waits for
+  // one small write at a time
+  size_t written = 0;
+  bool ok = stats->write_trace([this, &file, &written](const char *data, size_t length) {
+    SdLock lock(this->sd_mutex_);
+    if (file.write(data, length) != length) return false;
+    written += length;
     return true;
-  } else {
-    ESP_LOGE(TAG, "Upload failed: %s", status_line.c_str());
-    this->status_ = "Upload Fail";
+  });
+  {
+    SdLock lock(this->sd_mutex_);
+    file.close();
+  }
+  if (!ok) {
+    ESP_LOGE(TAG, "Failed to write trace to %s", path.c_str());
     return false;
   }
+  ESP_LOGI(TAG, "Trace saved to %s (%u bytes)", path.c_str(), (unsigned) written);
+  return true;
+}
+
+void MedallionVoiceComponent::list_recordings(bool pending_only) {
+  if (!this->sd_mounted_) {
+    ESP_LOGW(TAG, "Cannot list recordings: SD card not mounted");
+    return;
+  }
+  CatalogList records;
+  if (!this->catalog_.read_all(records)) {
+    ESP_LOGW(TAG, "Recording catalog unavailable");
+    return;
+  }
+
+  unsigned listed = 0;
+  uint64_t total_bytes = 0;
+  for (const CatalogRecord &record : records) {
+    RecordingState state = static_cast<RecordingState>(record.state);
+    if (pending_only && (state == RecordingState::UPLOADED || state == RecordingState::EVICTED)) continue;
+    listed++;
+    total_bytes += record.data_bytes;
+
+    char started[20] = "-";
+    if (record.timestamp != 0) {
+      time_t t = record.timestamp;
+      struct tm tm;
+      gmtime_r(&t, &tm);
+      strftime(started, sizeof(started), "%Y-%m-%d %H:%M:%S", &tm);
+    }
+    ESP_LOGI(TAG, "  %-20s %7u.%01u s %9u bytes  %s  %u Hz/%u ch/%u bit  %s", record.name,
+             (unsigned) (record.duration_ms / 1000), (unsigned) (record.duration_ms % 1000 / 100),
+             (unsigned) record.data_bytes, started, (unsigned) record.sample_rate, record.channels,
+             record.bits_per_sample, recording_state_to_string(state));
+  }
+  ESP_LOGI(TAG, "%u %srecordings, %llu bytes", listed, pending_only ? "pending " : "",
+           (unsigned long long) total_bytes);
 }
 
 }  // namespace medallion_voice
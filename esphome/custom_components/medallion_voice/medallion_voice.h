@@ -4,14 +4,67 @@
 #include "esphome/core/hal.h"
 #include "esphome/core/gpio.h"
 #include "esphome/core/automation.h"
+#include "esphome/core/defines.h"
+#include "esphome/components/buffer_pool/block_pool.h"
+#include "esphome/components/deferred_log/deferred_log.h"
 #include "esphome/components/es8311/es8311.h"
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
+#include "esphome/components/perf_stats/event_trace.h"
+#include "esphome/components/perf_stats/perf_stats.h"
+#include "esphome/components/perf_stats/timing_histogram.h"
+#include "catalog.h"
+#include "content_hash.h"
+#include "download_handler.h"
+#include "flac_encoder.h"
+#include "http_upload_client.h"
+#include "log_file.h"
+#include "multipart_upload.h"
+#include "recorder_state.h"
+#include "resampler.h"
+#include "resumable_upload.h"
+#include "audio_bus.h"
+#include "audio_frontend.h"
+#include "rtp_stream.h"
+#include "sd_lock.h"
+#include "slot_store.h"
+#include "wav_format.h"
 #include <SPI.h>
 #include <SdFat.h>
 #include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <atomic>
 
 namespace esphome {
 namespace medallion_voice {
 
+// Capture pipeline health for the current (or last) recording
+struct CaptureStats {
+  uint32_t start_ms{0};
+  uint32_t duration_ms{0};
+  uint64_t expected_bytes{0};  // derived from the recording's byte rate and elapsed time
+  uint64_t captured_bytes{0};  // delivered by I2S, at the capture rate
+  uint64_t written_bytes{0};   // accepted by the SD card
+  uint32_t short_writes{0};
+  uint32_t i2s_overflows{0};
+  uint32_t i2s_read_errors{0};
+  perf_stats::TimingHistogram sd_write_latency;
+  // Header rewrite + sync; audio after the last checkpoint is lost on reset
+  uint32_t checkpoints{0};
+  uint32_t max_unsynced_ms{0};
+  perf_stats::TimingHistogram checkpoint_latency;
+  // CPU cycles the front end took per captured block
+  perf_stats::TimingHistogram frontend_cycles;
+
+  // Audio missing from the file: never delivered by I2S or lost in a short write
+  uint64_t get_dropped_bytes() const {
+    return this->expected_bytes > this->written_bytes ? this->expected_bytes - this->written_bytes : 0;
+  }
+};
+
 class MedallionVoiceComponent : public Component {
  public:
   void setup() override;
@@ -22,47 +75,283 @@ class MedallionVoiceComponent : public Component {
   void set_audio_codec(es8311::ES8311Component *codec) { this->audio_codec_ = codec; }
   void set_sd_cs_pin(InternalGPIOPin *pin) { this->sd_cs_pin_ = pin; }
   void set_upload_url(const std::string &url) { this->upload_url_ = url; }
+  void set_ca_certificate(const char *pem) {
+    this->ca_certificate_ = pem;
+    this->http_.set_ca_certificate(pem);
+  }
+  void set_resumable_upload(bool resumable) { this->resumable_upload_ = resumable; }
+  void set_upload_chunk_size(uint32_t size) { this->uploader_.set_chunk_size(size); }
+  // Roll into a new file every `ms` of audio and queue the finished one for
+  // upload while recording continues; 0 records a single file
+  void set_segment_duration(uint32_t ms) { this->segment_duration_ms_ = ms; }
+  // Rewrite the header sizes and sync the file this often while recording
+  void set_checkpoint_interval(uint32_t ms) { this->checkpoint_interval_ms_ = ms; }
+  // Record losslessly compressed .flac files instead of .wav
+  void set_flac(bool flac) { this->flac_ = flac; }
+  // Record at `rate` instead of the codec's sample rate
+  void set_sample_rate(uint32_t rate) { this->sample_rate_ = rate; }
+  // Record into `count` preallocated files of `size` bytes each, reusing the
+  // oldest uploaded one when none is empty
+  void set_storage_slots(uint16_t count, uint32_t size) {
+    this->slot_store_.set_slot_count(count);
+    this->slot_store_.set_slot_size(size);
+  }
+
+  // Condition captured audio before every consumer: a high-pass at `hz`
+  // (0: none), and automatic gain towards `target_dbfs` RMS adding at most
+  // `max_gain_db`, optionally stepping the codec's PGA as well
+  void set_highpass_cutoff(uint16_t hz) { this->frontend_.set_highpass_cutoff(hz); }
+  void set_agc(int8_t target_dbfs, uint8_t max_gain_db, bool pga_control) {
+    this->frontend_.set_agc(target_dbfs, max_gain_db);
+    this->frontend_.set_pga_control(pga_control);
+  }
+
+  // Stream the audio being recorded live to `host`:`port` as RTP, in packets
+  // of `frame_ms` of audio
+  void set_stream_target(const std::string &host, uint16_t port, uint32_t frame_ms) {
+    this->streamer_.set_target(host, port);
+    this->streamer_.set_frame_duration(frame_ms);
+  }
+  // Stream at `rate` instead of the codec's sample rate
+  void set_stream_sample_rate(uint32_t rate) { this->streamer_.set_sample_rate(rate); }
+  // Also write the deferred log to `path` on the card, keeping `files`
+  // older files of `max_size` bytes
+  void set_log_file(deferred_log::DeferredLogComponent *log, const std::string &path, uint32_t max_size,
+                    uint8_t files) {
+    this->deferred_log_ = log;
+    this->log_file_.set_path(path);
+    this->log_file_.set_max_size(max_size);
+    this->log_file_.set_files(files);
+  }
+#ifdef USE_MEDALLION_VOICE_DOWNLOAD
+  // Serve recordings under `path` on the web server
+  void set_download_server(web_server_base::WebServerBase *base, const std::string &path) {
+    this->web_server_base_ = base;
+    this->download_path_ = path;
+  }
+#endif
+
+  // Capture health sensors
+  void set_dropped_bytes_sensor(sensor::Sensor *sensor) { this->dropped_bytes_sensor_ = sensor; }
+  void set_i2s_overflows_sensor(sensor::Sensor *sensor) { this->i2s_overflows_sensor_ = sensor; }
+  void set_short_writes_sensor(sensor::Sensor *sensor) { this->short_writes_sensor_ = sensor; }
+  void set_sd_write_latency_p99_sensor(sensor::Sensor *sensor) { this->sd_write_latency_p99_sensor_ = sensor; }
+  void set_sd_write_latency_max_sensor(sensor::Sensor *sensor) { this->sd_write_latency_max_sensor_ = sensor; }
+  void set_agc_gain_sensor(sensor::Sensor *sensor) { this->agc_gain_sensor_ = sensor; }
+  void set_frontend_cycles_p99_sensor(sensor::Sensor *sensor) { this->frontend_cycles_p99_sensor_ = sensor; }
+  // Published on every state change
+  void set_status_text_sensor(text_sensor::TextSensor *sensor) { this->status_text_sensor_ = sensor; }
+  void set_recording_binary_sensor(binary_sensor::BinarySensor *sensor) { this->recording_binary_sensor_ = sensor; }
+  void set_streaming_binary_sensor(binary_sensor::BinarySensor *sensor) { this->streaming_binary_sensor_ = sensor; }
+  // Storage slot sensors
+  void set_storage_free_sensor(sensor::Sensor *sensor) { this->storage_free_sensor_ = sensor; }
+  void set_evictions_sensor(sensor::Sensor *sensor) { this->evictions_sensor_ = sensor; }
 
   // Recording control
   bool start_recording();
   void stop_recording();
-  bool is_recording() const { return this->recording_; }
+  bool is_recording() const { return this->state_ == RecorderState::RECORDING; }
 
-  // Upload the last recording
+  // Upload the last recording. With resumable uploads this only queues the
+  // file; the upload task then sends it in chunks.
   bool upload_recording();
 
-  // Get status
-  const char *get_status() const { return this->status_.c_str(); }
+  // Log the recordings in the catalog, optionally only those not uploaded yet
+  void list_recordings(bool pending_only);
+
+  // Write the event trace recorded by `stats` to `path` on the card, as
+  // Chrome trace JSON. Recording may carry on meanwhile.
+  bool save_trace(perf_stats::PerfStatsComponent *stats, const std::string &path);
+
+  // SD access for the download handler, which runs in the web server task
+  bool read_catalog(CatalogList &out);
+  // Open `recording` read-only. `length` is the file's length, which for a
+  // WAV recording in a storage slot is less than the file's size.
+  bool open_recording(const std::string &recording, FsFile &file, uint32_t *length);
+  SemaphoreHandle_t get_sd_mutex() const { return this->sd_mutex_; }
+
+  RecorderState get_state() const { return this->state_; }
+  RecorderError get_error() const { return this->error_; }
+  const char *get_status() const { return recorder_status_text(this->state_, this->error_); }
+  // Called on the main loop with the new and the previous state
+  void add_on_state_callback(std::function<void(RecorderState, RecorderState)> &&callback) {
+    this->state_callbacks_.add(std::move(callback));
+  }
   const char *get_current_file() const { return this->current_file_.c_str(); }
+  const CaptureStats &get_capture_stats() const { return this->capture_stats_; }
 
  protected:
+  // Capture and recording formats, resampler and front end for the codec's
+  // current rate
+  void setup_formats_();
+  // Main loop only. False, and nothing published, if the transition table
+  // does not allow the change.
+  bool set_state_(RecorderState state, RecorderError error = RecorderError::NONE);
+  void fail_(RecorderError error) { this->set_state_(RecorderState::ERROR, error); }
   bool init_sd_card_();
   void update_record_path_();
+  bool open_record_file_();
+  void close_record_file_();
+  void roll_segment_();
+  void capture_block_();
+  size_t read_wide_block_(uint8_t *out, size_t size);
+  void condition_block_(AudioBlock *block);
+  void write_block_(const AudioBlock *block);
+  void encode_block_(const uint8_t *data, size_t length);
+  void write_flac_frame_();
+  void write_queued_blocks_();
+  void checkpoint_record_file_();
+  void load_catalog_();
+  void rebuild_catalog_();
+  bool repair_recording_(FsFile &file, const char *name, uint32_t *data_bytes, bool fixed_size);
+  bool repair_flac_recording_(FsFile &file, const char *name, uint32_t *data_bytes);
+  void evict_recording_(const std::string &recording);
+  // File holding `recording`: its storage slot, else the recording's own name
+  std::string storage_path_(const std::string &recording);
+  CatalogRecord make_catalog_record_(const std::string &file, RecordingState state, uint32_t data_bytes);
   void write_wav_header_(FsFile &file, uint32_t data_length);
-  bool parse_url_(const std::string &url, std::string &host, uint16_t &port, std::string &path);
+  // Header of the FLAC file being recorded; with `checkpoint`, a seek point
+  // marks everything written so far as recoverable
+  void write_flac_header_(bool checkpoint);
+  bool parse_url_(const std::string &url, HttpUrl &out);
+  void close_upload_file_(FsFile &file);
+  bool start_upload_task_();
+  bool queue_upload_(const std::string &file);
+  // Upload task: queue the recordings the catalog still has as SAVED
+  void queue_saved_uploads_();
+  void update_upload_status_();
+  static void upload_task(void *param);
+  // Upload task: hand `status` to the loop
+  void publish_upload_result_(ResumableStatus status);
+  void update_capture_stats_();
+  void publish_capture_stats_();
+  void publish_storage_stats_();
+  void publish_stream_state_();
+  void write_stats_sidecar_();
+  bool read_manifest_hash_(const std::string &recording, char *hex);
 
   es8311::ES8311Component *audio_codec_{nullptr};
   InternalGPIOPin *sd_cs_pin_{nullptr};
   std::string upload_url_;
+  const char *ca_certificate_{nullptr};
 
   // SD card
   SdFs sd_;
   SPIClass sd_spi_{HSPI};
   bool sd_mounted_{false};
 
+  // Audio as captured, and as written to SD. Capture is always 16-bit: codec
+  // slots of 24 or 32 bits are narrowed as they are read.
+  AudioFormat capture_format_{16000, 2, 16};
+  AudioFormat record_format_{16000, 2, 16};
+  uint32_t sample_rate_{0};  // configured recording rate, 0: the capture rate
+  Resampler resampler_;
+  buffer_pool::BlockPool resample_pool_{"resample", buffer_pool::REGION_INTERNAL_DMA};
+  uint8_t *resample_buffer_{nullptr};  // held for good once reserved
+  bool resampling_{false};
+  buffer_pool::BlockPool wide_pool_{"wide_capture", buffer_pool::REGION_INTERNAL_DMA};
+  uint8_t *wide_buffer_{nullptr};  // one block of wide slots, held for good once reserved
+  AudioFrontEnd frontend_;
+
   // Recording state
-  bool recording_{false};
   FsFile record_file_;
   std::string current_file_;
-  uint32_t recorded_bytes_{0};
+  std::string record_path_;  // current_file_, or the slot file it is recorded into
+  uint32_t recorded_bytes_{0};  // whole session, across segments
+  uint32_t file_bytes_{0};      // data chunk of the current file; PCM bytes for FLAC too
   uint16_t record_counter_{1};
+  uint32_t record_started_at_{0};  // UNIX time, 0 if the clock was not set
+  uint16_t session_{0};
+  uint16_t segment_index_{0};
+  uint32_t segment_duration_ms_{0};
+  uint32_t segment_bytes_{0};
+  uint32_t file_limit_bytes_{0};  // data a slot file can hold, 0 if unlimited
+  uint32_t checkpoint_interval_ms_{2000};
+  uint32_t last_checkpoint_ms_{0};
+  RecordingCatalog catalog_;
+  SlotStore slot_store_;
+  LogFile log_file_;
+  deferred_log::DeferredLogComponent *deferred_log_{nullptr};
+  // SHA-256 of the audio data as written, stored in the manifest
+  ContentHash content_hash_;
+  char content_digest_[CONTENT_HASH_HEX_SIZE]{};
+  // FLAC recording: frames are written as they fill, file_bytes_ counts the
+  // PCM they hold and encoded_bytes_ their size after the header
+  bool flac_{false};
+  FlacEncoder encoder_;
+  uint32_t encoded_bytes_{0};
+
+  // Capture health
+  CaptureStats capture_stats_;
+  uint32_t last_stats_publish_{0};
+  sensor::Sensor *dropped_bytes_sensor_{nullptr};
+  sensor::Sensor *i2s_overflows_sensor_{nullptr};
+  sensor::Sensor *short_writes_sensor_{nullptr};
+  sensor::Sensor *sd_write_latency_p99_sensor_{nullptr};
+  sensor::Sensor *sd_write_latency_max_sensor_{nullptr};
+  sensor::Sensor *agc_gain_sensor_{nullptr};
+  sensor::Sensor *frontend_cycles_p99_sensor_{nullptr};
+  text_sensor::TextSensor *status_text_sensor_{nullptr};
+  binary_sensor::BinarySensor *recording_binary_sensor_{nullptr};
+  binary_sensor::BinarySensor *streaming_binary_sensor_{nullptr};
+  sensor::Sensor *storage_free_sensor_{nullptr};
+  sensor::Sensor *evictions_sensor_{nullptr};
+  uint64_t last_storage_free_{UINT64_MAX};
+  uint32_t last_evictions_{UINT32_MAX};
+  bool last_streaming_{false};
+
+  // Upload connection, kept alive across uploads
+  HttpUploadClient http_;
+  // SD to network copies of the one-shot upload
+  buffer_pool::BlockPool upload_io_pool_{"upload_io", buffer_pool::REGION_PSRAM};
+  bool resumable_upload_{false};
+  ResumableUploader uploader_;
+  RtpStreamer streamer_;
+
+  // Resumable uploads run in their own task so TLS handshakes and chunk
+  // transfers never hold up the capture loop
+  struct QueuedUpload {
+    char file[32];
+  };
+  static constexpr UBaseType_t UPLOAD_QUEUE_LENGTH = 16;
+  static constexpr uint32_t UPLOAD_TASK_STACK_SIZE = 12288;  // mbedTLS handshake
+  static constexpr UBaseType_t UPLOAD_TASK_PRIORITY = 1;
+  HttpUrl upload_target_;
+  SemaphoreHandle_t sd_mutex_{nullptr};
+  QueueHandle_t upload_queue_{nullptr};
+  TaskHandle_t upload_task_handle_{nullptr};
+  // Set at boot and when the queue overflows: once the queue has drained,
+  // the upload task queues what the catalog still has as SAVED
+  std::atomic<bool> requeue_saved_{false};
+  // Last result of the upload task in the low byte, numbered above it so a
+  // result that repeats the previous one is still seen
+  std::atomic<uint32_t> upload_result_{static_cast<uint8_t>(ResumableStatus::IDLE)};
+  uint32_t last_upload_result_{static_cast<uint8_t>(ResumableStatus::IDLE)};
+
+#ifdef USE_MEDALLION_VOICE_DOWNLOAD
+  web_server_base::WebServerBase *web_server_base_{nullptr};
+  std::string download_path_;
+#endif
 
-  // Status
-  std::string status_{"Ready"};
+  RecorderState state_{RecorderState::READY};
+  RecorderError error_{RecorderError::NONE};
+  CallbackManager<void(RecorderState, RecorderState)> state_callbacks_;
 
-  // Audio buffer
-  static constexpr size_t AUDIO_BUFFER_SIZE = 1024;
-  uint8_t audio_buffer_[AUDIO_BUFFER_SIZE];
+  // Captured audio, shared by the SD writer and the live stream
+  static constexpr size_t AUDIO_BLOCK_SIZE = 1024;
+  // Written in the same loop that captures, so rarely more than one waits
+  static constexpr uint8_t SD_BUS_DEPTH = 4;
+  AudioBus audio_bus_;
+  AudioConsumer *sd_consumer_{nullptr};
+
+  // Execution time statistics
+  perf_stats::TimingHistogram loop_time_{"medallion_voice.loop"};
+  perf_stats::TimingHistogram sd_write_time_{"medallion_voice.sd_write"};
+  perf_stats::TimingHistogram hash_time_{"medallion_voice.hash"};
+  perf_stats::TimingHistogram checkpoint_time_{"medallion_voice.checkpoint"};
+  perf_stats::TimingHistogram encode_time_{"medallion_voice.encode"};
+  perf_stats::TimingHistogram resample_time_{"medallion_voice.resample"};
+  perf_stats::TimingHistogram frontend_time_{"medallion_voice.frontend"};
 };
 
 // Actions
@@ -76,10 +365,39 @@ template<typename... Ts> class StopRecordingAction : public Action<Ts...>, publi
   void play(Ts... x) override { this->parent_->stop_recording(); }
 };
 
+template<typename... Ts>
+class ListRecordingsAction : public Action<Ts...>, public Parented<MedallionVoiceComponent> {
+ public:
+  TEMPLATABLE_VALUE(bool, pending_only)
+
+  void play(Ts... x) override { this->parent_->list_recordings(this->pending_only_.value(x...)); }
+};
+
 template<typename... Ts> class UploadAction : public Action<Ts...>, public Parented<MedallionVoiceComponent> {
  public:
   void play(Ts... x) override { this->parent_->upload_recording(); }
 };
 
+template<typename... Ts> class SaveTraceAction : public Action<Ts...>, public Parented<MedallionVoiceComponent> {
+ public:
+  void set_perf_stats(perf_stats::PerfStatsComponent *stats) { this->stats_ = stats; }
+  void set_path(const std::string &path) { this->path_ = path; }
+
+  void play(Ts... x) override { this->parent_->save_trace(this->stats_, this->path_); }
+
+ protected:
+  perf_stats::PerfStatsComponent *stats_{nullptr};
+  std::string path_;
+};
+
+// Triggers
+class StateTrigger : public Trigger<RecorderState, RecorderState> {
+ public:
+  explicit StateTrigger(MedallionVoiceComponent *parent) {
+    parent->add_on_state_callback(
+        [this](RecorderState state, RecorderState previous) { this->trigger(state, previous); });
+  }
+};
+
 }  // namespace medallion_voice
 }  // namespace esphome
@@ -0,0 +1,75 @@
+#include "multipart_upload.h"
+#include "catalog.h"
+#include "content_hash.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.multipart";
+
+static const char *const MULTIPART_BOUNDARY = "----ESPHomeMedallion";
+
+// How long to wait for "100 Continue" before sending the body anyway
+static const uint32_t EXPECT_CONTINUE_TIMEOUT_MS = 1000;
+
+static bool copy_body(HttpUploadClient &http, size_t length, const MultipartReader &read, uint8_t *buf,
+                      size_t buf_size) {
+  size_t sent = 0;
+  while (sent < length) {
+    int n = read(sent, buf, std::min(buf_size, length - sent));
+    if (n <= 0) break;
+    if (!http.write(buf, n)) return false;
+    sent += n;
+
+    // Yield to prevent watchdog
+    yield();
+  }
+  return true;
+}
+
+MultipartResult post_multipart(HttpUploadClient &http, const HttpUrl &url, const char *filename, size_t length,
+                               const char *digest, const MultipartReader &read, uint8_t *buf, size_t buf_size,
+                               HttpResponse &response) {
+  char head[192];
+  int head_len = snprintf(head, sizeof(head),
+                          "--%s\r\n"
+                          "Content-Disposition: form-data; name=\"file\"; filename=\"%s\"\r\n"
+                          "Content-Type: %s\r\n\r\n",
+                          MULTIPART_BOUNDARY, filename, RecordingCatalog::content_type(filename));
+  char tail[48];
+  int tail_len = snprintf(tail, sizeof(tail), "\r\n--%s--\r\n", MULTIPART_BOUNDARY);
+  char headers[224];
+  int headers_len =
+      snprintf(headers, sizeof(headers), "Content-Type: multipart/form-data; boundary=%s\r\n", MULTIPART_BOUNDARY);
+  if (digest != nullptr) {
+    snprintf(headers + headers_len, sizeof(headers) - headers_len, "%s: %s\r\nExpect: 100-continue\r\n",
+             CONTENT_HASH_HEADER, digest);
+  }
+  size_t total_length = head_len + length + tail_len;
+
+  http.set_server(url.host, url.port, url.secure);
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = false;
+    if (!http.ensure_connected(reused)) return MultipartResult::CONNECT_FAIL;
+
+    bool send_body = true;
+    bool ok = http.send_request("POST", url.path.c_str(), headers, total_length) &&
+              (digest == nullptr || http.await_continue(response, EXPECT_CONTINUE_TIMEOUT_MS, send_body));
+    if (ok && !send_body) return MultipartResult::BODY_SKIPPED;
+    if (ok && http.write((const uint8_t *) head, head_len) && copy_body(http, length, read, buf, buf_size) &&
+        http.write((const uint8_t *) tail, tail_len) && http.read_response(response)) {
+      return MultipartResult::SENT;
+    }
+    if (!reused) break;
+    ESP_LOGD(TAG, "Reused connection failed, reconnecting");
+    http.close();
+  }
+  return MultipartResult::NO_RESPONSE;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "http_upload_client.h"
+#include "http_url.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace esphome {
+namespace medallion_voice {
+
+// Body copies of the one-shot upload: one read and one network write each
+static const size_t MULTIPART_IO_SIZE = 4096;
+
+enum class MultipartResult : uint8_t {
+  SENT,          // body sent, server's answer in `response`
+  BODY_SKIPPED,  // server answered the 100-continue with a final response
+  CONNECT_FAIL,  // no connection to the server
+  NO_RESPONSE,   // connection lost before a response arrived
+};
+
+// Fills `buf` with up to `length` bytes of the file from `offset`. Returns the
+// bytes read, <= 0 at the end of the file or on errors.
+using MultipartReader = std::function<int(size_t offset, uint8_t *buf, size_t length)>;
+
+// One-shot upload of a `length` byte file as a multipart/form-data POST to
+// `url`, shown to the server as `filename`. With the audio `digest` (hex, may
+// be nullptr) the request carries it and asks for "100 Continue", so the
+// server can verify the upload and decline a body it already has.
+//
+// The connection is kept alive between uploads. If the server closed a
+// reused connection while it was idle, the request fails before any response
+// arrives; it is retried once on a fresh connection, reading the file again
+// from offset 0. `buf` holds one piece of the body copy.
+MultipartResult post_multipart(HttpUploadClient &http, const HttpUrl &url, const char *filename, size_t length,
+                               const char *digest, const MultipartReader &read, uint8_t *buf, size_t buf_size,
+                               HttpResponse &response);
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,51 @@
+#include "recorder_state.h"
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const STATE_TEXT[] = {
+    "Ready", "Recording", "Saved", "Upload Queued", "Uploading", "Upload Retry", "Uploaded", "Error",
+};
+
+static const char *const ERROR_TEXT[] = {
+    "Error",     "SD Failed", "SD Not Ready", "No Audio", "No Memory",  "Codec Error",  "File Error", "Storage Full",
+    "Slot Full", "No File",   "No WiFi",      "Bad URL",  "Empty File", "Connect Fail", "Upload Fail",
+};
+
+static constexpr uint8_t bit(RecorderState state) { return 1u << static_cast<uint8_t>(state); }
+
+// Targets of every state but RECORDING
+static constexpr uint8_t FROM_IDLE = bit(RecorderState::RECORDING) | bit(RecorderState::UPLOAD_QUEUED) |
+                                     bit(RecorderState::UPLOADING) | bit(RecorderState::UPLOAD_RETRY) |
+                                     bit(RecorderState::UPLOADED) | bit(RecorderState::ERROR);
+
+// Allowed targets, indexed by the current state
+static const uint8_t TRANSITIONS[] = {
+    FROM_IDLE,  // READY
+    bit(RecorderState::SAVED) | bit(RecorderState::ERROR),  // RECORDING
+    FROM_IDLE,  // SAVED
+    FROM_IDLE,  // UPLOAD_QUEUED
+    FROM_IDLE,  // UPLOADING
+    FROM_IDLE,  // UPLOAD_RETRY
+    FROM_IDLE,  // UPLOADED
+    FROM_IDLE,  // ERROR
+};
+
+static_assert(sizeof(STATE_TEXT) / sizeof(STATE_TEXT[0]) == static_cast<uint8_t>(RecorderState::ERROR) + 1,
+              "STATE_TEXT out of step with RecorderState");
+static_assert(sizeof(TRANSITIONS) == sizeof(STATE_TEXT) / sizeof(STATE_TEXT[0]),
+              "TRANSITIONS out of step with RecorderState");
+static_assert(sizeof(ERROR_TEXT) / sizeof(ERROR_TEXT[0]) == static_cast<uint8_t>(RecorderError::UPLOAD_FAIL) + 1,
+              "ERROR_TEXT out of step with RecorderError");
+
+const char *recorder_status_text(RecorderState state, RecorderError error) {
+  if (state == RecorderState::ERROR) return ERROR_TEXT[static_cast<uint8_t>(error)];
+  return STATE_TEXT[static_cast<uint8_t>(state)];
+}
+
+bool is_valid_transition(RecorderState from, RecorderState to) {
+  return (TRANSITIONS[static_cast<uint8_t>(from)] & bit(to)) != 0;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
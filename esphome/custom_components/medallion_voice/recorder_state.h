@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace medallion_voice {
+
+// What the recorder is doing. Every change goes through
+// MedallionVoiceComponent::set_state_(), which checks it against the
+// transition table and publishes it.
+enum class RecorderState : uint8_t {
+  READY,  // nothing recorded since boot
+  RECORDING,
+  SAVED,
+  UPLOAD_QUEUED,
+  UPLOADING,
+  UPLOAD_RETRY,  // resumable upload waiting for the server or the network
+  UPLOADED,
+  ERROR,  // the last command failed, see RecorderError
+};
+
+// Why the recorder is in RecorderState::ERROR
+enum class RecorderError : uint8_t {
+  NONE,
+  SD_FAILED,
+  SD_NOT_READY,
+  NO_AUDIO,
+  NO_MEMORY,
+  CODEC_ERROR,
+  FILE_ERROR,
+  STORAGE_FULL,
+  SLOT_FULL,
+  NO_FILE,
+  NO_WIFI,
+  BAD_URL,
+  EMPTY_FILE,
+  CONNECT_FAIL,
+  UPLOAD_FAIL,
+};
+
+// Status text of a state, or of the error in the error state
+const char *recorder_status_text(RecorderState state, RecorderError error);
+// A recording only starts from a state other than RECORDING and only ends
+// in SAVED or ERROR; READY is only left, never returned to
+bool is_valid_transition(RecorderState from, RecorderState to);
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,176 @@
+#include "resampler.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.resampler";
+
+// Taps per phase at the lower of the two rates. With the Kaiser window
+// below this gives about 60 dB of stopband and a transition band of 11% of
+// the lower rate, centred just below its Nyquist frequency.
+static const uint32_t ZERO_CROSSINGS = 32;
+static const double KAISER_BETA = 5.65;
+// Cutoff as a fraction of the lower Nyquist frequency
+static const double CUTOFF = 0.89;
+// Coefficients are Q14: the taps of a phase add up to 1.0 but their
+// magnitudes to just over 2.0, which in Q15 could overflow the 32-bit
+// accumulator on a full-scale input
+static const int COEF_BITS = 14;
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// Zeroth-order modified Bessel function of the first kind, for the window
+static double bessel_i0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+    if (term < sum * 1e-12) break;
+  }
+  return sum;
+}
+
+// Dot product over `n` taps, n a multiple of 4. Four independent
+// accumulators keep the S3's 16-bit multiply-add pipeline busy without a
+// dependency on the previous sum.
+static inline int32_t dot_product(const int16_t *coefs, const int16_t *samples, uint16_t n) {
+  int32_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+  for (uint16_t i = 0; i < n; i += 4) {
+    acc0 += (int32_t) coefs[i] * samples[i];
+    acc1 += (int32_t) coefs[i + 1] * samples[i + 1];
+    acc2 += (int32_t) coefs[i + 2] * samples[i + 2];
+    acc3 += (int32_t) coefs[i + 3] * samples[i + 3];
+  }
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+Resampler::~Resampler() { this->release_(); }
+
+void Resampler::release_() {
+  if (this->bank_ != nullptr) {
+    RAMAllocator<int16_t> allocator(RAMAllocator<int16_t>::ALLOC_INTERNAL);
+    allocator.deallocate(this->bank_, this->bank_size_);
+    this->bank_ = nullptr;
+    this->bank_size_ = 0;
+  }
+}
+
+bool Resampler::setup(uint32_t in_rate, uint32_t out_rate, uint8_t channels) {
+  if (in_rate == 0 || out_rate == 0 || channels == 0 || channels > MAX_CHANNELS) {
+    return false;
+  }
+  this->release_();
+  uint32_t divisor = gcd(in_rate, out_rate);
+  this->up_ = out_rate / divisor;
+  this->down_ = in_rate / divisor;
+  this->channels_ = channels;
+  this->reset();
+  if (this->is_passthrough()) return true;
+
+  double decimation = this->down_ > this->up_ ? (double) this->down_ / this->up_ : 1.0;
+  uint32_t taps = (uint32_t) ceil(ZERO_CROSSINGS * decimation);
+  taps = (taps + 3) & ~3u;
+  uint64_t size = (uint64_t) taps * this->up_;
+  if (taps > MAX_TAPS || size > MAX_BANK_SIZE) {
+    ESP_LOGE(TAG, "%" PRIu32 " -> %" PRIu32 " Hz needs %" PRIu32 " phases of %" PRIu32 " taps, more than supported",
+             in_rate, out_rate, this->up_, taps);
+    this->up_ = this->down_ = 1;
+    return false;
+  }
+  RAMAllocator<int16_t> allocator(RAMAllocator<int16_t>::ALLOC_INTERNAL | RAMAllocator<int16_t>::ALLOW_FAILURE);
+  this->bank_ = allocator.allocate(size);
+  if (this->bank_ == nullptr) {
+    ESP_LOGE(TAG, "Cannot allocate %u-byte filter bank", (unsigned) (size * sizeof(int16_t)));
+    this->up_ = this->down_ = 1;
+    return false;
+  }
+  this->taps_ = taps;
+  this->bank_size_ = size;
+
+  // Prototype lowpass at up_ * in_rate, in cycles per sample of that rate
+  uint32_t length = size;
+  double center = (length - 1) / 2.0;
+  double cutoff = CUTOFF * 0.5 / (this->up_ > this->down_ ? this->up_ : this->down_);
+  double window_norm = bessel_i0(KAISER_BETA);
+  double coefs[MAX_TAPS];
+  for (uint32_t phase = 0; phase < this->up_; phase++) {
+    // Tap j of a phase weights the input j samples before the newest
+    double sum = 0.0;
+    for (uint32_t j = 0; j < taps; j++) {
+      double t = phase + (double) j * this->up_ - center;
+      double x = 2.0 * cutoff * t;
+      double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+      double r = t / (center + 0.5);
+      double window = bessel_i0(KAISER_BETA * sqrt(fmax(0.0, 1.0 - r * r))) / window_norm;
+      coefs[j] = sinc * window;
+      sum += coefs[j];
+    }
+    // Unity gain per phase, rounded so the taps sum to exactly 1.0;
+    // stored oldest input first to run along the history window
+    int16_t *out = this->bank_ + phase * taps;
+    int32_t total = 0;
+    uint32_t peak = 0;
+    for (uint32_t j = 0; j < taps; j++) {
+      int32_t q = lround(coefs[j] / sum * (1 << COEF_BITS));
+      out[taps - 1 - j] = q;
+      total += q;
+      if (fabs(coefs[j]) > fabs(coefs[peak])) peak = j;
+    }
+    out[taps - 1 - peak] += (1 << COEF_BITS) - total;
+  }
+  return true;
+}
+
+void Resampler::reset() {
+  memset(this->history_, 0, sizeof(this->history_));
+  this->pos_ = 0;
+  this->phase_ = 0;
+}
+
+size_t Resampler::process(const int16_t *in, size_t frames, int16_t *out) {
+  const uint8_t channels = this->channels_;
+  if (this->is_passthrough()) {
+    memcpy(out, in, frames * channels * sizeof(int16_t));
+    return frames;
+  }
+
+  const uint16_t taps = this->taps_;
+  size_t produced = 0;
+  for (size_t i = 0; i < frames; i++) {
+    for (uint8_t c = 0; c < channels; c++) {
+      int16_t sample = in[i * channels + c];
+      this->history_[c][this->pos_] = sample;
+      this->history_[c][this->pos_ + taps] = sample;
+    }
+    if (++this->pos_ == taps) this->pos_ = 0;
+
+    // Every output that falls between this input and the next
+    while (this->phase_ < this->up_) {
+      const int16_t *coefs = this->bank_ + this->phase_ * taps;
+      for (uint8_t c = 0; c < channels; c++) {
+        int32_t acc = dot_product(coefs, &this->history_[c][this->pos_], taps);
+        int32_t sample = (acc + (1 << (COEF_BITS - 1))) >> COEF_BITS;
+        out[produced * channels + c] = sample > INT16_MAX ? INT16_MAX : sample < INT16_MIN ? INT16_MIN : sample;
+      }
+      produced++;
+      this->phase_ += this->down_;
+    }
+    this->phase_ -= this->up_;
+  }
+  return produced;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace medallion_voice {
+
+// Fixed-point polyphase sample rate converter for interleaved 16-bit PCM.
+//
+// For in_rate -> out_rate with L/M = out_rate/in_rate in lowest terms, a
+// windowed-sinc lowpass is designed once at setup for the rate L * in_rate
+// and split into L phases ("filter bank") of TAPS taps each. Every output
+// sample is one fixed-point dot product of a phase with the last TAPS
+// inputs of its channel, so converting costs TAPS multiply-adds per output
+// sample whatever the ratio. The cutoff follows the lower of the two rates,
+// so decimating is alias-free too.
+//
+// The bank is allocated in internal RAM by setup(), which may be called again
+// to change rates; process() only touches member state and may run in any
+// one task.
+class Resampler {
+ public:
+  static constexpr uint8_t MAX_CHANNELS = 2;
+  // Upper bounds on the filter: taps per phase grow with the decimation
+  // factor (48 -> 8 kHz needs 192), phases with the ratio's numerator
+  // (44.1 -> 16 kHz needs 160 phases of 92 taps)
+  static constexpr uint16_t MAX_TAPS = 192;
+  static constexpr uint32_t MAX_BANK_SIZE = 16384;
+
+  ~Resampler();
+
+  // Convert `channels` channels from `in_rate` to `out_rate`. Equal rates
+  // set up a passthrough. False if the ratio needs a larger filter bank
+  // than MAX_BANK_SIZE or memory is short, which leaves a passthrough.
+  bool setup(uint32_t in_rate, uint32_t out_rate, uint8_t channels);
+  // Forget past input, e.g. at the start of a recording
+  void reset();
+
+  bool is_passthrough() const { return this->up_ == this->down_; }
+  // Output frames process() can produce from `frames` input frames
+  size_t max_output_frames(size_t frames) const {
+    return ((uint64_t) frames * this->up_ + this->down_ - 1) / this->down_ + 1;
+  }
+
+  // Convert `frames` sample frames from `in` into `out`, which must hold
+  // max_output_frames(frames). Returns the output frames written.
+  size_t process(const int16_t *in, size_t frames, int16_t *out);
+
+  uint16_t get_taps() const { return this->taps_; }
+  uint16_t get_phases() const { return this->up_; }
+
+ protected:
+  void release_();
+
+  uint32_t up_{1};    // L
+  uint32_t down_{1};  // M
+  uint8_t channels_{0};
+  uint16_t taps_{0};  // per phase, a multiple of 4
+  // up_ phases of taps_ Q14 coefficients, oldest input first
+  int16_t *bank_{nullptr};
+  uint32_t bank_size_{0};
+  // Position of the next output between inputs, in 1/up_ steps
+  uint32_t phase_{0};
+  // Last taps_ inputs per channel, stored twice so the window that ends at
+  // the newest sample is always contiguous
+  int16_t history_[MAX_CHANNELS][2 * MAX_TAPS]{};
+  uint16_t pos_{0};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,317 @@
+#include "resumable_upload.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/components/deferred_log/deferred_log.h"
+#include <esp_rom_crc.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
+#include <strings.h>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.resume";
+
+// Upload progress, rewritten after every acknowledged chunk
+static const char *const STATE_FILE = "upload.state";
+
+static const uint32_t BACKOFF_MIN_MS = 1000;
+static const uint32_t BACKOFF_MAX_MS = 60000;
+
+bool ResumableUploader::setup(SdFs *sd, HttpUploadClient *http, SemaphoreHandle_t sd_mutex) {
+  this->sd_ = sd;
+  this->sd_mutex_ = sd_mutex;
+  this->http_ = http;
+
+  if (!this->chunk_pool_.reserve(this->chunk_size_, 1)) return false;
+
+  if (this->load_state_()) {
+    ESP_LOGI(TAG, "Pending upload: %s (%" PRIu32 "/%" PRIu32 " bytes)", this->file_.c_str(), this->offset_,
+             this->size_);
+  }
+  return true;
+}
+
+bool ResumableUploader::start(const std::string &file, const std::string &path, const HttpUrl &url,
+                              const char *digest) {
+  this->cancel();
+  this->file_ = file;
+  this->path_ = path;
+  this->offset_ = 0;
+  return this->resume(url, digest);
+}
+
+bool ResumableUploader::resume(const HttpUrl &url, const char *digest) {
+  if (!this->chunk_pool_.is_reserved() || this->file_.empty()) return false;
+
+  this->url_ = url;
+  if (digest != nullptr) {
+    snprintf(this->digest_, sizeof(this->digest_), "%s", digest);
+  } else {
+    this->digest_[0] = '\0';
+  }
+  if (!this->open_file_()) {
+    this->clear_state_();
+    return false;
+  }
+  this->build_request_path_();
+  this->active_ = true;
+  this->need_offset_ = true;
+  this->retry_at_ = millis();
+  this->backoff_ms_ = 0;
+  this->save_state_();
+  return true;
+}
+
+void ResumableUploader::cancel() {
+  if (this->fs_file_) {
+    SdLock lock(this->sd_mutex_);
+    this->fs_file_.close();
+  }
+  this->active_ = false;
+  this->clear_state_();
+}
+
+bool ResumableUploader::open_file_() {
+  const char *filename = this->path_.c_str();
+  if (filename[0] == '/') filename++;
+
+  SdLock lock(this->sd_mutex_);
+  if (this->fs_file_) this->fs_file_.close();
+  this->fs_file_ = this->sd_->open(filename, O_RDONLY);
+  if (!this->fs_file_) {
+    ESP_LOGE(TAG, "Failed to open %s", this->path_.c_str());
+    return false;
+  }
+  // Slot files are larger than the recording they hold; the header has the
+  // real length
+  this->size_ = this->fs_file_.size();
+  uint8_t header[WAV_HEADER_SIZE];
+  uint32_t data_length;
+  if (this->fs_file_.read(header, WAV_HEADER_SIZE) == (int) WAV_HEADER_SIZE &&
+      parse_wav_data_length(header, &data_length) && WAV_HEADER_SIZE + data_length < this->size_) {
+    this->size_ = WAV_HEADER_SIZE + data_length;
+  }
+  return true;
+}
+
+void ResumableUploader::build_request_path_() {
+  const char *name = this->file_.c_str();
+  const char *last_slash = strrchr(name, '/');
+  if (last_slash != nullptr) name = last_slash + 1;
+
+  // The upload URL path may already end in a slash
+  const char *base = this->url_.path.c_str();
+  const char *sep = (!this->url_.path.empty() && this->url_.path.back() == '/') ? "" : "/";
+  snprintf(this->request_path_, sizeof(this->request_path_), "%s%sresumable?file=%s&size=%" PRIu32, base, sep,
+           name, this->size_);
+}
+
+ResumableStatus ResumableUploader::step() {
+  if (!this->active_) return ResumableStatus::IDLE;
+  if ((int32_t) (millis() - this->retry_at_) < 0) return ResumableStatus::BACKOFF;
+
+  this->http_->set_server(this->url_.host, this->url_.port, this->url_.secure);
+
+  if (this->need_offset_) {
+    bool retry = true;
+    if (!this->query_offset_(retry)) return this->fail_(retry);
+    this->need_offset_ = false;
+    if (this->offset_ > 0) {
+      ESP_LOGI(TAG, "Resuming %s at %" PRIu32 "/%" PRIu32, this->file_.c_str(), this->offset_, this->size_);
+    }
+  }
+
+  if (this->offset_ >= this->size_) {
+    ESP_LOGI(TAG, "Upload complete: %s", this->file_.c_str());
+    this->cancel();
+    return ResumableStatus::COMPLETE;
+  }
+  return this->send_chunk_();
+}
+
+bool ResumableUploader::exchange_(const char *method, const char *headers, const uint8_t *body, size_t length,
+                                  HttpResponse &response) {
+  // Retry once on a fresh connection if a kept-alive one went stale
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = false;
+    if (!this->http_->ensure_connected(reused)) return false;
+
+    bool ok = this->http_->send_request(method, this->request_path_, headers, length) &&
+              (length == 0 || this->http_->write(body, length));
+    if (ok && this->http_->read_response(response)) return true;
+    if (!reused) return false;
+    this->http_->close();
+  }
+  return false;
+}
+
+bool ResumableUploader::query_offset_(bool &retry) {
+  uint32_t offset = 0;
+  bool has_offset = false;
+  HttpResponse response;
+  response.on_header = [&offset, &has_offset](const char *name, const char *value) {
+    if (strcasecmp(name, "Upload-Offset") == 0) {
+      offset = strtoul(value, nullptr, 10);
+      has_offset = true;
+    }
+  };
+
+  char headers[96];
+  headers[0] = '\0';
+  if (this->digest_[0] != '\0') {
+    snprintf(headers, sizeof(headers), "%s: %s\r\n", CONTENT_HASH_HEADER, this->digest_);
+  }
+  if (!this->exchange_("GET", headers, nullptr, 0, response)) return false;
+  if (!response.is_success() || !has_offset) {
+    DEFERRED_LOGW(TAG, "Offset query failed: HTTP %d", response.status);
+    // e.g. 404 from a server without resumable upload support
+    retry = !(response.status >= 400 && response.status < 500 && response.status != 408 && response.status != 429);
+    return false;
+  }
+  this->offset_ = offset < this->size_ ? offset : this->size_;
+  return true;
+}
+
+ResumableStatus ResumableUploader::send_chunk_() {
+  uint32_t remaining = this->size_ - this->offset_;
+  uint32_t length = remaining < this->chunk_size_ ? remaining : this->chunk_size_;
+  buffer_pool::ScopedBlock chunk(this->chunk_pool_);
+  if (!chunk) return this->fail_(true);
+
+  for (uint32_t done = 0; done < length;) {
+    uint32_t piece = std::min(length - done, SD_READ_PIECE_SIZE);
+    SdLock lock(this->sd_mutex_);
+    if (!this->fs_file_.seekSet(this->offset_ + done) ||
+        this->fs_file_.read(chunk.data() + done, piece) != (int) piece) {
+      DEFERRED_LOGE(TAG, "SD read failed at %" PRIu32, this->offset_ + done);
+      return this->fail_(true);
+    }
+    done += piece;
+  }
+
+  uint32_t crc = esp_rom_crc32_le(0, chunk.data(), length);
+  char headers[224];
+  int len = snprintf(headers, sizeof(headers),
+                     "Content-Type: application/offset+octet-stream\r\n"
+                     "Upload-Offset: %" PRIu32 "\r\n"
+                     "Upload-Checksum: crc32 %08" PRIx32 "\r\n",
+                     this->offset_, crc);
+  if (this->digest_[0] != '\0') {
+    snprintf(headers + len, sizeof(headers) - len, "%s: %s\r\n", CONTENT_HASH_HEADER, this->digest_);
+  }
+
+  uint32_t new_offset = 0;
+  bool has_offset = false;
+  HttpResponse response;
+  response.on_header = [&new_offset, &has_offset](const char *name, const char *value) {
+    if (strcasecmp(name, "Upload-Offset") == 0) {
+      new_offset = strtoul(value, nullptr, 10);
+      has_offset = true;
+    }
+  };
+
+  if (!this->exchange_("PATCH", headers, chunk.data(), length, response)) {
+    DEFERRED_LOGW(TAG, "Chunk at %" PRIu32 " not acknowledged", this->offset_);
+    return this->fail_(true);
+  }
+
+  if (response.is_success()) {
+    this->offset_ = has_offset ? new_offset : this->offset_ + length;
+    this->backoff_ms_ = 0;
+    this->save_state_();
+    DEFERRED_LOGV(TAG, "Committed %" PRIu32 "/%" PRIu32, this->offset_, this->size_);
+    return ResumableStatus::IN_PROGRESS;
+  }
+
+  if (response.status == 409 && has_offset) {
+    // Server committed a different amount (e.g. an ack was lost); follow it
+    DEFERRED_LOGD(TAG, "Offset mismatch, server at %" PRIu32, new_offset);
+    this->offset_ = new_offset < this->size_ ? new_offset : this->size_;
+    return ResumableStatus::IN_PROGRESS;
+  }
+
+  if (response.status == 460) {
+    DEFERRED_LOGW(TAG, "Checksum rejected at %" PRIu32 ", resending", this->offset_);
+    return this->fail_(true);
+  }
+
+  DEFERRED_LOGE(TAG, "Chunk rejected: HTTP %d", response.status);
+  // Client errors will not go away by retrying
+  return this->fail_(response.status >= 500 || response.status == 408 || response.status == 429);
+}
+
+ResumableStatus ResumableUploader::fail_(bool retry) {
+  if (!retry) {
+    this->cancel();
+    return ResumableStatus::FAILED;
+  }
+
+  this->need_offset_ = true;
+  this->backoff_ms_ = this->backoff_ms_ == 0 ? BACKOFF_MIN_MS : std::min(this->backoff_ms_ * 2, BACKOFF_MAX_MS);
+  this->retry_at_ = millis() + this->backoff_ms_;
+  DEFERRED_LOGD(TAG, "Retrying in %" PRIu32 " ms", this->backoff_ms_);
+  return ResumableStatus::BACKOFF;
+}
+
+void ResumableUploader::save_state_() {
+  SdLock lock(this->sd_mutex_);
+  FsFile state = this->sd_->open(STATE_FILE, O_WRONLY | O_CREAT | O_TRUNC);
+  if (!state) {
+    DEFERRED_LOGW(TAG, "Failed to save upload state");
+    return;
+  }
+  char line[128];
+  int len = snprintf(line, sizeof(line), "%s %" PRIu32 " %" PRIu32 " %s\n", this->file_.c_str(), this->size_,
+                     this->offset_, this->path_.c_str());
+  state.write((const uint8_t *) line, len);
+  state.close();
+}
+
+void ResumableUploader::clear_state_() {
+  this->file_.clear();
+  this->path_.clear();
+  this->offset_ = 0;
+  this->size_ = 0;
+  if (this->sd_ == nullptr) return;
+  SdLock lock(this->sd_mutex_);
+  if (this->sd_->exists(STATE_FILE)) {
+    this->sd_->remove(STATE_FILE);
+  }
+}
+
+bool ResumableUploader::load_state_() {
+  char line[128];
+  int len;
+  {
+    SdLock lock(this->sd_mutex_);
+    FsFile state = this->sd_->open(STATE_FILE, O_RDONLY);
+    if (!state) return false;
+    len = state.read(line, sizeof(line) - 1);
+    state.close();
+  }
+  if (len <= 0) return false;
+  line[len] = '\0';
+
+  char file[48];
+  char path[48];
+  unsigned long size = 0;
+  unsigned long offset = 0;
+  int fields = sscanf(line, "%47s %lu %lu %47s", file, &size, &offset, path);
+  if (fields < 3) {
+    ESP_LOGW(TAG, "Discarding corrupt upload state");
+    this->clear_state_();
+    return false;
+  }
+  this->file_ = file;
+  // Saved before recordings could live in slots
+  this->path_ = fields == 4 ? path : file;
+  this->size_ = size;
+  this->offset_ = offset;
+  return true;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
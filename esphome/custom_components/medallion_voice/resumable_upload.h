@@ -0,0 +1,99 @@
+#pragma once
+
+#include "esphome/components/buffer_pool/block_pool.h"
+#include "content_hash.h"
+#include "http_upload_client.h"
+#include "http_url.h"
+#include "sd_lock.h"
+#include "wav_format.h"
+#include <SdFat.h>
+#include <string>
+
+namespace esphome {
+namespace medallion_voice {
+
+enum class ResumableStatus : uint8_t {
+  IDLE,         // no upload in progress
+  IN_PROGRESS,  // made progress, call step() again
+  BACKOFF,      // last request failed, retrying later
+  COMPLETE,     // server has the whole file
+  FAILED,       // server rejected the upload; session dropped
+};
+
+// Chunked, resumable upload of one file (offset negotiation protocol):
+//
+//   GET   <path>/resumable?file=<name>&size=<n>
+//         -> 200, "Upload-Offset: <committed bytes>"
+//   PATCH <path>/resumable?file=<name>&size=<n>
+//         "Upload-Offset: <start>", "Upload-Checksum: crc32 <hex>", chunk body
+//         -> 204, "Upload-Offset: <new committed bytes>"
+//         -> 409 on offset mismatch, 460 on checksum mismatch
+//
+// The file being uploaded and the last acknowledged offset are persisted on
+// SD, so an interrupted upload resumes after a reboot. The server's offset is
+// authoritative and is queried again after every failure. With a content
+// digest, every request carries it so the server can verify the finished
+// file and report a full offset for content it already has.
+class ResumableUploader {
+ public:
+  void set_chunk_size(uint32_t size) { this->chunk_size_ = size; }
+  uint32_t get_chunk_size() const { return this->chunk_size_; }
+
+  // Allocate the chunk buffer and restore a session persisted before reboot.
+  // All SD access is done under `sd_mutex` (may be null).
+  bool setup(SdFs *sd, HttpUploadClient *http, SemaphoreHandle_t sd_mutex);
+
+  // Begin uploading recording `file` to `url`, replacing any current session.
+  // The data is read from SD `path`, which differs from `file` when the
+  // recording lives in a storage slot. `digest` is the audio SHA-256 in hex,
+  // or nullptr if unknown.
+  bool start(const std::string &file, const std::string &path, const HttpUrl &url, const char *digest);
+  // Resume the session restored by setup() against `url`
+  bool resume(const HttpUrl &url, const char *digest);
+  void cancel();
+
+  // Perform at most one request. Never blocks for longer than one chunk.
+  ResumableStatus step();
+
+  bool is_active() const { return this->active_; }
+  bool has_pending() const { return !this->file_.empty(); }
+  const std::string &get_file() const { return this->file_; }
+  uint32_t get_offset() const { return this->offset_; }
+  uint32_t get_size() const { return this->size_; }
+
+ protected:
+  bool open_file_();
+  bool query_offset_(bool &retry);
+  ResumableStatus send_chunk_();
+  ResumableStatus fail_(bool retry);
+  bool exchange_(const char *method, const char *headers, const uint8_t *body, size_t length,
+                 HttpResponse &response);
+  void build_request_path_();
+  void save_state_();
+  void clear_state_();
+  bool load_state_();
+
+  SdFs *sd_{nullptr};
+  SemaphoreHandle_t sd_mutex_{nullptr};
+  HttpUploadClient *http_{nullptr};
+  uint32_t chunk_size_{16 * 1024};
+  // One chunk, buffered whole so its checksum can go in the headers
+  buffer_pool::BlockPool chunk_pool_{"upload_chunk", buffer_pool::REGION_PSRAM};
+
+  // Session
+  bool active_{false};
+  bool need_offset_{true};
+  std::string file_;
+  std::string path_;
+  FsFile fs_file_;
+  HttpUrl url_;
+  char request_path_[160]{};
+  char digest_[CONTENT_HASH_HEX_SIZE]{};
+  uint32_t size_{0};
+  uint32_t offset_{0};
+  uint32_t retry_at_{0};
+  uint32_t backoff_ms_{0};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,275 @@
+#include "rtp_stream.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/components/network/util.h"
+#include <esp_random.h>
+#include <esp_timer.h>
+#include <lwip/netdb.h>
+#include <lwip/sockets.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.rtp";
+
+// Dynamic payload type, as there is no static one for 16 kHz stereo L16
+static const uint8_t RTP_PAYLOAD_TYPE = 96;
+// RFC 8285 one-byte header extension elements
+static const uint8_t EXT_CAPTURE_TIME_UNIX = 1;
+static const uint8_t EXT_CAPTURE_TIME_BOOT = 2;
+
+static const uint32_t RESOLVE_RETRY_MS = 1000;
+
+// Before this (2020-09-13) the clock has not been set by SNTP
+static const time_t CLOCK_VALID_AFTER = 1600000000;
+
+static void put_be16(uint8_t *p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+  put_be16(p, v >> 16);
+  put_be16(p + 2, v);
+}
+
+bool RtpStreamer::setup(const AudioFormat &capture, AudioBus *bus, size_t block_size) {
+  this->capture_ = capture;
+  this->capture_rate_.store(capture.sample_rate);
+  this->block_size_ = block_size;
+  this->packet_align_ = capture.block_align();
+  this->configured_ = this->configure_();
+  if (!this->configured_) return false;
+
+  this->consumer_ = bus->add_consumer("rtp", BUS_DEPTH);
+  if (this->consumer_ == nullptr) return false;
+  // Core 0 runs the WiFi stack, next to the upload task
+  if (xTaskCreatePinnedToCore(RtpStreamer::send_task, "voice_rtp", TASK_STACK_SIZE, this, TASK_PRIORITY,
+                              &this->task_handle_, 0) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start stream task");
+    this->task_handle_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool RtpStreamer::configure_() {
+  const AudioFormat &capture = this->capture_;
+  AudioFormat &format = this->format_;
+  format = capture;
+  if (this->sample_rate_ > 0) format.sample_rate = this->sample_rate_;
+  this->capture_block_align_ = capture.block_align();
+  this->block_align_ = format.block_align();
+  this->byte_rate_ = format.byte_rate();
+  this->frame_bytes_ = this->frame_bytes_at_(format.sample_rate);
+  if (this->frame_bytes_ == 0 || this->frame_bytes_ > MAX_FRAME_BYTES || format.bits_per_sample != 16) {
+    ESP_LOGE(TAG, "Unsupported stream format: %" PRIu32 " bytes per %" PRIu32 " ms frame", this->frame_bytes_,
+             this->frame_duration_ms_);
+    return false;
+  }
+  this->resampling_ = format.sample_rate != capture.sample_rate;
+  if (this->resampling_) {
+    size_t frames = this->block_size_ / this->capture_block_align_;
+    // Sized by the first ratio, like the recorder's buffer
+    size_t size = this->resampler_.setup(capture.sample_rate, format.sample_rate, format.channels)
+                      ? this->resampler_.max_output_frames(frames) * this->block_align_
+                      : 0;
+    if (size > 0 && !this->resample_pool_.is_reserved() && this->resample_pool_.reserve(size, 1)) {
+      this->resample_buffer_ = this->resample_pool_.acquire();
+    }
+    if (size == 0 || this->resample_buffer_ == nullptr || size > this->resample_pool_.get_block_size()) {
+      ESP_LOGE(TAG, "Cannot resample the stream to %" PRIu32 " Hz", format.sample_rate);
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t RtpStreamer::frame_bytes_at_(uint32_t rate) const {
+  uint32_t bytes = (uint64_t) this->frame_duration_ms_ * rate * this->packet_align_ / 1000;
+  return bytes - bytes % this->packet_align_;
+}
+
+bool RtpStreamer::begin(uint32_t capture_rate) {
+  if (this->consumer_ == nullptr) return false;
+  // A capture rate the packets cannot carry is refused here, before a
+  // block is queued; the task finds out the rest when it adapts
+  uint32_t rate = this->sample_rate_ > 0 ? this->sample_rate_ : capture_rate;
+  if (this->frame_bytes_at_(rate) > MAX_FRAME_BYTES) {
+    ESP_LOGE(TAG, "%" PRIu32 " ms packets at %" PRIu32 " Hz exceed %u bytes", this->frame_duration_ms_, rate,
+             (unsigned) MAX_FRAME_BYTES);
+    this->streaming_.store(false);
+    return false;
+  }
+  this->capture_rate_.store(capture_rate);
+  this->sent_.store(0);
+  this->send_errors_.store(0);
+  this->consumer_->reset_stats();
+  this->generation_++;
+  this->streaming_.store(true);
+  this->consumer_->set_active(true);
+  return true;
+}
+
+void RtpStreamer::end() {
+  if (this->consumer_ != nullptr) this->consumer_->set_active(false);
+  this->streaming_.store(false);
+}
+
+void RtpStreamer::restart_() {
+  uint32_t capture_rate = this->capture_rate_.load();
+  if (capture_rate != this->capture_.sample_rate) {
+    this->capture_.sample_rate = capture_rate;
+    this->configured_ = this->configure_();
+    if (!this->configured_) {
+      ESP_LOGE(TAG, "Not streaming at a capture rate of %" PRIu32 " Hz", capture_rate);
+      this->streaming_.store(false);
+    }
+  }
+  this->resampler_.reset();
+  this->fill_ = 0;
+  this->marker_ = true;
+  this->has_block_ = false;
+  this->ssrc_ = esp_random();
+  this->sequence_ = esp_random();
+  this->timestamp_ = esp_random();
+}
+
+void RtpStreamer::start_packet_(int64_t capture_us) {
+  uint8_t *p = this->packet_;
+  p[0] = 0x90;  // V=2, X=1
+  p[1] = RTP_PAYLOAD_TYPE | (this->marker_ ? 0x80 : 0);
+  put_be16(p + 2, this->sequence_);
+  put_be32(p + 4, this->timestamp_);
+  put_be32(p + 8, this->ssrc_);
+
+  // Capture time of the first sample, the reference for end-to-end latency
+  uint8_t *ext = p + RTP_HEADER_SIZE;
+  put_be16(ext, 0xBEDE);
+  put_be16(ext + 2, (EXTENSION_SIZE - 4) / 4);
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  uint64_t stamp;
+  if (tv.tv_sec > CLOCK_VALID_AFTER) {
+    ext[4] = (EXT_CAPTURE_TIME_UNIX << 4) | 7;
+    stamp = (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec - (esp_timer_get_time() - capture_us);
+  } else {
+    ext[4] = (EXT_CAPTURE_TIME_BOOT << 4) | 7;
+    stamp = capture_us;
+  }
+  put_be32(ext + 5, stamp >> 32);
+  put_be32(ext + 9, stamp);
+  memset(ext + 13, 0, EXTENSION_SIZE - 13);
+}
+
+void RtpStreamer::add_block_(const AudioBlock *block) {
+  const uint8_t *data = block->data;
+  size_t length = block->length;
+  if (this->resampling_) {
+    size_t frames = this->resampler_.process(reinterpret_cast<const int16_t *>(block->data),
+                                             length / this->capture_block_align_,
+                                             reinterpret_cast<int16_t *>(this->resample_buffer_));
+    data = this->resample_buffer_;
+    length = frames * this->block_align_;
+  }
+
+  // Blocks the bus dropped for us: skip their packets so the receiver sees
+  // the loss, and keep the timestamp on the audio clock. Each was a full
+  // capture block; resampled blocks vary by a frame, so the gap is taken at
+  // the stream rate rather than from this block's length.
+  if (this->has_block_ && block->sequence != this->next_block_) {
+    uint64_t frames = (uint64_t) (block->sequence - this->next_block_) * this->block_size_ /
+                      this->capture_block_align_ * this->format_.sample_rate / this->capture_.sample_rate;
+    uint32_t missing = frames * this->block_align_ + this->fill_;
+    this->sequence_ += (missing + this->frame_bytes_ - 1) / this->frame_bytes_;
+    this->timestamp_ += missing / this->block_align_;
+    this->fill_ = 0;
+  }
+  this->has_block_ = true;
+  this->next_block_ = block->sequence + 1;
+
+  uint8_t *payload = this->packet_ + PACKET_HEADER_SIZE;
+  for (size_t offset = 0; offset < length;) {
+    if (this->fill_ == 0) {
+      // The block's last sample was read just before capture_us
+      this->start_packet_(block->capture_us - (int64_t) (length - offset) * 1000000 / this->byte_rate_);
+    }
+    size_t n = std::min<size_t>(length - offset, this->frame_bytes_ - this->fill_);
+    // Little-endian samples to network order; fill_ stays sample aligned
+    // across blocks, so swapping by position works for any split
+    const uint8_t *src = data + offset;
+    for (size_t i = 0; i < n; i++) {
+      payload[(this->fill_ + i) ^ 1] = src[i];
+    }
+    this->fill_ += n;
+    offset += n;
+    if (this->fill_ == this->frame_bytes_) this->send_packet_();
+  }
+}
+
+void RtpStreamer::send_packet_() {
+  if (this->sock_ < 0) this->sock_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (this->sock_ < 0 || sendto(this->sock_, this->packet_, PACKET_HEADER_SIZE + this->fill_, 0,
+                                (struct sockaddr *) &this->target_, sizeof(this->target_)) < 0) {
+    this->send_errors_++;
+    // ENOMEM means WiFi is congested and passes; for anything else, try a
+    // fresh socket
+    if (this->sock_ >= 0 && errno != ENOMEM) {
+      close(this->sock_);
+      this->sock_ = -1;
+    }
+  } else {
+    this->sent_++;
+  }
+  this->sequence_++;
+  this->timestamp_ += this->fill_ / this->block_align_;
+  this->marker_ = false;
+  this->fill_ = 0;
+}
+
+void RtpStreamer::send_task(void *param) {
+  auto *self = static_cast<RtpStreamer *>(param);
+  uint32_t generation = self->generation_.load() - 1;
+  bool resolved = false;
+  uint32_t last_resolve = 0;
+
+  while (true) {
+    AudioBlock *block = self->consumer_->receive(portMAX_DELAY);
+    if (block == nullptr) continue;
+    if (self->generation_.load() != generation) {
+      generation = self->generation_.load();
+      self->restart_();
+    }
+
+    if (!network::is_connected()) {
+      resolved = false;
+    } else if (!resolved && (last_resolve == 0 || millis() - last_resolve >= RESOLVE_RETRY_MS)) {
+      last_resolve = millis();
+      struct addrinfo hints {};
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_DGRAM;
+      struct addrinfo *result = nullptr;
+      if (getaddrinfo(self->host_.c_str(), nullptr, &hints, &result) == 0 && result != nullptr) {
+        self->target_ = *(struct sockaddr_in *) result->ai_addr;
+        self->target_.sin_port = htons(self->port_);
+        freeaddrinfo(result);
+        resolved = true;
+      } else {
+        ESP_LOGW(TAG, "Cannot resolve %s", self->host_.c_str());
+      }
+    }
+    // Without a target the block is still numbered, and shows up as loss
+    if (resolved && self->configured_) {
+      self->add_block_(block);
+    }
+    self->consumer_->release(block);
+  }
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "audio_bus.h"
+#include "resampler.h"
+#include "esphome/components/buffer_pool/block_pool.h"
+#include "wav_format.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lwip/sockets.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace medallion_voice {
+
+// Live copy of the captured audio as RTP over UDP (RFC 3550/3551):
+//
+//   RTP header   V=2, X=1, PT 96, marker on the first packet of a recording,
+//                timestamp in samples, random SSRC per recording
+//   extension    RFC 8285 one-byte header (0xBEDE): element 1 is the capture
+//                time of the first sample in UNIX microseconds, element 2
+//                the same in microseconds since boot when the clock is not
+//                set. 8 bytes, big-endian.
+//   payload      L16: 16-bit big-endian PCM, channels interleaved
+//
+// The streamer is an audio bus consumer: its task takes captured blocks off
+// the bus, resamples them if the stream has a rate of its own, and
+// packetizes them, so capture never waits on the network. When
+// the network falls behind, its bus queue fills and blocks are dropped
+// there. Packets are numbered across the gap, so the receiver counts them
+// as lost.
+class RtpStreamer {
+ public:
+  void set_target(const std::string &host, uint16_t port) {
+    this->host_ = host;
+    this->port_ = port;
+  }
+  // 10-20 ms keeps one packet inside one Ethernet frame
+  void set_frame_duration(uint32_t ms) { this->frame_duration_ms_ = ms; }
+  // 0 streams at the capture rate
+  void set_sample_rate(uint32_t rate) { this->sample_rate_ = rate; }
+  bool is_enabled() const { return this->task_handle_ != nullptr; }
+  // Whether the current recording is being streamed; cleared by end(), and
+  // by the task when it cannot adapt the stream to a new capture rate
+  bool is_streaming() const { return this->streaming_.load(); }
+
+  // Register on `bus` (before its setup), which carries blocks of up to
+  // `block_size` bytes in `capture` format, and start the sender task
+  bool setup(const AudioFormat &capture, AudioBus *bus, size_t block_size);
+  // Start streaming a new recording: new SSRC, marker bit. The task adapts
+  // the stream if `capture_rate` differs from the last recording's. False
+  // if the streamer did not set up or its packets cannot carry the rate.
+  bool begin(uint32_t capture_rate);
+  void end();
+
+  const std::string &get_host() const { return this->host_; }
+  uint16_t get_port() const { return this->port_; }
+  uint32_t get_frame_duration() const { return this->frame_duration_ms_; }
+  // Format of the stream's payload
+  const AudioFormat &get_format() const { return this->format_; }
+  AudioConsumer *get_consumer() const { return this->consumer_; }
+  uint32_t get_sent() const { return this->sent_.load(); }
+  // Packets that failed to send; blocks dropped before packetizing are
+  // counted by the bus consumer
+  uint32_t get_send_errors() const { return this->send_errors_.load(); }
+
+ protected:
+  static constexpr size_t RTP_HEADER_SIZE = 12;
+  static constexpr size_t EXTENSION_SIZE = 16;  // 4-byte header, 9-byte element, padding
+  static constexpr size_t MAX_FRAME_BYTES = 20 * 64;  // 20 ms at up to 64 kB/s
+  static constexpr size_t PACKET_HEADER_SIZE = RTP_HEADER_SIZE + EXTENSION_SIZE;
+  // 8 blocks of 1 KiB: 128 ms of audio at 64 kB/s
+  static constexpr uint8_t BUS_DEPTH = 8;
+  static constexpr uint32_t TASK_STACK_SIZE = 4096;
+  // Above the upload task: a late packet is a lost packet
+  static constexpr UBaseType_t TASK_PRIORITY = 3;
+
+  // Stream format and resampler for capture_; false if they cannot be set up
+  bool configure_();
+  // Payload bytes of one packet at `rate`
+  uint32_t frame_bytes_at_(uint32_t rate) const;
+  void restart_();
+  void add_block_(const AudioBlock *block);
+  void start_packet_(int64_t capture_us);
+  void send_packet_();
+  static void send_task(void *param);
+
+  std::string host_;
+  uint16_t port_{0};
+  uint32_t frame_duration_ms_{20};
+  uint32_t sample_rate_{0};
+  AudioFormat format_{16000, 2, 16};
+  size_t block_size_{0};
+  // Capture rate of the current recording, handed from begin() to the task
+  std::atomic<uint32_t> capture_rate_{0};
+  uint16_t capture_block_align_{4};
+  // Bytes per frame of the stream, set before the task starts
+  uint16_t packet_align_{4};
+  uint32_t frame_bytes_{0};
+  uint16_t block_align_{4};
+  uint32_t byte_rate_{0};
+  AudioConsumer *consumer_{nullptr};
+  TaskHandle_t task_handle_{nullptr};
+  // Bumped by begin(); the task starts a new stream when it changes
+  std::atomic<uint32_t> generation_{0};
+  std::atomic<bool> streaming_{false};
+
+  // Owned by the task after setup
+  AudioFormat capture_{16000, 2, 16};
+  bool configured_{false};
+  bool resampling_{false};
+  Resampler resampler_;
+  buffer_pool::BlockPool resample_pool_{"rtp_resample", buffer_pool::REGION_INTERNAL_DMA};
+  uint8_t *resample_buffer_{nullptr};
+  uint8_t packet_[PACKET_HEADER_SIZE + MAX_FRAME_BYTES];
+  uint32_t fill_{0};
+  uint16_t sequence_{0};
+  uint32_t timestamp_{0};
+  uint32_t ssrc_{0};
+  bool marker_{false};
+  uint32_t next_block_{0};
+  bool has_block_{false};
+  int sock_{-1};
+  struct sockaddr_in target_ {};
+
+  std::atomic<uint32_t> sent_{0};
+  std::atomic<uint32_t> send_errors_{0};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <cstdint>
+
+namespace esphome {
+namespace medallion_voice {
+
+// Bulk reads (uploads, downloads) take the card in pieces this size, which
+// bounds how long the SD lock is held against the recorder
+static const uint32_t SD_READ_PIECE_SIZE = 4096;
+
+// Scoped SD card access. SdFat shares one block cache per volume, so the
+// main loop and the upload task must not interleave any SD operations, even
+// on different files. A null mutex makes the lock a no-op.
+class SdLock {
+ public:
+  explicit SdLock(SemaphoreHandle_t mutex) : mutex_(mutex) {
+    if (this->mutex_ != nullptr) xSemaphoreTake(this->mutex_, portMAX_DELAY);
+  }
+  ~SdLock() {
+    if (this->mutex_ != nullptr) xSemaphoreGive(this->mutex_);
+  }
+  SdLock(const SdLock &) = delete;
+  SdLock &operator=(const SdLock &) = delete;
+
+ protected:
+  SemaphoreHandle_t mutex_;
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
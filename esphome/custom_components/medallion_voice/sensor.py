@@ -0,0 +1,126 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_DECIBEL,
+)
+from . import MedallionVoiceComponent, CONF_MEDALLION_VOICE_ID
+
+DEPENDENCIES = ["medallion_voice"]
+
+CONF_DROPPED_BYTES = "dropped_bytes"
+CONF_I2S_OVERFLOWS = "i2s_overflows"
+CONF_SHORT_WRITES = "short_writes"
+CONF_SD_WRITE_LATENCY_P99 = "sd_write_latency_p99"
+CONF_SD_WRITE_LATENCY_MAX = "sd_write_latency_max"
+CONF_STORAGE_FREE = "storage_free"
+CONF_EVICTIONS = "evictions"
+CONF_AGC_GAIN = "agc_gain"
+CONF_FRONTEND_CYCLES_P99 = "frontend_cycles_p99"
+
+UNIT_MICROSECOND = "µs"
+
+_LATENCY_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MICROSECOND,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    icon="mdi:timer-outline",
+)
+
+_COUNTER_SCHEMA = sensor.sensor_schema(
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    icon="mdi:alert-circle-outline",
+)
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_MEDALLION_VOICE_ID): cv.use_id(MedallionVoiceComponent),
+        cv.Optional(CONF_DROPPED_BYTES): sensor.sensor_schema(
+            unit_of_measurement=UNIT_BYTES,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:waveform",
+        ),
+        cv.Optional(CONF_I2S_OVERFLOWS): _COUNTER_SCHEMA,
+        cv.Optional(CONF_SHORT_WRITES): _COUNTER_SCHEMA,
+        cv.Optional(CONF_SD_WRITE_LATENCY_P99): _LATENCY_SCHEMA,
+        cv.Optional(CONF_SD_WRITE_LATENCY_MAX): _LATENCY_SCHEMA,
+        # Only published with audio_processing
+        cv.Optional(CONF_AGC_GAIN): sensor.sensor_schema(
+            unit_of_measurement=UNIT_DECIBEL,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:tune-vertical",
+        ),
+        # CPU cycles per captured block
+        cv.Optional(CONF_FRONTEND_CYCLES_P99): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:chip",
+        ),
+        # Only published with storage_slots
+        cv.Optional(CONF_STORAGE_FREE): sensor.sensor_schema(
+            unit_of_measurement=UNIT_BYTES,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:sd",
+        ),
+        cv.Optional(CONF_EVICTIONS): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:delete-clock-outline",
+        ),
+    }
+)
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_MEDALLION_VOICE_ID])
+
+    if CONF_DROPPED_BYTES in config:
+        sens = await sensor.new_sensor(config[CONF_DROPPED_BYTES])
+        cg.add(parent.set_dropped_bytes_sensor(sens))
+
+    if CONF_I2S_OVERFLOWS in config:
+        sens = await sensor.new_sensor(config[CONF_I2S_OVERFLOWS])
+        cg.add(parent.set_i2s_overflows_sensor(sens))
+
+    if CONF_SHORT_WRITES in config:
+        sens = await sensor.new_sensor(config[CONF_SHORT_WRITES])
+        cg.add(parent.set_short_writes_sensor(sens))
+
+    if CONF_SD_WRITE_LATENCY_P99 in config:
+        sens = await sensor.new_sensor(config[CONF_SD_WRITE_LATENCY_P99])
+        cg.add(parent.set_sd_write_latency_p99_sensor(sens))
+
+    if CONF_SD_WRITE_LATENCY_MAX in config:
+        sens = await sensor.new_sensor(config[CONF_SD_WRITE_LATENCY_MAX])
+        cg.add(parent.set_sd_write_latency_max_sensor(sens))
+
+    if CONF_AGC_GAIN in config:
+        sens = await sensor.new_sensor(config[CONF_AGC_GAIN])
+        cg.add(parent.set_agc_gain_sensor(sens))
+
+    if CONF_FRONTEND_CYCLES_P99 in config:
+        sens = await sensor.new_sensor(config[CONF_FRONTEND_CYCLES_P99])
+        cg.add(parent.set_frontend_cycles_p99_sensor(sens))
+
+    if CONF_STORAGE_FREE in config:
+        sens = await sensor.new_sensor(config[CONF_STORAGE_FREE])
+        cg.add(parent.set_storage_free_sensor(sens))
+
+    if CONF_EVICTIONS in config:
+        sens = await sensor.new_sensor(config[CONF_EVICTIONS])
+        cg.add(parent.set_evictions_sensor(sens))
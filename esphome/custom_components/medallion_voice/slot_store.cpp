@@ -0,0 +1,252 @@
+#include "slot_store.h"
+#include "wav_format.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.slots";
+
+static const char *const SLOT_DIR = "slots";
+static const char *const SLOT_TABLE_FILE = "slots/slots.bin";
+
+static const char SLOT_TABLE_MAGIC[4] = {'M', 'V', 'S', 'L'};
+static const uint16_t SLOT_TABLE_VERSION = 1;
+
+struct SlotTableHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t slot_count;
+  uint32_t slot_size;
+  uint32_t evictions;
+  uint32_t next_sequence;
+};
+
+void SlotStore::slot_path(uint16_t index, char *out, size_t size) {
+  snprintf(out, size, "/%s/slot_%03u.wav", SLOT_DIR, index);
+}
+
+uint32_t SlotStore::get_capacity() const {
+  return this->slot_size_ > WAV_HEADER_SIZE ? this->slot_size_ - WAV_HEADER_SIZE : 0;
+}
+
+bool SlotStore::setup(SdFs *sd, SemaphoreHandle_t sd_mutex) {
+  this->sd_ = sd;
+  this->sd_mutex_ = sd_mutex;
+  if (this->slot_count_ == 0) return false;
+
+  uint32_t start = millis();
+  SdLock lock(this->sd_mutex_);
+  if (!this->sd_->exists(SLOT_DIR) && !this->sd_->mkdir(SLOT_DIR)) {
+    ESP_LOGE(TAG, "Failed to create /%s", SLOT_DIR);
+    return false;
+  }
+
+  // Without a matching table the slots' contents are unknown, so all of
+  // them are recreated
+  bool loaded = this->load_table_();
+  if (!loaded) {
+    this->slots_.assign(this->slot_count_, SlotEntry{});
+  }
+
+  unsigned created = 0;
+  for (uint16_t i = 0; i < this->slot_count_; i++) {
+    char path[32];
+    slot_path(i, path, sizeof(path));
+    if (loaded && this->sd_->exists(path + 1)) continue;
+    this->slots_[i] = SlotEntry{};
+    if (!this->create_slot_(i)) return false;
+    created++;
+  }
+  // Left over from a larger pool
+  for (uint16_t i = this->slot_count_;; i++) {
+    char path[32];
+    slot_path(i, path, sizeof(path));
+    if (!this->sd_->exists(path + 1)) break;
+    this->sd_->remove(path + 1);
+  }
+
+  this->save_table_();
+  this->count_free_();
+  this->ready_ = true;
+  ESP_LOGI(TAG, "%u slots of %" PRIu32 " bytes, %" PRIu32 " free; created %u in %" PRIu32 " ms", this->slot_count_,
+           this->slot_size_, this->free_slots_.load(), created, millis() - start);
+  return true;
+}
+
+bool SlotStore::load_table_() {
+  FsFile file = this->sd_->open(SLOT_TABLE_FILE, O_RDONLY);
+  if (!file) return false;
+
+  SlotTableHeader header;
+  bool ok = file.read(&header, sizeof(header)) == (int) sizeof(header) &&
+            memcmp(header.magic, SLOT_TABLE_MAGIC, sizeof(SLOT_TABLE_MAGIC)) == 0 &&
+            header.version == SLOT_TABLE_VERSION && header.slot_size == this->slot_size_;
+  if (!ok) {
+    file.close();
+    ESP_LOGW(TAG, "Slot size or table format changed, recreating slots");
+    return false;
+  }
+
+  // A changed slot count keeps the slots both pools have
+  this->slots_.assign(this->slot_count_, SlotEntry{});
+  uint16_t keep = std::min(header.slot_count, this->slot_count_);
+  ok = file.read(this->slots_.data(), keep * sizeof(SlotEntry)) == (int) (keep * sizeof(SlotEntry));
+  file.close();
+  if (!ok) {
+    ESP_LOGW(TAG, "Slot table truncated, recreating slots");
+    return false;
+  }
+  this->evictions_.store(header.evictions);
+  this->next_sequence_ = header.next_sequence;
+  return true;
+}
+
+bool SlotStore::create_slot_(uint16_t index) {
+  char path[32];
+  slot_path(index, path, sizeof(path));
+  if (this->sd_->exists(path + 1)) this->sd_->remove(path + 1);
+
+  // One contiguous run of clusters, allocated now rather than while recording
+  FsFile file = this->sd_->open(path + 1, O_RDWR | O_CREAT | O_TRUNC);
+  if (!file) {
+    ESP_LOGE(TAG, "Failed to create %s", path);
+    return false;
+  }
+  bool ok = file.preAllocate(this->slot_size_);
+  file.close();
+  if (!ok) {
+    ESP_LOGE(TAG, "No contiguous space for %s (%" PRIu32 " bytes)", path, this->slot_size_);
+    this->sd_->remove(path + 1);
+    return false;
+  }
+  return true;
+}
+
+void SlotStore::save_table_() {
+  // Same size every time, so this rewrites the file in place
+  FsFile file = this->sd_->open(SLOT_TABLE_FILE, O_RDWR | O_CREAT);
+  if (!file) {
+    ESP_LOGW(TAG, "Failed to save slot table");
+    return;
+  }
+  SlotTableHeader header{};
+  memcpy(header.magic, SLOT_TABLE_MAGIC, sizeof(SLOT_TABLE_MAGIC));
+  header.version = SLOT_TABLE_VERSION;
+  header.slot_count = this->slot_count_;
+  header.slot_size = this->slot_size_;
+  header.evictions = this->evictions_.load();
+  header.next_sequence = this->next_sequence_;
+  file.seekSet(0);
+  file.write(&header, sizeof(header));
+  file.write(this->slots_.data(), this->slots_.size() * sizeof(SlotEntry));
+  file.close();
+}
+
+int SlotStore::reuse_rank_(const SlotEntry &slot) {
+  if (slot.key == 0) return 3;
+  switch (static_cast<RecordingState>(slot.state)) {
+    case RecordingState::UPLOADED:
+      return 2;
+    case RecordingState::UPLOAD_FAILED:
+      // Retrying will not get it uploaded; without this a pool of rejected
+      // recordings would stop recording for good
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+void SlotStore::count_free_() {
+  uint32_t free_slots = 0;
+  for (const SlotEntry &slot : this->slots_) {
+    if (reuse_rank_(slot) > 0) free_slots++;
+  }
+  this->free_slots_.store(free_slots);
+}
+
+int SlotStore::find_slot_(const char *name) {
+  uint16_t session, segment;
+  if (!RecordingCatalog::parse_name(name, &session, &segment)) return -1;
+  uint32_t key = ((uint32_t) session << 16) | segment;
+  for (size_t i = 0; i < this->slots_.size(); i++) {
+    if (this->slots_[i].key == key) return i;
+  }
+  return -1;
+}
+
+bool SlotStore::acquire(const char *name, std::string &path, std::string &evicted) {
+  uint16_t session, segment;
+  if (!this->ready_ || !RecordingCatalog::parse_name(name, &session, &segment)) return false;
+
+  SdLock lock(this->sd_mutex_);
+  // A recording of the same name (numbering restarted without a catalog) is
+  // being overwritten anyway
+  int same = this->find_slot_(name);
+  if (same >= 0) this->slots_[same] = SlotEntry{};
+
+  // An empty slot, else the one uploaded longest ago, else the one rejected
+  // longest ago
+  int best = -1;
+  int best_rank = 0;
+  for (size_t i = 0; i < this->slots_.size(); i++) {
+    const SlotEntry &slot = this->slots_[i];
+    int rank = reuse_rank_(slot);
+    if (rank > best_rank || (rank > 0 && rank == best_rank && slot.sequence < this->slots_[best].sequence)) {
+      best = i;
+      best_rank = rank;
+    }
+  }
+  if (best < 0) return false;
+
+  SlotEntry &slot = this->slots_[best];
+  evicted.clear();
+  if (slot.key != 0) {
+    char old[32];
+    RecordingCatalog::format_name(slot.key >> 16, slot.key & 0xFFFF, old, sizeof(old));
+    evicted = old;
+    this->evictions_++;
+  }
+  slot.key = ((uint32_t) session << 16) | segment;
+  slot.sequence = this->next_sequence_++;
+  slot.state = static_cast<uint8_t>(RecordingState::RECORDING);
+  this->save_table_();
+  this->count_free_();
+
+  char slot_file[32];
+  slot_path(best, slot_file, sizeof(slot_file));
+  path = slot_file;
+  return true;
+}
+
+void SlotStore::set_state(const char *name, RecordingState state) {
+  if (!this->ready_) return;
+  SdLock lock(this->sd_mutex_);
+  int index = this->find_slot_(name);
+  if (index < 0) return;
+  SlotEntry &slot = this->slots_[index];
+  slot.state = static_cast<uint8_t>(state);
+  // Evicted in the order their uploads ended
+  if (state == RecordingState::UPLOADED || state == RecordingState::UPLOAD_FAILED)
+    slot.sequence = this->next_sequence_++;
+  this->save_table_();
+  this->count_free_();
+}
+
+bool SlotStore::find(const char *name, std::string &path) {
+  if (!this->ready_) return false;
+  SdLock lock(this->sd_mutex_);
+  int index = this->find_slot_(name);
+  if (index < 0) return false;
+  char slot_file[32];
+  slot_path(index, slot_file, sizeof(slot_file));
+  path = slot_file;
+  return true;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "catalog.h"
+#include "sd_lock.h"
+#include <SdFat.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace medallion_voice {
+
+// Fixed pool of preallocated, contiguous recording files
+// ("/slots/slot_000.wav", ...).
+//
+// Slot files are allocated once and never truncated, so recording into one
+// allocates no clusters and never walks or extends a FAT chain; the WAV
+// header carries the real length. A new recording takes a slot that is
+// empty, else the one whose recording was uploaded longest ago, else the
+// one whose upload the server rejected longest ago (that recording is
+// evicted). Recordings still waiting for their upload are never evicted:
+// with every slot holding one, acquire() fails. Which recording is in which
+// slot is kept in "/slots/slots.bin", rewritten in place on every change.
+class SlotStore {
+ public:
+  void set_slot_count(uint16_t count) { this->slot_count_ = count; }
+  void set_slot_size(uint32_t size) { this->slot_size_ = size; }
+  bool is_enabled() const { return this->slot_count_ > 0 && this->ready_; }
+
+  // Load the slot table and create missing slot files. All SD access is done
+  // under `sd_mutex` (may be null).
+  bool setup(SdFs *sd, SemaphoreHandle_t sd_mutex);
+
+  // Take a slot for recording `name`. On success `path` is the slot file and
+  // `evicted` the recording it held before, or empty.
+  bool acquire(const char *name, std::string &path, std::string &evicted);
+  void set_state(const char *name, RecordingState state);
+  // Slot file holding recording `name`, or false if it is not in a slot
+  bool find(const char *name, std::string &path);
+
+  // Audio bytes one slot can hold
+  uint32_t get_capacity() const;
+  uint16_t get_slot_count() const { return this->slot_count_; }
+  uint32_t get_slot_size() const { return this->slot_size_; }
+  // Bytes available to new recordings: empty slots, uploaded ones and ones
+  // the server rejected
+  uint64_t get_free_bytes() const { return (uint64_t) this->free_slots_.load() * this->get_capacity(); }
+  uint32_t get_evictions() const { return this->evictions_.load(); }
+
+ protected:
+  struct SlotEntry {
+    uint32_t key;       // CatalogRecord::key() of the recording, 0 if empty
+    // Acquire order, then upload order once uploaded or rejected: the
+    // oldest of those is evicted first
+    uint32_t sequence;
+    uint8_t state;      // RecordingState
+    uint8_t reserved[3];
+  };
+
+  bool load_table_();
+  bool create_slot_(uint16_t index);
+  void save_table_();
+  void count_free_();
+  // 0: in use, else higher for a better slot to record into
+  static int reuse_rank_(const SlotEntry &slot);
+  int find_slot_(const char *name);
+  static void slot_path(uint16_t index, char *out, size_t size);
+
+  SdFs *sd_{nullptr};
+  SemaphoreHandle_t sd_mutex_{nullptr};
+  uint16_t slot_count_{0};
+  uint32_t slot_size_{0};
+  bool ready_{false};
+  std::vector<SlotEntry> slots_;
+  uint32_t next_sequence_{1};
+  // Read by the main loop for the sensors, updated by either task
+  std::atomic<uint32_t> free_slots_{0};
+  std::atomic<uint32_t> evictions_{0};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
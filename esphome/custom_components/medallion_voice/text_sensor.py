@@ -0,0 +1,25 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import text_sensor
+from esphome.const import CONF_STATUS
+from . import MedallionVoiceComponent, CONF_MEDALLION_VOICE_ID
+
+DEPENDENCIES = ["medallion_voice"]
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_MEDALLION_VOICE_ID): cv.use_id(MedallionVoiceComponent),
+        # Published on every state change
+        cv.Optional(CONF_STATUS): text_sensor.text_sensor_schema(
+            icon="mdi:list-status",
+        ),
+    }
+)
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_MEDALLION_VOICE_ID])
+
+    if CONF_STATUS in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_STATUS])
+        cg.add(parent.set_status_text_sensor(sens))
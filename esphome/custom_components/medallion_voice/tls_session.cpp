@@ -0,0 +1,250 @@
+#include "tls_session.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <mbedtls/error.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl_ciphersuites.h>
+#include <sdkconfig.h>
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static const char *const TAG = "medallion_voice.tls";
+
+// AES suites only: they run on the AES/SHA peripherals, unlike ChaCha20
+static const int CIPHERSUITES[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256,
+    0,
+};
+
+TlsSession::TlsSession() {
+  mbedtls_ssl_session_init(&this->session_);
+}
+
+TlsSession::~TlsSession() {
+  this->close();
+  mbedtls_ssl_session_free(&this->session_);
+  this->free_config_();
+}
+
+void TlsSession::free_config_() {
+  if (!this->config_ready_) return;
+  mbedtls_ssl_config_free(&this->conf_);
+  mbedtls_x509_crt_free(&this->ca_);
+  mbedtls_ctr_drbg_free(&this->ctr_drbg_);
+  mbedtls_entropy_free(&this->entropy_);
+  this->config_ready_ = false;
+}
+
+const char *TlsSession::crypto_backend() {
+#if defined(CONFIG_MBEDTLS_HARDWARE_AES) && defined(CONFIG_MBEDTLS_HARDWARE_SHA)
+  return "hardware AES/SHA";
+#else
+  return "software";
+#endif
+}
+
+bool TlsSession::init_config_() {
+  mbedtls_entropy_init(&this->entropy_);
+  mbedtls_ctr_drbg_init(&this->ctr_drbg_);
+  mbedtls_x509_crt_init(&this->ca_);
+  mbedtls_ssl_config_init(&this->conf_);
+  this->config_ready_ = true;
+
+  static const char PERSONALIZATION[] = "medallion_voice";
+  int ret = mbedtls_ctr_drbg_seed(&this->ctr_drbg_, mbedtls_entropy_func, &this->entropy_,
+                                  (const unsigned char *) PERSONALIZATION, sizeof(PERSONALIZATION) - 1);
+  if (ret == 0) {
+    ret = mbedtls_ssl_config_defaults(&this->conf_, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+  }
+  if (ret != 0) {
+    ESP_LOGE(TAG, "TLS setup failed: -0x%04x", -ret);
+    return false;
+  }
+
+  // TLS 1.2 resumption (session ID or RFC 5077 ticket) completes within the
+  // handshake itself, so the cached session is usable right away
+  mbedtls_ssl_conf_min_tls_version(&this->conf_, MBEDTLS_SSL_VERSION_TLS1_2);
+  mbedtls_ssl_conf_max_tls_version(&this->conf_, MBEDTLS_SSL_VERSION_TLS1_2);
+  mbedtls_ssl_conf_ciphersuites(&this->conf_, CIPHERSUITES);
+  mbedtls_ssl_conf_rng(&this->conf_, mbedtls_ctr_drbg_random, &this->ctr_drbg_);
+#ifdef MBEDTLS_SSL_SESSION_TICKETS
+  mbedtls_ssl_conf_session_tickets(&this->conf_, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+  if (this->ca_pem_ != nullptr) {
+    // PEM parsing needs the terminating NUL in the length
+    ret = mbedtls_x509_crt_parse(&this->ca_, (const unsigned char *) this->ca_pem_, strlen(this->ca_pem_) + 1);
+    if (ret != 0) {
+      ESP_LOGE(TAG, "Invalid CA certificate: -0x%04x", -ret);
+      return false;
+    }
+    mbedtls_ssl_conf_ca_chain(&this->conf_, &this->ca_, nullptr);
+    mbedtls_ssl_conf_authmode(&this->conf_, MBEDTLS_SSL_VERIFY_REQUIRED);
+  } else {
+    ESP_LOGW(TAG, "No CA certificate configured, server identity is not verified");
+    mbedtls_ssl_conf_authmode(&this->conf_, MBEDTLS_SSL_VERIFY_NONE);
+  }
+  return true;
+}
+
+bool TlsSession::handshake(WiFiClient *socket, const std::string &host, uint32_t timeout_ms) {
+  this->close();
+  if (!this->config_ready_ && !this->init_config_()) {
+    // Start over on the next attempt
+    this->free_config_();
+    return false;
+  }
+
+  this->socket_ = socket;
+  this->timeout_ms_ = timeout_ms;
+  mbedtls_ssl_init(&this->ssl_);
+  this->ssl_ready_ = true;
+
+  int ret = mbedtls_ssl_setup(&this->ssl_, &this->conf_);
+  if (ret == 0) ret = mbedtls_ssl_set_hostname(&this->ssl_, host.c_str());
+  if (ret != 0) {
+    ESP_LOGE(TAG, "TLS setup failed: -0x%04x", -ret);
+    this->close();
+    return false;
+  }
+  mbedtls_ssl_set_bio(&this->ssl_, this, TlsSession::bio_send_, TlsSession::bio_recv_, nullptr);
+
+  // Remember the offered session ID: the server echoes it when it accepts
+  // the session (or ticket) and picks a new one for a full handshake
+  unsigned char offered_id[32];
+  size_t offered_len = 0;
+  if (this->has_session_) {
+    offered_len = mbedtls_ssl_session_get_id_len(&this->session_);
+    if (offered_len > sizeof(offered_id)) offered_len = 0;
+    memcpy(offered_id, mbedtls_ssl_session_get_id(&this->session_), offered_len);
+    if (mbedtls_ssl_set_session(&this->ssl_, &this->session_) != 0) {
+      this->forget_session();
+      offered_len = 0;
+    }
+  }
+
+  uint32_t start = millis();
+  while ((ret = mbedtls_ssl_handshake(&this->ssl_)) != 0) {
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      char error[80];
+      mbedtls_strerror(ret, error, sizeof(error));
+      ESP_LOGE(TAG, "TLS handshake with %s failed: -0x%04x %s", host.c_str(), -ret, error);
+      this->forget_session();
+      this->close();
+      return false;
+    }
+    if (millis() - start > timeout_ms) {
+      ESP_LOGE(TAG, "TLS handshake with %s timed out", host.c_str());
+      this->close();
+      return false;
+    }
+    delay(1);
+  }
+  uint32_t elapsed = millis() - start;
+  this->open_ = true;
+  this->handshake_count_++;
+
+  this->cache_session_();
+  bool resumed = offered_len > 0 && this->has_session_ &&
+                 mbedtls_ssl_session_get_id_len(&this->session_) == offered_len &&
+                 memcmp(mbedtls_ssl_session_get_id(&this->session_), offered_id, offered_len) == 0;
+  if (resumed) this->resumed_count_++;
+
+  ESP_LOGI(TAG, "TLS handshake with %s: %u ms, %s, %s", host.c_str(), (unsigned) elapsed,
+           resumed ? "resumed" : "full", mbedtls_ssl_get_ciphersuite(&this->ssl_));
+  return true;
+}
+
+void TlsSession::cache_session_() {
+  // A session can only be exported once per connection, so do it right
+  // after the handshake while it is known to be good
+  mbedtls_ssl_session_free(&this->session_);
+  mbedtls_ssl_session_init(&this->session_);
+  this->has_session_ = mbedtls_ssl_get_session(&this->ssl_, &this->session_) == 0;
+}
+
+void TlsSession::forget_session() {
+  mbedtls_ssl_session_free(&this->session_);
+  mbedtls_ssl_session_init(&this->session_);
+  this->has_session_ = false;
+}
+
+void TlsSession::close() {
+  if (this->open_) {
+    // Best effort; the TCP connection is closed right after
+    mbedtls_ssl_close_notify(&this->ssl_);
+    this->open_ = false;
+  }
+  if (this->ssl_ready_) {
+    mbedtls_ssl_free(&this->ssl_);
+    this->ssl_ready_ = false;
+  }
+}
+
+int TlsSession::read(uint8_t *buf, size_t length) {
+  if (!this->open_) return -1;
+  int ret = mbedtls_ssl_read(&this->ssl_, buf, length);
+  if (ret > 0) return ret;
+  if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) return 0;
+
+  if (ret != 0 && ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY && ret != MBEDTLS_ERR_SSL_CONN_EOF) {
+    ESP_LOGW(TAG, "TLS read failed: -0x%04x", -ret);
+  }
+  this->open_ = false;
+  return -1;
+}
+
+int TlsSession::available() {
+  if (!this->open_) return 0;
+  return mbedtls_ssl_get_bytes_avail(&this->ssl_) + this->socket_->available();
+}
+
+bool TlsSession::write(const uint8_t *data, size_t length) {
+  if (!this->open_) return false;
+  uint32_t start = millis();
+  while (length > 0) {
+    int ret = mbedtls_ssl_write(&this->ssl_, data, length);
+    if (ret > 0) {
+      data += ret;
+      length -= ret;
+      start = millis();
+      continue;
+    }
+    if ((ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_WANT_READ) ||
+        millis() - start > this->timeout_ms_) {
+      ESP_LOGW(TAG, "TLS write failed: -0x%04x", -ret);
+      this->open_ = false;
+      return false;
+    }
+    delay(1);
+  }
+  return true;
+}
+
+int TlsSession::bio_send_(void *ctx, const unsigned char *buf, size_t len) {
+  WiFiClient *socket = static_cast<TlsSession *>(ctx)->socket_;
+  size_t n = socket->write(buf, len);
+  if (n > 0) return n;
+  return socket->connected() ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_CONN_RESET;
+}
+
+int TlsSession::bio_recv_(void *ctx, unsigned char *buf, size_t len) {
+  WiFiClient *socket = static_cast<TlsSession *>(ctx)->socket_;
+  int available = socket->available();
+  if (available <= 0) {
+    // 0 tells mbedTLS the peer closed the connection
+    return socket->connected() ? MBEDTLS_ERR_SSL_WANT_READ : 0;
+  }
+  int n = socket->read(buf, len < (size_t) available ? len : (size_t) available);
+  return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <WiFi.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+#include <string>
+
+namespace esphome {
+namespace medallion_voice {
+
+// mbedTLS client session over an already connected WiFiClient.
+//
+// The negotiated session (ID or ticket) is cached when a connection closes
+// and offered on the next handshake, so reconnecting to the same server
+// costs an abbreviated handshake instead of a full ECDHE + certificate
+// verification. Cipher suites are limited to AES-GCM/AES-CBC, which the
+// ESP32-S3 runs on its AES and SHA accelerators.
+class TlsSession {
+ public:
+  TlsSession();
+  ~TlsSession();
+  TlsSession(const TlsSession &) = delete;
+  TlsSession &operator=(const TlsSession &) = delete;
+
+  // PEM CA certificate used to verify the server; without one the server is
+  // not authenticated (the traffic is still encrypted)
+  void set_ca_certificate(const char *pem) { this->ca_pem_ = pem; }
+
+  bool handshake(WiFiClient *socket, const std::string &host, uint32_t timeout_ms);
+  bool is_open() const { return this->open_; }
+  // Returns bytes read, 0 if no data is available yet, or -1 once the
+  // connection is closed or failed
+  int read(uint8_t *buf, size_t length);
+  // Nonzero if decrypted or raw bytes are waiting to be read
+  int available();
+  bool write(const uint8_t *data, size_t length);
+  // Send close_notify and release the connection state; the session stays
+  // cached for resumption
+  void close();
+  // Drop the cached session, e.g. when switching servers
+  void forget_session();
+
+  // "hardware AES/SHA" when mbedTLS is built with the crypto accelerators
+  static const char *crypto_backend();
+
+  uint32_t get_handshake_count() const { return this->handshake_count_; }
+  uint32_t get_resumed_count() const { return this->resumed_count_; }
+
+ protected:
+  bool init_config_();
+  void free_config_();
+  void cache_session_();
+
+  static int bio_send_(void *ctx, const unsigned char *buf, size_t len);
+  static int bio_recv_(void *ctx, unsigned char *buf, size_t len);
+
+  const char *ca_pem_{nullptr};
+  bool config_ready_{false};
+  mbedtls_entropy_context entropy_;
+  mbedtls_ctr_drbg_context ctr_drbg_;
+  mbedtls_x509_crt ca_;
+  mbedtls_ssl_config conf_;
+
+  mbedtls_ssl_context ssl_;
+  bool ssl_ready_{false};
+  WiFiClient *socket_{nullptr};
+  uint32_t timeout_ms_{0};
+  bool open_{false};
+
+  mbedtls_ssl_session session_;
+  bool has_session_{false};
+
+  uint32_t handshake_count_{0};
+  uint32_t resumed_count_{0};
+};
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,62 @@
+#include "wav_format.h"
+#include <cstring>
+
+namespace esphome {
+namespace medallion_voice {
+
+static uint32_t get_le32(const uint8_t *p) {
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put_le16(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+  p[2] = (v >> 16) & 0xFF;
+  p[3] = (v >> 24) & 0xFF;
+}
+
+void build_wav_header(uint8_t *out, const AudioFormat &format, uint32_t data_length) {
+  // RIFF header
+  memcpy(out + 0, "RIFF", 4);
+  put_le32(out + 4, 36 + data_length);
+  memcpy(out + 8, "WAVE", 4);
+
+  // fmt subchunk
+  memcpy(out + 12, "fmt ", 4);
+  put_le32(out + 16, 16);
+  put_le16(out + 20, 1);  // PCM
+  put_le16(out + 22, format.channels);
+  put_le32(out + 24, format.sample_rate);
+  put_le32(out + 28, format.byte_rate());
+  put_le16(out + 32, format.block_align());
+  put_le16(out + 34, format.bits_per_sample);
+
+  // data subchunk
+  memcpy(out + 36, "data", 4);
+  put_le32(out + 40, data_length);
+}
+
+bool parse_wav_data_length(const uint8_t *header, uint32_t *data_length) {
+  if (memcmp(header + 0, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0 ||
+      memcmp(header + 36, "data", 4) != 0)
+    return false;
+  uint32_t length = get_le32(header + 40);
+  if (get_le32(header + 4) != 36 + length) return false;
+  *data_length = length;
+  return true;
+}
+
+uint32_t wav_data_length_for_size(const AudioFormat &format, uint64_t file_size) {
+  if (file_size <= WAV_HEADER_SIZE) return 0;
+  uint64_t length = file_size - WAV_HEADER_SIZE;
+  if (length > UINT32_MAX - 36) length = UINT32_MAX - 36;
+  return length - length % format.block_align();
+}
+
+}  // namespace medallion_voice
+}  // namespace esphome
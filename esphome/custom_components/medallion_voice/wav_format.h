@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace medallion_voice {
+
+// PCM stream format of a recording sink
+struct AudioFormat {
+  uint32_t sample_rate;
+  uint16_t channels;
+  uint16_t bits_per_sample;
+
+  uint16_t block_align() const { return this->channels * (this->bits_per_sample / 8); }
+  uint32_t byte_rate() const { return this->sample_rate * this->block_align(); }
+};
+
+static constexpr size_t WAV_HEADER_SIZE = 44;
+
+// Fill a canonical 44-byte RIFF/WAVE header for `data_length` bytes of PCM.
+// Has no hardware dependencies so it can be built and checked on the host.
+void build_wav_header(uint8_t *out, const AudioFormat &format, uint32_t data_length);
+
+// Data length stored in a 44-byte header. Fails unless the RIFF and data
+// sizes agree, e.g. for the zeroed placeholder of an unfinished recording.
+bool parse_wav_data_length(const uint8_t *header, uint32_t *data_length);
+
+// Largest whole-frame data length that fits in a file of `file_size` bytes
+uint32_t wav_data_length_for_size(const AudioFormat &format, uint64_t file_size);
+
+}  // namespace medallion_voice
+}  // namespace esphome
@@ -0,0 +1,97 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome import automation
+from esphome.components import web_server_base
+from esphome.components.web_server_base import CONF_WEB_SERVER_BASE_ID
+from esphome.const import CONF_ID, CONF_PATH
+
+CODEOWNERS = ["@medallion"]
+AUTO_LOAD = ["sensor", "buffer_pool"]
+MULTI_CONF = False
+
+CONF_PERF_STATS_ID = "perf_stats_id"
+CONF_TRACE = "trace"
+CONF_EVENTS = "events"
+CONF_START_ON_BOOT = "start_on_boot"
+CONF_HTTP = "http"
+
+perf_stats_ns = cg.esphome_ns.namespace("perf_stats")
+PerfStatsComponent = perf_stats_ns.class_("PerfStatsComponent", cg.PollingComponent)
+
+# Actions
+DumpAction = perf_stats_ns.class_("DumpAction", automation.Action)
+TraceStartAction = perf_stats_ns.class_("TraceStartAction", automation.Action)
+TraceStopAction = perf_stats_ns.class_("TraceStopAction", automation.Action)
+
+
+def _validate_trace_path(value):
+    value = cv.string_strict(value)
+    if not value.startswith("/") or len(value) < 2:
+        raise cv.Invalid("Trace path must start with / and not be the root")
+    return value
+
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(PerfStatsComponent),
+        # Ring of begin/end/instant events from every component, in PSRAM
+        # (24 bytes per event), exported as Chrome trace JSON
+        cv.Optional(CONF_TRACE): cv.Schema(
+            {
+                cv.Optional(CONF_EVENTS, default=4096): cv.int_range(min=64, max=65536),
+                cv.Optional(CONF_START_ON_BOOT, default=True): cv.boolean,
+                # Download the trace from the web server
+                cv.Optional(CONF_HTTP): cv.Schema(
+                    {
+                        cv.GenerateID(CONF_WEB_SERVER_BASE_ID): cv.use_id(
+                            web_server_base.WebServerBase
+                        ),
+                        cv.Optional(CONF_PATH, default="/trace.json"): _validate_trace_path,
+                    }
+                ),
+            }
+        ),
+    }
+).extend(cv.polling_component_schema("60s"))
+
+DUMP_ACTION_SCHEMA = automation.maybe_simple_id(
+    {
+        cv.GenerateID(): cv.use_id(PerfStatsComponent),
+    }
+)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    if CONF_TRACE in config:
+        trace = config[CONF_TRACE]
+        cg.add_define("USE_PERF_STATS_TRACE")
+        cg.add(var.set_trace(trace[CONF_EVENTS], trace[CONF_START_ON_BOOT]))
+        if CONF_HTTP in trace:
+            http = trace[CONF_HTTP]
+            base = await cg.get_variable(http[CONF_WEB_SERVER_BASE_ID])
+            cg.add(var.set_trace_server(base, http[CONF_PATH]))
+            cg.add_define("USE_PERF_STATS_TRACE_HTTP")
+
+
+@automation.register_action("perf_stats.dump", DumpAction, DUMP_ACTION_SCHEMA)
+async def dump_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action("perf_stats.trace_start", TraceStartAction, DUMP_ACTION_SCHEMA)
+async def trace_start_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action("perf_stats.trace_stop", TraceStopAction, DUMP_ACTION_SCHEMA)
+async def trace_stop_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
@@ -0,0 +1,147 @@
+#include "event_trace.h"
+#include <atomic>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+namespace esphome {
+namespace perf_stats {
+
+#ifdef USE_PERF_STATS_TRACE
+std::atomic<EventTrace *> global_event_trace{nullptr};
+#endif
+
+// Tasks named in the trace's metadata; events of further tasks still show,
+// under their handle
+static const uint8_t MAX_NAMED_TASKS = 16;
+
+bool EventTrace::setup(uint8_t *buffer, size_t size) {
+  size_t count = size / sizeof(Slot);
+  if (buffer == nullptr || count == 0) return false;
+  // Largest power of two that fits, so a slot is the index masked
+  while ((count & (count - 1)) != 0) count &= count - 1;
+  this->slots_ = reinterpret_cast<Slot *>(buffer);
+  for (size_t i = 0; i < count; i++) {
+    new (&this->slots_[i]) Slot();
+  }
+  this->mask_ = count - 1;
+  this->head_.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+size_t EventTrace::buffer_size(uint32_t events) { return events * sizeof(Slot); }
+
+namespace {
+
+// Collects the JSON into a stack buffer and hands it on in pieces
+class JsonWriter {
+ public:
+  explicit JsonWriter(const std::function<bool(const char *, size_t)> &write) : write_(write) {}
+
+  bool printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+      va_list args;
+      va_start(args, format);
+      int length = vsnprintf(this->buffer_ + this->used_, sizeof(this->buffer_) - this->used_, format, args);
+      va_end(args);
+      if (length < 0) return false;
+      if (this->used_ + length < sizeof(this->buffer_)) {
+        this->used_ += length;
+        return true;
+      }
+      // Did not fit: send what is there and try again in the empty buffer
+      if (!this->flush()) return false;
+    }
+    return false;
+  }
+
+  bool flush() {
+    bool ok = this->used_ == 0 || this->write_(this->buffer_, this->used_);
+    this->used_ = 0;
+    return ok;
+  }
+
+ protected:
+  const std::function<bool(const char *, size_t)> &write_;
+  char buffer_[512];
+  size_t used_{0};
+};
+
+}  // namespace
+
+bool EventTrace::write_json(const std::function<bool(const char *, size_t)> &write) const {
+  JsonWriter out(write);
+  if (!out.printf("{\"traceEvents\":[")) return false;
+
+  TaskHandle_t tasks[MAX_NAMED_TASKS];
+  uint8_t task_count = 0;
+  bool first = true;
+  uint64_t epoch = 0;  // micros() wraps every 71 minutes
+  uint32_t last_timestamp = 0;
+
+  uint32_t head = this->get_recorded();
+  uint32_t count = head < this->get_capacity() ? head : this->get_capacity();
+  for (uint32_t index = head - count; index != head; index++) {
+    const Slot &slot = this->slots_[index & this->mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != index + 1) continue;
+    uint32_t timestamp = slot.timestamp;
+    const char *name = slot.name;
+    uint32_t arg = slot.arg;
+    TaskHandle_t task = slot.task;
+    uint8_t phase = slot.phase;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Overwritten while it was copied
+    if (slot.sequence.load(std::memory_order_relaxed) != index + 1) continue;
+
+    // Events are claimed in order but stamped a moment later, so a small
+    // step back is two tasks racing, not a wrap
+    if (timestamp < last_timestamp && last_timestamp - timestamp > UINT32_MAX / 2) epoch += 1ULL << 32;
+    last_timestamp = timestamp;
+
+    uint8_t known = 0;
+    while (known < task_count && tasks[known] != task) known++;
+    if (known == task_count && task_count < MAX_NAMED_TASKS) tasks[task_count++] = task;
+
+    // The category is the component: the name up to the first dot
+    const char *dot = strchr(name, '.');
+    int category_length = dot != nullptr ? dot - name : strlen(name);
+    bool ok = out.printf("%s\n{\"name\":\"%s\",\"cat\":\"%.*s\",\"ph\":\"%c\",\"ts\":%" PRIu64
+                         ",\"pid\":1,\"tid\":%" PRIu32,
+                         first ? "" : ",", name, category_length, name, phase, epoch + timestamp,
+                         (uint32_t) (uintptr_t) task);
+    first = false;
+    if (ok && phase == TRACE_INSTANT) {
+      ok = out.printf(",\"s\":\"t\",\"args\":{\"value\":%" PRIu32 "}", arg);
+    } else if (ok && (phase == TRACE_ASYNC_BEGIN || phase == TRACE_ASYNC_END)) {
+      ok = out.printf(",\"id\":%" PRIu32, arg);
+    }
+    if (!ok || !out.printf("}")) return false;
+  }
+
+  for (uint8_t i = 0; i < task_count; i++) {
+    // Copied with a bound and filtered: a task that has since been deleted
+    // leaves its name behind in freed memory
+    char name[configMAX_TASK_NAME_LEN + 1];
+    const char *source = pcTaskGetName(tasks[i]);
+    size_t length = 0;
+    while (length < configMAX_TASK_NAME_LEN && source[length] >= ' ' && source[length] <= '~' &&
+           source[length] != '"' && source[length] != '\\') {
+      name[length] = source[length];
+      length++;
+    }
+    name[length] = '\0';
+    if (!out.printf("%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32
+                    ",\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",", (uint32_t) (uintptr_t) tasks[i], length > 0 ? name : "?")) {
+      return false;
+    }
+    first = false;
+  }
+
+  return out.printf("\n],\"displayTimeUnit\":\"ms\"}\n") && out.flush();
+}
+
+}  // namespace perf_stats
+}  // namespace esphome
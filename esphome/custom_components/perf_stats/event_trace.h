@@ -0,0 +1,105 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace esphome {
+namespace perf_stats {
+
+// Event kinds, as Chrome trace event phases
+enum TracePhase : uint8_t {
+  TRACE_BEGIN = 'B',        // a span on the calling task...
+  TRACE_END = 'E',          // ...ended by the same task
+  TRACE_INSTANT = 'i',      // a point in time, with a value
+  TRACE_ASYNC_BEGIN = 'b',  // a span identified by name and id, which any task
+  TRACE_ASYNC_END = 'e',    // may end: a recording, an upload
+};
+
+// Timestamped events from every instrumented component in one ring, for
+// following one action across components: a touch to the first recorded
+// audio, a stop to the upload that follows. Recording is lock-free: a
+// writer claims a slot with one atomic increment and publishes it with a
+// per-slot sequence number, so any task may record and a reader skips
+// slots overwritten under it. When full, the oldest events are overwritten.
+class EventTrace {
+ public:
+  // Record into `buffer` of `size` bytes; the slot count is rounded down to
+  // a power of two
+  bool setup(uint8_t *buffer, size_t size);
+  // Bytes a ring of `events` events takes
+  static size_t buffer_size(uint32_t events);
+
+  void record(TracePhase phase, const char *name, uint32_t arg) {
+    uint32_t index = this->head_.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = this->slots_[index & this->mask_];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    slot.timestamp = micros();
+    slot.name = name;
+    slot.arg = arg;
+    slot.task = xTaskGetCurrentTaskHandle();
+    slot.phase = phase;
+    slot.sequence.store(index + 1, std::memory_order_release);
+  }
+
+  uint32_t get_capacity() const { return this->mask_ + 1; }
+  // Events recorded since setup, including those overwritten since
+  uint32_t get_recorded() const { return this->head_.load(std::memory_order_relaxed); }
+
+  // Write the events in the ring, oldest first, as Chrome trace JSON
+  // (chrome://tracing, ui.perfetto.dev) in pieces through `write`. Recording
+  // carries on meanwhile. False if `write` failed.
+  bool write_json(const std::function<bool(const char *, size_t)> &write) const;
+
+ protected:
+  struct Slot {
+    std::atomic<uint32_t> sequence;  // index + 1 once written, 0 while being written
+    uint32_t timestamp;              // micros()
+    const char *name;                // string literal, "<component>.<event>"
+    uint32_t arg;
+    TaskHandle_t task;
+    uint8_t phase;
+  };
+
+  Slot *slots_{nullptr};
+  uint32_t mask_{0};
+  std::atomic<uint32_t> head_{0};
+};
+
+#ifdef USE_PERF_STATS_TRACE
+// The ring being recorded into, nullptr while tracing is stopped
+extern std::atomic<EventTrace *> global_event_trace;
+
+inline void trace_event(TracePhase phase, const char *name, uint32_t arg) {
+  EventTrace *trace = global_event_trace.load(std::memory_order_relaxed);
+  if (trace != nullptr) trace->record(phase, name, arg);
+}
+#else
+// Without `trace:` in perf_stats every trace point compiles to nothing
+inline void trace_event(TracePhase phase, const char *name, uint32_t arg) {}
+#endif
+
+// `name` must be a string literal, "<component>.<event>"
+inline void trace_begin(const char *name) { trace_event(TRACE_BEGIN, name, 0); }
+inline void trace_end(const char *name) { trace_event(TRACE_END, name, 0); }
+inline void trace_instant(const char *name, uint32_t value = 0) { trace_event(TRACE_INSTANT, name, value); }
+inline void trace_async_begin(const char *name, uint32_t id) { trace_event(TRACE_ASYNC_BEGIN, name, id); }
+inline void trace_async_end(const char *name, uint32_t id) { trace_event(TRACE_ASYNC_END, name, id); }
+
+// Traces the lifetime of the scope as a span on the calling task
+class TraceScope {
+ public:
+  explicit TraceScope(const char *name) : name_(name) { trace_begin(name); }
+  ~TraceScope() { trace_end(this->name_); }
+
+ protected:
+  const char *name_;
+};
+
+}  // namespace perf_stats
+}  // namespace esphome
@@ -0,0 +1,116 @@
+#include "perf_stats.h"
+#include "trace_handler.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace perf_stats {
+
+static const char *const TAG = "perf_stats";
+
+void PerfStatsComponent::setup() {
+  // Histograms are registered by their owners' constructors, so all of them
+  // exist by the time we get here
+  for (auto &binding : this->sensors_) {
+    binding.histogram = find_histogram(binding.operation);
+    if (binding.histogram == nullptr) {
+      ESP_LOGW(TAG, "Unknown operation '%s'", binding.operation);
+    }
+  }
+
+  if (this->trace_events_ > 0) {
+    size_t size = EventTrace::buffer_size(this->trace_events_);
+    uint8_t *buffer = this->trace_pool_.reserve(size, 1) ? this->trace_pool_.acquire() : nullptr;
+    this->trace_ready_ = this->trace_.setup(buffer, size);
+    if (!this->trace_ready_) {
+      ESP_LOGE(TAG, "No memory for %u trace events", (unsigned) this->trace_events_);
+    } else if (this->trace_on_boot_) {
+      this->start_trace();
+    }
+  }
+#ifdef USE_PERF_STATS_TRACE_HTTP
+  if (this->web_server_base_ != nullptr && this->trace_ready_) {
+    this->web_server_base_->add_handler(new TraceHandler(this, this->trace_path_));
+  }
+#endif
+}
+
+void PerfStatsComponent::update() {
+  for (auto &binding : this->sensors_) {
+    if (binding.histogram == nullptr) continue;
+    if (binding.histogram->get_count() == 0) continue;
+
+    uint32_t value = 0;
+    switch (binding.statistic) {
+      case STATISTIC_MIN:
+        value = binding.histogram->get_min();
+        break;
+      case STATISTIC_AVG:
+        value = binding.histogram->get_avg();
+        break;
+      case STATISTIC_P99:
+        value = binding.histogram->get_percentile(99);
+        break;
+      case STATISTIC_MAX:
+        value = binding.histogram->get_max();
+        break;
+    }
+    binding.sensor->publish_state(value);
+  }
+
+  // Each update interval is its own measurement window
+  for (auto *histogram : global_histograms()) {
+    histogram->reset();
+  }
+}
+
+void PerfStatsComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "Performance Statistics:");
+  LOG_UPDATE_INTERVAL(this);
+  ESP_LOGCONFIG(TAG, "  Operations: %u", (unsigned) global_histograms().size());
+  ESP_LOGCONFIG(TAG, "  Sensors: %u", (unsigned) this->sensors_.size());
+  if (this->trace_ready_) {
+    ESP_LOGCONFIG(TAG, "  Trace: %u events, %s", (unsigned) this->trace_.get_capacity(),
+                  this->tracing_ ? "recording" : "stopped");
+#ifdef USE_PERF_STATS_TRACE_HTTP
+    if (this->web_server_base_ != nullptr) ESP_LOGCONFIG(TAG, "  Trace Path: %s", this->trace_path_.c_str());
+#endif
+  }
+}
+
+void PerfStatsComponent::add_sensor(const char *operation, Statistic statistic, sensor::Sensor *sensor) {
+  this->sensors_.push_back({operation, statistic, sensor, nullptr});
+}
+
+void PerfStatsComponent::start_trace() {
+#ifdef USE_PERF_STATS_TRACE
+  if (!this->trace_ready_) return;
+  global_event_trace.store(&this->trace_, std::memory_order_relaxed);
+  this->tracing_ = true;
+  ESP_LOGD(TAG, "Trace started, %u events recorded so far", (unsigned) this->trace_.get_recorded());
+#endif
+}
+
+void PerfStatsComponent::stop_trace() {
+#ifdef USE_PERF_STATS_TRACE
+  global_event_trace.store(nullptr, std::memory_order_relaxed);
+  this->tracing_ = false;
+  ESP_LOGD(TAG, "Trace stopped, %u events recorded", (unsigned) this->trace_.get_recorded());
+#endif
+}
+
+bool PerfStatsComponent::write_trace(const std::function<bool(const char *, size_t)> &write) const {
+  if (!this->trace_ready_) return false;
+  return this->trace_.write_json(write);
+}
+
+void PerfStatsComponent::dump_stats() {
+  ESP_LOGI(TAG, "%-28s %8s %8s %8s %8s %8s", "operation", "count", "min_us", "avg_us", "p99_us", "max_us");
+  for (auto *histogram : global_histograms()) {
+    ESP_LOGI(TAG, "%-28s %8u %8u %8u %8u %8u", histogram->get_name(), (unsigned) histogram->get_count(),
+             (unsigned) histogram->get_min(), (unsigned) histogram->get_avg(),
+             (unsigned) histogram->get_percentile(99), (unsigned) histogram->get_max());
+  }
+}
+
+}  // namespace perf_stats
+}  // namespace esphome
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/automation.h"
+#include "esphome/core/defines.h"
+#include "esphome/components/buffer_pool/block_pool.h"
+#include "esphome/components/sensor/sensor.h"
+#ifdef USE_PERF_STATS_TRACE_HTTP
+#include "esphome/components/web_server_base/web_server_base.h"
+#endif
+#include "event_trace.h"
+#include "timing_histogram.h"
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace perf_stats {
+
+enum Statistic : uint8_t {
+  STATISTIC_MIN,
+  STATISTIC_AVG,
+  STATISTIC_P99,
+  STATISTIC_MAX,
+};
+
+class PerfStatsComponent : public PollingComponent {
+ public:
+  void setup() override;
+  void update() override;
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::LATE; }
+
+  // Publish a statistic of the named histogram to a sensor every update
+  void add_sensor(const char *operation, Statistic statistic, sensor::Sensor *sensor);
+
+  // Log min/avg/p99/max for every registered histogram (current window)
+  void dump_stats();
+
+  // Keep the last `events` trace events, recording from boot if `start`
+  void set_trace(uint32_t events, bool start) {
+    this->trace_events_ = events;
+    this->trace_on_boot_ = start;
+  }
+#ifdef USE_PERF_STATS_TRACE_HTTP
+  // Serve the trace as Chrome trace JSON at `path` on the web server
+  void set_trace_server(web_server_base::WebServerBase *base, const std::string &path) {
+    this->web_server_base_ = base;
+    this->trace_path_ = path;
+  }
+#endif
+  // Start or stop recording trace events; the ring keeps what it has
+  void start_trace();
+  void stop_trace();
+  bool is_tracing() const { return this->tracing_; }
+  // Write the trace as Chrome trace JSON, see EventTrace::write_json()
+  bool write_trace(const std::function<bool(const char *, size_t)> &write) const;
+
+ protected:
+  struct SensorBinding {
+    const char *operation;
+    Statistic statistic;
+    sensor::Sensor *sensor;
+    TimingHistogram *histogram;
+  };
+
+  std::vector<SensorBinding> sensors_;
+
+  EventTrace trace_;
+  buffer_pool::BlockPool trace_pool_{"trace", buffer_pool::REGION_PSRAM};
+  uint32_t trace_events_{0};
+  bool trace_on_boot_{false};
+  bool trace_ready_{false};
+  bool tracing_{false};
+#ifdef USE_PERF_STATS_TRACE_HTTP
+  web_server_base::WebServerBase *web_server_base_{nullptr};
+  std::string trace_path_;
+#endif
+};
+
+template<typename... Ts> class DumpAction : public Action<Ts...>, public Parented<PerfStatsComponent> {
+ public:
+  void play(Ts... x) override { this->parent_->dump_stats(); }
+};
+
+template<typename... Ts> class TraceStartAction : public Action<Ts...>, public Parented<PerfStatsComponent> {
+ public:
+  void play(Ts... x) override { this->parent_->start_trace(); }
+};
+
+template<typename... Ts> class TraceStopAction : public Action<Ts...>, public Parented<PerfStatsComponent> {
+ public:
+  void play(Ts... x) override { this->parent_->stop_trace(); }
+};
+
+}  // namespace perf_stats
+}  // namespace esphome
@@ -0,0 +1,78 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    CONF_MAX,
+    CONF_MIN,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+)
+from . import perf_stats_ns, PerfStatsComponent, CONF_PERF_STATS_ID
+
+DEPENDENCIES = ["perf_stats"]
+
+CONF_OPERATION = "operation"
+CONF_AVG = "avg"
+CONF_P99 = "p99"
+
+UNIT_MICROSECOND = "µs"
+
+Statistic = perf_stats_ns.enum("Statistic")
+STATISTICS = {
+    CONF_MIN: Statistic.STATISTIC_MIN,
+    CONF_AVG: Statistic.STATISTIC_AVG,
+    CONF_P99: Statistic.STATISTIC_P99,
+    CONF_MAX: Statistic.STATISTIC_MAX,
+}
+
+# Operation names registered by the custom components, e.g. "cst92xx.loop"
+OPERATIONS = [
+    "axp2101.loop",
+    "axp2101.i2c",
+    "axp2101.i2c_wait",
+    "co5300_qspi.flush",
+    "cst92xx.loop",
+    "cst92xx.i2c",
+    "cst92xx.i2c_wait",
+    "es8311.i2c",
+    "es8311.i2c_wait",
+    "es8311.i2s_read",
+    "medallion_voice.loop",
+    "medallion_voice.sd_write",
+    "medallion_voice.hash",
+    "medallion_voice.checkpoint",
+    "medallion_voice.encode",
+    "medallion_voice.resample",
+    "medallion_voice.frontend",
+]
+
+_TIMING_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MICROSECOND,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    icon="mdi:timer-outline",
+)
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(CONF_PERF_STATS_ID): cv.use_id(PerfStatsComponent),
+            cv.Required(CONF_OPERATION): cv.one_of(*OPERATIONS, lower=True),
+            cv.Optional(CONF_MIN): _TIMING_SENSOR_SCHEMA,
+            cv.Optional(CONF_AVG): _TIMING_SENSOR_SCHEMA,
+            cv.Optional(CONF_P99): _TIMING_SENSOR_SCHEMA,
+            cv.Optional(CONF_MAX): _TIMING_SENSOR_SCHEMA,
+        }
+    ),
+    cv.has_at_least_one_key(*STATISTICS),
+)
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_PERF_STATS_ID])
+
+    for key, statistic in STATISTICS.items():
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(parent.add_sensor(config[CONF_OPERATION], statistic, sens))
@@ -0,0 +1,99 @@
+#include "timing_histogram.h"
+#include <cstring>
+
+namespace esphome {
+namespace perf_stats {
+
+std::vector<TimingHistogram *> &global_histograms() {
+  static std::vector<TimingHistogram *> histograms;
+  return histograms;
+}
+
+TimingHistogram *find_histogram(const char *name) {
+  for (auto *histogram : global_histograms()) {
+    if (strcmp(histogram->get_name(), name) == 0)
+      return histogram;
+  }
+  return nullptr;
+}
+
+TimingHistogram::TimingHistogram(const char *name) : name_(name) { global_histograms().push_back(this); }
+
+void TimingHistogram::reset() {
+  portENTER_CRITICAL_SAFE(&this->lock_);
+  this->count_ = 0;
+  this->min_ = UINT32_MAX;
+  this->max_ = 0;
+  this->sum_ = 0;
+  memset(this->buckets_, 0, sizeof(this->buckets_));
+  portEXIT_CRITICAL_SAFE(&this->lock_);
+}
+
+uint32_t TimingHistogram::get_count() const {
+  portENTER_CRITICAL_SAFE(&this->lock_);
+  uint32_t count = this->count_;
+  portEXIT_CRITICAL_SAFE(&this->lock_);
+  return count;
+}
+
+uint32_t TimingHistogram::get_min() const {
+  portENTER_CRITICAL_SAFE(&this->lock_);
+  uint32_t min = this->count_ > 0 ? this->min_ : 0;
+  portEXIT_CRITICAL_SAFE(&this->lock_);
+  return min;
+}
+
+uint32_t TimingHistogram::get_max() const {
+  portENTER_CRITICAL_SAFE(&this->lock_);
+  uint32_t max = this->max_;
+  portEXIT_CRITICAL_SAFE(&this->lock_);
+  return max;
+}
+
+uint32_t TimingHistogram::get_avg() const {
+  portENTER_CRITICAL_SAFE(&this->lock_);
+  uint32_t avg = this->count_ > 0 ? (uint32_t) (this->sum_ / this->count_) : 0;
+  portEXIT_CRITICAL_SAFE(&this->lock_);
+  return avg;
+}
+
+uint32_t TimingHistogram::bucket_upper_bound_(uint16_t index) {
+  if (index < SUB_BUCKETS) return index;
+  uint8_t octave = index / SUB_BUCKETS - 1 + SUB_BUCKET_BITS;
+  uint8_t sub = index % SUB_BUCKETS;
+  uint32_t width = 1UL << (octave - SUB_BUCKET_BITS);
+  return (1UL << octave) + (sub + 1) * width - 1;
+}
+
+uint32_t TimingHistogram::get_percentile(uint8_t pct) const {
+  if (pct > 100) pct = 100;
+  // The walk is at most NUM_BUCKETS steps, short enough to hold the lock,
+  // so count and buckets always agree
+  portENTER_CRITICAL_SAFE(&this->lock_);
+  uint32_t result = this->max_;
+  if (this->count_ == 0) {
+    result = 0;
+  } else {
+    // Rank of the sample at the requested percentile, rounded up, and
+    // never past the last sample
+    uint32_t rank = ((uint64_t) this->count_ * pct + 99) / 100;
+    if (rank == 0) rank = 1;
+    if (rank > this->count_) rank = this->count_;
+
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < NUM_BUCKETS; i++) {
+      seen += this->buckets_[i];
+      if (seen >= rank) {
+        // The last bucket also holds everything longer: only max bounds it
+        uint32_t bound = i < NUM_BUCKETS - 1 ? bucket_upper_bound_(i) : UINT32_MAX;
+        if (bound < result) result = bound;
+        break;
+      }
+    }
+  }
+  portEXIT_CRITICAL_SAFE(&this->lock_);
+  return result;
+}
+
+}  // namespace perf_stats
+}  // namespace esphome
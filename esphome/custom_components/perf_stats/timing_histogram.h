@@ -0,0 +1,87 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+#include <freertos/FreeRTOS.h>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace perf_stats {
+
+// Log-linear execution time histogram (microseconds).
+// Each power-of-two octave is split into SUB_BUCKETS linear buckets, so the
+// reported percentiles are accurate to within 1/SUB_BUCKETS of the value.
+//
+// Recording, reset and reads may run on different tasks and cores (perf_stats
+// resets every window from the main loop while the upload and frame tasks
+// record), so each takes a short critical section.
+class TimingHistogram {
+ public:
+  static constexpr uint8_t SUB_BUCKET_BITS = 2;
+  static constexpr uint8_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr uint8_t NUM_OCTAVES = 22;  // up to ~4 s
+  static constexpr uint16_t NUM_BUCKETS = NUM_OCTAVES * SUB_BUCKETS;
+
+  // Registers the histogram under `name` (must be a string literal)
+  explicit TimingHistogram(const char *name);
+  // Unregistered histogram, reset only by its owner
+  TimingHistogram() : name_(nullptr) {}
+
+  void record(uint32_t us) {
+    uint16_t index = bucket_index_(us);
+    portENTER_CRITICAL_SAFE(&this->lock_);
+    this->buckets_[index]++;
+    this->count_++;
+    this->sum_ += us;
+    if (us < this->min_) this->min_ = us;
+    if (us > this->max_) this->max_ = us;
+    portEXIT_CRITICAL_SAFE(&this->lock_);
+  }
+
+  void reset();
+
+  const char *get_name() const { return this->name_; }
+  uint32_t get_count() const;
+  uint32_t get_min() const;
+  uint32_t get_max() const;
+  uint32_t get_avg() const;
+  // Returns the upper bound of the bucket holding the given percentile
+  // (0-100, larger values read as 100)
+  uint32_t get_percentile(uint8_t pct) const;
+
+ protected:
+  static uint16_t bucket_index_(uint32_t us) {
+    if (us < SUB_BUCKETS) return us;
+    uint8_t octave = 31 - __builtin_clz(us);  // >= SUB_BUCKET_BITS
+    uint8_t sub = (us >> (octave - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    uint16_t index = (octave - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+    return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+  }
+  static uint32_t bucket_upper_bound_(uint16_t index);
+
+  const char *name_;
+  mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+  uint32_t count_{0};
+  uint32_t min_{UINT32_MAX};
+  uint32_t max_{0};
+  uint64_t sum_{0};
+  uint32_t buckets_[NUM_BUCKETS]{};
+};
+
+// Records the lifetime of the scope into a histogram
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(TimingHistogram &histogram) : histogram_(histogram), start_(micros()) {}
+  ~ScopedTimer() { this->histogram_.record(micros() - this->start_); }
+
+ protected:
+  TimingHistogram &histogram_;
+  uint32_t start_;
+};
+
+// All histograms created so far, in construction order
+std::vector<TimingHistogram *> &global_histograms();
+TimingHistogram *find_histogram(const char *name);
+
+}  // namespace perf_stats
+}  // namespace esphome
@@ -0,0 +1,41 @@
+#include "trace_handler.h"
+
+#ifdef USE_PERF_STATS_TRACE_HTTP
+
+#include "perf_stats.h"
+#include "esphome/core/log.h"
+#include <esp_http_server.h>
+
+namespace esphome {
+namespace perf_stats {
+
+static const char *const TAG = "perf_stats.trace";
+
+bool TraceHandler::canHandle(AsyncWebServerRequest *request) const {
+  return request->method() == HTTP_GET && request->url() == this->path_;
+}
+
+void TraceHandler::handleRequest(AsyncWebServerRequest *request) {
+  httpd_req_t *req = *request;
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.json\"");
+  uint32_t start = millis();
+  size_t sent = 0;
+  bool ok = this->parent_->write_trace([req, &sent](const char *data, size_t length) {
+    sent += length;
+    return httpd_resp_send_chunk(req, data, length) == ESP_OK;
+  });
+  if (ok) {
+    httpd_resp_send_chunk(req, nullptr, 0);
+    ESP_LOGD(TAG, "Sent trace: %u bytes in %u ms", (unsigned) sent, (unsigned) (millis() - start));
+  } else {
+    // A response cut short can only be ended by dropping the connection
+    ESP_LOGW(TAG, "Trace download stopped after %u bytes", (unsigned) sent);
+    httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+  }
+}
+
+}  // namespace perf_stats
+}  // namespace esphome
+
+#endif  // USE_PERF_STATS_TRACE_HTTP
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_PERF_STATS_TRACE_HTTP
+
+#include "esphome/components/web_server_base/web_server_base.h"
+#include <string>
+
+namespace esphome {
+namespace perf_stats {
+
+class PerfStatsComponent;
+
+// Serves the event trace on the web server:
+//
+//   GET <path>   -> Chrome trace JSON, for chrome://tracing or ui.perfetto.dev
+//
+// The JSON is built a few hundred bytes at a time and sent chunked, so
+// nothing the size of the trace is allocated.
+class TraceHandler : public AsyncWebHandler {
+ public:
+  TraceHandler(PerfStatsComponent *parent, const std::string &path) : parent_(parent), path_(path) {}
+
+  bool canHandle(AsyncWebServerRequest *request) const override;
+  void handleRequest(AsyncWebServerRequest *request) override;
+  bool isRequestHandlerTrivial() const override { return false; }
+
+ protected:
+  PerfStatsComponent *parent_;
+  std::string path_;
+};
+
+}  // namespace perf_stats
+}  // namespace esphome
+
+#endif  // USE_PERF_STATS_TRACE_HTTP
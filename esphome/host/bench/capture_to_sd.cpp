@@ -0,0 +1,68 @@
+// Capture to SD: how the recorder keeps up with cards of different write
+// latency, and how fast the pipeline behind the codec can go at all.
+//
+//   capture_to_sd [--quick]
+//
+// Real-time runs pace the I2S DMA at 16 kHz, so a card that stalls the
+// writer long enough shows up as overflows and dropped audio. The
+// free-running run serves every I2S read at once and reports the capture
+// rate as a multiple of real time.
+
+#include "test_support.h"
+#include "host/mock_i2s.h"
+#include <cstdio>
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+struct Card {
+  const char *name;
+  uint32_t per_call_us;
+  uint32_t per_kib_us;
+};
+
+static const Card CARDS[] = {
+    {"fast", 100, 50},
+    {"spi_20mhz", 300, 400},
+    {"slow", 2000, 1500},
+    {"stalling", 40000, 1500},
+};
+
+static void print_row(const char *name, const CaptureStats &stats, double wall_s) {
+  // The file's byte rate, from what real time would have delivered
+  double byte_rate = stats.duration_ms > 0 ? stats.expected_bytes * 1000.0 / stats.duration_ms : 0;
+  double audio_s = byte_rate > 0 ? stats.written_bytes / byte_rate : 0;
+  printf("%-10s %7.2f %8.2f %8llu %6u %8u %8u %8u\n", name, wall_s, audio_s / wall_s,
+         (unsigned long long) stats.get_dropped_bytes(), (unsigned) stats.i2s_overflows,
+         (unsigned) stats.sd_write_latency.get_percentile(50), (unsigned) stats.sd_write_latency.get_percentile(99),
+         (unsigned) stats.sd_write_latency.get_max());
+}
+
+static bool run(const Card &card, bool realtime, uint32_t ms) {
+  host::sd_card().format();
+  host::sd_card().set_write_latency(card.per_call_us, card.per_kib_us);
+  host::i2s_set_realtime(realtime);
+  test::Recorder recorder;
+  if (!recorder.setup()) return false;
+  uint32_t start = millis();
+  if (!recorder.record(ms)) return false;
+  double wall_s = (millis() - start) / 1000.0;
+  print_row(realtime ? card.name : "free", recorder.voice.get_capture_stats(), wall_s);
+  host::sd_card().set_write_latency(0, 0);
+  host::i2s_set_realtime(true);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  host::set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+  const bool quick = test::quick_run(argc, argv);
+  const uint32_t ms = quick ? 300 : 5000;
+
+  printf("%-10s %7s %8s %8s %6s %8s %8s %8s\n", "card", "wall_s", "x_rt", "dropped", "ovf", "p50_us", "p99_us",
+         "max_us");
+  bool ok = true;
+  for (const Card &card : CARDS) ok &= run(card, true, ms);
+  // The pipeline's own ceiling, on the fastest card
+  ok &= run(CARDS[0], false, ms);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,282 @@
+// Fleet upload load from the firmware's own HTTP client: many simulated
+// devices, each a thread with its own HttpUploadClient (and, with
+// --resumable, ResumableUploader), upload recordings to one endpoint.
+//
+//   fleet_load [--url URL] [--devices N] [--files N] [--bytes N]
+//              [--repeat-rate R] [--resumable] [--chunk-kb N]
+//              [--min-throughput-kbps X] [--max-p99-ms X] [--quick]
+//
+// Without --url the in-process test server is used. For fault injection
+// (latency, drops, resets, errors) run it against tools/upload_server.py,
+// or let tools/fleet_load_test.py --host-client spawn both.
+//
+// Both the one-shot POST (post_multipart(), as upload_recording() sends it)
+// and the resumable protocol are the firmware's code.
+
+#include "test_support.h"
+#include "esphome/components/medallion_voice/catalog.h"
+#include "esphome/components/medallion_voice/content_hash.h"
+#include "esphome/components/medallion_voice/http_upload_client.h"
+#include "esphome/components/medallion_voice/http_url.h"
+#include "esphome/components/medallion_voice/multipart_upload.h"
+#include "esphome/components/medallion_voice/resumable_upload.h"
+#include "esphome/components/medallion_voice/wav_format.h"
+#include <freertos/semphr.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <unistd.h>
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+static const uint32_t RESUMABLE_TIMEOUT_MS = 120000;
+
+struct Options {
+  std::string url;
+  uint32_t devices{10};
+  uint32_t files{3};
+  uint32_t bytes{44 + 10 * 16000 * 2 * 2};
+  double repeat_rate{0};
+  bool resumable{false};
+  uint32_t chunk_kb{16};
+  double min_throughput_kbps{-1};
+  double max_p99_ms{-1};
+};
+
+struct Results {
+  std::mutex lock;
+  std::map<std::string, uint32_t> outcomes;
+  std::vector<double> latencies_ms;
+  uint64_t bytes_ok{0};
+  uint32_t connects{0};
+
+  void add(const std::string &outcome, uint64_t sent, double latency_ms) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->outcomes[outcome]++;
+    if (outcome == "ok") {
+      this->latencies_ms.push_back(latency_ms);
+      this->bytes_ok += sent;
+    }
+  }
+};
+
+static std::vector<uint8_t> make_wav(uint32_t size, uint32_t device, uint32_t n) {
+  AudioFormat format{16000, 2, 16};
+  uint32_t data_length = size > WAV_HEADER_SIZE ? size - WAV_HEADER_SIZE : 0;
+  std::vector<uint8_t> wav(WAV_HEADER_SIZE + data_length);
+  build_wav_header(wav.data(), format, data_length);
+  for (uint32_t i = 0; i < data_length; i++) wav[WAV_HEADER_SIZE + i] = i & 0xFF;
+  // Unique audio, and so a unique digest, per recording
+  memcpy(&wav[WAV_HEADER_SIZE], &device, std::min<uint32_t>(4, data_length));
+  if (data_length >= 8) memcpy(&wav[WAV_HEADER_SIZE + 4], &n, 4);
+  return wav;
+}
+
+static std::string one_shot(HttpUploadClient &http, const HttpUrl &url, const std::string &name,
+                            const std::vector<uint8_t> &wav, const std::string &digest, uint64_t &sent) {
+  uint8_t buf[MULTIPART_IO_SIZE];
+  auto read = [&wav](size_t offset, uint8_t *data, size_t length) {
+    memcpy(data, wav.data() + offset, length);
+    return (int) length;
+  };
+  HttpResponse response;
+  sent = 0;
+  switch (post_multipart(http, url, name.c_str(), wav.size(), digest.c_str(), read, buf, sizeof(buf), response)) {
+    case MultipartResult::CONNECT_FAIL:
+      return "connect_fail";
+    case MultipartResult::NO_RESPONSE:
+      return "no_response";
+    case MultipartResult::BODY_SKIPPED:
+      return response.is_success() ? "duplicate" : "http_" + std::to_string(response.status);
+    case MultipartResult::SENT:
+      break;
+  }
+  if (!response.is_success()) return "http_" + std::to_string(response.status);
+  sent = wav.size();
+  return "ok";
+}
+
+static std::string resumable(ResumableUploader &uploader, const HttpUrl &url, const std::string &name,
+                             const std::string &digest, uint64_t &sent) {
+  sent = 0;
+  if (!uploader.start("/" + name, "/" + name, url, digest.c_str())) return "file_error";
+  // The session is forgotten once complete
+  uint32_t size = uploader.get_size();
+  uint32_t start = millis();
+  while (millis() - start < RESUMABLE_TIMEOUT_MS) {
+    switch (uploader.step()) {
+      case ResumableStatus::COMPLETE:
+        sent = size;
+        return "ok";
+      case ResumableStatus::FAILED:
+        return "failed";
+      case ResumableStatus::BACKOFF:
+        delay(5);
+        break;
+      default:
+        break;
+    }
+  }
+  uploader.cancel();
+  return "timeout";
+}
+
+static void run_device(uint32_t device, const Options &options, const HttpUrl &url, SdFs *sd,
+                       SemaphoreHandle_t sd_mutex, Results &results) {
+  HttpUploadClient http;
+  ResumableUploader uploader;
+  if (options.resumable) {
+    uploader.set_chunk_size(options.chunk_kb * 1024);
+    if (!uploader.setup(sd, &http, sd_mutex)) {
+      results.add("setup_fail", 0, 0);
+      return;
+    }
+  }
+  std::mt19937 rng(device);
+  std::uniform_real_distribution<double> chance(0, 1);
+  std::string previous_name, previous_digest;
+  for (uint32_t n = 0; n < options.files; n++) {
+    std::string name, digest;
+    std::vector<uint8_t> wav;
+    if (!previous_name.empty() && chance(rng) < options.repeat_rate) {
+      // Re-send an earlier recording, as after a lost acknowledgement
+      name = previous_name;
+      digest = previous_digest;
+      if (!options.resumable) host::sd_card().read_file("/" + name, wav);
+    } else {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "dev%03u_voice_%04u.wav", (unsigned) device, (unsigned) n + 1);
+      name = buf;
+      wav = make_wav(options.bytes, device, n);
+      digest = test::sha256_hex(wav.data() + WAV_HEADER_SIZE, wav.size() - WAV_HEADER_SIZE);
+      host::sd_card().write_file("/" + name, wav);
+      previous_name = name;
+      previous_digest = digest;
+    }
+    uint64_t sent = 0;
+    uint32_t start = micros();
+    std::string outcome = options.resumable ? resumable(uploader, url, name, digest, sent)
+                                            : one_shot(http, url, name, wav, digest, sent);
+    results.add(outcome, sent, (micros() - start) / 1000.0);
+  }
+  http.close();
+  std::lock_guard<std::mutex> guard(results.lock);
+  results.connects += http.get_connect_count();
+}
+
+static double percentile(std::vector<double> values, double pct) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  size_t index = std::min(values.size() - 1, (size_t) std::max(0.0, std::round(pct / 100.0 * values.size() + 0.5) - 1));
+  return values[index];
+}
+
+static bool parse_args(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--quick") {
+      options.devices = 4;
+      options.files = 2;
+      options.bytes = 64 * 1024;
+    } else if (arg == "--resumable") {
+      options.resumable = true;
+    } else if (arg == "--url" && has_value) {
+      options.url = argv[++i];
+    } else if (arg == "--devices" && has_value) {
+      options.devices = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--files" && has_value) {
+      options.files = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--bytes" && has_value) {
+      options.bytes = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--repeat-rate" && has_value) {
+      options.repeat_rate = strtod(argv[++i], nullptr);
+    } else if (arg == "--chunk-kb" && has_value) {
+      options.chunk_kb = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--min-throughput-kbps" && has_value) {
+      options.min_throughput_kbps = strtod(argv[++i], nullptr);
+    } else if (arg == "--max-p99-ms" && has_value) {
+      options.max_p99_ms = strtod(argv[++i], nullptr);
+    } else {
+      fprintf(stderr, "Unknown or incomplete option: %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return options.devices > 0 && options.chunk_kb > 0;
+}
+
+int main(int argc, char **argv) {
+  host::set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+  Options options;
+  if (!parse_args(argc, argv, options)) return 2;
+
+  test::UploadServer server;
+  const bool local = options.url.empty();
+  if (local) {
+    if (server.start() == 0) return 1;
+    options.url = server.url();
+  }
+  HttpUrl url;
+  const char *error = nullptr;
+  if (!parse_http_url(options.url, url, &error)) {
+    fprintf(stderr, "Bad URL %s: %s\n", options.url.c_str(), error);
+    return 2;
+  }
+  if (url.secure) {
+    fprintf(stderr, "The host build has no TLS; use tools/fleet_load_test.py for https://\n");
+    return 2;
+  }
+
+  // The recordings live on the mock card, shared by every device
+  host::sd_card().format();
+  SdFs sd;
+  if (!sd.begin(SdSpiConfig(41, 0, 1000000))) return 1;
+  SemaphoreHandle_t sd_mutex = xSemaphoreCreateMutex();
+
+  Results results;
+  std::vector<std::thread> threads;
+  uint32_t start = millis();
+  for (uint32_t i = 0; i < options.devices; i++) {
+    threads.emplace_back(run_device, i, std::cref(options), std::cref(url), &sd, sd_mutex, std::ref(results));
+  }
+  for (auto &thread : threads) thread.join();
+  double elapsed = (millis() - start) / 1000.0;
+
+  uint32_t total = 0;
+  for (const auto &outcome : results.outcomes) total += outcome.second;
+  // Duplicates the server declined before the body count as delivered
+  uint32_t succeeded = results.outcomes["ok"] + results.outcomes["duplicate"];
+  double goodput = elapsed > 0 ? results.bytes_ok / 1024.0 / elapsed : 0;
+  double p99 = percentile(results.latencies_ms, 99);
+  printf("%u %s uploads of %u bytes from %u devices in %.2f s\n", (unsigned) total,
+         options.resumable ? "resumable" : "one-shot", (unsigned) options.bytes, (unsigned) options.devices, elapsed);
+  printf("  succeeded:  %u (%.1f%%)\n", (unsigned) succeeded, total > 0 ? succeeded * 100.0 / total : 0.0);
+  printf("  goodput:    %.1f KiB/s\n", goodput);
+  printf("  latency ms: p50 %.1f  p95 %.1f  p99 %.1f  max %.1f\n", percentile(results.latencies_ms, 50),
+         percentile(results.latencies_ms, 95), p99, percentile(results.latencies_ms, 100));
+  printf("  connections: %u\n", (unsigned) results.connects);
+  printf("  outcomes:  ");
+  for (const auto &outcome : results.outcomes) {
+    if (outcome.second > 0) printf(" %s=%u", outcome.first.c_str(), (unsigned) outcome.second);
+  }
+  printf("\n");
+
+  // The local server injects no faults: every upload has to get through
+  bool failed = local && succeeded < total;
+  if (options.min_throughput_kbps >= 0 && goodput < options.min_throughput_kbps) {
+    fprintf(stderr, "FAIL: goodput below %.1f KiB/s\n", options.min_throughput_kbps);
+    failed = true;
+  }
+  if (options.max_p99_ms >= 0 && p99 > options.max_p99_ms) {
+    fprintf(stderr, "FAIL: p99 latency above %.1f ms\n", options.max_p99_ms);
+    failed = true;
+  }
+  // Device threads are joined, but the server's are not
+  fflush(stdout);
+  _exit(failed ? 1 : 0);
+}
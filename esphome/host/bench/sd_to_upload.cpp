@@ -0,0 +1,75 @@
+// SD to upload: throughput of the one-shot POST and the resumable chunked
+// upload, reading from cards of different read latency to a local server
+// with and without a round-trip delay.
+//
+//   sd_to_upload [--quick]
+//
+// Each case uploads a fresh recording, captured free-running so that a
+// short run yields tens of seconds of audio.
+
+#include "test_support.h"
+#include "host/mock_i2s.h"
+#include <cstdio>
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+struct Case {
+  const char *name;
+  uint32_t chunk_size;  // 0: one-shot POST
+  uint32_t read_per_call_us;
+  uint32_t read_per_kib_us;
+  uint32_t server_delay_ms;
+};
+
+static const Case CASES[] = {
+    {"one_shot", 0, 100, 50, 0},
+    {"one_shot_spi", 0, 300, 250, 0},
+    {"one_shot_rtt20", 0, 300, 250, 20},
+    {"resumable_4k", 4096, 300, 250, 0},
+    {"resumable_32k", 32768, 300, 250, 0},
+    {"resumable_4k_rtt20", 4096, 300, 250, 20},
+    {"resumable_32k_rtt20", 32768, 300, 250, 20},
+};
+
+static bool run(const Case &c, uint32_t record_ms) {
+  host::sd_card().format();
+  test::UploadServer server;
+  if (server.start() == 0) return false;
+  test::Recorder recorder;
+  recorder.voice.set_upload_url(server.url());
+  if (c.chunk_size > 0) {
+    recorder.voice.set_resumable_upload(true);
+    recorder.voice.set_upload_chunk_size(c.chunk_size);
+  }
+  if (!recorder.setup()) return false;
+  host::i2s_set_realtime(false);
+  bool recorded = recorder.record(record_ms);
+  host::i2s_set_realtime(true);
+  if (!recorded) return false;
+
+  std::vector<uint8_t> wav;
+  host::sd_card().read_file(recorder.voice.get_current_file(), wav);
+  host::sd_card().set_read_latency(c.read_per_call_us, c.read_per_kib_us);
+  server.set_response_delay_ms(c.server_delay_ms);
+  uint32_t start = millis();
+  bool ok = recorder.voice.upload_recording() &&
+            recorder.run_until([&] { return recorder.voice.get_state() == RecorderState::UPLOADED; }, 120000);
+  double wall_s = (millis() - start) / 1000.0;
+  host::sd_card().set_read_latency(0, 0);
+
+  printf("%-20s %9zu %7.2f %8.0f %8u %s\n", c.name, wav.size(), wall_s, wav.size() / 1024.0 / wall_s,
+         (unsigned) server.get_requests(), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  host::set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+  const bool quick = test::quick_run(argc, argv);
+  const uint32_t record_ms = quick ? 50 : 1000;
+
+  printf("%-20s %9s %7s %8s %8s\n", "case", "bytes", "wall_s", "KiB/s", "requests");
+  bool ok = true;
+  for (const Case &c : CASES) ok &= run(c, record_ms);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// The parts of the Arduino-ESP32 core the components reach through SPI.h and
+// WiFi.h
+
+#include "esphome/core/hal.h"
+#include <cstddef>
+#include <cstdint>
+
+uint32_t getCpuFrequencyMhz();
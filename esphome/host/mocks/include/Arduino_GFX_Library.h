@@ -0,0 +1,154 @@
+#pragma once
+
+// Host stand-in for the parts of Arduino_GFX the CO5300 driver uses. The
+// panel keeps its pixels in memory, so a test can check what reached the
+// "glass" and how; text is not rasterised. Implemented in
+// mocks/src/arduino_gfx.cpp.
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#define BLACK 0x0000
+#define BLUE 0x001F
+#define RED 0xF800
+#define GREEN 0x07E0
+#define WHITE 0xFFFF
+
+#define GFX_NOT_DEFINED -1
+#define GFX_SKIP_OUTPUT_BEGIN -2
+
+class Arduino_DataBus {
+ public:
+  virtual ~Arduino_DataBus() = default;
+  virtual bool begin(int32_t speed = GFX_NOT_DEFINED, int8_t data_mode = GFX_NOT_DEFINED);
+  virtual void beginWrite() { this->writing_ = true; }
+  virtual void endWrite() { this->writing_ = false; }
+  virtual void writeCommand(uint8_t c);
+  virtual void writeC8D8(uint8_t c, uint8_t d);
+
+  // Commands with their first data byte, in the order they were sent
+  const std::vector<std::pair<uint8_t, uint8_t>> &get_commands() const { return this->commands_; }
+
+ protected:
+  bool writing_{false};
+  std::vector<std::pair<uint8_t, uint8_t>> commands_;
+};
+
+class Arduino_ESP32QSPI : public Arduino_DataBus {
+ public:
+  Arduino_ESP32QSPI(int8_t cs, int8_t sck, int8_t mosi, int8_t miso, int8_t quadwp, int8_t quadhd)
+      : cs_(cs), sck_(sck), d0_(mosi), d1_(miso), d2_(quadwp), d3_(quadhd) {}
+
+ protected:
+  int8_t cs_, sck_, d0_, d1_, d2_, d3_;
+};
+
+class Arduino_G {
+ public:
+  Arduino_G(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h) {}
+  virtual ~Arduino_G() = default;
+  virtual bool begin(int32_t speed = GFX_NOT_DEFINED) = 0;
+  virtual void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16_t h) = 0;
+
+ protected:
+  int16_t WIDTH;
+  int16_t HEIGHT;
+};
+
+class Arduino_GFX : public Arduino_G {
+ public:
+  Arduino_GFX(int16_t w, int16_t h) : Arduino_G(w, h) {}
+
+  void fillScreen(uint16_t color) { this->fillRect(0, 0, this->WIDTH, this->HEIGHT, color); }
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawPixel(int16_t x, int16_t y, uint16_t color) { this->fillRect(x, y, 1, 1, color); }
+  void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16_t h) override;
+
+  void setTextColor(uint16_t color) { this->text_color_ = color; }
+  void setTextSize(uint8_t size) { this->text_size_ = size; }
+  void setTextWrap(bool wrap) { this->wrap_ = wrap; }
+  void setCursor(int16_t x, int16_t y) {
+    this->cursor_x_ = x;
+    this->cursor_y_ = y;
+  }
+  size_t print(const char *text);
+  size_t println(const char *text);
+
+  int16_t width() const { return this->WIDTH; }
+  int16_t height() const { return this->HEIGHT; }
+
+ protected:
+  // Every drawing call ends here, with the rectangle already clipped
+  virtual void write_rect_(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels, uint16_t color) = 0;
+
+  uint16_t text_color_{WHITE};
+  uint8_t text_size_{1};
+  bool wrap_{true};
+  int16_t cursor_x_{0};
+  int16_t cursor_y_{0};
+};
+
+class Arduino_CO5300 : public Arduino_GFX {
+ public:
+  Arduino_CO5300(Arduino_DataBus *bus, int8_t rst, uint8_t r, bool ips, int16_t w, int16_t h, uint8_t col_offset1,
+                 uint8_t row_offset1, uint8_t col_offset2, uint8_t row_offset2);
+
+  bool begin(int32_t speed = GFX_NOT_DEFINED) override;
+  void setBrightness(uint8_t brightness) {
+    this->brightness_ = brightness;
+    this->brightness_thread_ = std::this_thread::get_id();
+  }
+
+  // What the panel shows, row by row
+  const std::vector<uint16_t> &get_pixels() const { return this->pixels_; }
+  uint16_t get_pixel(int16_t x, int16_t y) const { return this->pixels_[(size_t) y * this->WIDTH + x]; }
+  uint8_t get_brightness() const { return this->brightness_; }
+  Arduino_DataBus *get_bus() const { return this->bus_; }
+  // Drawing calls that reached the panel and the pixels they sent
+  uint32_t get_write_count() const { return this->writes_; }
+  uint64_t get_pixels_written() const { return this->pixels_written_; }
+  // Threads that last set the brightness and last drew: the bus has no lock,
+  // so both belong on one
+  std::thread::id get_brightness_thread() const { return this->brightness_thread_; }
+  std::thread::id get_write_thread() const { return this->write_thread_; }
+
+ protected:
+  void write_rect_(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels, uint16_t color) override;
+
+  Arduino_DataBus *bus_;
+  std::vector<uint16_t> pixels_;
+  uint8_t brightness_{0};
+  uint32_t writes_{0};
+  uint64_t pixels_written_{0};
+  std::thread::id brightness_thread_;
+  std::thread::id write_thread_;
+};
+
+class Arduino_Canvas : public Arduino_GFX {
+ public:
+  Arduino_Canvas(int16_t w, int16_t h, Arduino_G *output, int16_t output_x = 0, int16_t output_y = 0)
+      : Arduino_GFX(w, h), _output(output), _output_x(output_x), _output_y(output_y) {}
+  ~Arduino_Canvas() override;
+
+  bool begin(int32_t speed = GFX_NOT_DEFINED) override;
+  void flush();
+  uint16_t *getFramebuffer() { return this->_framebuffer; }
+
+ protected:
+  void write_rect_(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels, uint16_t color) override;
+
+  uint16_t *_framebuffer{nullptr};
+  bool owns_framebuffer_{false};
+  Arduino_G *_output;
+  int16_t _output_x;
+  int16_t _output_y;
+};
+
+namespace esphome {
+namespace host {
+// The panel the last Arduino_CO5300 was built for
+Arduino_CO5300 *display_panel();
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Arduino.h"
+
+#define FSPI 0
+#define HSPI 1
+
+// Only remembers its pins: the SD card behind it is host::MockSdCard
+class SPIClass {
+ public:
+  explicit SPIClass(uint8_t spi_bus = HSPI) : bus_(spi_bus) {}
+  void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+    this->sck_ = sck;
+    this->miso_ = miso;
+    this->mosi_ = mosi;
+    this->ss_ = ss;
+    this->started_ = true;
+  }
+  void end() { this->started_ = false; }
+  bool is_started() const { return this->started_; }
+
+ protected:
+  uint8_t bus_;
+  int8_t sck_{-1};
+  int8_t miso_{-1};
+  int8_t mosi_{-1};
+  int8_t ss_{-1};
+  bool started_{false};
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+// Host stand-in for SdFat's SdFs/FsFile. The card is host::MockSdCard (see
+// host/mock_sd.h): files in memory, saved to and loaded from a single image
+// file, with the directory entry's size only updated on sync() or close() so
+// a simulated power cut leaves what a real card would. Implemented in
+// mocks/src/sdfat.cpp.
+
+#include "SPI.h"
+#include <fcntl.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+typedef int oflag_t;
+
+#define SHARED_SPI 0
+#define DEDICATED_SPI 1
+#define SD_SCK_MHZ(maxMhz) (uint32_t)(1000000UL * (maxMhz))
+
+#define SD_CARD_TYPE_SD1 1
+#define SD_CARD_TYPE_SD2 2
+#define SD_CARD_TYPE_SDHC 3
+
+namespace esphome {
+namespace host {
+class MockSdCard;
+struct SdNode;
+}  // namespace host
+}  // namespace esphome
+
+class SdSpiConfig {
+ public:
+  SdSpiConfig(uint8_t cs, uint8_t opt, uint32_t max_sck, SPIClass *spi = nullptr)
+      : csPin(cs), options(opt), maxSck(max_sck), spiPort(spi) {}
+  uint8_t csPin;
+  uint8_t options;
+  uint32_t maxSck;
+  SPIClass *spiPort;
+};
+
+class SdCard {
+ public:
+  explicit SdCard(esphome::host::MockSdCard *card) : card_(card) {}
+  uint8_t type() const;
+  uint32_t sectorCount() const;
+
+ protected:
+  esphome::host::MockSdCard *card_;
+};
+
+class FsFile {
+ public:
+  FsFile() = default;
+  ~FsFile() = default;
+  FsFile(const FsFile &) = default;
+  FsFile &operator=(const FsFile &) = default;
+
+  explicit operator bool() const { return this->isOpen(); }
+  bool isOpen() const;
+  bool isDir() const;
+  bool isFile() const { return this->isOpen() && !this->isDir(); }
+
+  bool openNext(FsFile *dir, oflag_t oflag = O_RDONLY);
+  size_t getName(char *name, size_t len);
+  bool close();
+  bool sync();
+  void flush() { this->sync(); }
+
+  int read();
+  int read(void *buf, size_t count);
+  size_t write(uint8_t b) { return this->write(&b, 1); }
+  size_t write(const void *buf, size_t count);
+  size_t write(const char *str);
+
+  int available();
+  uint64_t available64();
+  uint64_t size() const { return this->fileSize(); }
+  uint64_t fileSize() const;
+  uint64_t curPosition() const { return this->position_; }
+  uint64_t position() const { return this->position_; }
+  bool seek(uint64_t position) { return this->seekSet(position); }
+  bool seekSet(uint64_t position);
+  bool seekCur(int64_t offset) { return this->seekSet(this->position_ + offset); }
+  bool seekEnd(int64_t offset = 0) { return this->seekSet(this->fileSize() + offset); }
+  bool truncate(uint64_t length);
+  bool truncate() { return this->truncate(this->position_); }
+  bool preAllocate(uint64_t length);
+  void rewindDirectory() { this->position_ = 0; }
+
+ protected:
+  friend class SdFs;
+
+  bool check_open_() const;
+
+  esphome::host::MockSdCard *card_{nullptr};
+  std::shared_ptr<esphome::host::SdNode> node_;
+  std::string path_;
+  std::string name_;
+  std::string cursor_;  // directories: the entry openNext() returned last
+  oflag_t flags_{0};
+  uint64_t position_{0};
+  uint32_t mount_{0};  // the card's mount count when opened
+};
+
+class SdFs {
+ public:
+  bool begin(SdSpiConfig config);
+  void end();
+  SdCard *card() { return this->card_ != nullptr ? &this->sd_card_ : nullptr; }
+
+  FsFile open(const char *path, oflag_t oflag = O_RDONLY);
+  FsFile open(const std::string &path, oflag_t oflag = O_RDONLY) { return this->open(path.c_str(), oflag); }
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *old_path, const char *new_path);
+  bool mkdir(const char *path, bool parents = true);
+  bool rmdir(const char *path);
+
+ protected:
+  esphome::host::MockSdCard *card_{nullptr};
+  SdCard sd_card_{nullptr};
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 WiFiClient on a plain TCP socket, so
+// the upload code talks to a real server on the host. Implemented in
+// mocks/src/wifi.cpp.
+
+#include "Arduino.h"
+#include <cstddef>
+#include <cstdint>
+
+class WiFiClient {
+ public:
+  WiFiClient() = default;
+  ~WiFiClient() { this->stop(); }
+  WiFiClient(const WiFiClient &) = delete;
+  WiFiClient &operator=(const WiFiClient &) = delete;
+
+  int connect(const char *host, uint16_t port) { return this->connect(host, port, 30000); }
+  int connect(const char *host, uint16_t port, int32_t timeout_ms);
+  size_t write(const uint8_t *buf, size_t size);
+  size_t write(uint8_t b) { return this->write(&b, 1); }
+  int available();
+  int read();
+  int read(uint8_t *buf, size_t size);
+  int peek();
+  void flush() {}
+  void stop();
+  uint8_t connected();
+  explicit operator bool() { return this->connected(); }
+
+  void setTimeout(unsigned long timeout_ms) { this->timeout_ms_ = timeout_ms; }
+  int setNoDelay(bool nodelay);
+  int fd() const { return this->fd_; }
+
+ protected:
+  int fd_{-1};
+  unsigned long timeout_ms_{1000};
+};
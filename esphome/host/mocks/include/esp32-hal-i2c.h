@@ -0,0 +1,10 @@
+#pragma once
+
+// Bus clock control of the Arduino-ESP32 I2C HAL, kept per port by
+// mocks/src/i2c.cpp so the arbiter's Fast-mode Plus switching can be checked
+
+#include "esp_err.h"
+#include <cstdint>
+
+esp_err_t i2cGetClock(uint8_t i2c_num, uint32_t *frequency);
+esp_err_t i2cSetClock(uint8_t i2c_num, uint32_t frequency);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+// Nanoseconds on the host, read as cycles of a 1 GHz core
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count();
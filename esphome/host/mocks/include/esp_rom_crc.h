@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// The ROM's reflected CRC-32 (polynomial 0xEDB88320), with the ROM's
+// convention of inverting the running value on entry and exit
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
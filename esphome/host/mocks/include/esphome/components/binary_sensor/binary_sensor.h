@@ -0,0 +1,26 @@
+#pragma once
+
+// Host stand-in for binary_sensor::BinarySensor
+
+#include <cstdint>
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor {
+ public:
+  void publish_state(bool state) {
+    this->state = state;
+    this->publish_count_++;
+  }
+  bool get_state() const { return this->state; }
+  uint32_t get_publish_count() const { return this->publish_count_; }
+
+  bool state{false};
+
+ protected:
+  uint32_t publish_count_{0};
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
@@ -0,0 +1,62 @@
+#pragma once
+
+// Host stand-in for i2c::I2CDevice, with the register helpers the
+// components use
+
+#include "esphome/core/log.h"
+#include "esphome/core/helpers.h"
+#include "i2c_bus.h"
+#include <cstring>
+#include <vector>
+
+namespace esphome {
+namespace i2c {
+
+class I2CDevice {
+ public:
+  I2CDevice() = default;
+  void set_i2c_address(uint8_t address) { this->address_ = address; }
+  void set_i2c_bus(I2CBus *bus) { this->bus_ = bus; }
+  uint8_t get_i2c_address() const { return this->address_; }
+
+  ErrorCode read(uint8_t *data, size_t len) {
+    return this->bus_ != nullptr ? this->bus_->read(this->address_, data, len) : ERROR_NOT_INITIALIZED;
+  }
+  ErrorCode write(const uint8_t *data, size_t len, bool stop = true) {
+    return this->bus_ != nullptr ? this->bus_->write(this->address_, data, len, stop) : ERROR_NOT_INITIALIZED;
+  }
+
+  ErrorCode read_register(uint8_t a_register, uint8_t *data, size_t len, bool stop = true) {
+    ErrorCode err = this->write(&a_register, 1, stop);
+    if (err != ERROR_OK) return err;
+    return this->read(data, len);
+  }
+  ErrorCode write_register(uint8_t a_register, const uint8_t *data, size_t len, bool stop = true) {
+    std::vector<uint8_t> buffer(len + 1);
+    buffer[0] = a_register;
+    if (len > 0) std::memcpy(buffer.data() + 1, data, len);
+    return this->write(buffer.data(), buffer.size(), stop);
+  }
+
+  bool read_byte(uint8_t a_register, uint8_t *data, bool stop = true) {
+    return this->read_register(a_register, data, 1, stop) == ERROR_OK;
+  }
+  bool write_byte(uint8_t a_register, uint8_t data, bool stop = true) {
+    return this->write_register(a_register, &data, 1, stop) == ERROR_OK;
+  }
+  bool read_bytes(uint8_t a_register, uint8_t *data, uint8_t len) {
+    return this->read_register(a_register, data, len) == ERROR_OK;
+  }
+  bool write_bytes(uint8_t a_register, const uint8_t *data, uint8_t len) {
+    return this->write_register(a_register, data, len) == ERROR_OK;
+  }
+
+ protected:
+  uint8_t address_{0x00};
+  I2CBus *bus_{nullptr};
+};
+
+}  // namespace i2c
+}  // namespace esphome
+
+#define LOG_I2C_DEVICE(this) ESP_LOGCONFIG(TAG, "  Address: 0x%02X", this->address_);
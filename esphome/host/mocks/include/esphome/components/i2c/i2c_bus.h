@@ -0,0 +1,37 @@
+#pragma once
+
+// Host stand-in for the ESPHome I2C bus interface. host::MockI2CBus in
+// host/mock_i2c.h implements it with register-map devices.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace i2c {
+
+enum ErrorCode {
+  NO_ERROR = 0,
+  ERROR_OK = 0,
+  ERROR_INVALID_ARGUMENT = 1,
+  ERROR_NOT_ACKNOWLEDGED = 2,
+  ERROR_TIMEOUT = 3,
+  ERROR_NOT_INITIALIZED = 4,
+  ERROR_TOO_LARGE = 5,
+  ERROR_UNKNOWN = 6,
+  ERROR_CRC = 7,
+};
+
+class I2CBus {
+ public:
+  virtual ~I2CBus() = default;
+  virtual ErrorCode read(uint8_t address, uint8_t *buffer, size_t len) = 0;
+  virtual ErrorCode write(uint8_t address, const uint8_t *buffer, size_t len, bool stop) = 0;
+};
+
+class InternalI2CBus : public I2CBus {
+ public:
+  virtual int get_port() const = 0;
+};
+
+}  // namespace i2c
+}  // namespace esphome
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for the network helpers: connected unless a test takes the
+// link down with host::set_network_connected(false)
+
+namespace esphome {
+namespace network {
+
+bool is_connected();
+
+}  // namespace network
+}  // namespace esphome
@@ -0,0 +1,39 @@
+#pragma once
+
+// Host stand-in for sensor::Sensor: keeps the last state and how often it
+// was published
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  explicit Sensor(const std::string &name = "") : name_(name) {}
+
+  void publish_state(float state) {
+    this->state = state;
+    this->publish_count_++;
+  }
+  float get_state() const { return this->state; }
+  bool has_state() const { return this->publish_count_ > 0; }
+  uint32_t get_publish_count() const { return this->publish_count_; }
+  const std::string &get_name() const { return this->name_; }
+
+  float state{NAN};
+
+ protected:
+  std::string name_;
+  uint32_t publish_count_{0};
+};
+
+}  // namespace sensor
+}  // namespace esphome
+
+#define LOG_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) { \
+    ESP_LOGCONFIG(TAG, "%s%s '%s'", prefix, type, (obj)->get_name().c_str()); \
+  }
@@ -0,0 +1,27 @@
+#pragma once
+
+// Host stand-in for text_sensor::TextSensor: keeps every published state
+
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  void publish_state(const std::string &state) {
+    this->state = state;
+    this->history_.push_back(state);
+  }
+  const std::string &get_state() const { return this->state; }
+  const std::vector<std::string> &get_history() const { return this->history_; }
+
+  std::string state;
+
+ protected:
+  std::vector<std::string> history_;
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
@@ -0,0 +1,70 @@
+#pragma once
+
+// Host stand-in for the ESPHome automation types the components declare
+// actions and triggers with
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace esphome {
+
+template<typename T, typename... X> class TemplatableValue {
+ public:
+  TemplatableValue() = default;
+  template<typename F, typename std::enable_if<std::is_invocable<F, X...>::value, int>::type = 0>
+  TemplatableValue(F f) : has_value_(true), f_(f) {}
+  template<typename V, typename std::enable_if<!std::is_invocable<V, X...>::value, int>::type = 0>
+  TemplatableValue(V value) : has_value_(true), value_(value) {}
+
+  bool has_value() const { return this->has_value_; }
+  T value(X... x) const { return this->f_ ? this->f_(x...) : this->value_; }
+
+ protected:
+  bool has_value_{false};
+  T value_{};
+  std::function<T(X...)> f_;
+};
+
+#define TEMPLATABLE_VALUE_(type, name) \
+ protected: \
+  TemplatableValue<type, Ts...> name##_{}; \
+\
+ public: \
+  template<typename V> void set_##name(V name) { this->name##_ = name; }
+
+#define TEMPLATABLE_VALUE(type, name) TEMPLATABLE_VALUE_(type, name)
+
+template<typename T> class Parented {
+ public:
+  Parented() = default;
+  Parented(T *parent) : parent_(parent) {}
+  T *get_parent() const { return this->parent_; }
+  void set_parent(T *parent) { this->parent_ = parent; }
+
+ protected:
+  T *parent_{nullptr};
+};
+
+template<typename... Ts> class Trigger {
+ public:
+  void trigger(Ts... x) {
+    for (auto &callback : this->callbacks_)
+      callback(x...);
+  }
+  // Host only: what an automation attached to the trigger would run
+  void add_callback(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+
+ protected:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+template<typename... Ts> class Action {
+ public:
+  virtual ~Action() = default;
+  virtual void play(Ts... x) = 0;
+  void play_complex(Ts... x) { this->play(x...); }
+};
+
+}  // namespace esphome
@@ -0,0 +1,62 @@
+#pragma once
+
+// Host stand-in for esphome::Component. The loop flag is what
+// disable_loop()/enable_loop() toggle on the device; host::run_loop() honours
+// it, so tests see the same idle behaviour.
+
+#include "esphome/core/log.h"
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+
+namespace setup_priority {
+const float BUS = 1000.0f;
+const float IO = 900.0f;
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+const float PROCESSOR = 400.0f;
+const float WIFI = 250.0f;
+const float AFTER_WIFI = 200.0f;
+const float AFTER_CONNECTION = 100.0f;
+const float LATE = -100.0f;
+}  // namespace setup_priority
+
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return setup_priority::DATA; }
+
+  void mark_failed() { this->failed_ = true; }
+  bool is_failed() const { return this->failed_; }
+
+  void disable_loop() { this->loop_enabled_ = false; }
+  void enable_loop() { this->loop_enabled_ = true; }
+  // Safe from other tasks and interrupts
+  void enable_loop_soon_any_context() { this->loop_enabled_ = true; }
+  bool is_loop_enabled() const { return this->loop_enabled_; }
+
+ protected:
+  bool failed_{false};
+  std::atomic<bool> loop_enabled_{true};
+};
+
+class PollingComponent : public Component {
+ public:
+  PollingComponent() = default;
+  explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+  virtual void update() = 0;
+  void set_update_interval(uint32_t update_interval) { this->update_interval_ = update_interval; }
+  uint32_t get_update_interval() const { return this->update_interval_; }
+
+ protected:
+  uint32_t update_interval_{60000};
+};
+
+}  // namespace esphome
+
+#define LOG_UPDATE_INTERVAL(this) \
+  ESP_LOGCONFIG(TAG, "  Update Interval: %.1fs", (this)->get_update_interval() / 1000.0f)
@@ -0,0 +1,11 @@
+#pragma once
+
+// What codegen would define for the medallion on Arduino-ESP32. The web
+// server handlers (USE_MEDALLION_VOICE_DOWNLOAD, USE_PERF_STATS_TRACE_HTTP)
+// are left out: the host build has no esp_http_server.
+
+#define USE_ARDUINO
+#define USE_ESP32
+#define USE_SENSOR
+#define USE_TEXT_SENSOR
+#define USE_BINARY_SENSOR
@@ -0,0 +1,27 @@
+#pragma once
+
+// Host stand-in for the ESPHome HAL: time from the monotonic clock, delays
+// that sleep the calling thread
+
+#include "esphome/core/gpio.h"
+#include <cstdint>
+
+#define IRAM_ATTR
+#define ESPHOME_ALWAYS_INLINE __attribute__((always_inline))
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+}  // namespace esphome
+
+// Arduino code calls these outside the esphome namespace
+using esphome::delay;
+using esphome::delayMicroseconds;
+using esphome::micros;
+using esphome::millis;
+using esphome::yield;
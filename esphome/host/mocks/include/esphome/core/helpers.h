@@ -0,0 +1,96 @@
+#pragma once
+
+// Host stand-in for the ESPHome helpers the components use. Both allocators
+// take from the host heap; external RAM can be switched off to exercise the
+// no-PSRAM paths (host::set_psram_available()).
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace esphome {
+
+namespace host {
+bool is_psram_available();
+// Largest internal RAM block an S3 has free once WiFi is up
+static constexpr size_t INTERNAL_LARGEST_BLOCK = 128 * 1024;
+}  // namespace host
+
+template<typename T> class CallbackManager;
+
+template<typename... Ts> class CallbackManager<void(Ts...)> {
+ public:
+  void add(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+  void call(Ts... args) {
+    for (auto &callback : this->callbacks_)
+      callback(args...);
+  }
+  size_t size() const { return this->callbacks_.size(); }
+
+ protected:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+template<class T> class RAMAllocator {
+ public:
+  using value_type = T;
+
+  enum Flags {
+    NONE = 0,
+    ALLOC_EXTERNAL = 1 << 0,
+    ALLOC_INTERNAL = 1 << 1,
+    ALLOW_FAILURE = 1 << 2,
+  };
+
+  RAMAllocator() = default;
+  RAMAllocator(uint8_t flags) : flags_(flags) {}
+  template<class U> constexpr RAMAllocator(const RAMAllocator<U> &other) : flags_(other.get_flags()) {}
+
+  T *allocate(size_t n) {
+    // External only, with no PSRAM to take it from
+    if ((this->flags_ & (ALLOC_EXTERNAL | ALLOC_INTERNAL)) == ALLOC_EXTERNAL && !host::is_psram_available())
+      return nullptr;
+    T *ptr = static_cast<T *>(std::malloc(n * sizeof(T)));
+    if (ptr == nullptr && !(this->flags_ & ALLOW_FAILURE)) std::abort();
+    return ptr;
+  }
+  void deallocate(T *p, size_t n) { std::free(p); }
+
+  uint8_t get_flags() const { return this->flags_; }
+
+ protected:
+  uint8_t flags_{ALLOW_FAILURE};
+};
+
+template<class T> class ExternalRAMAllocator {
+ public:
+  using value_type = T;
+
+  enum Flags {
+    NONE = 0,
+    REFUSE_INTERNAL = 1 << 0,
+    ALLOW_FAILURE = 1 << 1,
+  };
+
+  ExternalRAMAllocator() = default;
+  ExternalRAMAllocator(Flags flags) : flags_(flags) {}
+  template<class U> constexpr ExternalRAMAllocator(const ExternalRAMAllocator<U> &other) : flags_(other.flags_) {}
+
+  T *allocate(size_t n) {
+    // Without PSRAM this falls back to internal RAM unless refused, as on
+    // the device, where no block past INTERNAL_LARGEST_BLOCK is free
+    if (!host::is_psram_available() && ((this->flags_ & REFUSE_INTERNAL) || n * sizeof(T) > host::INTERNAL_LARGEST_BLOCK))
+      return nullptr;
+    T *ptr = static_cast<T *>(std::malloc(n * sizeof(T)));
+    if (ptr == nullptr && !(this->flags_ & ALLOW_FAILURE)) std::abort();
+    return ptr;
+  }
+  void deallocate(T *p, size_t n) { std::free(p); }
+
+  Flags flags_{ALLOW_FAILURE};
+};
+
+}  // namespace esphome
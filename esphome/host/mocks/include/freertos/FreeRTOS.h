@@ -0,0 +1,51 @@
+#pragma once
+
+// Host stand-in for ESP-IDF FreeRTOS: tasks are threads, queues and
+// semaphores are condition-variable queues, a tick is a millisecond
+// (CONFIG_FREERTOS_HZ=1000, as ESPHome builds it). Implemented in
+// mocks/src/freertos.cpp.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+struct HostTask;
+struct HostQueue;
+typedef HostTask *TaskHandle_t;
+typedef HostQueue *QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE ((BaseType_t) 0)
+#define pdTRUE ((BaseType_t) 1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define errQUEUE_FULL ((BaseType_t) 0)
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_TASK_NAME_LEN 16
+#define portTICK_PERIOD_MS ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t) (((TickType_t) (ms) * (TickType_t) configTICK_RATE_HZ) / (TickType_t) 1000U))
+#define tskNO_AFFINITY ((BaseType_t) 0x7FFFFFFF)
+
+// A spinlock, as on the dual-core ESP32
+struct portMUX_TYPE {
+  std::atomic<bool> locked{false};
+};
+#define portMUX_INITIALIZER_UNLOCKED \
+  {}
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_SAFE(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_SAFE(mux) vPortExitCritical(mux)
+#define portYIELD_FROM_ISR(woken) (void) (woken)
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait);
+BaseType_t xQueuePeek(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#define xQueueSendToBack(queue, item, ticks) xQueueSend(queue, item, ticks)
+#define xQueueSendFromISR(queue, item, woken) xQueueSend(queue, item, 0)
+#define xQueueSendToBackFromISR(queue, item, woken) xQueueSend(queue, item, 0)
+#define xQueueReceiveFromISR(queue, buffer, woken) xQueueReceive(queue, buffer, 0)
+#define xQueueOverwrite(queue, item) (xQueueReset(queue), xQueueSend(queue, item, 0))
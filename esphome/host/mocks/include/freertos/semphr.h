@@ -0,0 +1,16 @@
+#pragma once
+
+#include "queue.h"
+
+// As in FreeRTOS, a semaphore is a queue of empty items: giving sends one,
+// taking receives one. A mutex starts with its one item available.
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+
+#define xSemaphoreTake(semaphore, ticks) xQueueReceive(semaphore, nullptr, ticks)
+#define xSemaphoreGive(semaphore) xQueueSend(semaphore, nullptr, 0)
+#define xSemaphoreTakeFromISR(semaphore, woken) xQueueReceive(semaphore, nullptr, 0)
+#define xSemaphoreGiveFromISR(semaphore, woken) xQueueSend(semaphore, nullptr, 0)
+#define vSemaphoreDelete(semaphore) vQueueDelete(semaphore)
+#define uxSemaphoreGetCount(semaphore) uxQueueMessagesWaiting(semaphore)
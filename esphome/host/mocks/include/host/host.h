@@ -0,0 +1,25 @@
+#pragma once
+
+// Controls for the host build's simulated device, shared by tests and
+// benchmarks
+
+#include "esphome/core/component.h"
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+
+namespace esphome {
+namespace host {
+
+void set_log_level(int level);
+void set_network_connected(bool connected);
+void set_psram_available(bool available);
+
+// Calls loop() on every component whose loop is enabled, as the ESPHome
+// main loop does, until `done` returns true or `timeout_ms` elapses. Returns
+// whether `done` was reached.
+bool run_loop(std::initializer_list<Component *> components, const std::function<bool()> &done,
+              uint32_t timeout_ms);
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#pragma once
+
+// Host I2C bus with register-map devices. A device keeps 256 registers and a
+// pointer that the first written byte sets and every access advances, which
+// is how the CST92xx, ES8311 and AXP2101 behave. Each transfer takes
+// `byte_time_us` per byte so the arbiter's waits can be measured, and
+// overlapping transfers are counted, since the real bus would corrupt them.
+
+#include "esphome/components/i2c/i2c_bus.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+class RegisterDevice {
+ public:
+  virtual ~RegisterDevice() = default;
+
+  void set_register(uint8_t reg, uint8_t value);
+  void set_registers(uint8_t reg, const std::vector<uint8_t> &values);
+  uint8_t get_register(uint8_t reg) const;
+  // Register values in the order the host wrote them
+  std::vector<std::pair<uint8_t, uint8_t>> get_writes() const;
+  void set_nack(bool nack) { this->nack_ = nack; }
+
+  i2c::ErrorCode write(const uint8_t *data, size_t len);
+  i2c::ErrorCode read(uint8_t *data, size_t len);
+
+ protected:
+  mutable std::mutex lock_;
+  uint8_t registers_[256]{};
+  uint8_t pointer_{0};
+  bool nack_{false};
+  std::vector<std::pair<uint8_t, uint8_t>> writes_;
+};
+
+class MockI2CBus : public i2c::InternalI2CBus {
+ public:
+  explicit MockI2CBus(int port = 0) : port_(port) {}
+
+  void add_device(uint8_t address, RegisterDevice *device) { this->devices_[address] = device; }
+  void set_byte_time_us(uint32_t byte_time_us) { this->byte_time_us_ = byte_time_us; }
+
+  i2c::ErrorCode read(uint8_t address, uint8_t *buffer, size_t len) override;
+  i2c::ErrorCode write(uint8_t address, const uint8_t *buffer, size_t len, bool stop) override;
+  int get_port() const override { return this->port_; }
+
+  uint32_t get_transfer_count() const { return this->transfers_; }
+  uint32_t get_overlap_count() const { return this->overlaps_; }
+
+ protected:
+  RegisterDevice *find_(uint8_t address);
+  void occupy_(size_t bytes);
+
+  int port_;
+  std::map<uint8_t, RegisterDevice *> devices_;
+  uint32_t byte_time_us_{0};
+  std::atomic<int> active_{0};
+  std::atomic<uint32_t> transfers_{0};
+  std::atomic<uint32_t> overlaps_{0};
+};
+
+// Clock the arbiter last set on `port` through i2cSetClock()
+uint32_t i2c_clock(uint8_t port);
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,32 @@
+#pragma once
+
+// Controls for the host I2S receive driver (driver/i2s.h)
+
+#include <cstdint>
+#include <functional>
+
+namespace esphome {
+namespace host {
+
+// Sample `frame` of `channel` (0 left, 1 right) as 16-bit PCM; wider slots
+// carry it left-justified, as the ES8311 does
+using I2SSource = std::function<int16_t(uint64_t frame, int channel)>;
+
+// Default (or nullptr): a half-scale tone at 1/16 of the sample rate on
+// both channels
+void i2s_set_source(I2SSource source);
+
+// Real time (the default) paces the DMA at the configured rate, so a reader
+// that stalls overflows. Free-running serves every read at once, for
+// measuring how fast the pipeline behind the codec can go.
+void i2s_set_realtime(bool realtime);
+
+// Uninstall every driver, as a reboot does
+void i2s_reset();
+
+uint64_t i2s_frames_read();
+// DMA buffers dropped because the reader fell behind
+uint32_t i2s_overflow_count();
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#pragma once
+
+// A GPIO for the host build: remembers its level and mode, and lets a test
+// raise the interrupt a component attached to it
+
+#include "esphome/core/gpio.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+namespace esphome {
+namespace host {
+
+class MockPin : public InternalGPIOPin {
+ public:
+  explicit MockPin(uint8_t pin, bool inverted = false) : pin_(pin), inverted_(inverted) {}
+
+  void setup() override { this->setup_count_++; }
+  void pin_mode(gpio::Flags flags) override { this->flags_ = flags; }
+  bool digital_read() override { return this->level_ != this->inverted_; }
+  void digital_write(bool value) override {
+    this->level_ = value != this->inverted_;
+    this->write_count_++;
+  }
+  std::string dump_summary() const override {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "GPIO%u", this->pin_);
+    return buffer;
+  }
+  void detach_interrupt() const override { this->isr_ = nullptr; }
+  uint8_t get_pin() const override { return this->pin_; }
+  bool is_inverted() const override { return this->inverted_; }
+
+  // Drive the input from outside; fires the attached interrupt on a
+  // matching edge
+  void set_level(bool level) {
+    bool previous = this->level_.exchange(level);
+    if (this->isr_ == nullptr || previous == level) return;
+    bool rising = level && !previous;
+    if ((rising && (this->type_ & gpio::INTERRUPT_RISING_EDGE)) ||
+        (!rising && (this->type_ & gpio::INTERRUPT_FALLING_EDGE)))
+      this->isr_(this->isr_arg_);
+  }
+  void pulse() {
+    this->set_level(true);
+    this->set_level(false);
+  }
+  bool get_level() const { return this->level_; }
+  uint32_t get_setup_count() const { return this->setup_count_; }
+  uint32_t get_write_count() const { return this->write_count_; }
+  bool has_interrupt() const { return this->isr_ != nullptr; }
+
+ protected:
+  void attach_interrupt(void (*func)(void *), void *arg, gpio::InterruptType type) const override {
+    this->isr_arg_ = arg;
+    this->type_ = type;
+    this->isr_ = func;
+  }
+
+  uint8_t pin_;
+  bool inverted_;
+  gpio::Flags flags_{gpio::FLAG_NONE};
+  std::atomic<bool> level_{false};
+  uint32_t setup_count_{0};
+  uint32_t write_count_{0};
+  mutable std::atomic<void (*)(void *)> isr_{nullptr};
+  mutable void *isr_arg_{nullptr};
+  mutable gpio::InterruptType type_{gpio::INTERRUPT_RISING_EDGE};
+};
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,125 @@
+#pragma once
+
+// The SD card behind the SdFat stand-in. Files live in memory; a card image
+// (one file on the host) can be loaded before mounting and saved after.
+//
+// Writes land in the file's data at once, but its size as a power cut would
+// leave it only advances on sync() or close(), like a FAT directory entry.
+// power_cut() rolls every file back to that size and invalidates every open
+// handle, so recovery code can be run against what the card really holds.
+//
+// SdFat is not thread-safe, so the recorder serialises it with a mutex. The
+// card counts calls that overlap another task's call, which is what a
+// missing lock looks like; set_access_delay() widens each call to make a
+// race show up reliably.
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+struct SdNode {
+  bool is_dir{false};
+  std::vector<uint8_t> data;
+  uint64_t synced_size{0};
+};
+
+class MockSdCard {
+ public:
+  // Mounting fails while absent
+  void set_present(bool present) { this->present_ = present; }
+  bool is_present() const { return this->present_; }
+  void set_capacity(uint64_t bytes) { this->capacity_ = bytes; }
+  uint64_t get_capacity() const { return this->capacity_; }
+  uint64_t get_used() const;
+
+  // Time every write takes: a fixed cost plus a cost per KiB, the way a card
+  // behind SPI does (roughly 1-2 ms per 4 KiB at 20 MHz)
+  void set_write_latency(uint32_t per_call_us, uint32_t per_kib_us) {
+    this->write_call_us_ = per_call_us;
+    this->write_kib_us_ = per_kib_us;
+  }
+  void set_read_latency(uint32_t per_call_us, uint32_t per_kib_us) {
+    this->read_call_us_ = per_call_us;
+    this->read_kib_us_ = per_kib_us;
+  }
+  // Held inside every card call, to make overlapping calls likely
+  void set_access_delay(uint32_t us) { this->access_delay_us_ = us; }
+  // Every write of more than `bytes` is cut short to `bytes`; 0: off
+  void set_short_write(uint32_t bytes) { this->short_write_ = bytes; }
+
+  void power_cut();
+  void format();
+  bool load_image(const std::string &path);
+  bool save_image(const std::string &path);
+
+  // Contents of the file at `path`, as written (not as synced)
+  bool read_file(const std::string &path, std::vector<uint8_t> &out);
+  bool write_file(const std::string &path, const std::vector<uint8_t> &data);
+  bool exists(const std::string &path);
+  std::vector<std::string> list(const std::string &dir);
+
+  uint32_t get_mount_count() const { return this->mount_count_; }
+  uint64_t get_bytes_written() const { return this->bytes_written_; }
+  uint64_t get_bytes_read() const { return this->bytes_read_; }
+  uint32_t get_concurrent_accesses() const { return this->concurrent_accesses_; }
+  void reset_counters();
+
+  // Used by the SdFat stand-in
+  static std::string normalize(const char *path);
+  std::shared_ptr<SdNode> find(const std::string &path);
+  std::shared_ptr<SdNode> create(const std::string &path, bool is_dir);
+  bool remove(const std::string &path);
+  bool rename(const std::string &from, const std::string &to);
+  std::string next_entry(const std::string &dir, const std::string &after);
+  bool mount();
+  void unmount() { this->mounted_ = false; }
+  bool is_mounted() const { return this->mounted_; }
+  void write_delay(size_t bytes);
+  void read_delay(size_t bytes);
+  void count_written(size_t bytes) { this->bytes_written_ += bytes; }
+  void count_read(size_t bytes) { this->bytes_read_ += bytes; }
+  uint32_t get_short_write() const { return this->short_write_; }
+
+  // Marks a call into the card for the overlap count
+  class Access {
+   public:
+    explicit Access(MockSdCard *card);
+    ~Access();
+
+   protected:
+    MockSdCard *card_;
+  };
+
+ protected:
+  friend class Access;
+
+  mutable std::recursive_mutex lock_;  // the host's own map, not the recorder's lock
+  std::map<std::string, std::shared_ptr<SdNode>> nodes_{{"", std::make_shared<SdNode>(SdNode{true, {}, 0})}};
+  bool present_{true};
+  bool mounted_{false};
+  uint64_t capacity_{4ULL << 30};
+  uint32_t write_call_us_{0};
+  uint32_t write_kib_us_{0};
+  uint32_t read_call_us_{0};
+  uint32_t read_kib_us_{0};
+  uint32_t access_delay_us_{0};
+  uint32_t short_write_{0};
+  uint32_t mount_count_{0};
+  std::atomic<uint64_t> bytes_written_{0};
+  std::atomic<uint64_t> bytes_read_{0};
+  std::atomic<int> active_accesses_{0};
+  std::atomic<uint32_t> concurrent_accesses_{0};
+};
+
+// The one card in the slot
+MockSdCard &sd_card();
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,9 @@
+#pragma once
+
+// lwIP's BSD socket API is the POSIX one on the host
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
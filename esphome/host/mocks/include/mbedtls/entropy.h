@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+typedef struct mbedtls_entropy_context {
+  int unused;
+} mbedtls_entropy_context;
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx);
+void mbedtls_entropy_free(mbedtls_entropy_context *ctx);
+int mbedtls_entropy_func(void *data, unsigned char *output, size_t len);
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <cstddef>
+
+void mbedtls_strerror(int errnum, char *buffer, size_t buflen);
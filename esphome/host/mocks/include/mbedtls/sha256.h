@@ -0,0 +1,21 @@
+#pragma once
+
+// Host stand-in for mbedTLS SHA-256: a plain software implementation with
+// the mbedTLS 3 API, so content digests match the device's
+
+#include <cstddef>
+#include <cstdint>
+
+typedef struct mbedtls_sha256_context {
+  uint32_t state[8];
+  uint64_t total;
+  unsigned char buffer[64];
+  int is224;
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx);
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen);
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output);
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char *output, int is224);
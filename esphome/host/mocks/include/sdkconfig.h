@@ -0,0 +1,6 @@
+#pragma once
+
+// The host build has no crypto accelerator: CONFIG_MBEDTLS_HARDWARE_* are
+// left undefined
+
+#define CONFIG_FREERTOS_HZ 1000
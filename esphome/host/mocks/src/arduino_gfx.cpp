@@ -0,0 +1,115 @@
+#include <Arduino_GFX_Library.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+Arduino_CO5300 *last_panel = nullptr;
+}  // namespace
+
+namespace esphome {
+namespace host {
+Arduino_CO5300 *display_panel() { return last_panel; }
+}  // namespace host
+}  // namespace esphome
+
+bool Arduino_DataBus::begin(int32_t speed, int8_t data_mode) {
+  (void) speed;
+  (void) data_mode;
+  return true;
+}
+
+void Arduino_DataBus::writeCommand(uint8_t c) { this->commands_.emplace_back(c, 0); }
+
+void Arduino_DataBus::writeC8D8(uint8_t c, uint8_t d) { this->commands_.emplace_back(c, d); }
+
+void Arduino_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  int16_t x1 = std::max<int16_t>(x, 0), y1 = std::max<int16_t>(y, 0);
+  int16_t x2 = std::min<int16_t>(x + w, this->WIDTH), y2 = std::min<int16_t>(y + h, this->HEIGHT);
+  if (x1 >= x2 || y1 >= y2) return;
+  this->write_rect_(x1, y1, x2 - x1, y2 - y1, nullptr, color);
+}
+
+void Arduino_GFX::draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16_t h) {
+  // Only whole, on-screen bitmaps are drawn by the driver
+  if (x < 0 || y < 0 || x + w > this->WIDTH || y + h > this->HEIGHT || w <= 0 || h <= 0) return;
+  this->write_rect_(x, y, w, h, bitmap, 0);
+}
+
+size_t Arduino_GFX::print(const char *text) {
+  size_t len = strlen(text);
+  this->cursor_x_ += len * 6 * this->text_size_;
+  return len;
+}
+
+size_t Arduino_GFX::println(const char *text) {
+  size_t len = this->print(text);
+  this->cursor_x_ = 0;
+  this->cursor_y_ += 8 * this->text_size_;
+  return len + 1;
+}
+
+Arduino_CO5300::Arduino_CO5300(Arduino_DataBus *bus, int8_t rst, uint8_t r, bool ips, int16_t w, int16_t h,
+                               uint8_t col_offset1, uint8_t row_offset1, uint8_t col_offset2, uint8_t row_offset2)
+    : Arduino_GFX(w, h), bus_(bus) {
+  (void) rst;
+  (void) r;
+  (void) ips;
+  (void) col_offset1;
+  (void) row_offset1;
+  (void) col_offset2;
+  (void) row_offset2;
+  last_panel = this;
+}
+
+bool Arduino_CO5300::begin(int32_t speed) {
+  if (!this->bus_->begin(speed)) return false;
+  this->pixels_.assign((size_t) this->WIDTH * this->HEIGHT, 0);
+  return true;
+}
+
+void Arduino_CO5300::write_rect_(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels,
+                                 uint16_t color) {
+  for (int16_t row = 0; row < h; row++) {
+    uint16_t *dest = &this->pixels_[(size_t) (y + row) * this->WIDTH + x];
+    if (pixels != nullptr) {
+      memcpy(dest, pixels + (size_t) row * w, w * sizeof(uint16_t));
+    } else {
+      std::fill(dest, dest + w, color);
+    }
+  }
+  this->writes_++;
+  this->pixels_written_ += (uint64_t) w * h;
+  this->write_thread_ = std::this_thread::get_id();
+}
+
+Arduino_Canvas::~Arduino_Canvas() {
+  if (this->owns_framebuffer_) free(this->_framebuffer);
+}
+
+bool Arduino_Canvas::begin(int32_t speed) {
+  if (speed != GFX_SKIP_OUTPUT_BEGIN && !this->_output->begin(speed)) return false;
+  if (this->_framebuffer == nullptr) {
+    this->_framebuffer = static_cast<uint16_t *>(calloc((size_t) this->WIDTH * this->HEIGHT, sizeof(uint16_t)));
+    if (this->_framebuffer == nullptr) return false;
+    this->owns_framebuffer_ = true;
+  }
+  return true;
+}
+
+void Arduino_Canvas::flush() {
+  this->_output->draw16bitRGBBitmap(this->_output_x, this->_output_y, this->_framebuffer, this->WIDTH, this->HEIGHT);
+}
+
+void Arduino_Canvas::write_rect_(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels,
+                                 uint16_t color) {
+  for (int16_t row = 0; row < h; row++) {
+    uint16_t *dest = &this->_framebuffer[(size_t) (y + row) * this->WIDTH + x];
+    if (pixels != nullptr) {
+      memcpy(dest, pixels + (size_t) row * w, w * sizeof(uint16_t));
+    } else {
+      std::fill(dest, dest + w, color);
+    }
+  }
+}
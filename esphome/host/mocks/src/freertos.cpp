@@ -0,0 +1,206 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esphome/core/hal.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HostTask {
+  std::string name;
+  UBaseType_t priority{1};
+  std::mutex lock;
+  std::condition_variable notified;
+  uint32_t notify_count{0};
+};
+
+struct HostQueue {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length{0};
+  UBaseType_t item_size{0};
+};
+
+namespace {
+
+thread_local HostTask *current_task = nullptr;
+
+// Runs `wait` until `ready` holds or the FreeRTOS timeout expires
+template<typename Pred> bool wait_for(std::unique_lock<std::mutex> &lock, std::condition_variable &cv,
+                                      TickType_t ticks, Pred ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), ready);
+}
+
+BaseType_t queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, bool front) {
+  if (queue == nullptr) return pdFALSE;
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!wait_for(lock, queue->changed, ticks, [queue] { return queue->items.size() < queue->length; }))
+    return errQUEUE_FULL;
+  std::vector<uint8_t> data(queue->item_size);
+  if (item != nullptr && queue->item_size > 0) memcpy(data.data(), item, queue->item_size);
+  if (front) {
+    queue->items.push_front(std::move(data));
+  } else {
+    queue->items.push_back(std::move(data));
+  }
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t queue_receive(QueueHandle_t queue, void *buffer, TickType_t ticks, bool remove) {
+  if (queue == nullptr) return pdFALSE;
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!wait_for(lock, queue->changed, ticks, [queue] { return !queue->items.empty(); }))
+    return pdFALSE;
+  if (buffer != nullptr && queue->item_size > 0) memcpy(buffer, queue->items.front().data(), queue->item_size);
+  if (remove) {
+    queue->items.pop_front();
+    queue->changed.notify_all();
+  }
+  return pdTRUE;
+}
+
+}  // namespace
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+  while (mux->locked.exchange(true, std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) { mux->locked.store(false, std::memory_order_release); }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stack_depth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *created_task, BaseType_t core_id) {
+  (void) stack_depth;
+  (void) core_id;
+  auto *task = new HostTask();
+  task->name = name != nullptr ? name : "";
+  task->priority = priority;
+  if (created_task != nullptr) *created_task = task;
+  // Tasks in these components never return or get deleted; the thread lives
+  // until the process exits
+  std::thread([code, param, task] {
+    current_task = task;
+    code(param);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *created_task) {
+  return xTaskCreatePinnedToCore(code, name, stack_depth, param, priority, created_task, tskNO_AFFINITY);
+}
+
+void vTaskDelay(TickType_t ticks) { esphome::delay(ticks * portTICK_PERIOD_MS); }
+
+TickType_t xTaskGetTickCount() { return esphome::millis() / portTICK_PERIOD_MS; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (current_task == nullptr) {
+    // Threads not started through xTaskCreate (the test's main thread) play
+    // the Arduino loop task
+    current_task = new HostTask();
+    current_task->name = "loopTask";
+  }
+  return current_task;
+}
+
+char *pcTaskGetName(TaskHandle_t task) {
+  if (task == nullptr) task = xTaskGetCurrentTaskHandle();
+  return const_cast<char *>(task->name.c_str());
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+  if (task == nullptr) task = xTaskGetCurrentTaskHandle();
+  return task->priority;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lock(task->lock);
+  task->notify_count++;
+  task->notified.notify_all();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken) {
+  xTaskNotifyGive(task);
+  if (higher_priority_task_woken != nullptr) *higher_priority_task_woken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait) {
+  HostTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->lock);
+  wait_for(lock, task->notified, ticks_to_wait, [task] { return task->notify_count > 0; });
+  uint32_t count = task->notify_count;
+  if (count > 0) task->notify_count = clear_count_on_exit ? 0 : count - 1;
+  return count;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  auto *queue = new HostQueue();
+  queue->length = length;
+  queue->item_size = item_size;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+  return queue_send(queue, item, ticks_to_wait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+  return queue_send(queue, item, ticks_to_wait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait) {
+  return queue_receive(queue, buffer, ticks_to_wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait) {
+  return queue_receive(queue, buffer, ticks_to_wait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->lock);
+  queue->items.clear();
+  queue->changed.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->lock);
+  return queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->lock);
+  return queue->length - queue->items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  SemaphoreHandle_t semaphore = xQueueCreate(1, 0);
+  xQueueSend(semaphore, nullptr, 0);
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xQueueCreate(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+  SemaphoreHandle_t semaphore = xQueueCreate(max_count, 0);
+  for (UBaseType_t i = 0; i < initial_count; i++) xQueueSend(semaphore, nullptr, 0);
+  return semaphore;
+}
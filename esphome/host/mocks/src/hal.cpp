@@ -0,0 +1,80 @@
+#include "Arduino.h"
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esphome/core/hal.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+const Clock::time_point START = Clock::now();
+
+int64_t elapsed_ns() { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - START).count(); }
+
+}  // namespace
+
+namespace esphome {
+
+uint32_t millis() { return static_cast<uint32_t>(elapsed_ns() / 1000000); }
+uint32_t micros() { return static_cast<uint32_t>(elapsed_ns() / 1000); }
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void yield() { std::this_thread::yield(); }
+
+}  // namespace esphome
+
+uint32_t getCpuFrequencyMhz() { return 240; }
+
+int64_t esp_timer_get_time() { return elapsed_ns() / 1000; }
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count() { return static_cast<esp_cpu_cycle_count_t>(elapsed_ns()); }
+
+uint32_t esp_random() {
+  static thread_local std::mt19937 generator{std::random_device{}()};
+  return generator();
+}
+
+void esp_fill_random(void *buf, size_t len) {
+  auto *bytes = static_cast<uint8_t *>(buf);
+  for (size_t i = 0; i < len; i++) bytes[i] = static_cast<uint8_t>(esp_random());
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc ^= buf[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK:
+      return "ESP_OK";
+    case ESP_FAIL:
+      return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+      return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+      return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+      return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+      return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+      return "ESP_ERR_TIMEOUT";
+    default:
+      return "UNKNOWN ERROR";
+  }
+}
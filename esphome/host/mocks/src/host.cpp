@@ -0,0 +1,85 @@
+#include "host/host.h"
+#include "esphome/components/network/util.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+
+namespace esphome {
+
+namespace {
+
+std::atomic<int> log_level{ESPHOME_LOG_LEVEL_INFO};
+std::atomic<bool> network_connected{true};
+std::atomic<bool> psram_available{true};
+std::mutex log_lock;
+
+const char *level_letter(int level) {
+  switch (level) {
+    case ESPHOME_LOG_LEVEL_ERROR:
+      return "E";
+    case ESPHOME_LOG_LEVEL_WARN:
+      return "W";
+    case ESPHOME_LOG_LEVEL_INFO:
+      return "I";
+    case ESPHOME_LOG_LEVEL_CONFIG:
+      return "C";
+    case ESPHOME_LOG_LEVEL_DEBUG:
+      return "D";
+    case ESPHOME_LOG_LEVEL_VERBOSE:
+      return "V";
+    default:
+      return "VV";
+  }
+}
+
+}  // namespace
+
+void esp_log_vprintf_(int level, const char *tag, int line, const char *format, va_list args) {
+  if (level > log_level.load()) return;
+  std::lock_guard<std::mutex> lock(log_lock);
+  fprintf(stderr, "[%8.3f][%s][%s:%03d]: ", millis() / 1000.0, level_letter(level), tag, line);
+  vfprintf(stderr, format, args);
+  fputc('\n', stderr);
+}
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  esp_log_vprintf_(level, tag, line, format, args);
+  va_end(args);
+}
+
+namespace network {
+bool is_connected() { return network_connected.load(); }
+}  // namespace network
+
+namespace host {
+
+void set_log_level(int level) { log_level = level; }
+void set_network_connected(bool connected) { network_connected = connected; }
+void set_psram_available(bool available) { psram_available = available; }
+bool is_psram_available() { return psram_available.load(); }
+
+bool run_loop(std::initializer_list<Component *> components, const std::function<bool()> &done,
+              uint32_t timeout_ms) {
+  uint32_t start = millis();
+  while (!done()) {
+    if (millis() - start > timeout_ms) return false;
+    bool any = false;
+    for (Component *component : components) {
+      if (component->is_failed() || !component->is_loop_enabled()) continue;
+      component->loop();
+      any = true;
+    }
+    // The device's main loop idles for up to 16 ms when nothing needs it
+    if (!any) delay(1);
+  }
+  return true;
+}
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,98 @@
+#include "host/mock_i2c.h"
+#include "esp32-hal-i2c.h"
+#include "esphome/core/hal.h"
+
+#include <atomic>
+
+namespace esphome {
+namespace host {
+
+namespace {
+std::atomic<uint32_t> port_clocks[2] = {{400000}, {400000}};
+}  // namespace
+
+void RegisterDevice::set_register(uint8_t reg, uint8_t value) {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  this->registers_[reg] = value;
+}
+
+void RegisterDevice::set_registers(uint8_t reg, const std::vector<uint8_t> &values) {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  for (uint8_t value : values) this->registers_[reg++] = value;
+}
+
+uint8_t RegisterDevice::get_register(uint8_t reg) const {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  return this->registers_[reg];
+}
+
+std::vector<std::pair<uint8_t, uint8_t>> RegisterDevice::get_writes() const {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  return this->writes_;
+}
+
+i2c::ErrorCode RegisterDevice::write(const uint8_t *data, size_t len) {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  if (this->nack_) return i2c::ERROR_NOT_ACKNOWLEDGED;
+  if (len == 0) return i2c::ERROR_OK;
+  this->pointer_ = data[0];
+  for (size_t i = 1; i < len; i++) {
+    this->registers_[this->pointer_] = data[i];
+    this->writes_.emplace_back(this->pointer_, data[i]);
+    this->pointer_++;
+  }
+  return i2c::ERROR_OK;
+}
+
+i2c::ErrorCode RegisterDevice::read(uint8_t *data, size_t len) {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  if (this->nack_) return i2c::ERROR_NOT_ACKNOWLEDGED;
+  for (size_t i = 0; i < len; i++) data[i] = this->registers_[this->pointer_++];
+  return i2c::ERROR_OK;
+}
+
+RegisterDevice *MockI2CBus::find_(uint8_t address) {
+  auto it = this->devices_.find(address);
+  return it != this->devices_.end() ? it->second : nullptr;
+}
+
+void MockI2CBus::occupy_(size_t bytes) {
+  this->transfers_++;
+  if (this->byte_time_us_ > 0) delayMicroseconds(this->byte_time_us_ * (bytes + 1));
+}
+
+i2c::ErrorCode MockI2CBus::read(uint8_t address, uint8_t *buffer, size_t len) {
+  if (this->active_.fetch_add(1) > 0) this->overlaps_++;
+  this->occupy_(len);
+  RegisterDevice *device = this->find_(address);
+  i2c::ErrorCode err = device != nullptr ? device->read(buffer, len) : i2c::ERROR_NOT_ACKNOWLEDGED;
+  this->active_--;
+  return err;
+}
+
+i2c::ErrorCode MockI2CBus::write(uint8_t address, const uint8_t *buffer, size_t len, bool stop) {
+  (void) stop;
+  if (this->active_.fetch_add(1) > 0) this->overlaps_++;
+  this->occupy_(len);
+  RegisterDevice *device = this->find_(address);
+  i2c::ErrorCode err = device != nullptr ? device->write(buffer, len) : i2c::ERROR_NOT_ACKNOWLEDGED;
+  this->active_--;
+  return err;
+}
+
+uint32_t i2c_clock(uint8_t port) { return port < 2 ? port_clocks[port].load() : 0; }
+
+}  // namespace host
+}  // namespace esphome
+
+esp_err_t i2cGetClock(uint8_t i2c_num, uint32_t *frequency) {
+  if (i2c_num >= 2) return ESP_ERR_INVALID_ARG;
+  *frequency = esphome::host::port_clocks[i2c_num];
+  return ESP_OK;
+}
+
+esp_err_t i2cSetClock(uint8_t i2c_num, uint32_t frequency) {
+  if (i2c_num >= 2) return ESP_ERR_INVALID_ARG;
+  esphome::host::port_clocks[i2c_num] = frequency;
+  return ESP_OK;
+}
@@ -0,0 +1,191 @@
+#include "driver/i2s.h"
+#include "host/mock_i2s.h"
+#include "esphome/core/hal.h"
+#include "esp_timer.h"
+
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+namespace esphome {
+namespace host {
+
+namespace {
+
+struct Port {
+  bool installed{false};
+  uint32_t rate{16000};
+  uint32_t slot_bytes{2};
+  uint64_t capacity_frames{0};
+  uint32_t dma_buf_len{0};
+  QueueHandle_t events{nullptr};
+  int64_t start_us{0};
+  uint64_t produced_base{0};  // frames produced before the last clock change
+  uint64_t consumed{0};
+};
+
+std::mutex lock;
+Port ports[I2S_NUM_MAX];
+int16_t tone(uint64_t frame, int channel) {
+  (void) channel;
+  return static_cast<int16_t>(16384 * std::sin(2.0 * M_PI * 1000.0 * frame / 16000.0));
+}
+I2SSource source = tone;
+bool realtime = true;
+uint64_t frames_read = 0;
+uint32_t overflows = 0;
+
+uint64_t produced(const Port &port) {
+  int64_t elapsed = esp_timer_get_time() - port.start_us;
+  return port.produced_base + static_cast<uint64_t>(elapsed) * port.rate / 1000000;
+}
+
+void restart_clock(Port &port) {
+  port.start_us = esp_timer_get_time();
+  port.produced_base = port.consumed;
+}
+
+}  // namespace
+
+void i2s_set_source(I2SSource new_source) {
+  std::lock_guard<std::mutex> guard(lock);
+  source = new_source ? std::move(new_source) : tone;
+}
+
+void i2s_set_realtime(bool enabled) {
+  std::lock_guard<std::mutex> guard(lock);
+  realtime = enabled;
+  for (auto &port : ports) restart_clock(port);
+}
+
+void i2s_reset() {
+  std::lock_guard<std::mutex> guard(lock);
+  for (auto &port : ports) {
+    if (port.events != nullptr) vQueueDelete(port.events);
+    port = {};
+  }
+}
+
+uint64_t i2s_frames_read() {
+  std::lock_guard<std::mutex> guard(lock);
+  return frames_read;
+}
+
+uint32_t i2s_overflow_count() {
+  std::lock_guard<std::mutex> guard(lock);
+  return overflows;
+}
+
+}  // namespace host
+}  // namespace esphome
+
+using esphome::host::ports;
+
+esp_err_t i2s_driver_install(i2s_port_t i2s_num, const i2s_config_t *i2s_config, int queue_size, void *i2s_queue) {
+  if (i2s_num >= I2S_NUM_MAX || i2s_config == nullptr) return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(esphome::host::lock);
+  auto &port = ports[i2s_num];
+  if (port.installed) return ESP_ERR_INVALID_STATE;
+  port = {};
+  port.installed = true;
+  port.rate = i2s_config->sample_rate;
+  port.slot_bytes = i2s_config->bits_per_sample == I2S_BITS_PER_SAMPLE_16BIT ? 2 : 4;
+  port.dma_buf_len = i2s_config->dma_buf_len;
+  port.capacity_frames = static_cast<uint64_t>(i2s_config->dma_buf_count) * i2s_config->dma_buf_len;
+  if (i2s_queue != nullptr) {
+    port.events = xQueueCreate(queue_size, sizeof(i2s_event_t));
+    *static_cast<QueueHandle_t *>(i2s_queue) = port.events;
+  }
+  esphome::host::restart_clock(port);
+  return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t i2s_num) {
+  std::lock_guard<std::mutex> guard(esphome::host::lock);
+  if (i2s_num >= I2S_NUM_MAX || !ports[i2s_num].installed) return ESP_ERR_INVALID_STATE;
+  if (ports[i2s_num].events != nullptr) vQueueDelete(ports[i2s_num].events);
+  ports[i2s_num] = {};
+  return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t i2s_num, const i2s_pin_config_t *pin) {
+  if (i2s_num >= I2S_NUM_MAX || pin == nullptr) return ESP_ERR_INVALID_ARG;
+  return ports[i2s_num].installed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_set_clk(i2s_port_t i2s_num, uint32_t rate, uint32_t bits_cfg, i2s_channel_t ch) {
+  (void) ch;
+  std::lock_guard<std::mutex> guard(esphome::host::lock);
+  if (i2s_num >= I2S_NUM_MAX || !ports[i2s_num].installed) return ESP_ERR_INVALID_STATE;
+  auto &port = ports[i2s_num];
+  // The driver stops and restarts the DMA: whatever was buffered is gone
+  port.rate = rate;
+  port.slot_bytes = (bits_cfg & 0xFFFF) == 16 ? 2 : 4;
+  esphome::host::restart_clock(port);
+  return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t i2s_num) {
+  std::lock_guard<std::mutex> guard(esphome::host::lock);
+  if (i2s_num >= I2S_NUM_MAX || !ports[i2s_num].installed) return ESP_ERR_INVALID_STATE;
+  esphome::host::restart_clock(ports[i2s_num]);
+  return ESP_OK;
+}
+
+esp_err_t i2s_read(i2s_port_t i2s_num, void *dest, size_t size, size_t *bytes_read, TickType_t ticks_to_wait) {
+  using namespace esphome::host;
+  *bytes_read = 0;
+  if (i2s_num >= I2S_NUM_MAX) return ESP_ERR_INVALID_ARG;
+  std::unique_lock<std::mutex> guard(lock);
+  auto &port = ports[i2s_num];
+  if (!port.installed) return ESP_ERR_INVALID_STATE;
+  const uint32_t frame_bytes = port.slot_bytes * 2;
+  const uint64_t wanted = size / frame_bytes;
+  if (wanted == 0) return ESP_OK;
+
+  uint64_t available = wanted;
+  if (realtime) {
+    // Wait for the DMA to deliver the request, up to the timeout
+    int64_t deadline = esp_timer_get_time() + static_cast<int64_t>(ticks_to_wait) * portTICK_PERIOD_MS * 1000;
+    while (true) {
+      available = produced(port) - port.consumed;
+      if (available > port.capacity_frames) {
+        // The reader fell behind: the oldest buffers were overwritten
+        uint64_t lost = available - port.capacity_frames;
+        uint64_t buffers = (lost + port.dma_buf_len - 1) / port.dma_buf_len;
+        port.consumed += buffers * port.dma_buf_len;
+        available = produced(port) - port.consumed;
+        overflows += buffers;
+        for (uint64_t i = 0; i < buffers && port.events != nullptr; i++) {
+          i2s_event_t event{I2S_EVENT_RX_Q_OVF, 0};
+          xQueueSend(port.events, &event, 0);
+        }
+      }
+      if (available >= wanted || esp_timer_get_time() >= deadline) break;
+      uint64_t missing_us = (wanted - available) * 1000000 / port.rate + 1;
+      int64_t sleep_us = std::min<int64_t>(missing_us, deadline - esp_timer_get_time());
+      guard.unlock();
+      delayMicroseconds(sleep_us > 0 ? sleep_us : 0);
+      guard.lock();
+    }
+    if (available > wanted) available = wanted;
+  }
+
+  auto *out = static_cast<uint8_t *>(dest);
+  for (uint64_t frame = 0; frame < available; frame++) {
+    for (int channel = 0; channel < 2; channel++) {
+      int16_t sample = source(port.consumed + frame, channel);
+      if (port.slot_bytes == 2) {
+        memcpy(out, &sample, 2);
+      } else {
+        int32_t wide = static_cast<int32_t>(sample) * 65536;
+        memcpy(out, &wide, 4);
+      }
+      out += port.slot_bytes;
+    }
+  }
+  port.consumed += available;
+  frames_read += available;
+  *bytes_read = available * frame_bytes;
+  return ESP_OK;
+}
@@ -0,0 +1,188 @@
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/error.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "esp_random.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+void sha256_block(mbedtls_sha256_context *ctx, const unsigned char *block) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t) block[i * 4] << 24 | (uint32_t) block[i * 4 + 1] << 16 | (uint32_t) block[i * 4 + 2] << 8 |
+           block[i * 4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+  uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  ctx->state[0] += a;
+  ctx->state[1] += b;
+  ctx->state[2] += c;
+  ctx->state[3] += d;
+  ctx->state[4] += e;
+  ctx->state[5] += f;
+  ctx->state[6] += g;
+  ctx->state[7] += h;
+}
+
+}  // namespace
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224) {
+  // SHA-224 is not used by the components
+  static const uint32_t INIT[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  if (is224) return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+  memcpy(ctx->state, INIT, sizeof(INIT));
+  ctx->total = 0;
+  ctx->is224 = 0;
+  return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen) {
+  size_t fill = ctx->total % 64;
+  ctx->total += ilen;
+  if (fill > 0) {
+    size_t take = ilen < 64 - fill ? ilen : 64 - fill;
+    memcpy(ctx->buffer + fill, input, take);
+    input += take;
+    ilen -= take;
+    if (fill + take < 64) return 0;
+    sha256_block(ctx, ctx->buffer);
+  }
+  for (; ilen >= 64; input += 64, ilen -= 64) sha256_block(ctx, input);
+  memcpy(ctx->buffer, input, ilen);
+  return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output) {
+  uint64_t bits = ctx->total * 8;
+  unsigned char pad[72] = {0x80};
+  size_t fill = ctx->total % 64;
+  size_t pad_len = fill < 56 ? 56 - fill : 120 - fill;
+  for (int i = 0; i < 8; i++) pad[pad_len + i] = (unsigned char) (bits >> (56 - i * 8));
+  mbedtls_sha256_update(ctx, pad, pad_len + 8);
+  for (int i = 0; i < 8; i++) {
+    output[i * 4] = ctx->state[i] >> 24;
+    output[i * 4 + 1] = ctx->state[i] >> 16;
+    output[i * 4 + 2] = ctx->state[i] >> 8;
+    output[i * 4 + 3] = ctx->state[i];
+  }
+  return 0;
+}
+
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char *output, int is224) {
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  int ret = mbedtls_sha256_starts(&ctx, is224);
+  if (ret == 0) ret = mbedtls_sha256_update(&ctx, input, ilen);
+  if (ret == 0) ret = mbedtls_sha256_finish(&ctx, output);
+  mbedtls_sha256_free(&ctx);
+  return ret;
+}
+
+void mbedtls_ssl_init(mbedtls_ssl_context *ssl) { memset(ssl, 0, sizeof(*ssl)); }
+void mbedtls_ssl_free(mbedtls_ssl_context *ssl) { memset(ssl, 0, sizeof(*ssl)); }
+int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf) {
+  ssl->conf = conf;
+  return 0;
+}
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *, const char *) { return 0; }
+void mbedtls_ssl_set_bio(mbedtls_ssl_context *, void *, mbedtls_ssl_send_t *, mbedtls_ssl_recv_t *,
+                         mbedtls_ssl_recv_timeout_t *) {}
+int mbedtls_ssl_handshake(mbedtls_ssl_context *) { return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE; }
+int mbedtls_ssl_read(mbedtls_ssl_context *, unsigned char *, size_t) { return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE; }
+int mbedtls_ssl_write(mbedtls_ssl_context *, const unsigned char *, size_t) {
+  return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+int mbedtls_ssl_close_notify(mbedtls_ssl_context *) { return 0; }
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context *) { return 0; }
+const char *mbedtls_ssl_get_ciphersuite(const mbedtls_ssl_context *) { return "none"; }
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *, mbedtls_ssl_session *) {
+  return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+int mbedtls_ssl_set_session(mbedtls_ssl_context *, const mbedtls_ssl_session *) {
+  return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config *conf) { memset(conf, 0, sizeof(*conf)); }
+void mbedtls_ssl_config_free(mbedtls_ssl_config *conf) { memset(conf, 0, sizeof(*conf)); }
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config *, int, int, int) { return 0; }
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode) { conf->authmode = authmode; }
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *, mbedtls_x509_crt *, mbedtls_x509_crl *) {}
+void mbedtls_ssl_conf_ciphersuites(mbedtls_ssl_config *, const int *) {}
+void mbedtls_ssl_conf_min_tls_version(mbedtls_ssl_config *, mbedtls_ssl_protocol_version) {}
+void mbedtls_ssl_conf_max_tls_version(mbedtls_ssl_config *, mbedtls_ssl_protocol_version) {}
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config *, int (*)(void *, unsigned char *, size_t), void *) {}
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config *, int) {}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session) { memset(session, 0, sizeof(*session)); }
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session) { memset(session, 0, sizeof(*session)); }
+const unsigned char *mbedtls_ssl_session_get_id(const mbedtls_ssl_session *session) { return session->id; }
+size_t mbedtls_ssl_session_get_id_len(const mbedtls_ssl_session *session) { return session->id_len; }
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt *crt) { memset(crt, 0, sizeof(*crt)); }
+void mbedtls_x509_crt_free(mbedtls_x509_crt *crt) { memset(crt, 0, sizeof(*crt)); }
+int mbedtls_x509_crt_parse(mbedtls_x509_crt *, const unsigned char *, size_t) { return 0; }
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+void mbedtls_entropy_free(mbedtls_entropy_context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+int mbedtls_entropy_func(void *, unsigned char *output, size_t len) {
+  esp_fill_random(output, len);
+  return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *, int (*)(void *, unsigned char *, size_t), void *,
+                          const unsigned char *, size_t) {
+  return 0;
+}
+int mbedtls_ctr_drbg_random(void *, unsigned char *output, size_t output_len) {
+  esp_fill_random(output, output_len);
+  return 0;
+}
+
+void mbedtls_strerror(int errnum, char *buffer, size_t buflen) {
+  if (errnum == MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE) {
+    snprintf(buffer, buflen, "SSL - TLS is not available in the host build");
+  } else {
+    snprintf(buffer, buflen, "UNKNOWN ERROR CODE (%04X)", -errnum);
+  }
+}
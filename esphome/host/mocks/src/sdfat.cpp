@@ -0,0 +1,452 @@
+#include <SdFat.h>
+#include "host/mock_sd.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace esphome {
+namespace host {
+
+static const uint32_t IMAGE_MAGIC = 0x31444D48;  // "HMD1"
+
+MockSdCard &sd_card() {
+  static MockSdCard card;
+  return card;
+}
+
+static void sleep_us(uint64_t us) {
+  if (us > 0) std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// Calls made by this thread that are still running; only the outermost one
+// counts, as a card call may use another internally
+static thread_local int access_depth = 0;
+
+MockSdCard::Access::Access(MockSdCard *card) : card_(card) {
+  if (access_depth++ > 0) return;
+  if (card->active_accesses_.fetch_add(1) > 0) card->concurrent_accesses_++;
+  sleep_us(card->access_delay_us_);
+}
+
+MockSdCard::Access::~Access() {
+  if (--access_depth == 0) this->card_->active_accesses_.fetch_sub(1);
+}
+
+std::string MockSdCard::normalize(const char *path) {
+  std::string out;
+  const char *p = path;
+  while (*p != '\0') {
+    while (*p == '/') p++;
+    const char *end = p;
+    while (*end != '\0' && *end != '/') end++;
+    if (end > p) {
+      if (!out.empty()) out += '/';
+      out.append(p, end - p);
+    }
+    p = end;
+  }
+  return out;
+}
+
+uint64_t MockSdCard::get_used() const {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  uint64_t used = 0;
+  for (const auto &entry : this->nodes_) {
+    used += entry.second->data.size();
+  }
+  return used;
+}
+
+std::shared_ptr<SdNode> MockSdCard::find(const std::string &path) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  auto it = this->nodes_.find(path);
+  return it != this->nodes_.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<SdNode> MockSdCard::create(const std::string &path, bool is_dir) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  size_t slash = path.rfind('/');
+  std::string parent = slash == std::string::npos ? "" : path.substr(0, slash);
+  auto parent_node = this->find(parent);
+  if (parent_node == nullptr || !parent_node->is_dir) return nullptr;
+  auto node = std::make_shared<SdNode>();
+  node->is_dir = is_dir;
+  this->nodes_[path] = node;
+  return node;
+}
+
+bool MockSdCard::remove(const std::string &path) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  auto it = this->nodes_.find(path);
+  if (path.empty() || it == this->nodes_.end()) return false;
+  if (it->second->is_dir && !this->next_entry(path, "").empty()) return false;
+  this->nodes_.erase(it);
+  return true;
+}
+
+bool MockSdCard::rename(const std::string &from, const std::string &to) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  auto node = this->find(from);
+  // SdFat refuses to replace an existing file
+  if (node == nullptr || node->is_dir || this->find(to) != nullptr) return false;
+  size_t slash = to.rfind('/');
+  auto parent = this->find(slash == std::string::npos ? "" : to.substr(0, slash));
+  if (parent == nullptr || !parent->is_dir) return false;
+  this->nodes_.erase(from);
+  this->nodes_[to] = node;
+  return true;
+}
+
+std::string MockSdCard::next_entry(const std::string &dir, const std::string &after) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  std::string prefix = dir.empty() ? "" : dir + "/";
+  auto it = after.empty() ? this->nodes_.upper_bound(prefix) : this->nodes_.upper_bound(after);
+  for (; it != this->nodes_.end(); ++it) {
+    const std::string &path = it->first;
+    if (path.compare(0, prefix.size(), prefix) != 0) break;
+    if (path.size() > prefix.size() && path.find('/', prefix.size()) == std::string::npos) return path;
+  }
+  return "";
+}
+
+bool MockSdCard::mount() {
+  if (!this->present_) return false;
+  this->mounted_ = true;
+  this->mount_count_++;
+  return true;
+}
+
+void MockSdCard::write_delay(size_t bytes) {
+  sleep_us(this->write_call_us_ + (uint64_t) this->write_kib_us_ * bytes / 1024);
+}
+
+void MockSdCard::read_delay(size_t bytes) {
+  sleep_us(this->read_call_us_ + (uint64_t) this->read_kib_us_ * bytes / 1024);
+}
+
+void MockSdCard::power_cut() {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  for (auto &entry : this->nodes_) {
+    SdNode &node = *entry.second;
+    if (!node.is_dir) node.data.resize(node.synced_size);
+  }
+  // Handles opened before the cut fail from now on
+  this->mounted_ = false;
+  this->mount_count_++;
+}
+
+void MockSdCard::format() {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  this->nodes_.clear();
+  this->nodes_[""] = std::make_shared<SdNode>(SdNode{true, {}, 0});
+}
+
+void MockSdCard::reset_counters() {
+  this->bytes_written_ = 0;
+  this->bytes_read_ = 0;
+  this->concurrent_accesses_ = 0;
+}
+
+bool MockSdCard::read_file(const std::string &path, std::vector<uint8_t> &out) {
+  auto node = this->find(normalize(path.c_str()));
+  if (node == nullptr || node->is_dir) return false;
+  out = node->data;
+  return true;
+}
+
+bool MockSdCard::write_file(const std::string &path, const std::vector<uint8_t> &data) {
+  std::string name = normalize(path.c_str());
+  auto node = this->find(name);
+  if (node == nullptr) node = this->create(name, false);
+  if (node == nullptr || node->is_dir) return false;
+  node->data = data;
+  node->synced_size = data.size();
+  return true;
+}
+
+bool MockSdCard::exists(const std::string &path) { return this->find(normalize(path.c_str())) != nullptr; }
+
+std::vector<std::string> MockSdCard::list(const std::string &dir) {
+  std::vector<std::string> names;
+  std::string base = normalize(dir.c_str());
+  for (std::string entry = this->next_entry(base, ""); !entry.empty(); entry = this->next_entry(base, entry)) {
+    names.push_back(entry.substr(base.empty() ? 0 : base.size() + 1));
+  }
+  return names;
+}
+
+// Image layout: magic, node count, then per node its path, type and the
+// data a power cut would leave (the synced size)
+bool MockSdCard::save_image(const std::string &path) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) return false;
+  auto put32 = [&out](uint32_t v) { out.write(reinterpret_cast<const char *>(&v), sizeof(v)); };
+  put32(IMAGE_MAGIC);
+  put32(this->nodes_.size());
+  for (const auto &entry : this->nodes_) {
+    const SdNode &node = *entry.second;
+    put32(entry.first.size());
+    out.write(entry.first.data(), entry.first.size());
+    put32(node.is_dir ? 1 : 0);
+    uint64_t size = node.is_dir ? 0 : std::min<uint64_t>(node.synced_size, node.data.size());
+    put32(size);
+    out.write(reinterpret_cast<const char *>(node.data.data()), size);
+  }
+  return (bool) out;
+}
+
+bool MockSdCard::load_image(const std::string &path) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  auto get32 = [&in]() {
+    uint32_t v = 0;
+    in.read(reinterpret_cast<char *>(&v), sizeof(v));
+    return v;
+  };
+  if (get32() != IMAGE_MAGIC) return false;
+  std::map<std::string, std::shared_ptr<SdNode>> nodes;
+  uint32_t count = get32();
+  for (uint32_t i = 0; i < count && in; i++) {
+    std::string name(get32(), '\0');
+    in.read(&name[0], name.size());
+    auto node = std::make_shared<SdNode>();
+    node->is_dir = get32() != 0;
+    node->data.resize(get32());
+    in.read(reinterpret_cast<char *>(node->data.data()), node->data.size());
+    node->synced_size = node->data.size();
+    nodes[name] = node;
+  }
+  if (!in || nodes.count("") == 0) return false;
+  this->nodes_ = std::move(nodes);
+  return true;
+}
+
+}  // namespace host
+}  // namespace esphome
+
+using esphome::host::MockSdCard;
+
+uint8_t SdCard::type() const { return SD_CARD_TYPE_SDHC; }
+uint32_t SdCard::sectorCount() const { return this->card_->get_capacity() / 512; }
+
+bool SdFs::begin(SdSpiConfig config) {
+  MockSdCard &card = esphome::host::sd_card();
+  if (config.spiPort != nullptr && !config.spiPort->is_started()) return false;
+  if (!card.mount()) return false;
+  this->card_ = &card;
+  this->sd_card_ = SdCard(&card);
+  return true;
+}
+
+void SdFs::end() {
+  if (this->card_ != nullptr) this->card_->unmount();
+  this->card_ = nullptr;
+}
+
+FsFile SdFs::open(const char *path, oflag_t oflag) {
+  FsFile file;
+  if (this->card_ == nullptr || !this->card_->is_mounted()) return file;
+  MockSdCard::Access access(this->card_);
+  std::string name = MockSdCard::normalize(path);
+  auto node = this->card_->find(name);
+  if (node != nullptr && (oflag & O_CREAT) && (oflag & O_EXCL)) return file;
+  if (node == nullptr) {
+    if (!(oflag & O_CREAT)) return file;
+    node = this->card_->create(name, false);
+    if (node == nullptr) return file;
+  }
+  int mode = oflag & O_ACCMODE;
+  if (node->is_dir && mode != O_RDONLY) return file;
+  if ((oflag & O_TRUNC) && mode != O_RDONLY) {
+    node->data.clear();
+    node->synced_size = 0;
+  }
+  file.card_ = this->card_;
+  file.node_ = node;
+  file.path_ = name;
+  file.name_ = name.substr(name.rfind('/') == std::string::npos ? 0 : name.rfind('/') + 1);
+  file.flags_ = oflag;
+  file.position_ = (oflag & O_APPEND) ? node->data.size() : 0;
+  file.mount_ = this->card_->get_mount_count();
+  return file;
+}
+
+bool SdFs::exists(const char *path) {
+  if (this->card_ == nullptr) return false;
+  MockSdCard::Access access(this->card_);
+  return this->card_->find(MockSdCard::normalize(path)) != nullptr;
+}
+
+bool SdFs::remove(const char *path) {
+  if (this->card_ == nullptr) return false;
+  MockSdCard::Access access(this->card_);
+  auto node = this->card_->find(MockSdCard::normalize(path));
+  return node != nullptr && !node->is_dir && this->card_->remove(MockSdCard::normalize(path));
+}
+
+bool SdFs::rename(const char *old_path, const char *new_path) {
+  if (this->card_ == nullptr) return false;
+  MockSdCard::Access access(this->card_);
+  return this->card_->rename(MockSdCard::normalize(old_path), MockSdCard::normalize(new_path));
+}
+
+bool SdFs::mkdir(const char *path, bool parents) {
+  if (this->card_ == nullptr) return false;
+  MockSdCard::Access access(this->card_);
+  std::string name = MockSdCard::normalize(path);
+  if (name.empty() || this->card_->find(name) != nullptr) return false;
+  if (parents) {
+    for (size_t slash = name.find('/'); slash != std::string::npos; slash = name.find('/', slash + 1)) {
+      std::string parent = name.substr(0, slash);
+      if (this->card_->find(parent) == nullptr) this->card_->create(parent, true);
+    }
+  }
+  return this->card_->create(name, true) != nullptr;
+}
+
+bool SdFs::rmdir(const char *path) {
+  if (this->card_ == nullptr) return false;
+  MockSdCard::Access access(this->card_);
+  auto node = this->card_->find(MockSdCard::normalize(path));
+  return node != nullptr && node->is_dir && this->card_->remove(MockSdCard::normalize(path));
+}
+
+bool FsFile::isOpen() const { return this->node_ != nullptr; }
+
+bool FsFile::check_open_() const {
+  // A power cut or remount leaves old handles dangling
+  return this->node_ != nullptr && this->card_->is_mounted() && this->mount_ == this->card_->get_mount_count();
+}
+
+bool FsFile::isDir() const { return this->node_ != nullptr && this->node_->is_dir; }
+
+bool FsFile::openNext(FsFile *dir, oflag_t oflag) {
+  this->close();
+  if (dir == nullptr || !dir->check_open_() || !dir->isDir()) return false;
+  MockSdCard::Access access(dir->card_);
+  // A directory's position is the path of the entry it returned last
+  std::string next = dir->card_->next_entry(dir->path_, dir->cursor_);
+  if (next.empty()) return false;
+  dir->cursor_ = next;
+  auto node = dir->card_->find(next);
+  if (node == nullptr) return false;
+  int mode = oflag & O_ACCMODE;
+  if (node->is_dir && mode != O_RDONLY) oflag = O_RDONLY;
+  this->card_ = dir->card_;
+  this->node_ = node;
+  this->path_ = next;
+  this->name_ = next.substr(next.rfind('/') == std::string::npos ? 0 : next.rfind('/') + 1);
+  this->flags_ = oflag;
+  this->position_ = 0;
+  this->mount_ = dir->mount_;
+  return true;
+}
+
+size_t FsFile::getName(char *name, size_t len) {
+  if (len == 0) return 0;
+  size_t n = std::min(len - 1, this->name_.size());
+  memcpy(name, this->name_.data(), n);
+  name[n] = '\0';
+  return n;
+}
+
+bool FsFile::close() {
+  bool ok = this->sync();
+  this->node_ = nullptr;
+  this->card_ = nullptr;
+  this->cursor_.clear();
+  return ok;
+}
+
+bool FsFile::sync() {
+  if (!this->check_open_()) return false;
+  MockSdCard::Access access(this->card_);
+  if ((this->flags_ & O_ACCMODE) != O_RDONLY) this->node_->synced_size = this->node_->data.size();
+  return true;
+}
+
+int FsFile::read() {
+  uint8_t b;
+  return this->read(&b, 1) == 1 ? b : -1;
+}
+
+int FsFile::read(void *buf, size_t count) {
+  if (!this->check_open_() || this->isDir() || (this->flags_ & O_ACCMODE) == O_WRONLY) return -1;
+  MockSdCard::Access access(this->card_);
+  const auto &data = this->node_->data;
+  if (this->position_ >= data.size()) return 0;
+  size_t n = std::min<uint64_t>(count, data.size() - this->position_);
+  this->card_->read_delay(n);
+  memcpy(buf, data.data() + this->position_, n);
+  this->position_ += n;
+  this->card_->count_read(n);
+  return n;
+}
+
+size_t FsFile::write(const void *buf, size_t count) {
+  if (!this->check_open_() || this->isDir() || (this->flags_ & O_ACCMODE) == O_RDONLY) return 0;
+  MockSdCard::Access access(this->card_);
+  auto &data = this->node_->data;
+  if (this->flags_ & O_APPEND) this->position_ = data.size();
+  uint64_t end = this->position_ + count;
+  if (end > data.size()) {
+    uint64_t used = this->card_->get_used();
+    uint64_t capacity = this->card_->get_capacity();
+    uint64_t room = capacity > used ? capacity - used : 0;
+    if (end - data.size() > room) count = data.size() + room - this->position_;
+  }
+  uint32_t limit = this->card_->get_short_write();
+  if (limit > 0 && count > limit) count = limit;
+  if (count == 0) return 0;
+  this->card_->write_delay(count);
+  end = this->position_ + count;
+  if (end > data.size()) data.resize(end);
+  memcpy(data.data() + this->position_, buf, count);
+  this->position_ = end;
+  this->card_->count_written(count);
+  return count;
+}
+
+size_t FsFile::write(const char *str) { return this->write(str, strlen(str)); }
+
+int FsFile::available() {
+  uint64_t n = this->available64();
+  return n > INT32_MAX ? INT32_MAX : (int) n;
+}
+
+uint64_t FsFile::available64() {
+  if (!this->check_open_() || this->isDir()) return 0;
+  uint64_t size = this->node_->data.size();
+  return this->position_ < size ? size - this->position_ : 0;
+}
+
+uint64_t FsFile::fileSize() const { return this->node_ != nullptr ? this->node_->data.size() : 0; }
+
+bool FsFile::seekSet(uint64_t position) {
+  if (!this->check_open_() || position > this->node_->data.size()) return false;
+  this->position_ = position;
+  return true;
+}
+
+bool FsFile::truncate(uint64_t length) {
+  if (!this->check_open_() || (this->flags_ & O_ACCMODE) == O_RDONLY || length > this->node_->data.size())
+    return false;
+  MockSdCard::Access access(this->card_);
+  this->node_->data.resize(length);
+  if (this->position_ > length) this->position_ = length;
+  return true;
+}
+
+bool FsFile::preAllocate(uint64_t length) {
+  // Like SdFat, only on an empty file; the file then has that size
+  if (!this->check_open_() || (this->flags_ & O_ACCMODE) == O_RDONLY || this->node_->data.size() > 0) return false;
+  MockSdCard::Access access(this->card_);
+  if (this->card_->get_used() + length > this->card_->get_capacity()) return false;
+  this->node_->data.resize(length);
+  return true;
+}
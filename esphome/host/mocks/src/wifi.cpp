@@ -0,0 +1,106 @@
+#include <WiFi.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeout_ms) {
+  this->stop();
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *result = nullptr;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &result) != 0 || result == nullptr) return 0;
+
+  int fd = socket(result->ai_family, SOCK_STREAM, 0);
+  if (fd < 0) {
+    freeaddrinfo(result);
+    return 0;
+  }
+  // Connect with a timeout, then block with send/receive timeouts like lwIP
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  int rc = ::connect(fd, result->ai_addr, result->ai_addrlen);
+  freeaddrinfo(result);
+  if (rc < 0 && errno == EINPROGRESS) {
+    pollfd pfd{fd, POLLOUT, 0};
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (poll(&pfd, 1, timeout_ms) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) rc = 0;
+  }
+  if (rc < 0) {
+    ::close(fd);
+    return 0;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  timeval tv{(time_t) (this->timeout_ms_ / 1000), (suseconds_t) (this->timeout_ms_ % 1000 * 1000)};
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  this->fd_ = fd;
+  return 1;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+  if (this->fd_ < 0) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(this->fd_, buf + sent, size - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    sent += n;
+  }
+  return sent;
+}
+
+int WiFiClient::available() {
+  if (this->fd_ < 0) return 0;
+  int count = 0;
+  if (ioctl(this->fd_, FIONREAD, &count) < 0) return 0;
+  return count;
+}
+
+int WiFiClient::read() {
+  uint8_t b;
+  return this->read(&b, 1) == 1 ? b : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size) {
+  if (this->fd_ < 0) return -1;
+  ssize_t n = recv(this->fd_, buf, size, MSG_DONTWAIT);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return -1;
+  return n <= 0 ? -1 : (int) n;
+}
+
+int WiFiClient::peek() {
+  if (this->fd_ < 0) return -1;
+  uint8_t b;
+  return recv(this->fd_, &b, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? b : -1;
+}
+
+void WiFiClient::stop() {
+  if (this->fd_ >= 0) ::close(this->fd_);
+  this->fd_ = -1;
+}
+
+uint8_t WiFiClient::connected() {
+  if (this->fd_ < 0) return 0;
+  // Closed by the peer once a read would return end of stream; data still
+  // waiting counts as connected, as on the device
+  uint8_t b;
+  ssize_t n = recv(this->fd_, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n == 0) return 0;
+  if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+  return 1;
+}
+
+int WiFiClient::setNoDelay(bool nodelay) {
+  if (this->fd_ < 0) return -1;
+  int flag = nodelay ? 1 : 0;
+  return setsockopt(this->fd_, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
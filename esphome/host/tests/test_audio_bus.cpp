@@ -0,0 +1,62 @@
+// The audio bus fan-out: consumers that fall behind lose blocks from their
+// own queues, never the producer's next block
+
+#include "test_support.h"
+#include "esphome/components/medallion_voice/audio_bus.h"
+
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+// The SD writer stalls holding its oldest block with its queue full, while
+// the streamer queues the blocks after those: the two hold different
+// blocks, and capture still finds a free one
+static void test_consumers_behind_apart() {
+  AudioBus bus;
+  AudioConsumer *sd = bus.add_consumer("sd", 4);
+  AudioConsumer *rtp = bus.add_consumer("rtp", 8);
+  EXPECT(bus.setup(1024));
+  EXPECT_EQ(bus.get_pool_size(), 1 + 5 + 9);
+  sd->set_active(true);
+  rtp->set_active(true);
+
+  auto produce = [&bus] {
+    AudioBlock *block = bus.acquire();
+    if (block == nullptr) return false;
+    block->length = 1024;
+    bus.publish(block);
+    return true;
+  };
+
+  // The SD writer takes block 0 and stalls with 1-4 queued
+  EXPECT(produce());
+  AudioBlock *writing = sd->receive(0);
+  EXPECT(writing != nullptr);
+  for (int i = 0; i < 4; i++) EXPECT(produce());
+  // The streamer keeps up with 0-4, then takes block 5 and stalls with
+  // 6-13 queued
+  rtp->flush();
+  for (int i = 0; i < 8; i++) EXPECT(produce());
+  AudioBlock *sending = rtp->receive(0);
+  EXPECT(sending != nullptr);
+  EXPECT(produce());
+
+  // Both queues are full and each consumer holds a block: capture goes on,
+  // and both consumers drop blocks instead
+  for (int i = 0; i < 50; i++) EXPECT(produce());
+  EXPECT_EQ(bus.get_overruns(), 0);
+  EXPECT_EQ(sd->get_dropped(), 9 + 50);
+  EXPECT_EQ(rtp->get_dropped(), 50);
+
+  sd->release(writing);
+  rtp->release(sending);
+  sd->flush();
+  rtp->flush();
+}
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_WARN);
+  test_consumers_behind_apart();
+  test::finish();
+}
@@ -0,0 +1,217 @@
+// The rest of the board: AXP2101 power rails and ADC reads, the I2C arbiter
+// with every device on one bus, and CO5300 frames out of the PSRAM frame
+// buffer
+
+#include "test_support.h"
+#include "esphome/components/axp2101/axp2101.h"
+#include "esphome/components/co5300_qspi/co5300_qspi.h"
+#include "esphome/components/cst92xx/cst92xx.h"
+#include "esphome/components/i2c_arbiter/i2c_arbiter.h"
+#include <Arduino_GFX_Library.h>
+#include <atomic>
+#include <thread>
+
+using namespace esphome;
+
+static const uint8_t PMU_ADDRESS = 0x34;
+static const uint8_t TOUCH_ADDRESS = 0x5A;
+
+struct Power {
+  host::MockI2CBus bus;
+  host::RegisterDevice device;
+  axp2101::AXP2101Component pmu;
+
+  explicit Power(uint8_t chip_id = 0x4A) {
+    this->device.set_register(axp2101::reg::CHIP_ID, chip_id);
+    this->bus.add_device(PMU_ADDRESS, &this->device);
+    this->pmu.set_i2c_bus(&this->bus);
+    this->pmu.set_i2c_address(PMU_ADDRESS);
+  }
+};
+
+static void test_power_rails() {
+  Power p;
+  p.pmu.set_dc1_voltage(3300);
+  p.pmu.set_aldo1_voltage(3300);
+  p.pmu.set_aldo2_voltage(400);
+  p.pmu.set_bldo2_voltage(1800);
+  p.pmu.setup();
+  EXPECT(!p.pmu.is_failed());
+
+  // DC1 upper range: 20 mV steps from 1220 mV at code 71
+  EXPECT_EQ(p.device.get_register(axp2101::reg::DC1_VOLTAGE), 71 + (3300 - 1220) / 20);
+  // LDOs: 100 mV steps from 500 mV, clamped to the range
+  EXPECT_EQ(p.device.get_register(axp2101::reg::ALDO1_VOLTAGE), 28);
+  EXPECT_EQ(p.device.get_register(axp2101::reg::ALDO2_VOLTAGE), 0);
+  EXPECT_EQ(p.device.get_register(axp2101::reg::BLDO2_VOLTAGE), 13);
+  EXPECT_EQ(p.device.get_register(axp2101::reg::LDO_CTRL0) & 0x0F, 0x0F);
+  EXPECT_EQ(p.device.get_register(axp2101::reg::LDO_CTRL1) & 0x03, 0x03);
+  EXPECT_EQ(p.device.get_register(axp2101::reg::ADC_CTRL) & 0x0D, 0x0D);
+
+  // 14-bit ADC readings in mV; the top bits are not part of the value
+  p.device.set_registers(axp2101::reg::VBAT_H, {0xCF, 0x6C});
+  EXPECT(std::abs(p.pmu.get_battery_voltage() - 3.948f) < 0.0005f);
+  p.device.set_registers(axp2101::reg::VBUS_H, {0x13, 0x88});
+  EXPECT(std::abs(p.pmu.get_vbus_voltage() - 5.0f) < 0.0005f);
+  p.device.set_register(axp2101::reg::BAT_PERCENT, 0x80 | 87);
+  EXPECT_EQ(p.pmu.get_battery_level(), 87);
+}
+
+static void test_power_wrong_chip() {
+  Power p(0x00);
+  p.pmu.setup();
+  EXPECT(p.pmu.is_failed());
+  // Nothing written to a device that is not an AXP2101
+  EXPECT_EQ(p.device.get_writes().size(), 0);
+}
+
+// A 1 MHz touch controller and the PMU share the bus from two tasks: the
+// arbiter keeps their transactions apart and the clock where it belongs
+static void test_arbiter() {
+  host::MockI2CBus bus;
+  bus.set_byte_time_us(20);
+  host::RegisterDevice pmu_device, touch_device;
+  pmu_device.set_register(axp2101::reg::CHIP_ID, 0x4B);
+  touch_device.set_registers(0xA7, {0xB3, 0x01, 0x12});
+  bus.add_device(PMU_ADDRESS, &pmu_device);
+  bus.add_device(TOUCH_ADDRESS, &touch_device);
+
+  i2c_arbiter::I2CArbiter arbiter;
+  arbiter.set_bus(&bus);
+  axp2101::AXP2101Component pmu;
+  pmu.set_i2c_bus(&bus);
+  pmu.set_i2c_address(PMU_ADDRESS);
+  pmu.set_bus_arbiter(&arbiter, i2c_arbiter::PRIORITY_BACKGROUND, false);
+  cst92xx::CST92xxComponent touch;
+  touch.set_i2c_bus(&bus);
+  touch.set_i2c_address(TOUCH_ADDRESS);
+  touch.set_bus_arbiter(&arbiter, i2c_arbiter::PRIORITY_LATENCY_CRITICAL, true);
+  pmu.setup();
+  touch.setup();
+  EXPECT(!pmu.is_failed());
+  EXPECT(!touch.is_failed());
+
+  std::atomic<bool> stop{false};
+  std::thread telemetry([&] {
+    while (!stop) {
+      pmu.get_battery_voltage();
+      pmu.get_vbus_voltage();
+    }
+  });
+  for (int i = 0; i < 200; i++) touch.loop();
+  stop = true;
+  telemetry.join();
+
+  EXPECT_EQ(bus.get_overlap_count(), 0);
+  // Back at the bus's own 400 kHz whenever the touch controller lets go
+  EXPECT_EQ(host::i2c_clock(bus.get_port()), 400000);
+}
+
+static Arduino_CO5300 *wait_for_panel(co5300_qspi::CO5300QSPIComponent *display, uint32_t frames,
+                                      host::MockPin *te = nullptr) {
+  uint32_t start = millis();
+  while (display->get_frames() < frames && millis() - start < 2000) {
+    if (te != nullptr) te->pulse();
+    delay(17);
+  }
+  return host::display_panel();
+}
+
+struct Display {
+  host::MockPin cs{12}, sclk{11}, d0{4}, d1{5}, d2{6}, d3{7}, rst{8}, te{9};
+  co5300_qspi::CO5300QSPIComponent display;
+
+  explicit Display(bool with_te) {
+    this->display.set_cs_pin(&this->cs);
+    this->display.set_sclk_pin(&this->sclk);
+    this->display.set_data0_pin(&this->d0);
+    this->display.set_data1_pin(&this->d1);
+    this->display.set_data2_pin(&this->d2);
+    this->display.set_data3_pin(&this->d3);
+    this->display.set_reset_pin(&this->rst);
+    this->display.set_width(466);
+    this->display.set_height(466);
+    this->display.set_brightness(200);
+    if (with_te) this->display.set_te_pin(&this->te);
+  }
+};
+
+static void test_display_direct() {
+  // Without PSRAM every call draws straight to the panel
+  host::set_psram_available(false);
+  // The frame task outlives the test, so the display does too
+  auto *d = new Display(false);
+  d->display.setup();
+  host::set_psram_available(true);
+  EXPECT(!d->display.is_failed());
+  EXPECT(!d->display.has_frame_buffer());
+  Arduino_CO5300 *panel = host::display_panel();
+  EXPECT_EQ(panel->get_brightness(), 200);
+  EXPECT_EQ(panel->get_pixel(0, 0), RED);
+  EXPECT_EQ(panel->get_pixel(0, 464), BLUE);
+
+  uint32_t writes = panel->get_write_count();
+  d->display.fill_rect(10, 10, 20, 20, WHITE);
+  EXPECT_EQ(panel->get_write_count(), writes + 1);
+  EXPECT_EQ(panel->get_pixel(15, 15), WHITE);
+}
+
+static void test_display_frame_buffer() {
+  auto *d = new Display(true);
+  d->display.setup();
+  EXPECT(!d->display.is_failed());
+  EXPECT(d->display.has_frame_buffer());
+  EXPECT(d->te.has_interrupt());
+  // Tearing-effect output switched on before the first frame
+  bool te_on = false;
+  Arduino_CO5300 *panel = host::display_panel();
+  for (const auto &command : panel->get_bus()->get_commands()) te_on |= command.first == 0x35;
+  EXPECT(te_on);
+
+  // The test pattern goes out as the first frame, on a TE edge
+  panel = wait_for_panel(&d->display, 1, &d->te);
+  EXPECT_EQ(d->display.get_frames(), 1);
+  EXPECT_EQ(panel->get_pixel(0, 0), RED);
+  EXPECT_EQ(panel->get_pixel(0, 464), BLUE);
+
+  // Drawing stays in the frame buffer until the next frame, which sends
+  // only the dirty rows, widened to an even window
+  d->display.fill_rect(10, 11, 20, 20, WHITE);
+  EXPECT_EQ(panel->get_pixel(15, 15), RED);
+  uint64_t pixels = panel->get_pixels_written();
+  wait_for_panel(&d->display, 2, &d->te);
+  EXPECT_EQ(panel->get_pixel(15, 15), WHITE);
+  EXPECT_EQ(panel->get_pixels_written() - pixels, 466u * 22);
+
+  // Nothing changed: TE edges send no frames
+  uint32_t frames = d->display.get_frames();
+  for (int i = 0; i < 5; i++) {
+    d->te.pulse();
+    delay(17);
+  }
+  EXPECT_EQ(d->display.get_frames(), frames);
+
+  // Without TE pulses the timer paces the frames
+  d->display.draw_pixel(100, 100, GREEN);
+  wait_for_panel(&d->display, frames + 1);
+  EXPECT_EQ(panel->get_pixel(100, 100), GREEN);
+
+  // Brightness goes out from the frame task, between frames
+  d->display.set_brightness(50);
+  uint32_t start = millis();
+  while (panel->get_brightness() != 50 && millis() - start < 500) delay(5);
+  EXPECT_EQ(panel->get_brightness(), 50);
+  EXPECT(panel->get_brightness_thread() == panel->get_write_thread());
+}
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_WARN);
+  test_power_rails();
+  test_power_wrong_chip();
+  test_arbiter();
+  // The driver keeps its panel in statics: the panel without a frame buffer
+  // first, so the second setup replaces it
+  test_display_direct();
+  test_display_frame_buffer();
+  test::finish();
+}
@@ -0,0 +1,223 @@
+// Recording to the mock SD card: WAV finalisation, the manifest digest and
+// recovery of a recording cut off by a power loss
+
+#include "test_support.h"
+#include "esphome/components/medallion_voice/log_file.h"
+#include "esphome/components/medallion_voice/wav_format.h"
+#include "host/mock_i2s.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+static uint32_t le32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24; }
+static uint16_t le16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+static std::string manifest_digest(const std::string &recording) {
+  std::vector<uint8_t> json;
+  std::string path = recording.substr(0, recording.rfind('.')) + ".json";
+  if (!host::sd_card().read_file(path, json)) return "";
+  std::string text(json.begin(), json.end());
+  size_t key = text.find("\"sha256\":\"");
+  return key == std::string::npos ? "" : text.substr(key + 10, 64);
+}
+
+static void test_finalized_wav() {
+  host::sd_card().format();
+  test::Recorder recorder;
+  EXPECT(recorder.setup());
+  EXPECT(recorder.record(1500));
+  EXPECT(recorder.voice.get_state() == RecorderState::SAVED);
+
+  std::string name = recorder.voice.get_current_file();
+  EXPECT(name == "/voice_0001.wav");
+  std::vector<uint8_t> wav;
+  EXPECT(host::sd_card().read_file(name, wav));
+  if (!EXPECT(wav.size() > WAV_HEADER_SIZE)) return;
+
+  // Sizes in the header match the file
+  EXPECT(memcmp(wav.data(), "RIFF", 4) == 0);
+  EXPECT(memcmp(wav.data() + 8, "WAVEfmt ", 8) == 0);
+  EXPECT_EQ(le32(wav.data() + 4), wav.size() - 8);
+  EXPECT(memcmp(wav.data() + 36, "data", 4) == 0);
+  EXPECT_EQ(le32(wav.data() + 40), wav.size() - WAV_HEADER_SIZE);
+  EXPECT_EQ(le16(wav.data() + 20), 1);  // PCM
+  EXPECT_EQ(le32(wav.data() + 24), 16000);
+  EXPECT_EQ(le16(wav.data() + 34), 16);
+  uint32_t byte_rate = le32(wav.data() + 28);
+  uint16_t block_align = le16(wav.data() + 32);
+  EXPECT_EQ((wav.size() - WAV_HEADER_SIZE) % block_align, 0);
+
+  // Everything captured was written, nothing dropped: 1.5 s of audio plus
+  // what the DMA buffered (up to 256 ms) before the recording started
+  const CaptureStats &stats = recorder.voice.get_capture_stats();
+  EXPECT_EQ(stats.get_dropped_bytes(), 0);
+  EXPECT_EQ(stats.i2s_overflows, 0);
+  uint32_t ms = (uint64_t) (wav.size() - WAV_HEADER_SIZE) * 1000 / byte_rate;
+  EXPECT(ms >= 1400 && ms <= 1800);
+
+  // The manifest carries the digest of the audio data
+  EXPECT(manifest_digest(name) ==
+         test::sha256_hex(wav.data() + WAV_HEADER_SIZE, wav.size() - WAV_HEADER_SIZE));
+  EXPECT_EQ(host::sd_card().get_concurrent_accesses(), 0);
+}
+
+static void test_power_cut_recovery() {
+  host::sd_card().format();
+  std::string name;
+  {
+    auto *recorder = new test::Recorder();  // lost with the power, like the device's RAM
+    recorder->voice.set_checkpoint_interval(200);
+    EXPECT(recorder->setup());
+    EXPECT(recorder->voice.start_recording());
+    uint32_t start = millis();
+    recorder->run_until([start] { return millis() - start >= 1100; }, 3000);
+    name = recorder->voice.get_current_file();
+    host::sd_card().power_cut();
+  }
+
+  // What the card holds: the last checkpoint, or a bit more
+  std::vector<uint8_t> cut;
+  EXPECT(host::sd_card().read_file(name, cut));
+  EXPECT(cut.size() > WAV_HEADER_SIZE);
+
+  // The next boot repairs the header from the catalog
+  test::Recorder rebooted;
+  EXPECT(rebooted.setup());
+  std::vector<uint8_t> wav;
+  EXPECT(host::sd_card().read_file(name, wav));
+  if (!EXPECT(wav.size() > WAV_HEADER_SIZE)) return;
+  uint32_t data_length = 0;
+  EXPECT(parse_wav_data_length(wav.data(), &data_length));
+  EXPECT_EQ(data_length, wav.size() - WAV_HEADER_SIZE);
+  uint32_t block_align = le16(wav.data() + 32);
+  EXPECT_EQ(data_length % block_align, 0);
+  // At least one checkpoint's worth of the 1.1 s survived
+  uint32_t ms = (uint64_t) data_length * 1000 / le32(wav.data() + 28);
+  EXPECT(ms >= 700);
+
+  // The next recording gets a new session number
+  EXPECT(rebooted.record(300));
+  EXPECT(std::string(rebooted.voice.get_current_file()) == "/voice_0002.wav");
+}
+
+static void test_overflow_counted() {
+  // A main loop that stalls past the DMA buffers loses audio, and says so
+  host::sd_card().format();
+  test::Recorder recorder;
+  EXPECT(recorder.setup());
+  EXPECT(recorder.voice.start_recording());
+  recorder.run_until([] { return false; }, 200);
+  delay(600);  // 4 x 1024 frames at 16 kHz is 256 ms
+  recorder.run_until([] { return false; }, 200);
+  recorder.voice.stop_recording();
+  EXPECT(recorder.voice.get_capture_stats().i2s_overflows > 0);
+}
+
+// The log file sink writes from deferred_log's drain task while the main
+// loop records; both go through the recorder's SD lock. The ring itself
+// does not run on 64-bit hosts, so a thread stands in for the drain task.
+static void test_log_file_shares_card() {
+  host::sd_card().format();
+  SdFs sd;
+  EXPECT(sd.begin(SdSpiConfig(41, 0, 1000000)));
+  test::Recorder recorder;
+  EXPECT(recorder.setup());
+  LogFile log;
+  log.set_path("/medallion.log");
+  EXPECT(log.setup(&sd, recorder.voice.get_sd_mutex()));
+
+  host::sd_card().reset_counters();
+  host::sd_card().set_access_delay(200);
+  std::atomic<bool> stop{false};
+  uint32_t lines = 0;
+  std::thread drain([&] {
+    deferred_log::LogRecord record{};
+    record.tag = "test";
+    record.level = ESPHOME_LOG_LEVEL_INFO;
+    while (!stop) {
+      record.timestamp = millis();
+      log.write(record, "a line long enough to fill the buffer in a few dozen records");
+      lines++;
+      log.flush();
+      delayMicroseconds(200);
+    }
+  });
+  EXPECT(recorder.record(800));
+  stop = true;
+  drain.join();
+  host::sd_card().set_access_delay(0);
+
+  EXPECT_EQ(host::sd_card().get_concurrent_accesses(), 0);
+  EXPECT_EQ(recorder.voice.get_capture_stats().get_dropped_bytes(), 0);
+  // Everything but the last, unflushed buffer reached the card
+  std::vector<uint8_t> text;
+  EXPECT(host::sd_card().read_file("/medallion.log", text));
+  EXPECT(text.size() > 0);
+  EXPECT(std::count(text.begin(), text.end(), '\n') + 20 > lines);
+}
+
+// A codec in 24-bit mode fills 32-bit slots; the recording is still
+// 16-bit, with each sample taken from the top of its slot
+static void test_wide_codec_slots() {
+  host::sd_card().format();
+  host::i2s_set_source([](uint64_t frame, int channel) { return (int16_t) (frame * 3 + channel); });
+  test::Recorder recorder;
+  recorder.codec.set_bits_per_sample(24);
+  EXPECT(recorder.setup());
+  EXPECT(recorder.record(500));
+  host::i2s_set_source(nullptr);
+
+  std::vector<uint8_t> wav;
+  EXPECT(host::sd_card().read_file(recorder.voice.get_current_file(), wav));
+  if (!EXPECT(wav.size() > WAV_HEADER_SIZE + 4096)) return;
+  EXPECT_EQ(le16(wav.data() + 34), 16);
+  EXPECT_EQ(le16(wav.data() + 22), 2);
+  uint32_t errors = 0;
+  for (size_t i = WAV_HEADER_SIZE; i + 8 <= wav.size(); i += 4) {
+    uint16_t left = le16(&wav[i]), right = le16(&wav[i + 2]), next = le16(&wav[i + 4]);
+    if (right != (uint16_t) (left + 1) || next != (uint16_t) (left + 3)) errors++;
+  }
+  EXPECT_EQ(errors, 0);
+  EXPECT_EQ(recorder.voice.get_capture_stats().get_dropped_bytes(), 0);
+}
+
+// The live stream follows each recording; one the packets cannot carry
+// leaves the sensor off and the recording itself untouched
+static void test_stream_state() {
+  host::sd_card().format();
+  test::Recorder recorder;
+  binary_sensor::BinarySensor streaming;
+  recorder.voice.set_stream_target("127.0.0.1", 5004, 20);
+  recorder.voice.set_streaming_binary_sensor(&streaming);
+  EXPECT(recorder.setup());
+  EXPECT(!streaming.get_state());
+
+  EXPECT(recorder.voice.start_recording());
+  EXPECT(streaming.get_state());
+  recorder.voice.stop_recording();
+  EXPECT(!streaming.get_state());
+
+  // 20 ms at 48 kHz stereo is 3840 bytes, three times a packet
+  EXPECT(recorder.codec.set_sample_rate(48000));
+  uint32_t published = streaming.get_publish_count();
+  EXPECT(recorder.voice.start_recording());
+  EXPECT(recorder.voice.get_state() == RecorderState::RECORDING);
+  EXPECT(!streaming.get_state());
+  EXPECT_EQ(streaming.get_publish_count(), published);
+  recorder.voice.stop_recording();
+  EXPECT(recorder.voice.get_state() == RecorderState::SAVED);
+}
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_WARN);
+  test_finalized_wav();
+  test_power_cut_recovery();
+  test_overflow_counted();
+  test_log_file_shares_card();
+  test_wide_codec_slots();
+  test_stream_state();
+  test::finish();
+}
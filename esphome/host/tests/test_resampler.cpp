@@ -0,0 +1,101 @@
+// The polyphase resampler: passthrough, unity gain at DC, and rejection of
+// what would alias into the lower rate
+
+#include "test_support.h"
+#include "esphome/components/medallion_voice/resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+// Stereo: a tone of `hz` and `amplitude` on the left, its negation on the right
+static std::vector<int16_t> tone(uint32_t rate, double hz, double amplitude, size_t frames) {
+  std::vector<int16_t> pcm(frames * 2);
+  for (size_t i = 0; i < frames; i++) {
+    int16_t v = (int16_t) lround(amplitude * sin(2 * M_PI * hz * i / rate));
+    pcm[2 * i] = v;
+    pcm[2 * i + 1] = (int16_t) -v;
+  }
+  return pcm;
+}
+
+// Feed `in` in 1 KiB capture blocks, as the recorder does
+static std::vector<int16_t> convert(Resampler &resampler, const std::vector<int16_t> &in) {
+  const size_t block_frames = 1024 / 4;
+  std::vector<int16_t> out;
+  std::vector<int16_t> buf(resampler.max_output_frames(block_frames) * 2);
+  for (size_t frame = 0; frame < in.size() / 2; frame += block_frames) {
+    size_t frames = std::min(block_frames, in.size() / 2 - frame);
+    size_t n = resampler.process(&in[frame * 2], frames, buf.data());
+    out.insert(out.end(), buf.begin(), buf.begin() + n * 2);
+  }
+  return out;
+}
+
+// RMS of one channel, past the filter's startup
+static double rms(const std::vector<int16_t> &pcm, int channel, size_t skip_frames) {
+  double sum = 0;
+  size_t n = 0;
+  for (size_t i = skip_frames; i < pcm.size() / 2; i++, n++) sum += (double) pcm[2 * i + channel] * pcm[2 * i + channel];
+  return n > 0 ? sqrt(sum / n) : 0;
+}
+
+static void test_passthrough() {
+  Resampler resampler;
+  EXPECT(resampler.setup(16000, 16000, 2));
+  EXPECT(resampler.is_passthrough());
+  std::vector<int16_t> in = tone(16000, 1000, 20000, 1000);
+  std::vector<int16_t> out = convert(resampler, in);
+  EXPECT(out == in);
+}
+
+static void test_dc_gain(uint32_t in_rate, uint32_t out_rate) {
+  Resampler resampler;
+  EXPECT(resampler.setup(in_rate, out_rate, 2));
+  EXPECT(!resampler.is_passthrough());
+  std::vector<int16_t> in(in_rate / 4 * 2);
+  for (size_t i = 0; i < in.size(); i += 2) {
+    in[i] = 20000;
+    in[i + 1] = -12000;
+  }
+  std::vector<int16_t> out = convert(resampler, in);
+  EXPECT_EQ(out.size(), in.size() * out_rate / in_rate);
+  // Q14 coefficients: within rounding of the input, on every sample
+  // once the history is full
+  int worst = 0;
+  for (size_t i = resampler.get_taps(); i < out.size() / 2; i++) {
+    worst = std::max(worst, abs(out[2 * i] - 20000));
+    worst = std::max(worst, abs(out[2 * i + 1] + 12000));
+  }
+  EXPECT(worst <= 2);
+}
+
+// A passband tone keeps its level; a tone above the output's Nyquist
+// frequency, which decimating would alias into the passband, is removed
+static void test_stopband(uint32_t in_rate, uint32_t out_rate, double pass_hz, double stop_hz) {
+  const double amplitude = 16000;
+  Resampler resampler;
+  EXPECT(resampler.setup(in_rate, out_rate, 2));
+  std::vector<int16_t> pass = convert(resampler, tone(in_rate, pass_hz, amplitude, in_rate / 2));
+  double pass_db = 20 * log10(rms(pass, 0, resampler.get_taps()) / (amplitude / sqrt(2)));
+  EXPECT(fabs(pass_db) < 0.1);
+  EXPECT(fabs(rms(pass, 1, resampler.get_taps()) - rms(pass, 0, resampler.get_taps())) < 1);
+
+  resampler.reset();
+  std::vector<int16_t> stop = convert(resampler, tone(in_rate, stop_hz, amplitude, in_rate / 2));
+  double stop_db = 20 * log10(std::max(rms(stop, 0, resampler.get_taps()), 1e-3) / (amplitude / sqrt(2)));
+  EXPECT(stop_db < -55);
+}
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_WARN);
+  test_passthrough();
+  test_dc_gain(48000, 16000);
+  test_dc_gain(16000, 8000);
+  test_stopband(48000, 16000, 1000, 10000);
+  test_stopband(16000, 8000, 1000, 5000);
+  test::finish();
+}
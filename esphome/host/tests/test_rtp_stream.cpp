@@ -0,0 +1,100 @@
+// The RTP streamer over a real UDP socket: packets numbered and timestamped
+// on the audio clock across blocks the bus dropped for it
+
+#include "test_support.h"
+#include "esphome/components/medallion_voice/audio_bus.h"
+#include "esphome/components/medallion_voice/rtp_stream.h"
+
+#include <esp_timer.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+struct Packet {
+  uint16_t sequence;
+  uint32_t timestamp;
+  bool marker;
+};
+
+static bool receive(int sock, Packet &packet) {
+  uint8_t buf[2048];
+  ssize_t n = recv(sock, buf, sizeof(buf), 0);
+  if (n < 12) return false;
+  packet.marker = buf[1] & 0x80;
+  packet.sequence = buf[2] << 8 | buf[3];
+  packet.timestamp = (uint32_t) buf[4] << 24 | buf[5] << 16 | buf[6] << 8 | buf[7];
+  return true;
+}
+
+// 48 kHz capture streamed at 16 kHz: a 1 KiB block of 256 frames becomes
+// 85 or 86, so a gap must not be sized from the block after it
+static void test_gap_at_stream_rate() {
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  EXPECT(bind(sock, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+  EXPECT(getsockname(sock, (struct sockaddr *) &addr, &addr_len) == 0);
+  struct timeval timeout {1, 0};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  // The stream task outlives the test
+  static AudioBus bus;
+  static RtpStreamer streamer;
+  streamer.set_target("127.0.0.1", ntohs(addr.sin_port));
+  streamer.set_frame_duration(20);
+  streamer.set_sample_rate(16000);
+  EXPECT(streamer.setup(AudioFormat{48000, 2, 16}, &bus, 1024));
+  EXPECT(bus.setup(1024));
+  EXPECT(streamer.begin(48000));
+
+  auto produce = [](int count) {
+    for (int i = 0; i < count; i++) {
+      AudioBlock *block = bus.acquire();
+      EXPECT(block != nullptr);
+      if (block == nullptr) return;
+      memset(block->data, 0, 1024);
+      block->length = 1024;
+      block->capture_us = esp_timer_get_time();
+      bus.publish(block);
+      delay(2);
+    }
+  };
+
+  // 15 blocks are 1280 frames at 16 kHz, four 20 ms packets; then the bus
+  // drops three blocks, 256 frames
+  produce(15);
+  delay(50);
+  streamer.get_consumer()->set_active(false);
+  produce(3);
+  streamer.get_consumer()->set_active(true);
+  produce(15);
+
+  std::vector<Packet> packets(8);
+  for (Packet &packet : packets) EXPECT(receive(sock, packet));
+  EXPECT(packets[0].marker);
+  for (int i = 1; i < 4; i++) {
+    EXPECT_EQ((uint16_t) (packets[i].sequence - packets[0].sequence), i);
+    EXPECT_EQ(packets[i].timestamp - packets[0].timestamp, 320 * i);
+  }
+  // The 256 lost frames take one packet number and keep their time
+  EXPECT_EQ((uint16_t) (packets[4].sequence - packets[0].sequence), 5);
+  EXPECT_EQ(packets[4].timestamp - packets[0].timestamp, 1280 + 256);
+  for (int i = 5; i < 8; i++) {
+    EXPECT_EQ(packets[i].timestamp - packets[4].timestamp, 320 * (i - 4));
+  }
+  streamer.end();
+  close(sock);
+}
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_WARN);
+  test_gap_at_stream_rate();
+  test::finish();
+}
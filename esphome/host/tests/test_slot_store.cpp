@@ -0,0 +1,120 @@
+// Storage slots: which slot a recording takes, which recording it evicts,
+// and the slot table surviving a reboot
+
+#include "test_support.h"
+#include "esphome/components/medallion_voice/slot_store.h"
+#include "esphome/components/medallion_voice/wav_format.h"
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+static const uint32_t SLOT_SIZE = 64 * 1024;
+
+static std::string name(uint16_t session) {
+  char out[24];
+  RecordingCatalog::format_name(session, 0, out, sizeof(out));
+  return out;
+}
+
+struct Store {
+  SdFs sd;
+  SlotStore slots;
+
+  explicit Store(uint16_t count) {
+    EXPECT(this->sd.begin(SdSpiConfig(41, 0, 1000000)));
+    this->slots.set_slot_count(count);
+    this->slots.set_slot_size(SLOT_SIZE);
+    EXPECT(this->slots.setup(&this->sd, nullptr));
+  }
+
+  // Slot path taken by `session`, empty on failure
+  std::string acquire(uint16_t session, std::string *evicted = nullptr) {
+    std::string path, old;
+    if (!this->slots.acquire(name(session).c_str(), path, old)) return "";
+    if (evicted != nullptr) *evicted = old;
+    return path;
+  }
+};
+
+static void test_acquire_and_evict() {
+  host::sd_card().format();
+  Store store(3);
+  EXPECT_EQ(store.slots.get_free_bytes(), 3ull * (SLOT_SIZE - WAV_HEADER_SIZE));
+  std::string a = store.acquire(1), b = store.acquire(2), c = store.acquire(3);
+  EXPECT(a == "/slots/slot_000.wav");
+  EXPECT(b == "/slots/slot_001.wav");
+  EXPECT(c == "/slots/slot_002.wav");
+  EXPECT_EQ(store.slots.get_free_bytes(), 0);
+
+  // Nothing uploaded: no slot to take
+  EXPECT(store.acquire(4).empty());
+
+  // Uploaded first is evicted first, whatever order they were recorded in
+  store.slots.set_state(name(1).c_str(), RecordingState::SAVED);
+  store.slots.set_state(name(3).c_str(), RecordingState::UPLOADED);
+  store.slots.set_state(name(2).c_str(), RecordingState::UPLOADED);
+  store.slots.set_state(name(1).c_str(), RecordingState::UPLOADED);
+  std::string evicted;
+  EXPECT(store.acquire(4, &evicted) == c);
+  EXPECT(evicted == name(3));
+  EXPECT(store.acquire(5, &evicted) == b);
+  EXPECT(evicted == name(2));
+  EXPECT_EQ(store.slots.get_evictions(), 2);
+}
+
+// A rejected upload will not succeed by waiting; its slot is reused after
+// the uploaded ones, so a pool of rejections still records
+static void test_failed_uploads_reclaimed() {
+  host::sd_card().format();
+  Store store(3);
+  for (uint16_t session = 1; session <= 3; session++) store.acquire(session);
+  store.slots.set_state(name(2).c_str(), RecordingState::UPLOAD_FAILED);
+  store.slots.set_state(name(1).c_str(), RecordingState::UPLOAD_FAILED);
+  store.slots.set_state(name(3).c_str(), RecordingState::UPLOADED);
+  EXPECT_EQ(store.slots.get_free_bytes(), 3ull * (SLOT_SIZE - WAV_HEADER_SIZE));
+
+  std::string evicted;
+  EXPECT(store.acquire(4, &evicted) == "/slots/slot_002.wav");
+  EXPECT(evicted == name(3));
+  EXPECT(store.acquire(5, &evicted) == "/slots/slot_001.wav");
+  EXPECT(evicted == name(2));
+  EXPECT(store.acquire(6, &evicted) == "/slots/slot_000.wav");
+  EXPECT(evicted == name(1));
+  // Recordings waiting for their upload are kept
+  EXPECT(store.acquire(7).empty());
+}
+
+static void test_table_reloaded() {
+  host::sd_card().format();
+  {
+    Store store(3);
+    store.acquire(1);
+    store.acquire(2);
+    store.slots.set_state(name(2).c_str(), RecordingState::UPLOADED);
+  }
+  // A reboot keeps the recordings and the eviction order
+  Store store(3);
+  std::string path;
+  EXPECT(store.slots.find(name(1).c_str(), path));
+  EXPECT(path == "/slots/slot_000.wav");
+  EXPECT(store.acquire(3) == "/slots/slot_002.wav");
+  std::string evicted;
+  EXPECT(store.acquire(4, &evicted) == "/slots/slot_001.wav");
+  EXPECT(evicted == name(2));
+  EXPECT(store.acquire(5).empty());
+
+  // A changed slot size recreates every slot
+  Store resized(2);
+  resized.slots.set_slot_size(SLOT_SIZE * 2);
+  EXPECT(resized.slots.setup(&resized.sd, nullptr));
+  EXPECT(!resized.slots.find(name(1).c_str(), path));
+  EXPECT_EQ(resized.slots.get_free_bytes(), 2ull * (2 * SLOT_SIZE - WAV_HEADER_SIZE));
+}
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_WARN);
+  test_acquire_and_evict();
+  test_failed_uploads_reclaimed();
+  test_table_reloaded();
+  test::finish();
+}
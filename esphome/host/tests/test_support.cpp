@@ -0,0 +1,345 @@
+#include "test_support.h"
+#include "esp_rom_crc.h"
+#include "host/mock_i2s.h"
+#include "mbedtls/sha256.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace test {
+
+using namespace esphome;
+
+static std::atomic<int> failures{0};
+static std::atomic<int> checks{0};
+
+bool expect(bool ok, const char *what, const char *file, int line) {
+  checks++;
+  if (!ok) {
+    failures++;
+    fprintf(stderr, "FAIL %s:%d: %s\n", file, line, what);
+  }
+  return ok;
+}
+
+bool expect_eq(uint64_t a, uint64_t b, const char *what, const char *file, int line) {
+  checks++;
+  if (a != b) {
+    failures++;
+    fprintf(stderr, "FAIL %s:%d: %s (%llu != %llu)\n", file, line, what, (unsigned long long) a,
+            (unsigned long long) b);
+  }
+  return a == b;
+}
+
+void finish() {
+  fprintf(stderr, "%d checks, %d failed\n", checks.load(), failures.load());
+  fflush(stderr);
+  fflush(stdout);
+  _exit(failures > 0 ? 1 : 0);
+}
+
+bool quick_run(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) return true;
+  }
+  return false;
+}
+
+std::string sha256_hex(const uint8_t *data, size_t length) {
+  uint8_t digest[32];
+  mbedtls_sha256(data, length, digest, 0);
+  char hex[65];
+  for (int i = 0; i < 32; i++) snprintf(hex + i * 2, 3, "%02x", digest[i]);
+  return hex;
+}
+
+// ---- UploadServer ----
+
+UploadServer::~UploadServer() {
+  if (this->listen_fd_ >= 0) ::shutdown(this->listen_fd_, SHUT_RDWR);
+}
+
+uint16_t UploadServer::start() {
+  this->listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (this->listen_fd_ < 0) return 0;
+  int reuse = 1;
+  setsockopt(this->listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t len = sizeof(addr);
+  if (bind(this->listen_fd_, (sockaddr *) &addr, sizeof(addr)) != 0 || listen(this->listen_fd_, 128) != 0 ||
+      getsockname(this->listen_fd_, (sockaddr *) &addr, &len) != 0)
+    return 0;
+  this->port_ = ntohs(addr.sin_port);
+  std::thread([this] { this->accept_loop_(); }).detach();
+  return this->port_;
+}
+
+std::string UploadServer::url(const char *path) const {
+  return "http://127.0.0.1:" + std::to_string(this->port_) + path;
+}
+
+void UploadServer::add_known_digest(const std::string &digest) {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  this->known_digests_.push_back(digest);
+}
+
+bool UploadServer::has_file(const std::string &name) const {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  return this->files_.count(name) > 0;
+}
+
+std::vector<uint8_t> UploadServer::get_file(const std::string &name) const {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  auto it = this->files_.find(name);
+  return it != this->files_.end() ? it->second : std::vector<uint8_t>{};
+}
+
+void UploadServer::accept_loop_() {
+  while (true) {
+    int fd = accept(this->listen_fd_, nullptr, nullptr);
+    if (fd < 0) return;
+    this->connections_++;
+    std::thread([this, fd] {
+      this->serve_(fd);
+      ::close(fd);
+    }).detach();
+  }
+}
+
+static bool send_all(int fd, const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+static bool send_status(int fd, int status, const char *reason, const std::string &extra = "") {
+  char line[160];
+  snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", status, reason);
+  return send_all(fd, std::string(line) + extra + "Content-Length: 0\r\n\r\n");
+}
+
+static std::string query_param(const std::string &target, const char *name) {
+  size_t query = target.find('?');
+  if (query == std::string::npos) return "";
+  std::string key = std::string(name) + "=";
+  size_t pos = query;
+  while (pos != std::string::npos) {
+    pos++;
+    if (target.compare(pos, key.size(), key) == 0) {
+      size_t end = target.find('&', pos);
+      return target.substr(pos + key.size(), end == std::string::npos ? std::string::npos : end - pos - key.size());
+    }
+    pos = target.find('&', pos);
+  }
+  return "";
+}
+
+// Audio data of a recording: after the WAV or FLAC header
+static size_t audio_offset(const std::vector<uint8_t> &data) {
+  if (data.size() >= 44 && memcmp(data.data(), "RIFF", 4) == 0) return 44;
+  if (data.size() >= 4 && memcmp(data.data(), "fLaC", 4) == 0) {
+    size_t pos = 4;
+    while (pos + 4 <= data.size()) {
+      bool last = data[pos] & 0x80;
+      pos += 4 + ((size_t) data[pos + 1] << 16 | (size_t) data[pos + 2] << 8 | data[pos + 3]);
+      if (last) break;
+    }
+    return std::min(pos, data.size());
+  }
+  return 0;
+}
+
+void UploadServer::store_(const std::string &name, std::vector<uint8_t> data, const std::string &digest) {
+  if (!digest.empty()) {
+    size_t offset = audio_offset(data);
+    if (sha256_hex(data.data() + offset, data.size() - offset) != digest) this->digest_mismatches_++;
+  }
+  std::lock_guard<std::mutex> guard(this->lock_);
+  this->files_[name] = std::move(data);
+  this->uploads_++;
+}
+
+void UploadServer::serve_(int fd) {
+  std::string buffer;
+  char chunk[16384];
+  while (true) {
+    // Request line and headers
+    size_t header_end;
+    while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+      if (n <= 0) return;
+      buffer.append(chunk, n);
+    }
+    std::string head = buffer.substr(0, header_end);
+    buffer.erase(0, header_end + 4);
+
+    size_t line_end = head.find("\r\n");
+    std::string request_line = head.substr(0, line_end);
+    size_t sp1 = request_line.find(' ');
+    size_t sp2 = request_line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) return;
+    std::string method = request_line.substr(0, sp1);
+    std::string target = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+    std::map<std::string, std::string> headers;
+    size_t pos = line_end == std::string::npos ? head.size() : line_end + 2;
+    while (pos < head.size()) {
+      size_t end = head.find("\r\n", pos);
+      if (end == std::string::npos) end = head.size();
+      std::string line = head.substr(pos, end - pos);
+      size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        size_t value = line.find_first_not_of(' ', colon + 1);
+        headers[name] = value == std::string::npos ? "" : line.substr(value);
+      }
+      pos = end + 2;
+    }
+    this->requests_++;
+
+    size_t length = headers.count("content-length") ? strtoul(headers["content-length"].c_str(), nullptr, 10) : 0;
+    if (headers.count("expect") && strcasecmp(headers["expect"].c_str(), "100-continue") == 0) {
+      uint32_t delay_ms = this->response_delay_ms_;
+      if (delay_ms > 0) usleep(delay_ms * 1000);
+      bool known;
+      {
+        std::lock_guard<std::mutex> guard(this->lock_);
+        auto digest = headers.find("x-audio-sha256");
+        known = digest != headers.end() && std::find(this->known_digests_.begin(), this->known_digests_.end(),
+                                                     digest->second) != this->known_digests_.end();
+      }
+      if (known) {
+        // Decline the body; the client closes the connection
+        this->declined_++;
+        send_status(fd, 200, "OK");
+        return;
+      }
+      if (!send_all(fd, "HTTP/1.1 100 Continue\r\n\r\n")) return;
+    }
+
+    std::vector<uint8_t> body(buffer.begin(), buffer.begin() + std::min(length, buffer.size()));
+    buffer.erase(0, body.size());
+    while (body.size() < length) {
+      ssize_t n = recv(fd, chunk, std::min(sizeof(chunk), length - body.size()), 0);
+      if (n <= 0) return;
+      body.insert(body.end(), chunk, chunk + n);
+    }
+    this->body_bytes_ += length;
+
+    uint32_t delay_ms = this->response_delay_ms_;
+    if (delay_ms > 0) usleep(delay_ms * 1000);
+    if (!this->handle_(fd, method, target, headers, body)) return;
+  }
+}
+
+bool UploadServer::handle_(int fd, const std::string &method, const std::string &target,
+                           const std::map<std::string, std::string> &headers, const std::vector<uint8_t> &body) {
+  auto header = [&headers](const char *name) {
+    auto it = headers.find(name);
+    return it != headers.end() ? it->second : std::string();
+  };
+
+  if (method == "POST") {
+    // One multipart part holding the file
+    std::string boundary = header("content-type");
+    size_t b = boundary.find("boundary=");
+    if (b == std::string::npos) return send_status(fd, 400, "Bad Request");
+    boundary = "--" + boundary.substr(b + 9);
+    std::string text(body.begin(), body.end());
+    size_t part = text.find("\r\n\r\n");
+    size_t end = text.rfind("\r\n" + boundary + "--");
+    size_t name_pos = text.find("filename=\"");
+    if (text.compare(0, boundary.size(), boundary) != 0 || part == std::string::npos || end == std::string::npos ||
+        name_pos == std::string::npos || end < part + 4)
+      return send_status(fd, 400, "Bad Request");
+    std::string name = text.substr(name_pos + 10, text.find('"', name_pos + 10) - name_pos - 10);
+    this->store_(name, std::vector<uint8_t>(body.begin() + part + 4, body.begin() + end), header("x-audio-sha256"));
+    return send_status(fd, 200, "OK");
+  }
+
+  std::string name = query_param(target, "file");
+  uint32_t size = strtoul(query_param(target, "size").c_str(), nullptr, 10);
+  if (target.find("/resumable") == std::string::npos || name.empty()) return send_status(fd, 404, "Not Found");
+  std::string key = name + ":" + std::to_string(size);
+
+  if (method == "GET") {
+    std::lock_guard<std::mutex> guard(this->lock_);
+    uint32_t offset = this->files_.count(name) && this->files_[name].size() == size ? size : this->partial_[key].size();
+    return send_status(fd, 200, "OK", "Upload-Offset: " + std::to_string(offset) + "\r\n");
+  }
+  if (method == "PATCH") {
+    uint32_t offset = strtoul(header("upload-offset").c_str(), nullptr, 10);
+    std::string checksum = header("upload-checksum");
+    char expected[24];
+    snprintf(expected, sizeof(expected), "crc32 %08x", esp_rom_crc32_le(0, body.data(), body.size()));
+    std::vector<uint8_t> complete;
+    uint32_t committed;
+    {
+      std::lock_guard<std::mutex> guard(this->lock_);
+      auto &partial = this->partial_[key];
+      if (offset != partial.size())
+        return send_status(fd, 409, "Conflict", "Upload-Offset: " + std::to_string(partial.size()) + "\r\n");
+      if (strcasecmp(checksum.c_str(), expected) != 0) return send_status(fd, 460, "Checksum Mismatch");
+      partial.insert(partial.end(), body.begin(), body.end());
+      committed = partial.size();
+      if (committed >= size) {
+        complete = std::move(partial);
+        this->partial_.erase(key);
+      }
+    }
+    if (committed >= size) this->store_(name, std::move(complete), header("x-audio-sha256"));
+    return send_status(fd, 204, "No Content", "Upload-Offset: " + std::to_string(committed) + "\r\n");
+  }
+  return send_status(fd, 405, "Method Not Allowed");
+}
+
+// ---- Recorder ----
+
+Recorder::Recorder() {
+  // A fresh boot: the I2S peripheral is free again
+  host::i2s_reset();
+  // ES8311 chip ID
+  this->codec_registers.set_registers(0xFD, {0x83, 0x11});
+  this->bus.add_device(0x18, &this->codec_registers);
+  this->codec.set_i2c_bus(&this->bus);
+  this->codec.set_i2c_address(0x18);
+  this->voice.set_audio_codec(&this->codec);
+  this->voice.set_sd_cs_pin(&this->sd_cs);
+}
+
+bool Recorder::setup() {
+  this->codec.setup();
+  if (this->codec.is_failed()) return false;
+  this->voice.setup();
+  return !this->voice.is_failed();
+}
+
+bool Recorder::record(uint32_t ms) {
+  if (!this->voice.start_recording()) return false;
+  uint32_t start = millis();
+  this->run_until([start, ms] { return millis() - start >= ms; }, ms + 1000);
+  this->voice.stop_recording();
+  return true;
+}
+
+bool Recorder::run_until(const std::function<bool()> &done, uint32_t timeout_ms) {
+  return host::run_loop({&this->codec, &this->voice}, done, timeout_ms);
+}
+
+}  // namespace test
@@ -0,0 +1,106 @@
+#pragma once
+
+// Shared pieces of the host tests and benchmarks: expectations, a local
+// upload server speaking both of the firmware's upload protocols, and a
+// recorder wired to the mock codec, bus and SD card the way medallion.yaml
+// wires the real ones.
+
+#include "esphome/components/es8311/es8311.h"
+#include "esphome/components/medallion_voice/medallion_voice.h"
+#include "host/host.h"
+#include "host/mock_i2c.h"
+#include "host/mock_pin.h"
+#include "host/mock_sd.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define EXPECT(cond) ::test::expect((cond), #cond, __FILE__, __LINE__)
+#define EXPECT_EQ(a, b) ::test::expect_eq((uint64_t) (a), (uint64_t) (b), #a " == " #b, __FILE__, __LINE__)
+
+namespace test {
+
+bool expect(bool ok, const char *what, const char *file, int line);
+bool expect_eq(uint64_t a, uint64_t b, const char *what, const char *file, int line);
+// Print the result and exit without running static destructors: component
+// tasks (upload, frame) are still running, as they would on the device
+[[noreturn]] void finish();
+
+// "--quick" on the command line: a short run to check a benchmark works
+bool quick_run(int argc, char **argv);
+
+// Lowercase hex SHA-256 of `data`
+std::string sha256_hex(const uint8_t *data, size_t length);
+
+// HTTP/1.1 upload server on 127.0.0.1, one thread per connection. Accepts
+// the one-shot multipart POST (honouring "Expect: 100-continue") and the
+// resumable GET/PATCH offset protocol, like tools/upload_server.py. Stored
+// files are kept in memory.
+class UploadServer {
+ public:
+  ~UploadServer();
+  // Listen on an ephemeral port; returns it, or 0 on failure
+  uint16_t start();
+  uint16_t get_port() const { return this->port_; }
+  std::string url(const char *path = "/upload") const;
+
+  // Delay before every response, to model a slow or distant server
+  void set_response_delay_ms(uint32_t delay_ms) { this->response_delay_ms_ = delay_ms; }
+  // Audio digests the server already has: an upload carrying one is
+  // declined before its body with 200
+  void add_known_digest(const std::string &digest);
+
+  bool has_file(const std::string &name) const;
+  std::vector<uint8_t> get_file(const std::string &name) const;
+  uint32_t get_requests() const { return this->requests_; }
+  uint32_t get_connections() const { return this->connections_; }
+  uint32_t get_uploads() const { return this->uploads_; }
+  uint32_t get_declined() const { return this->declined_; }
+  uint32_t get_digest_mismatches() const { return this->digest_mismatches_; }
+  uint64_t get_body_bytes() const { return this->body_bytes_; }
+
+ protected:
+  void accept_loop_();
+  void serve_(int fd);
+  bool handle_(int fd, const std::string &method, const std::string &target,
+               const std::map<std::string, std::string> &headers, const std::vector<uint8_t> &body);
+  void store_(const std::string &name, std::vector<uint8_t> data, const std::string &digest);
+
+  int listen_fd_{-1};
+  uint16_t port_{0};
+  std::atomic<uint32_t> response_delay_ms_{0};
+  mutable std::mutex lock_;
+  std::map<std::string, std::vector<uint8_t>> files_;
+  std::map<std::string, std::vector<uint8_t>> partial_;
+  std::vector<std::string> known_digests_;
+  std::atomic<uint32_t> requests_{0};
+  std::atomic<uint32_t> connections_{0};
+  std::atomic<uint32_t> uploads_{0};
+  std::atomic<uint32_t> declined_{0};
+  std::atomic<uint32_t> digest_mismatches_{0};
+  std::atomic<uint64_t> body_bytes_{0};
+};
+
+// The recorder with an ES8311 on a mock I2C bus and a mock SD card
+struct Recorder {
+  esphome::host::MockI2CBus bus;
+  esphome::host::RegisterDevice codec_registers;
+  esphome::host::MockPin sd_cs{41};
+  esphome::es8311::ES8311Component codec;
+  esphome::medallion_voice::MedallionVoiceComponent voice;
+
+  Recorder();
+  // Set up the codec and recorder; configure `voice` before this
+  bool setup();
+  // Record for `ms` of wall time, running the main loop
+  bool record(uint32_t ms);
+  // Run the main loop until `done` or `timeout_ms`
+  bool run_until(const std::function<bool()> &done, uint32_t timeout_ms);
+};
+
+}  // namespace test
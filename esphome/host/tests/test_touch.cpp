@@ -0,0 +1,124 @@
+// CST92xx touch reports read over the mock I2C bus
+
+#include "test_support.h"
+#include "esphome/components/cst92xx/cst92xx.h"
+
+using namespace esphome;
+using namespace esphome::cst92xx;
+
+static const uint8_t ADDRESS = 0x5A;
+
+struct Point {
+  uint8_t event;  // 0 down, 1 up, 2 contact
+  uint8_t id;
+  uint16_t x;
+  uint16_t y;
+};
+
+static void set_report(host::RegisterDevice &device, uint8_t count, const std::vector<Point> &points) {
+  std::vector<uint8_t> report(TOUCH_REPORT_SIZE, 0);
+  report[2] = count;
+  for (size_t i = 0; i < points.size(); i++) {
+    uint8_t *p = &report[3 + i * 6];
+    p[0] = points[i].event << 4 | (points[i].x >> 8 & 0x0F);
+    p[1] = points[i].x & 0xFF;
+    p[2] = points[i].id << 4 | (points[i].y >> 8 & 0x0F);
+    p[3] = points[i].y & 0xFF;
+  }
+  device.set_registers(0x00, report);
+}
+
+struct Touch {
+  host::MockI2CBus bus;
+  host::RegisterDevice device;
+  CST92xxComponent touch;
+  std::vector<std::tuple<uint8_t, int16_t, int16_t>> events;
+
+  Touch() {
+    this->device.set_registers(0xA7, {0xB3, 0x01, 0x12});
+    this->bus.add_device(ADDRESS, &this->device);
+    this->touch.set_i2c_bus(&this->bus);
+    this->touch.set_i2c_address(ADDRESS);
+    this->touch.add_on_touch_callback(
+        [this](uint8_t count, int16_t x, int16_t y) { this->events.emplace_back(count, x, y); });
+  }
+};
+
+static void test_touch_and_release() {
+  Touch t;
+  t.touch.setup();
+  EXPECT(!t.touch.is_failed());
+
+  set_report(t.device, 1, {{0, 0, 100, 200}});
+  t.touch.loop();
+  EXPECT_EQ(t.touch.get_touch_count(), 1);
+  // Mirrored on both axes by default, 466 x 466
+  EXPECT_EQ(t.touch.get_touch_x(), 366);
+  EXPECT_EQ(t.touch.get_touch_y(), 266);
+  EXPECT(t.touch.get_touch_point(0).pressed);
+  if (EXPECT_EQ(t.events.size(), 1)) EXPECT(t.events[0] == std::make_tuple(uint8_t(1), int16_t(366), int16_t(266)));
+
+  // Holding still is not a new touch
+  set_report(t.device, 1, {{2, 0, 101, 201}});
+  t.touch.loop();
+  EXPECT_EQ(t.events.size(), 1);
+  EXPECT_EQ(t.touch.get_touch_x(), 365);
+
+  set_report(t.device, 0, {});
+  t.touch.loop();
+  EXPECT(!t.touch.is_touched());
+  EXPECT_EQ(t.touch.get_touch_x(), -1);
+  EXPECT(!t.touch.get_touch_point(0).pressed);
+}
+
+static void test_geometry() {
+  Touch t;
+  t.touch.set_mirror_x(false);
+  t.touch.set_mirror_y(false);
+  t.touch.set_width(410);
+  t.touch.set_height(502);
+  t.touch.setup();
+
+  // Two points; coordinates past the panel are clamped
+  set_report(t.device, 2, {{0, 0, 100, 200}, {0, 1, 4000, 600}});
+  t.touch.loop();
+  EXPECT_EQ(t.touch.get_touch_count(), 2);
+  EXPECT_EQ(t.touch.get_touch_point(0).x, 100);
+  EXPECT_EQ(t.touch.get_touch_point(0).y, 200);
+  EXPECT_EQ(t.touch.get_touch_point(1).id, 1);
+  EXPECT_EQ(t.touch.get_touch_point(1).x, 409);
+  EXPECT_EQ(t.touch.get_touch_point(1).y, 501);
+
+  // A count beyond what the report holds is capped
+  set_report(t.device, 0x0F, {});
+  t.touch.loop();
+  EXPECT_EQ(t.touch.get_touch_count(), MAX_TOUCH_POINTS);
+}
+
+static void test_bus_errors() {
+  Touch t;
+  t.touch.setup();
+  set_report(t.device, 1, {{0, 0, 10, 10}});
+  t.touch.loop();
+  EXPECT_EQ(t.touch.get_touch_count(), 1);
+
+  // A failed read keeps the last state instead of reporting a release
+  t.device.set_nack(true);
+  t.touch.loop();
+  EXPECT_EQ(t.touch.get_touch_count(), 1);
+  EXPECT_EQ(t.events.size(), 1);
+  t.device.set_nack(false);
+
+  // One register read per loop: the address, then the whole report
+  uint32_t before = t.bus.get_transfer_count();
+  t.touch.loop();
+  EXPECT_EQ(t.bus.get_transfer_count() - before, 2);
+}
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_WARN);
+  test_touch_and_release();
+  test_geometry();
+  test_bus_errors();
+  test::finish();
+}
@@ -0,0 +1,202 @@
+// Uploads from the mock SD card to a local server, over a real socket:
+// the one-shot multipart POST and the resumable chunked upload
+
+#include "test_support.h"
+#include "esphome/components/medallion_voice/sd_lock.h"
+#include "esphome/components/medallion_voice/wav_format.h"
+
+using namespace esphome;
+using namespace esphome::medallion_voice;
+
+static std::vector<uint8_t> card_file(const std::string &name) {
+  std::vector<uint8_t> data;
+  host::sd_card().read_file(name, data);
+  return data;
+}
+
+static std::string base_name(const std::string &path) { return path.substr(path.rfind('/') + 1); }
+
+static void test_one_shot_upload() {
+  host::sd_card().format();
+  test::UploadServer server;
+  EXPECT(server.start() != 0);
+  test::Recorder recorder;
+  recorder.voice.set_upload_url(server.url());
+  EXPECT(recorder.setup());
+
+  EXPECT(recorder.record(500));
+  std::string name = recorder.voice.get_current_file();
+  EXPECT(recorder.voice.upload_recording());
+  EXPECT(recorder.voice.get_state() == RecorderState::UPLOADED);
+  std::vector<uint8_t> sent = card_file(name);
+  EXPECT(sent.size() > WAV_HEADER_SIZE);
+  EXPECT(server.get_file(base_name(name)) == sent);
+  EXPECT_EQ(server.get_digest_mismatches(), 0);
+
+  // A second recording reuses the connection
+  EXPECT(recorder.record(300));
+  EXPECT(recorder.voice.upload_recording());
+  EXPECT(server.get_file(base_name(recorder.voice.get_current_file())) == card_file(recorder.voice.get_current_file()));
+  EXPECT_EQ(server.get_uploads(), 2);
+  EXPECT_EQ(server.get_connections(), 1);
+}
+
+static void test_duplicate_declined() {
+  host::sd_card().format();
+  test::UploadServer server;
+  EXPECT(server.start() != 0);
+  test::Recorder recorder;
+  recorder.voice.set_upload_url(server.url());
+  EXPECT(recorder.setup());
+  EXPECT(recorder.record(300));
+
+  // The server already has this audio: the body is never sent
+  std::vector<uint8_t> wav = card_file(recorder.voice.get_current_file());
+  server.add_known_digest(test::sha256_hex(wav.data() + WAV_HEADER_SIZE, wav.size() - WAV_HEADER_SIZE));
+  EXPECT(recorder.voice.upload_recording());
+  EXPECT(recorder.voice.get_state() == RecorderState::UPLOADED);
+  EXPECT_EQ(server.get_declined(), 1);
+  EXPECT_EQ(server.get_uploads(), 0);
+  EXPECT(server.get_body_bytes() < 1024);
+}
+
+static void test_upload_failures() {
+  host::sd_card().format();
+  test::Recorder recorder;
+  // Nothing listens on port 1
+  recorder.voice.set_upload_url("http://127.0.0.1:1/upload");
+  EXPECT(recorder.setup());
+  EXPECT(recorder.record(200));
+
+  host::set_network_connected(false);
+  EXPECT(!recorder.voice.upload_recording());
+  EXPECT(recorder.voice.get_error() == RecorderError::NO_WIFI);
+  host::set_network_connected(true);
+
+  EXPECT(!recorder.voice.upload_recording());
+  EXPECT(recorder.voice.get_error() == RecorderError::CONNECT_FAIL);
+}
+
+static void test_resumable_upload() {
+  host::sd_card().format();
+  test::UploadServer server;
+  EXPECT(server.start() != 0);
+  test::Recorder recorder;
+  recorder.voice.set_upload_url(server.url());
+  recorder.voice.set_resumable_upload(true);
+  recorder.voice.set_upload_chunk_size(4096);
+  EXPECT(recorder.setup());
+
+  EXPECT(recorder.record(800));
+  std::string name = recorder.voice.get_current_file();
+  EXPECT(recorder.voice.upload_recording());
+  EXPECT(recorder.run_until([&] { return recorder.voice.get_state() == RecorderState::UPLOADED; }, 10000));
+
+  std::vector<uint8_t> wav = card_file(name);
+  EXPECT(server.get_file(base_name(name)) == wav);
+  EXPECT_EQ(server.get_digest_mismatches(), 0);
+  // One offset query, then a PATCH per chunk
+  EXPECT_EQ(server.get_requests(), 1 + (wav.size() + 4095) / 4096);
+}
+
+// Each result of the upload task reaches the state, even one that repeats
+// the last: a second upload that fails to start does not leave the
+// recorder queued
+static void test_resumable_failures_repeat() {
+  host::sd_card().format();
+  test::Recorder recorder;
+  recorder.voice.set_upload_url("http://127.0.0.1:1/upload");
+  recorder.voice.set_resumable_upload(true);
+  EXPECT(recorder.setup());
+  auto failed = [&] { return recorder.voice.get_error() == RecorderError::UPLOAD_FAIL; };
+  for (int i = 0; i < 2; i++) {
+    EXPECT(recorder.record(200));
+    // Gone from the card: the uploader cannot open it
+    EXPECT(host::sd_card().remove(host::MockSdCard::normalize(recorder.voice.get_current_file())));
+    EXPECT(recorder.voice.upload_recording());
+    EXPECT(recorder.run_until(failed, 5000));
+  }
+}
+
+// Finished recordings live on in the catalog as SAVED until they are
+// uploaded: a boot in segment mode queues them all, more than the queue
+// holds, once it has drained
+static void test_saved_requeued_at_boot() {
+  host::sd_card().format();
+  const int files = 20;
+  {
+    test::Recorder recorder;
+    EXPECT(recorder.setup());
+    for (int i = 0; i < files; i++) EXPECT(recorder.record(50));
+  }
+
+  test::UploadServer server;
+  EXPECT(server.start() != 0);
+  test::Recorder recorder;
+  recorder.voice.set_upload_url(server.url());
+  recorder.voice.set_resumable_upload(true);
+  recorder.voice.set_segment_duration(60000);
+  EXPECT(recorder.setup());
+  auto all_uploaded = [&] {
+    for (int i = 1; i <= files; i++) {
+      char name[24];
+      RecordingCatalog::format_name(i, 0, name, sizeof(name));
+      if (!server.has_file(base_name(name))) return false;
+    }
+    // The last upload has finished on the device side too
+    return recorder.voice.get_state() == RecorderState::UPLOADED;
+  };
+  EXPECT(recorder.run_until(all_uploaded, 20000));
+  EXPECT_EQ(server.get_digest_mismatches(), 0);
+}
+
+// The one-shot upload takes the SD lock for each card access and never
+// across the network: another task on the card (the log file, background
+// uploads) neither races it nor waits out a slow server
+static void test_upload_shares_card() {
+  host::sd_card().format();
+  test::UploadServer server;
+  EXPECT(server.start() != 0);
+  test::Recorder recorder;
+  recorder.voice.set_upload_url(server.url());
+  EXPECT(recorder.setup());
+  EXPECT(recorder.record(500));
+
+  host::sd_card().reset_counters();
+  host::sd_card().set_access_delay(200);
+  server.set_response_delay_ms(300);
+  std::atomic<bool> stop{false};
+  std::atomic<uint32_t> max_wait_us{0};
+  std::thread other([&] {
+    while (!stop) {
+      uint32_t start = micros();
+      {
+        SdLock lock(recorder.voice.get_sd_mutex());
+        max_wait_us = std::max<uint32_t>(max_wait_us, micros() - start);
+        host::MockSdCard::Access access(&host::sd_card());
+        delayMicroseconds(200);
+      }
+      delayMicroseconds(100);
+    }
+  });
+  EXPECT(recorder.voice.upload_recording());
+  stop = true;
+  other.join();
+  host::sd_card().set_access_delay(0);
+
+  EXPECT(server.get_file(base_name(recorder.voice.get_current_file())) == card_file(recorder.voice.get_current_file()));
+  EXPECT_EQ(host::sd_card().get_concurrent_accesses(), 0);
+  EXPECT(max_wait_us < 100000);
+}
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_WARN);
+  test_one_shot_upload();
+  test_duplicate_declined();
+  test_upload_failures();
+  test_resumable_upload();
+  test_resumable_failures_repeat();
+  test_saved_requeued_at_boot();
+  test_upload_shares_card();
+  test::finish();
+}
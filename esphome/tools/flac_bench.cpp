@@ -0,0 +1,525 @@
+// Host benchmark and round-trip check of the recorder's FLAC encoder
+// (`file_format: flac`).
+//
+//     g++ -O2 -std=c++17 -o flac_bench tools/flac_bench.cpp
+//     ./flac_bench --seconds 30 --wav voice_0001.wav --out voice_0001.flac
+//
+// The host build (host/CMakeLists.txt) builds it too, and ctest runs the
+// decode check with --quick.
+//
+// Encodes test signals (silence, a stereo tone, correlated stereo "speech"
+// made of swept tones in a noise envelope, full-scale noise) and optionally
+// a 16-bit WAV recording, fed in the recorder's 1 KiB capture blocks. For
+// each it reports encode speed in samples per second per channel, as a
+// multiple of real time at the stream's sample rate, and the size against
+// PCM. Every stream is then decoded by the independent decoder below, with
+// header and frame CRCs checked, and compared sample for sample with the
+// input.
+//
+// The host is far faster than the S3; on the device the
+// `medallion_voice.encode` perf_stats operation gives the real cost of each
+// frame (64 ms of audio at 16 kHz).
+//
+// Exit status is non-zero when a stream does not decode bit-exactly, or
+// when --min-realtime is given and a signal encodes slower than that.
+
+#include "../custom_components/medallion_voice/flac_encoder.cpp"
+#include "../custom_components/medallion_voice/wav_format.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using esphome::medallion_voice::AudioFormat;
+using esphome::medallion_voice::FLAC_HEADER_SIZE;
+using esphome::medallion_voice::FlacEncoder;
+using esphome::medallion_voice::FlacStreamInfo;
+
+static const size_t CAPTURE_BLOCK_SIZE = 1024;
+
+// ---------------------------------------------------------------------------
+// Decoder, written from the format specification (RFC 9639) rather than
+// from the encoder, for the subset the encoder produces
+
+class BitReader {
+ public:
+  BitReader(const uint8_t *data, size_t length) : data_(data), length_(length) {}
+
+  bool ok() const { return this->pos_ <= this->length_ * 8; }
+  size_t byte_pos() const { return this->pos_ / 8; }
+  bool aligned() const { return this->pos_ % 8 == 0; }
+
+  uint64_t bits(unsigned n) {
+    uint64_t v = 0;
+    for (unsigned i = 0; i < n; i++) {
+      size_t byte = this->pos_ / 8;
+      unsigned bit = byte < this->length_ ? (this->data_[byte] >> (7 - this->pos_ % 8)) & 1 : 0;
+      v = (v << 1) | bit;
+      this->pos_++;
+    }
+    return v;
+  }
+
+  int64_t signed_bits(unsigned n) {
+    uint64_t v = this->bits(n);
+    return n > 0 && (v >> (n - 1)) ? (int64_t) v - ((int64_t) 1 << n) : (int64_t) v;
+  }
+
+  uint64_t unary() {
+    uint64_t zeros = 0;
+    while (this->ok() && this->bits(1) == 0) zeros++;
+    return zeros;
+  }
+
+  void align() { this->pos_ = (this->pos_ + 7) / 8 * 8; }
+
+ private:
+  const uint8_t *data_;
+  size_t length_;
+  size_t pos_{0};
+};
+
+static uint8_t ref_crc8(const uint8_t *data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+static uint16_t ref_crc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i] << 8;
+    for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+  }
+  return crc;
+}
+
+struct Decoded {
+  uint32_t sample_rate = 0;
+  unsigned channels = 0;
+  unsigned bits_per_sample = 0;
+  uint64_t total_samples = 0;
+  uint32_t frames = 0;
+  uint32_t min_frame_size = 0, max_frame_size = 0;
+  std::vector<int16_t> pcm;  // interleaved
+  std::string error;
+};
+
+static bool decode_residual(BitReader &r, unsigned block_size, unsigned order, std::vector<int64_t> &out) {
+  unsigned method = r.bits(2);
+  if (method > 1) return false;
+  unsigned param_bits = method == 0 ? 4 : 5;
+  unsigned escape = method == 0 ? 15 : 31;
+  unsigned partition_order = r.bits(4);
+  unsigned partitions = 1u << partition_order;
+  if ((block_size >> partition_order) << partition_order != block_size) return false;
+  for (unsigned p = 0; p < partitions; p++) {
+    unsigned count = (block_size >> partition_order) - (p == 0 ? order : 0);
+    unsigned param = r.bits(param_bits);
+    if (param == escape) {
+      unsigned width = r.bits(5);
+      for (unsigned i = 0; i < count; i++) out.push_back(r.signed_bits(width));
+      continue;
+    }
+    for (unsigned i = 0; i < count; i++) {
+      uint64_t folded = (r.unary() << param) | r.bits(param);
+      out.push_back(folded & 1 ? -(int64_t) (folded >> 1) - 1 : (int64_t) (folded >> 1));
+    }
+  }
+  return r.ok();
+}
+
+static bool decode_subframe(BitReader &r, unsigned block_size, unsigned bps, std::vector<int64_t> &x) {
+  x.clear();
+  if (r.bits(1) != 0) return false;
+  unsigned type = r.bits(6);
+  if (r.bits(1)) {
+    // Wasted bits; not produced by the encoder
+    return false;
+  }
+  if (type == 0) {
+    int64_t v = r.signed_bits(bps);
+    x.assign(block_size, v);
+    return true;
+  }
+  if (type == 1) {
+    for (unsigned i = 0; i < block_size; i++) x.push_back(r.signed_bits(bps));
+    return true;
+  }
+  if (type >= 8 && type <= 12) {
+    unsigned order = type - 8;
+    for (unsigned i = 0; i < order; i++) x.push_back(r.signed_bits(bps));
+    std::vector<int64_t> res;
+    if (!decode_residual(r, block_size, order, res)) return false;
+    static const int coefs[5][4] = {{0}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+    for (int64_t e : res) {
+      size_t i = x.size();
+      int64_t pred = 0;
+      for (unsigned j = 0; j < order; j++) pred += coefs[order][j] * x[i - 1 - j];
+      x.push_back(pred + e);
+    }
+    return true;
+  }
+  if (type >= 32) {
+    unsigned order = type - 31;
+    for (unsigned i = 0; i < order; i++) x.push_back(r.signed_bits(bps));
+    unsigned precision = r.bits(4) + 1;
+    if (precision == 16) return false;
+    int shift = (int) r.signed_bits(5);
+    if (shift < 0) return false;
+    std::vector<int64_t> q;
+    for (unsigned j = 0; j < order; j++) q.push_back(r.signed_bits(precision));
+    std::vector<int64_t> res;
+    if (!decode_residual(r, block_size, order, res)) return false;
+    for (int64_t e : res) {
+      size_t i = x.size();
+      int64_t sum = 0;
+      for (unsigned j = 0; j < order; j++) sum += q[j] * x[i - 1 - j];
+      x.push_back((sum >> shift) + e);
+    }
+    return true;
+  }
+  return false;
+}
+
+static Decoded decode(const std::vector<uint8_t> &file) {
+  Decoded d;
+  if (file.size() < 4 + 4 + 34 || memcmp(file.data(), "fLaC", 4) != 0) {
+    d.error = "no fLaC marker";
+    return d;
+  }
+
+  // Metadata blocks
+  size_t pos = 4;
+  bool last = false, have_streaminfo = false;
+  while (!last) {
+    if (pos + 4 > file.size()) {
+      d.error = "truncated metadata";
+      return d;
+    }
+    last = file[pos] & 0x80;
+    unsigned type = file[pos] & 0x7F;
+    size_t length = (file[pos + 1] << 16) | (file[pos + 2] << 8) | file[pos + 3];
+    pos += 4;
+    if (type == 0) {
+      BitReader r(&file[pos], length);
+      r.bits(16);  // min block size
+      r.bits(16);
+      d.min_frame_size = r.bits(24);
+      d.max_frame_size = r.bits(24);
+      d.sample_rate = r.bits(20);
+      d.channels = r.bits(3) + 1;
+      d.bits_per_sample = r.bits(5) + 1;
+      d.total_samples = r.bits(36);
+      have_streaminfo = true;
+    }
+    pos += length;
+  }
+  if (!have_streaminfo || d.bits_per_sample != 16) {
+    d.error = "missing or unsupported STREAMINFO";
+    return d;
+  }
+
+  // Frames
+  std::vector<int64_t> sub[2];
+  uint32_t min_size = UINT32_MAX, max_size = 0;
+  while (pos < file.size()) {
+    const uint8_t *frame = &file[pos];
+    BitReader r(frame, file.size() - pos);
+    char where[64];
+    snprintf(where, sizeof(where), "frame %u", (unsigned) d.frames);
+    if (r.bits(15) != 0x7FFC || r.bits(1) != 0) {
+      d.error = std::string(where) + ": no sync (variable block size?)";
+      return d;
+    }
+    unsigned bs_code = r.bits(4), sr_code = r.bits(4), assignment = r.bits(4), ss_code = r.bits(3);
+    r.bits(1);
+    // Frame number, UTF-8 coded
+    uint64_t number = r.bits(8);
+    unsigned extra = 0;
+    while (extra < 7 && (number & (0x80 >> extra))) extra++;
+    if (extra == 1 || extra > 7) {
+      d.error = std::string(where) + ": bad frame number";
+      return d;
+    }
+    if (extra > 1) {
+      number &= 0xFF >> (extra + 1);
+      for (unsigned i = 1; i < extra; i++) number = (number << 6) | (r.bits(8) & 0x3F);
+    }
+    unsigned block_size;
+    if (bs_code == 1) {
+      block_size = 192;
+    } else if (bs_code >= 2 && bs_code <= 5) {
+      block_size = 576 << (bs_code - 2);
+    } else if (bs_code == 6) {
+      block_size = r.bits(8) + 1;
+    } else if (bs_code == 7) {
+      block_size = r.bits(16) + 1;
+    } else if (bs_code >= 8) {
+      block_size = 256 << (bs_code - 8);
+    } else {
+      d.error = std::string(where) + ": reserved block size";
+      return d;
+    }
+    if (sr_code == 12) r.bits(8);
+    if (sr_code == 13 || sr_code == 14) r.bits(16);
+    if (ss_code != 4 && ss_code != 0) {
+      d.error = std::string(where) + ": sample size is not 16 bits";
+      return d;
+    }
+    if (number != d.frames) {
+      d.error = std::string(where) + ": out of sequence";
+      return d;
+    }
+    size_t header_length = r.byte_pos();
+    if (r.bits(8) != ref_crc8(frame, header_length)) {
+      d.error = std::string(where) + ": header CRC-8 mismatch";
+      return d;
+    }
+
+    unsigned channels = assignment < 8 ? assignment + 1 : 2;
+    if (channels != d.channels) {
+      d.error = std::string(where) + ": channel count differs from STREAMINFO";
+      return d;
+    }
+    for (unsigned c = 0; c < channels; c++) {
+      unsigned bps = 16;
+      if ((assignment == 8 && c == 1) || (assignment == 9 && c == 0) || (assignment == 10 && c == 1)) bps = 17;
+      if (!decode_subframe(r, block_size, bps, sub[c]) || sub[c].size() != block_size) {
+        d.error = std::string(where) + ": bad subframe";
+        return d;
+      }
+    }
+    r.align();
+    size_t body_length = r.byte_pos();
+    if (r.bits(16) != ref_crc16(frame, body_length) || !r.ok()) {
+      d.error = std::string(where) + ": frame CRC-16 mismatch";
+      return d;
+    }
+    size_t frame_size = r.byte_pos();
+    if (frame_size < min_size) min_size = frame_size;
+    if (frame_size > max_size) max_size = frame_size;
+
+    for (unsigned i = 0; i < block_size; i++) {
+      int64_t a = sub[0][i], b = channels == 2 ? sub[1][i] : 0;
+      int64_t left = a, right = b;
+      if (assignment == 8) {
+        right = a - b;
+      } else if (assignment == 9) {
+        left = a + b;
+      } else if (assignment == 10) {
+        int64_t mid = (a << 1) | (b & 1);
+        left = (mid + b) >> 1;
+        right = (mid - b) >> 1;
+      }
+      d.pcm.push_back((int16_t) left);
+      if (channels == 2) d.pcm.push_back((int16_t) right);
+    }
+    d.frames++;
+    pos += frame_size;
+  }
+
+  if (d.pcm.size() / d.channels != d.total_samples) {
+    d.error = "STREAMINFO total samples does not match the frames";
+  } else if (d.frames > 0 && (d.min_frame_size != min_size || d.max_frame_size != max_size)) {
+    d.error = "STREAMINFO frame sizes do not match the frames";
+  }
+  return d;
+}
+
+// ---------------------------------------------------------------------------
+// Signals
+
+static std::vector<int16_t> make_signal(const std::string &name, uint32_t rate, double seconds) {
+  size_t frames = (size_t) (rate * seconds);
+  std::vector<int16_t> pcm(frames * 2);
+  std::mt19937 rng(1234);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::uniform_int_distribution<int> full(-32768, 32767);
+  double phase = 0.0, envelope = 0.0;
+  for (size_t i = 0; i < frames; i++) {
+    double t = (double) i / rate;
+    int32_t left = 0, right = 0;
+    if (name == "tone") {
+      left = (int32_t) (12000 * sin(2 * M_PI * 440 * t));
+      right = (int32_t) (9000 * sin(2 * M_PI * 440 * t + 0.3));
+    } else if (name == "speech") {
+      // Syllable-rate envelope over a gliding pitch and its harmonics, plus
+      // a little room noise; the two channels differ by gain and noise
+      double pitch = 140 + 40 * sin(2 * M_PI * 0.7 * t);
+      phase += 2 * M_PI * pitch / rate;
+      double target = 0.5 + 0.5 * sin(2 * M_PI * 4 * t);
+      envelope += (target - envelope) * 0.002;
+      double voice = 0.0;
+      for (int h = 1; h <= 8; h++) voice += sin(h * phase) / h;
+      double v = 6000 * envelope * voice;
+      left = (int32_t) (v + 30 * gauss(rng));
+      right = (int32_t) (0.8 * v + 30 * gauss(rng));
+    } else if (name == "noise") {
+      left = full(rng);
+      right = full(rng);
+    }
+    pcm[2 * i] = (int16_t) std::max(-32768, std::min(32767, left));
+    pcm[2 * i + 1] = (int16_t) std::max(-32768, std::min(32767, right));
+  }
+  return pcm;
+}
+
+static bool read_wav(const char *path, std::vector<int16_t> &pcm, AudioFormat &format) {
+  FILE *f = fopen(path, "rb");
+  if (f == nullptr) return false;
+  std::vector<uint8_t> data;
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+  fclose(f);
+  if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) != 0 || memcmp(&data[8], "WAVE", 4) != 0) return false;
+  size_t pos = 12;
+  bool have_fmt = false;
+  while (pos + 8 <= data.size()) {
+    uint32_t size = data[pos + 4] | (data[pos + 5] << 8) | (data[pos + 6] << 16) | ((uint32_t) data[pos + 7] << 24);
+    const uint8_t *body = &data[pos + 8];
+    if (memcmp(&data[pos], "fmt ", 4) == 0 && size >= 16) {
+      format.channels = body[2] | (body[3] << 8);
+      format.sample_rate = body[4] | (body[5] << 8) | (body[6] << 16) | ((uint32_t) body[7] << 24);
+      format.bits_per_sample = body[14] | (body[15] << 8);
+      have_fmt = true;
+    } else if (memcmp(&data[pos], "data", 4) == 0 && have_fmt) {
+      size = std::min<size_t>(size, data.size() - pos - 8);
+      pcm.resize(size / 2);
+      memcpy(pcm.data(), body, pcm.size() * 2);
+      return format.bits_per_sample == 16 && format.channels >= 1 && format.channels <= 2;
+    }
+    pos += 8 + size + (size & 1);
+  }
+  return false;
+}
+
+// ---------------------------------------------------------------------------
+
+// Kept static: the encoder holds its buffers inline, like on the device
+static FlacEncoder encoder;
+
+struct Result {
+  double samples_per_second;
+  double realtime;
+  double ratio;
+  bool exact;
+};
+
+static Result run(const std::string &name, const std::vector<int16_t> &pcm, const AudioFormat &format,
+                  const char *out_path) {
+  std::vector<uint8_t> file(FLAC_HEADER_SIZE);
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(pcm.data());
+  size_t length = pcm.size() * 2;
+
+  auto start = std::chrono::steady_clock::now();
+  encoder.begin(format);
+  for (size_t offset = 0; offset < length; offset += CAPTURE_BLOCK_SIZE) {
+    size_t block = std::min(CAPTURE_BLOCK_SIZE, length - offset);
+    for (size_t done = 0; done < block;) {
+      done += encoder.add(bytes + offset + done, block - done);
+      if (encoder.is_frame_ready()) {
+        size_t size = encoder.encode_frame();
+        file.insert(file.end(), encoder.get_frame(), encoder.get_frame() + size);
+      }
+    }
+  }
+  if (encoder.has_samples()) {
+    size_t size = encoder.encode_frame();
+    file.insert(file.end(), encoder.get_frame(), encoder.get_frame() + size);
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  FlacStreamInfo info{};
+  info.total_samples = encoder.get_total_samples();
+  info.min_frame_size = encoder.get_min_frame_size();
+  info.max_frame_size = encoder.get_max_frame_size();
+  esphome::medallion_voice::build_flac_header(file.data(), format, info);
+
+  if (out_path != nullptr) {
+    FILE *f = fopen(out_path, "wb");
+    if (f != nullptr) {
+      fwrite(file.data(), 1, file.size(), f);
+      fclose(f);
+    }
+  }
+
+  Decoded decoded = decode(file);
+  bool exact = decoded.error.empty() && decoded.pcm == pcm && decoded.sample_rate == format.sample_rate;
+  size_t frames = pcm.size() / format.channels;
+  Result result;
+  result.samples_per_second = elapsed > 0 ? frames / elapsed : 0;
+  result.realtime = result.samples_per_second / format.sample_rate;
+  result.ratio = (double) file.size() / (length + 44);
+  result.exact = exact;
+  printf("%-10s %9.2f s %12.0f %10.0fx %7.1f%% %8s\n", name.c_str(), (double) frames / format.sample_rate,
+         result.samples_per_second, result.realtime, 100.0 * result.ratio, exact ? "exact" : "MISMATCH");
+  if (!exact) {
+    if (!decoded.error.empty()) {
+      printf("  decode error: %s\n", decoded.error.c_str());
+    } else {
+      size_t i = 0;
+      while (i < pcm.size() && i < decoded.pcm.size() && pcm[i] == decoded.pcm[i]) i++;
+      printf("  first difference at sample %zu (%zu decoded, %zu expected)\n", i, decoded.pcm.size(), pcm.size());
+    }
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  double seconds = 10.0;
+  double min_realtime = 0.0;
+  const char *wav_path = nullptr;
+  const char *out_path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--seconds" && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (arg == "--quick") {
+      seconds = 1.0;
+    } else if (arg == "--min-realtime" && i + 1 < argc) {
+      min_realtime = atof(argv[++i]);
+    } else if (arg == "--wav" && i + 1 < argc) {
+      wav_path = argv[++i];
+    } else if (arg == "--out" && i + 1 < argc) {
+      out_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--seconds S | --quick] [--wav in.wav [--out out.flac]] [--min-realtime X]\n"
+              "  --seconds       length of each test signal (default 10)\n"
+              "  --quick         1 s signals, for the decode check in ctest\n"
+              "  --wav           also encode this 16-bit WAV file\n"
+              "  --out           write the WAV file's FLAC here\n"
+              "  --min-realtime  fail if any signal encodes slower than X times real time\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  AudioFormat format = {16000, 2, 16};
+  printf("%-10s %11s %12s %11s %8s %8s\n", "signal", "audio", "samples/s", "real time", "size", "decode");
+  bool failed = false;
+  for (const char *name : {"silence", "tone", "speech", "noise"}) {
+    Result r = run(name, make_signal(name, format.sample_rate, seconds), format, nullptr);
+    failed |= !r.exact || (min_realtime > 0 && r.realtime < min_realtime);
+  }
+  if (wav_path != nullptr) {
+    std::vector<int16_t> pcm;
+    AudioFormat wav_format{};
+    if (!read_wav(wav_path, pcm, wav_format)) {
+      fprintf(stderr, "%s: not a 16-bit mono or stereo WAV file\n", wav_path);
+      return 2;
+    }
+    Result r = run(wav_path, pcm, wav_format, out_path);
+    failed |= !r.exact || (min_realtime > 0 && r.realtime < min_realtime);
+  }
+  printf("size is the FLAC file against the 44-byte-header WAV file\n");
+  return failed ? 1 : 0;
+}
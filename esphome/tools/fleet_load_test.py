@@ -0,0 +1,496 @@
+#!/usr/bin/env python3
+"""Fleet upload load test for the Medallion upload path.
+
+Simulates many devices uploading recordings concurrently to one endpoint and
+reports aggregate throughput, latency percentiles and failure breakdown.
+Each simulated device sends byte-for-byte the request produced by
+MedallionVoiceComponent::upload_recording() (same headers, multipart framing
+and 4 KiB body writes) over a persistent connection and judges success the
+same way, so keep FirmwareUploader in sync with the firmware when the upload
+code changes. Every upload carries the audio digest with
+"Expect: 100-continue"; --repeat-rate re-sends earlier recordings to measure
+how cheaply the server turns duplicates away.
+
+Against a local stand-in with injected faults:
+
+    python3 fleet_load_test.py --spawn-server --devices 40 --files 5 \\
+        --seconds 30 --latency-ms 150 --reset-rate 0.02
+
+Against a real server:
+
+    python3 fleet_load_test.py --url http://192.168.1.119:8000/upload
+
+HTTPS works the same way (https:// URL, or --tls-self-signed for the
+stand-in). Like the firmware, each device caches its TLS session and offers
+it on every reconnect; the summary shows full vs. resumed handshake times.
+
+Exit status is non-zero when --min-throughput-kbps or --max-p99-ms is given
+and not met, so the tool can gate upload performance regressions.
+
+The Python client above is a mirror and can drift from the firmware. With
+--host-client, the load comes from the firmware's own HttpUploadClient and
+ResumableUploader instead, built for the host (host/bench/fleet_load.cpp),
+against the stand-in and its faults:
+
+    python3 fleet_load_test.py --host-client ../host/build/fleet_load \
+        --devices 40 --files 5 --reset-rate 0.02 --resumable
+
+The host build has no TLS, so HTTPS runs stay on the Python client.
+"""
+
+import argparse
+import json
+import random
+import select
+import socket
+import ssl
+import subprocess
+import sys
+import threading
+import time
+from collections import Counter
+from urllib.parse import urlsplit
+
+import upload_server
+
+BOUNDARY = "----ESPHomeMedallion"
+WRITE_SIZE = 4096  # matches the firmware's upload buffer (MULTIPART_IO_SIZE)
+SOCKET_TIMEOUT = 10.0  # matches client.setTimeout(10000)
+EXPECT_CONTINUE_TIMEOUT = 1.0  # matches EXPECT_CONTINUE_TIMEOUT_MS
+WAV_BYTE_RATE = 16000 * 2 * 2  # 16 kHz, stereo, 16-bit
+
+
+def make_wav(size):
+    """Synthetic recording: valid 44-byte header plus a ramp payload."""
+    data_len = max(size - 44, 0)
+    header = bytearray(b"RIFF")
+    header += (36 + data_len).to_bytes(4, "little") + b"WAVEfmt "
+    header += (16).to_bytes(4, "little") + (1).to_bytes(2, "little") + (2).to_bytes(2, "little")
+    header += (16000).to_bytes(4, "little") + WAV_BYTE_RATE.to_bytes(4, "little")
+    header += (4).to_bytes(2, "little") + (16).to_bytes(2, "little")
+    header += b"data" + data_len.to_bytes(4, "little")
+    payload = bytes(i & 0xFF for i in range(256)) * (data_len // 256 + 1)
+    return bytes(header) + payload[:data_len]
+
+
+def stamp_wav(wav, device_id, n):
+    """Make each recording's audio (and so its digest) unique."""
+    stamp = device_id.to_bytes(4, "little") + n.to_bytes(4, "little")
+    return wav[:44] + stamp + wav[44 + len(stamp) :]
+
+
+class FirmwareUploader:
+    """One device's upload client, mirroring MedallionVoiceComponent.
+
+    Like the firmware's HttpUploadClient it keeps a persistent HTTP/1.1
+    connection, parses complete responses (Content-Length, chunked or
+    close-delimited bodies) and retries once on a fresh connection when a
+    reused one fails before any response arrives. With a TLS context it
+    resumes the previous TLS session on reconnect, as TlsSession does.
+    """
+
+    def __init__(self, host, port, path, tls=None):
+        self.host = host
+        self.port = port
+        self.path = path
+        self.tls = tls
+        self.tls_session = None
+        self.sock = None
+        self.reader = None
+        self.connects = 0
+        self.handshakes_full = []
+        self.handshakes_resumed = []
+
+    def close(self):
+        if self.sock is not None:
+            self.sock.close()
+        self.sock = None
+        self.reader = None
+
+    def connect(self):
+        if self.sock is not None:
+            return True
+        try:
+            self.sock = socket.create_connection((self.host, self.port), timeout=SOCKET_TIMEOUT)
+        except OSError:
+            return False
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        if self.tls is not None and not self._handshake():
+            return False
+        self.reader = self.sock.makefile("rb")
+        self.connects += 1
+        return True
+
+    def _handshake(self):
+        started = time.monotonic()
+        try:
+            self.sock = self.tls.wrap_socket(self.sock, server_hostname=self.host, session=self.tls_session)
+        except (ssl.SSLError, OSError):
+            # A rejected session must not be offered again
+            self.tls_session = None
+            self.close()
+            return False
+        elapsed = time.monotonic() - started
+        if self.sock.session_reused:
+            self.handshakes_resumed.append(elapsed)
+        else:
+            self.handshakes_full.append(elapsed)
+        self.tls_session = self.sock.session
+        return True
+
+    def upload(self, filename, wav):
+        """Returns (outcome, bytes_sent, latency_seconds)."""
+        started = time.monotonic()
+        for _ in range(2):
+            reused = self.sock is not None
+            if not self.connect():
+                return "connect_fail", 0, time.monotonic() - started
+            try:
+                early = self._send(filename, wav)
+                if early is None:
+                    sent = len(wav)
+                    status, keep_alive = self._read_response()
+                else:
+                    # Answered before the body, so the connection is spent
+                    sent = 0
+                    status, keep_alive = early
+            except (OSError, ValueError, EOFError) as err:
+                self.close()
+                if reused:
+                    continue
+                return self._classify(err), 0, time.monotonic() - started
+            if not keep_alive:
+                self.close()
+            latency = time.monotonic() - started
+            if 200 <= status < 300:
+                return ("ok" if early is None else "duplicate"), sent, latency
+            return f"http_{status}", sent, latency
+        return "no_response", 0, time.monotonic() - started
+
+    @staticmethod
+    def _classify(err):
+        if isinstance(err, socket.timeout):
+            return "timeout"
+        if isinstance(err, ConnectionResetError):
+            return "reset"
+        if isinstance(err, ValueError):
+            return "bad_response"
+        if isinstance(err, EOFError):
+            return "no_response"
+        return "io_error"
+
+    def _send(self, filename, wav):
+        """Send the request; returns (status, keep_alive) if the server
+        answered before the body, else None once the body is sent."""
+        head = (
+            f"--{BOUNDARY}\r\n"
+            f'Content-Disposition: form-data; name="file"; filename="{filename}"\r\n'
+            "Content-Type: audio/wav\r\n\r\n"
+        ).encode()
+        tail = f"\r\n--{BOUNDARY}--\r\n".encode()
+        total_length = len(head) + len(wav) + len(tail)
+
+        self.sock.sendall(f"POST {self.path} HTTP/1.1\r\nHost: {self.host}\r\n".encode())
+        self.sock.sendall(
+            f"Content-Type: multipart/form-data; boundary={BOUNDARY}\r\n"
+            f"{upload_server.DIGEST_HEADER}: {upload_server.audio_digest(wav)}\r\n"
+            "Expect: 100-continue\r\n".encode()
+        )
+        self.sock.sendall(f"Content-Length: {total_length}\r\n\r\n".encode())
+        early = self._await_continue()
+        if early is not None:
+            self.close()
+            return early
+        self.sock.sendall(head)
+        for offset in range(0, len(wav), WRITE_SIZE):
+            self.sock.sendall(wav[offset : offset + WRITE_SIZE])
+        self.sock.sendall(tail)
+        return None
+
+    def _await_continue(self):
+        deadline = time.monotonic() + EXPECT_CONTINUE_TIMEOUT
+        while True:
+            pending = isinstance(self.sock, ssl.SSLSocket) and self.sock.pending()
+            if not pending:
+                readable, _, _ = select.select([self.sock], [], [], max(0.0, deadline - time.monotonic()))
+                if not readable:
+                    # Server ignores Expect; send the body anyway
+                    return None
+            status_line, status, headers = self._read_head()
+            if status == 100:
+                return None
+            if status > 100 and status < 200:
+                continue
+            self._read_body(status_line, status, headers)
+            return status, False
+
+    def _readline(self):
+        line = self.reader.readline(8192)
+        if not line:
+            raise EOFError("connection closed")
+        if not line.endswith(b"\n"):
+            raise ValueError("truncated line")
+        return line.rstrip(b"\r\n")
+
+    def _read_head(self):
+        status_line = self._readline()
+        if not status_line.startswith(b"HTTP/1.") or len(status_line) < 12:
+            raise ValueError("malformed status line")
+        status = int(status_line[9:12])
+        headers = {}
+        while True:
+            line = self._readline()
+            if not line:
+                break
+            name, _, value = line.partition(b":")
+            headers[name.strip().lower()] = value.strip()
+        return status_line, status, headers
+
+    def _read_response(self):
+        while True:
+            status_line, status, headers = self._read_head()
+            if status >= 200:
+                break
+        return status, self._read_body(status_line, status, headers)
+
+    def _read_body(self, status_line, status, headers):
+        """Consume the body; returns whether the connection stays open."""
+        keep_alive = status_line[7:8] == b"1"
+        connection = headers.get(b"connection", b"").lower()
+        if connection == b"close":
+            keep_alive = False
+        elif connection == b"keep-alive":
+            keep_alive = True
+
+        if status in (204, 304):
+            pass
+        elif headers.get(b"transfer-encoding", b"").lower().endswith(b"chunked"):
+            while True:
+                size = int(self._readline().split(b";")[0], 16)
+                if size == 0:
+                    while self._readline():
+                        pass
+                    break
+                self.reader.read(size)
+                self._readline()
+        elif b"content-length" in headers:
+            self.reader.read(int(headers[b"content-length"]))
+        else:
+            self.reader.read()
+            keep_alive = False
+        return keep_alive
+
+
+class Results:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.outcomes = Counter()
+        self.latencies_ok = []
+        self.bytes_ok = 0
+        self.connects = 0
+        self.handshakes_full = []
+        self.handshakes_resumed = []
+
+    def add_connections(self, uploader):
+        with self.lock:
+            self.connects += uploader.connects
+            self.handshakes_full += uploader.handshakes_full
+            self.handshakes_resumed += uploader.handshakes_resumed
+
+    def add(self, outcome, sent, latency):
+        with self.lock:
+            self.outcomes[outcome] += 1
+            if outcome == "ok":
+                self.latencies_ok.append(latency)
+                self.bytes_ok += sent
+
+
+def percentile(values, pct):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, max(0, int(round(pct / 100.0 * len(ordered) + 0.5)) - 1))
+    return ordered[index]
+
+
+def run_device(device_id, args, target, wav, results, start_barrier):
+    uploader = FirmwareUploader(*target)
+    rng = random.Random(None if args.seed is None else args.seed + device_id)
+    previous = None
+    start_barrier.wait()
+    for n in range(args.files):
+        if previous is not None and rng.random() < args.repeat_rate:
+            # Re-send an earlier recording, as after a lost acknowledgement
+            filename, recording = previous
+        else:
+            filename = f"dev{device_id:03d}_voice_{n + 1:04d}.wav"
+            recording = stamp_wav(wav, device_id, n)
+            previous = (filename, recording)
+        outcome, sent, latency = uploader.upload(filename, recording)
+        results.add(outcome, sent, latency)
+        if args.think_ms > 0:
+            time.sleep(args.think_ms / 1000.0)
+    uploader.close()
+    results.add_connections(uploader)
+
+
+def run_host_client(args, server, target, file_size):
+    """Drive the load from the firmware's client code; returns its exit status."""
+    host, port, path, tls = target
+    if tls is not None:
+        print("The host build has no TLS; run HTTPS without --host-client", file=sys.stderr)
+        return 2
+    command = [
+        args.host_client,
+        "--url", f"http://{host}:{port}{path}",
+        "--devices", str(args.devices),
+        "--files", str(args.files),
+        "--bytes", str(file_size),
+        "--repeat-rate", str(args.repeat_rate),
+    ]
+    if args.resumable:
+        command += ["--resumable", "--chunk-kb", str(args.chunk_kb)]
+    if args.min_throughput_kbps is not None:
+        command += ["--min-throughput-kbps", str(args.min_throughput_kbps)]
+    if args.max_p99_ms is not None:
+        command += ["--max-p99-ms", str(args.max_p99_ms)]
+    status = subprocess.run(command).returncode
+    if server is not None:
+        stats = server.RequestHandlerClass.stats.snapshot()
+        print("  server:     " + ", ".join(f"{k}={v}" for k, v in sorted(stats.items())))
+        server.shutdown()
+    return status
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--url", default=None, help="upload URL (default: spawned stand-in)")
+    parser.add_argument("--spawn-server", action="store_true", help="run upload_server.py in-process")
+    parser.add_argument("--devices", type=int, default=10)
+    parser.add_argument("--files", type=int, default=3, help="uploads per device")
+    size = parser.add_mutually_exclusive_group()
+    size.add_argument("--seconds", type=float, default=10, help="recording length per file")
+    size.add_argument("--bytes", type=int, default=None, help="file size per upload")
+    parser.add_argument("--think-ms", type=float, default=0, help="pause between uploads")
+    parser.add_argument("--repeat-rate", type=float, default=0, help="fraction of uploads re-sending a recording")
+    parser.add_argument("--json", action="store_true", help="print machine-readable summary")
+    parser.add_argument("--min-throughput-kbps", type=float, default=None)
+    parser.add_argument("--max-p99-ms", type=float, default=None)
+    parser.add_argument("--ca-file", default=None, help="verify the HTTPS server against this CA (default: no check)")
+    parser.add_argument("--host-client", default=None, help="run the host build's fleet_load binary as the devices")
+    parser.add_argument("--resumable", action="store_true", help="with --host-client: use the resumable upload")
+    parser.add_argument("--chunk-kb", type=int, default=16, help="with --host-client --resumable: chunk size")
+    upload_server.add_fault_arguments(parser)
+    upload_server.add_tls_arguments(parser)
+    args = parser.parse_args()
+    if args.resumable and args.host_client is None:
+        parser.error("--resumable needs --host-client")
+
+    server = None
+    if args.spawn_server or args.url is None:
+        server = upload_server.make_server(args, "127.0.0.1", 0)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        secure = server.tls is not None
+        target = ("127.0.0.1", server.server_address[1], "/upload")
+    else:
+        parts = urlsplit(args.url)
+        if parts.scheme not in ("http", "https"):
+            parser.error("only http:// and https:// URLs are supported")
+        secure = parts.scheme == "https"
+        target = (parts.hostname, parts.port or (443 if secure else 80), parts.path or "/")
+
+    tls = None
+    if secure:
+        # TLS 1.2 with the firmware's AES cipher suites
+        tls = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+        tls.minimum_version = ssl.TLSVersion.TLSv1_2
+        tls.maximum_version = ssl.TLSVersion.TLSv1_2
+        tls.set_ciphers("ECDHE+AESGCM:ECDHE+AES")
+        if args.ca_file:
+            tls.load_verify_locations(args.ca_file)
+        else:
+            tls.check_hostname = False
+            tls.verify_mode = ssl.CERT_NONE
+    target += (tls,)
+
+    file_size = args.bytes if args.bytes is not None else int(44 + args.seconds * WAV_BYTE_RATE)
+    if args.host_client is not None:
+        sys.exit(run_host_client(args, server, target, file_size))
+    wav = make_wav(file_size)
+    results = Results()
+    barrier = threading.Barrier(args.devices + 1)
+    threads = [
+        threading.Thread(target=run_device, args=(i, args, target, wav, results, barrier), daemon=True)
+        for i in range(args.devices)
+    ]
+    for thread in threads:
+        thread.start()
+    barrier.wait()
+    started = time.monotonic()
+    for thread in threads:
+        thread.join()
+    elapsed = time.monotonic() - started
+
+    total = sum(results.outcomes.values())
+    # Duplicates the server declined before the body count as delivered
+    succeeded = results.outcomes.get("ok", 0) + results.outcomes.get("duplicate", 0)
+    lat_ms = [x * 1000.0 for x in results.latencies_ok]
+    summary = {
+        "devices": args.devices,
+        "uploads": total,
+        "file_bytes": file_size,
+        "elapsed_s": round(elapsed, 3),
+        "succeeded": succeeded,
+        "success_rate": round(succeeded / total, 4) if total else 0.0,
+        "goodput_kbps": round(results.bytes_ok / 1024.0 / elapsed, 1) if elapsed > 0 else 0.0,
+        "latency_ms": {
+            "p50": round(percentile(lat_ms, 50), 1),
+            "p95": round(percentile(lat_ms, 95), 1),
+            "p99": round(percentile(lat_ms, 99), 1),
+            "max": round(max(lat_ms), 1) if lat_ms else 0.0,
+        },
+        "connections": results.connects,
+        "outcomes": dict(sorted(results.outcomes.items())),
+    }
+    if tls is not None:
+        full_ms = [x * 1000.0 for x in results.handshakes_full]
+        resumed_ms = [x * 1000.0 for x in results.handshakes_resumed]
+        summary["tls"] = {
+            "full": len(full_ms),
+            "resumed": len(resumed_ms),
+            "full_p50_ms": round(percentile(full_ms, 50), 1),
+            "resumed_p50_ms": round(percentile(resumed_ms, 50), 1),
+        }
+    if server is not None:
+        summary["server"] = server.RequestHandlerClass.stats.snapshot()
+        server.shutdown()
+
+    if args.json:
+        print(json.dumps(summary, indent=2))
+    else:
+        print(f"{summary['uploads']} uploads of {file_size} bytes from {args.devices} devices in {elapsed:.2f} s")
+        print(f"  succeeded:  {summary['succeeded']} ({summary['success_rate'] * 100:.1f}%)")
+        print(f"  goodput:    {summary['goodput_kbps']} KiB/s")
+        lat = summary["latency_ms"]
+        print(f"  latency ms: p50 {lat['p50']}  p95 {lat['p95']}  p99 {lat['p99']}  max {lat['max']}")
+        print(f"  connections: {summary['connections']}")
+        if tls is not None:
+            t = summary["tls"]
+            print(
+                f"  tls:        {t['full']} full (p50 {t['full_p50_ms']} ms), "
+                f"{t['resumed']} resumed (p50 {t['resumed_p50_ms']} ms)"
+            )
+        print("  outcomes:   " + ", ".join(f"{k}={v}" for k, v in summary["outcomes"].items()))
+
+    failed = False
+    if args.min_throughput_kbps is not None and summary["goodput_kbps"] < args.min_throughput_kbps:
+        print(f"FAIL: goodput below {args.min_throughput_kbps} KiB/s", file=sys.stderr)
+        failed = True
+    if args.max_p99_ms is not None and summary["latency_ms"]["p99"] > args.max_p99_ms:
+        print(f"FAIL: p99 latency above {args.max_p99_ms} ms", file=sys.stderr)
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+"""Receiver for the Medallion live audio stream (`live_stream:`).
+
+Listens for the RTP packets sent by RtpStreamer and reports, per stream
+(SSRC), packet loss, duplicates, reordering, interarrival jitter (RFC 3550)
+and end-to-end latency:
+
+    python3 rtp_receiver.py --port 5004 --wav live.wav
+
+Each packet carries the capture time of its first sample in an RFC 8285
+header extension. Element 1 is UNIX time: with the device clock set by SNTP
+and this host synced by NTP, latency is absolute (capture to arrival,
+including the packet's own duration). Element 2 is time since device boot,
+sent before the clock is set. Only the delay above the lowest one seen can
+be reported then ("relative").
+
+Packets the device dropped before sending still used up their sequence
+numbers, so they count as lost here, like packets lost on the network.
+With --wav the received audio is written out, with silence in place of lost
+packets so the timing is kept.
+
+Exit status is non-zero when --max-loss-pct or --max-p99-ms is given and not
+met, so the tool can gate streaming regressions.
+"""
+
+import argparse
+import json
+import socket
+import struct
+import sys
+import time
+import wave
+
+RTP_VERSION = 2
+PAYLOAD_TYPE = 96
+EXT_PROFILE_ONE_BYTE = 0xBEDE
+EXT_CAPTURE_TIME_UNIX = 1
+EXT_CAPTURE_TIME_BOOT = 2
+
+
+def percentile(values, pct):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, max(0, int(round(pct / 100.0 * len(ordered) + 0.5)) - 1))
+    return ordered[index]
+
+
+def parse_packet(data):
+    """(seq, timestamp, ssrc, marker, capture_id, capture_us, payload) or None."""
+    if len(data) < 12 or data[0] >> 6 != RTP_VERSION:
+        return None
+    has_ext = bool(data[0] & 0x10)
+    csrc_count = data[0] & 0x0F
+    marker = bool(data[1] & 0x80)
+    if data[1] & 0x7F != PAYLOAD_TYPE:
+        return None
+    seq, timestamp, ssrc = struct.unpack_from("!HII", data, 2)
+    offset = 12 + 4 * csrc_count
+    capture_id, capture_us = None, None
+    if has_ext:
+        if len(data) < offset + 4:
+            return None
+        profile, words = struct.unpack_from("!HH", data, offset)
+        ext = data[offset + 4 : offset + 4 + 4 * words]
+        offset += 4 + 4 * words
+        if profile == EXT_PROFILE_ONE_BYTE:
+            i = 0
+            while i < len(ext):
+                if ext[i] == 0:  # padding
+                    i += 1
+                    continue
+                elem_id, elem_len = ext[i] >> 4, (ext[i] & 0x0F) + 1
+                value = ext[i + 1 : i + 1 + elem_len]
+                if elem_id in (EXT_CAPTURE_TIME_UNIX, EXT_CAPTURE_TIME_BOOT) and len(value) == 8:
+                    capture_id, capture_us = elem_id, struct.unpack("!Q", value)[0]
+                i += 1 + elem_len
+    if data[0] & 0x20:  # padding
+        data = data[: len(data) - data[-1]]
+    return seq, timestamp, ssrc, marker, capture_id, capture_us, data[offset:]
+
+
+class StreamStats:
+    """Loss, order, jitter and latency of one SSRC."""
+
+    def __init__(self, ssrc, sample_rate):
+        self.ssrc = ssrc
+        self.sample_rate = sample_rate
+        self.first_seq = None
+        self.highest = None  # extended sequence number
+        self.received = 0
+        self.duplicates = 0
+        self.reordered = 0
+        self.seen = set()
+        self.jitter = 0.0  # in timestamp units
+        self.last_transit = None
+        self.latencies_ms = []  # with UNIX capture times
+        self.boot_delays_us = []  # with boot capture times
+        self.bytes = 0
+
+    def extend(self, seq):
+        """Map a 16-bit sequence number onto the extended sequence."""
+        if self.highest is None:
+            return seq
+        candidate = (self.highest & ~0xFFFF) | seq
+        if candidate - self.highest > 0x8000:
+            candidate -= 0x10000
+        elif self.highest - candidate > 0x8000:
+            candidate += 0x10000
+        return candidate
+
+    def add(self, seq, timestamp, capture_id, capture_us, payload, arrival, arrival_wall):
+        ext = self.extend(seq)
+        if ext in self.seen:
+            self.duplicates += 1
+            return None
+        self.seen.add(ext)
+        if self.first_seq is None:
+            self.first_seq = ext
+        self.received += 1
+        self.bytes += len(payload)
+        if self.highest is None or ext > self.highest:
+            self.highest = ext
+        else:
+            self.reordered += 1
+        if ext < self.first_seq:
+            self.first_seq = ext
+
+        # RFC 3550 A.8 interarrival jitter
+        transit = arrival * self.sample_rate - timestamp
+        if self.last_transit is not None:
+            d = abs(transit - self.last_transit)
+            self.jitter += (d - self.jitter) / 16.0
+        self.last_transit = transit
+
+        if capture_id == EXT_CAPTURE_TIME_UNIX:
+            self.latencies_ms.append((arrival_wall * 1e6 - capture_us) / 1000.0)
+        elif capture_id == EXT_CAPTURE_TIME_BOOT:
+            self.boot_delays_us.append(arrival * 1e6 - capture_us)
+        return ext
+
+    def summary(self):
+        expected = self.highest - self.first_seq + 1 if self.highest is not None else 0
+        lost = max(0, expected - self.received)
+        # The device clock switches to UNIX time once SNTP sets it
+        if self.latencies_ms:
+            kind, latencies = "absolute", self.latencies_ms
+        elif self.boot_delays_us:
+            # Device boot clock: only the delay above the minimum is known
+            base = min(self.boot_delays_us)
+            kind, latencies = "relative", [(d - base) / 1000.0 for d in self.boot_delays_us]
+        else:
+            kind, latencies = "none", []
+        return {
+            "ssrc": f"{self.ssrc:08x}",
+            "received": self.received,
+            "expected": expected,
+            "lost": lost,
+            "loss_pct": round(100.0 * lost / expected, 3) if expected else 0.0,
+            "duplicates": self.duplicates,
+            "reordered": self.reordered,
+            "jitter_ms": round(self.jitter * 1000.0 / self.sample_rate, 2),
+            "latency": kind,
+            "latency_ms": {
+                "p50": round(percentile(latencies, 50), 1),
+                "p95": round(percentile(latencies, 95), 1),
+                "p99": round(percentile(latencies, 99), 1),
+                "max": round(max(latencies), 1) if latencies else 0.0,
+            },
+            "audio_bytes": self.bytes,
+        }
+
+
+class WavSink:
+    """Received audio in sequence order, silence for lost packets."""
+
+    def __init__(self, path, sample_rate, channels):
+        self.wav = wave.open(path, "wb")
+        self.wav.setnchannels(channels)
+        self.wav.setsampwidth(2)
+        self.wav.setframerate(sample_rate)
+        self.pending = {}
+        self.next_seq = None
+        self.packet_bytes = 0
+
+    def add(self, ext_seq, payload):
+        # L16 is big-endian; WAV is little-endian
+        pcm = bytearray(payload)
+        pcm[0::2], pcm[1::2] = payload[1::2], payload[0::2]
+        self.packet_bytes = max(self.packet_bytes, len(pcm))
+        if self.next_seq is None:
+            self.next_seq = ext_seq
+        if ext_seq < self.next_seq:
+            return  # too late, already filled with silence
+        self.pending[ext_seq] = bytes(pcm)
+        # Allow a little reordering before giving up on a packet
+        while self.pending and (self.next_seq in self.pending or len(self.pending) > 8):
+            self.wav.writeframes(self.pending.pop(self.next_seq, b"\0" * self.packet_bytes))
+            self.next_seq += 1
+
+    def close(self):
+        while self.pending:
+            self.wav.writeframes(self.pending.pop(self.next_seq, b"\0" * self.packet_bytes))
+            self.next_seq += 1
+        self.wav.close()
+
+
+def print_summary(streams, elapsed):
+    for s in streams.values():
+        m = s.summary()
+        lat = m["latency_ms"]
+        print(
+            f"[{elapsed:7.1f} s] ssrc {m['ssrc']}: {m['received']}/{m['expected']} packets, "
+            f"lost {m['lost']} ({m['loss_pct']}%), dup {m['duplicates']}, reordered {m['reordered']}, "
+            f"jitter {m['jitter_ms']} ms, {m['latency']} latency ms p50 {lat['p50']} p99 {lat['p99']} "
+            f"max {lat['max']}"
+        )
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=5004)
+    parser.add_argument("--rate", type=int, default=16000, help="sample rate of the stream")
+    parser.add_argument("--channels", type=int, default=2)
+    parser.add_argument("--seconds", type=float, default=0, help="stop after this long (default: Ctrl-C)")
+    parser.add_argument("--interval", type=float, default=5, help="seconds between progress reports")
+    parser.add_argument("--wav", default=None, help="write the received audio of the first stream here")
+    parser.add_argument("--json", action="store_true", help="print the final summary as JSON")
+    parser.add_argument("--max-loss-pct", type=float, default=None, help="fail above this packet loss")
+    parser.add_argument("--max-p99-ms", type=float, default=None, help="fail above this p99 latency")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind((args.host, args.port))
+    sock.settimeout(0.5)
+    print(f"Listening on udp://{args.host}:{args.port}", file=sys.stderr)
+
+    streams = {}
+    sink = None
+    sink_ssrc = None
+    invalid = 0
+    start = time.monotonic()
+    next_report = start + args.interval
+    try:
+        while True:
+            now = time.monotonic()
+            if args.seconds and now - start >= args.seconds:
+                break
+            if now >= next_report:
+                next_report += args.interval
+                print_summary(streams, now - start)
+            try:
+                data, _ = sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            arrival, arrival_wall = time.monotonic(), time.time()
+            packet = parse_packet(data)
+            if packet is None:
+                invalid += 1
+                continue
+            seq, timestamp, ssrc, marker, capture_id, capture_us, payload = packet
+            stream = streams.get(ssrc)
+            if stream is None:
+                stream = streams[ssrc] = StreamStats(ssrc, args.rate)
+                print(f"New stream ssrc {ssrc:08x}{' (start of recording)' if marker else ''}", file=sys.stderr)
+            ext = stream.add(seq, timestamp, capture_id, capture_us, payload, arrival, arrival_wall)
+            if args.wav and ext is not None and sink_ssrc in (None, ssrc):
+                if sink is None:
+                    sink, sink_ssrc = WavSink(args.wav, args.rate, args.channels), ssrc
+                sink.add(ext, payload)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if sink is not None:
+            sink.close()
+
+    elapsed = time.monotonic() - start
+    summary = {"elapsed_s": round(elapsed, 1), "invalid_packets": invalid, "streams": [s.summary() for s in streams.values()]}
+    if args.json:
+        print(json.dumps(summary, indent=2))
+    else:
+        print_summary(streams, elapsed)
+        if invalid:
+            print(f"  {invalid} packets were not Medallion RTP")
+
+    failed = False
+    for m in summary["streams"]:
+        if args.max_loss_pct is not None and m["loss_pct"] > args.max_loss_pct:
+            print(f"FAIL: ssrc {m['ssrc']} lost {m['loss_pct']}% of packets", file=sys.stderr)
+            failed = True
+        if args.max_p99_ms is not None and m["latency_ms"]["p99"] > args.max_p99_ms:
+            print(f"FAIL: ssrc {m['ssrc']} p99 latency above {args.max_p99_ms} ms", file=sys.stderr)
+            failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,504 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Medallion upload server.
+
+Accepts the multipart POST sent by medallion_voice and can inject faults so
+the device (or tools/fleet_load_test.py) can be exercised against slow or
+misbehaving servers:
+
+    python3 upload_server.py --port 8000 --latency-ms 200 --error-rate 0.05
+
+Fault probabilities are evaluated per request, in the order drop, reset,
+partial, error. GET /stats returns the server-side counters as JSON.
+
+It is also the reference implementation of the resumable upload protocol
+used with `resumable_upload: true` (see ResumableUploader):
+
+    GET   <path>/resumable?file=<name>&size=<n>  -> 200, Upload-Offset
+    PATCH <path>/resumable?file=<name>&size=<n>  Upload-Offset, Upload-Checksum
+                                                 -> 204, Upload-Offset
+                                                 -> 409 offset mismatch
+                                                 -> 460 checksum mismatch
+
+Partial uploads are kept on disk, so they survive a server restart. For
+PATCH, drop/reset/partial faults are injected after the chunk is committed
+(a lost acknowledgement) and error faults before it.
+
+Requests may carry X-Audio-SHA256, the SHA-256 of the audio data after
+the 44-byte WAV header, or of the frames after the metadata of a FLAC file. The stand-in rejects uploads that do not match it
+(422) and remembers accepted digests. A POST with "Expect: 100-continue"
+for a known digest is answered 200 before the body is sent, and a
+resumable offset query for one reports the whole file as committed.
+
+With --tls-cert/--tls-key (or --tls-self-signed) it serves HTTPS and counts
+full and resumed TLS handshakes, to check that devices resume sessions:
+
+    python3 upload_server.py --tls-self-signed --port 8443
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import random
+import re
+import socket
+import ssl
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+FILENAME_RE = re.compile(rb'filename="([^"]+)"')
+DIGEST_HEADER = "X-Audio-SHA256"
+WAV_HEADER_SIZE = 44
+
+
+def audio_header_size(data):
+    """Bytes before the audio: the WAV header, or FLAC's metadata blocks."""
+    if not data.startswith(b"fLaC"):
+        return WAV_HEADER_SIZE
+    pos = 4
+    while pos + 4 <= len(data):
+        last = data[pos] & 0x80
+        pos += 4 + int.from_bytes(data[pos + 1 : pos + 4], "big")
+        if last:
+            break
+    return pos
+
+
+def audio_digest(data):
+    return hashlib.sha256(data[audio_header_size(data):]).hexdigest()
+
+
+def parse_multipart(body):
+    """(filename, payload) of a single-file multipart body."""
+    match = FILENAME_RE.search(body[:1024])
+    name = os.path.basename(match.group(1).decode()) if match else "upload.bin"
+    # Strip the multipart framing: payload starts after the first blank line
+    start = body.find(b"\r\n\r\n")
+    end = body.rfind(b"\r\n--")
+    payload = body[start + 4 : end] if start >= 0 and end > start else body
+    return name, payload
+
+
+class DigestIndex:
+    """Digests of recordings the server already has."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.digests = set()
+
+    def add(self, digest):
+        with self.lock:
+            self.digests.add(digest.lower())
+
+    def __contains__(self, digest):
+        with self.lock:
+            return digest.lower() in self.digests
+
+
+class FaultConfig:
+    def __init__(self, args):
+        self.latency_ms = args.latency_ms
+        self.jitter_ms = args.jitter_ms
+        self.drop_rate = args.drop_rate
+        self.reset_rate = args.reset_rate
+        self.partial_rate = args.partial_rate
+        self.error_rate = args.error_rate
+        self.error_code = args.error_code
+        self.read_kbps = args.read_kbps
+        self.store_dir = getattr(args, "store_dir", None)
+        if self.store_dir:
+            self.partial_dir = os.path.join(self.store_dir, ".partial")
+            os.makedirs(self.partial_dir, exist_ok=True)
+        else:
+            self.partial_dir = tempfile.mkdtemp(prefix="medallion-partial-")
+        self.rng = random.Random(args.seed)
+        self.lock = threading.Lock()
+
+    def roll(self, rate):
+        if rate <= 0:
+            return False
+        with self.lock:
+            return self.rng.random() < rate
+
+    def delay(self):
+        if self.latency_ms <= 0 and self.jitter_ms <= 0:
+            return
+        with self.lock:
+            jitter = self.rng.uniform(0, self.jitter_ms)
+        time.sleep((self.latency_ms + jitter) / 1000.0)
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.counters = {
+            "requests": 0,
+            "ok": 0,
+            "dropped": 0,
+            "reset": 0,
+            "partial": 0,
+            "error": 0,
+            "bytes_received": 0,
+            "chunks": 0,
+            "offset_conflicts": 0,
+            "checksum_failures": 0,
+            "completed": 0,
+            "duplicates": 0,
+            "digest_mismatch": 0,
+            "tls_handshakes": 0,
+            "tls_resumed": 0,
+            "tls_failed": 0,
+        }
+
+    def add(self, key, value=1):
+        with self.lock:
+            self.counters[key] += value
+
+    def snapshot(self):
+        with self.lock:
+            return dict(self.counters)
+
+
+class UploadHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "MedallionUploadStandIn/1.0"
+
+    # Set by make_server()
+    faults = None
+    stats = None
+    index = None
+
+    def log_message(self, fmt, *args):
+        if self.server.verbose:
+            super().log_message(fmt, *args)
+
+    def setup(self):
+        # Handshake here rather than in accept() so one slow client cannot
+        # stall the listener
+        self.tls_ok = True
+        if isinstance(self.request, ssl.SSLSocket):
+            try:
+                self.request.do_handshake()
+            except (ssl.SSLError, OSError):
+                self.stats.add("tls_failed")
+                self.tls_ok = False
+            else:
+                self.stats.add("tls_handshakes")
+                if self.request.session_reused:
+                    self.stats.add("tls_resumed")
+        super().setup()
+
+    def handle(self):
+        if self.tls_ok:
+            super().handle()
+
+    def do_GET(self):
+        resumable = self.resumable_target()
+        if resumable is not None:
+            self.handle_offset_query(*resumable)
+            return
+        if self.path.rstrip("/") != "/stats":
+            self.send_simple(404, b"not found\n")
+            return
+        body = json.dumps(self.stats.snapshot()).encode() + b"\n"
+        self.send_simple(200, body, "application/json")
+
+    def do_POST(self):
+        self.stats.add("requests")
+        length = int(self.headers.get("Content-Length", "0"))
+        body = self.read_body(length)
+        if body is None:
+            return
+        self.stats.add("bytes_received", len(body))
+
+        self.faults.delay()
+
+        if self.inject_connection_fault():
+            return
+        if self.faults.roll(self.faults.error_rate):
+            self.stats.add("error")
+            self.send_simple(self.faults.error_code, b"injected error\n")
+            return
+
+        name, payload = parse_multipart(body)
+        digest = self.headers.get(DIGEST_HEADER)
+        if digest is not None:
+            if audio_digest(payload) != digest.lower():
+                self.stats.add("digest_mismatch")
+                self.send_simple(422, b"digest mismatch\n")
+                return
+            self.index.add(digest)
+        self.store(name, payload)
+        self.stats.add("ok")
+        self.send_simple(201, b'{"status":"ok"}\n', "application/json")
+
+    def handle_expect_100(self):
+        # Decline the body of a recording the server already has
+        digest = self.headers.get(DIGEST_HEADER)
+        if self.command == "POST" and digest is not None and digest in self.index:
+            self.stats.add("requests")
+            self.stats.add("duplicates")
+            self.close_connection = True
+            self.send_simple(200, b'{"status":"duplicate"}\n', "application/json")
+            return False
+        return super().handle_expect_100()
+
+    def resumable_target(self):
+        """(name, size) for <path>/resumable?file=..&size=.. requests, else None."""
+        parts = urlsplit(self.path)
+        if not parts.path.rstrip("/").endswith("/resumable"):
+            return None
+        query = parse_qs(parts.query)
+        try:
+            name = os.path.basename(query["file"][0])
+            size = int(query["size"][0])
+        except (KeyError, ValueError, IndexError):
+            return None
+        if not name or size < 0:
+            return None
+        return name, size
+
+    def partial_path(self, name, size):
+        return os.path.join(self.faults.partial_dir, f"{name}.{size}.part")
+
+    def committed(self, name, size):
+        path = self.partial_path(name, size)
+        if os.path.exists(path):
+            return os.path.getsize(path)
+        if self.faults.store_dir and os.path.exists(os.path.join(self.faults.store_dir, name)):
+            if os.path.getsize(os.path.join(self.faults.store_dir, name)) == size:
+                return size
+        return 0
+
+    def send_offset(self, code, offset):
+        self.send_response(code)
+        self.send_header("Upload-Offset", str(offset))
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def handle_offset_query(self, name, size):
+        self.stats.add("requests")
+        self.faults.delay()
+        digest = self.headers.get(DIGEST_HEADER)
+        if digest is not None and digest in self.index:
+            self.stats.add("duplicates")
+            self.send_offset(200, size)
+            return
+        self.send_offset(200, self.committed(name, size))
+
+    def do_PATCH(self):
+        resumable = self.resumable_target()
+        if resumable is None:
+            self.send_simple(404, b"not found\n")
+            return
+        name, size = resumable
+        self.stats.add("requests")
+        length = int(self.headers.get("Content-Length", "0"))
+        body = self.read_body(length)
+        if body is None:
+            return
+        self.stats.add("bytes_received", len(body))
+        self.faults.delay()
+
+        if self.faults.roll(self.faults.error_rate):
+            self.stats.add("error")
+            self.send_simple(self.faults.error_code, b"injected error\n")
+            return
+
+        committed = self.committed(name, size)
+        try:
+            offset = int(self.headers.get("Upload-Offset", ""))
+        except ValueError:
+            self.send_simple(400, b"missing Upload-Offset\n")
+            return
+        if offset != committed or offset + len(body) > size:
+            self.stats.add("offset_conflicts")
+            self.send_offset(409, committed)
+            return
+
+        algorithm, _, digest = self.headers.get("Upload-Checksum", "").partition(" ")
+        if algorithm.lower() != "crc32" or digest.lower() != f"{zlib.crc32(body):08x}":
+            self.stats.add("checksum_failures")
+            self.send_offset(460, committed)
+            return
+
+        partial = self.partial_path(name, size)
+        with open(partial, "ab") as f:
+            f.write(body)
+        committed += len(body)
+        self.stats.add("chunks")
+        if committed == size:
+            digest = self.headers.get(DIGEST_HEADER)
+            if digest is not None:
+                with open(partial, "rb") as f:
+                    if audio_digest(f.read()) != digest.lower():
+                        self.stats.add("digest_mismatch")
+                        os.remove(partial)
+                        self.send_simple(422, b"digest mismatch\n")
+                        return
+                self.index.add(digest)
+            self.stats.add("completed")
+            # Without --store-dir the complete file stays in the partial
+            # directory, which still answers offset queries with its size
+            if self.faults.store_dir:
+                os.replace(partial, os.path.join(self.faults.store_dir, name))
+
+        if self.inject_connection_fault():
+            return
+        self.stats.add("ok")
+        self.send_offset(204, committed)
+
+    def inject_connection_fault(self):
+        """Drop, reset or truncate the response; True if one was injected."""
+        if self.faults.roll(self.faults.drop_rate):
+            # Close without any response
+            self.stats.add("dropped")
+            self.close_connection = True
+            return True
+        if self.faults.roll(self.faults.reset_rate):
+            # SO_LINGER with zero timeout turns close() into a TCP RST
+            self.stats.add("reset")
+            self.connection.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+            self.close_connection = True
+            return True
+        if self.faults.roll(self.faults.partial_rate):
+            # Truncated status line, then close
+            self.stats.add("partial")
+            self.wfile.write(b"HTTP/1.1 2")
+            self.wfile.flush()
+            self.close_connection = True
+            return True
+        return False
+
+    def read_body(self, length):
+        remaining = length
+        chunks = []
+        chunk_size = 4096
+        started = time.monotonic()
+        while remaining > 0:
+            data = self.rfile.read(min(chunk_size, remaining))
+            if not data:
+                return None
+            chunks.append(data)
+            remaining -= len(data)
+            if self.faults.read_kbps > 0:
+                # Throttle to emulate a slow server draining its socket
+                received = length - remaining
+                target = received / (self.faults.read_kbps * 1024.0)
+                sleep = target - (time.monotonic() - started)
+                if sleep > 0:
+                    time.sleep(sleep)
+        return b"".join(chunks)
+
+    def store(self, name, payload):
+        if not self.faults.store_dir:
+            return
+        with open(os.path.join(self.faults.store_dir, name), "wb") as f:
+            f.write(payload)
+
+    def send_simple(self, code, body, content_type="text/plain"):
+        self.send_response(code)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+
+def add_fault_arguments(parser):
+    group = parser.add_argument_group("fault injection")
+    group.add_argument("--latency-ms", type=float, default=0, help="fixed delay before responding")
+    group.add_argument("--jitter-ms", type=float, default=0, help="uniform random extra delay")
+    group.add_argument("--drop-rate", type=float, default=0, help="close without response")
+    group.add_argument("--reset-rate", type=float, default=0, help="abort with TCP RST")
+    group.add_argument("--partial-rate", type=float, default=0, help="send truncated status line")
+    group.add_argument("--error-rate", type=float, default=0, help="respond with --error-code")
+    group.add_argument("--error-code", type=int, default=503)
+    group.add_argument("--read-kbps", type=float, default=0, help="throttle request body reads")
+    group.add_argument("--seed", type=int, default=None, help="seed for reproducible faults")
+
+
+def add_tls_arguments(parser):
+    group = parser.add_argument_group("TLS")
+    group.add_argument("--tls-cert", default=None, help="serve HTTPS with this PEM certificate")
+    group.add_argument("--tls-key", default=None, help="PEM private key (default: read from --tls-cert)")
+    group.add_argument(
+        "--tls-self-signed", action="store_true", help="serve HTTPS with a throwaway certificate (needs openssl)"
+    )
+
+
+def generate_self_signed():
+    """Create a P-256 certificate for localhost; returns (cert, key) paths."""
+    directory = tempfile.mkdtemp(prefix="medallion-tls-")
+    cert = os.path.join(directory, "cert.pem")
+    key = os.path.join(directory, "key.pem")
+    subprocess.run(
+        ["openssl", "req", "-x509", "-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:prime256v1", "-nodes",
+         "-keyout", key, "-out", cert, "-days", "30", "-subj", "/CN=localhost",
+         "-addext", "subjectAltName=DNS:localhost,IP:127.0.0.1"],
+        check=True,
+        capture_output=True,
+    )
+    return cert, key
+
+
+def make_tls_context(args):
+    """Server SSLContext for the TLS arguments, or None for plain HTTP."""
+    cert = getattr(args, "tls_cert", None)
+    key = getattr(args, "tls_key", None)
+    if cert is None and getattr(args, "tls_self_signed", False):
+        cert, key = generate_self_signed()
+        args.tls_cert = cert
+    if cert is None:
+        return None
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(cert, key)
+    return context
+
+
+def make_server(args, host, port):
+    handler = type(
+        "Handler", (UploadHandler,), {"faults": FaultConfig(args), "stats": Stats(), "index": DigestIndex()}
+    )
+    server = ThreadingHTTPServer((host, port), handler)
+    server.daemon_threads = True
+    server.verbose = getattr(args, "verbose", False)
+    server.tls = make_tls_context(args)
+    if server.tls is not None:
+        server.socket = server.tls.wrap_socket(server.socket, server_side=True, do_handshake_on_connect=False)
+    return server
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--store-dir", default=None, help="save received files here")
+    parser.add_argument("--verbose", action="store_true")
+    add_fault_arguments(parser)
+    add_tls_arguments(parser)
+    args = parser.parse_args()
+
+    if args.store_dir:
+        os.makedirs(args.store_dir, exist_ok=True)
+
+    server = make_server(args, args.host, args.port)
+    scheme = "https" if server.tls is not None else "http"
+    print(f"Upload stand-in listening on {scheme}://{args.host}:{args.port}", file=sys.stderr)
+    if server.tls is not None:
+        print(f"Server certificate: {args.tls_cert}", file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(json.dumps(server.RequestHandlerClass.stats.snapshot()), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()